@@ -2,7 +2,10 @@
 
 #include <boost/format.hpp>
 #include <boost/thread/recursive_mutex.hpp>
-#include <cuda_runtime_api.h>
+#include <cuv/tools/cuda_compat.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <new>
 #include <sstream>
 #include <stdexcept>
 #include <limits>
@@ -418,6 +421,434 @@ void nan_pooled_cuda_allocator::alloc(void** ptr, size_t memsize, size_t valueSi
     }
 }
 
+
+namespace detail {
+
+/// log2(MIN_BLOCK_SIZE)
+static const unsigned int MIN_CLASS_SHIFT = 6;
+/// number of cached size classes, MIN_BLOCK_SIZE ... MAX_BLOCK_SIZE
+static const unsigned int N_SIZE_CLASSES = 23;
+/// size class of blocks that are too large to be cached
+static const unsigned int LARGE_CLASS = N_SIZE_CLASSES;
+static const unsigned int BLOCK_MAGIC = 0xcafe64;
+
+/**
+ * bookkeeping in front of every host block.
+ *
+ * Occupies the first ALIGNMENT bytes of the system allocation, the user
+ * pointer starts directly behind it and is therefore aligned as well.
+ */
+struct block_header {
+    unsigned int size_class;
+    unsigned int magic;
+    size_t capacity;        ///< usable bytes behind the header
+    block_header* next;     ///< free list link while the block is cached
+};
+
+static inline void* user_ptr(block_header* b) {
+    return reinterpret_cast<char*>(b) + thread_caching_allocator::ALIGNMENT;
+}
+
+static inline block_header* header_of(void* p) {
+    return reinterpret_cast<block_header*>(static_cast<char*>(p) - thread_caching_allocator::ALIGNMENT);
+}
+
+/// smallest size class whose blocks hold the given number of bytes
+static inline unsigned int size_class_of(size_t bytes) {
+    if (bytes <= thread_caching_allocator::MIN_BLOCK_SIZE)
+        return 0;
+    if (bytes > thread_caching_allocator::MAX_BLOCK_SIZE)
+        return LARGE_CLASS;
+    // ceil(log2(bytes)) - log2(MIN_BLOCK_SIZE)
+    unsigned int log2 = sizeof(unsigned long) * 8 - __builtin_clzl((unsigned long) (bytes - 1));
+    return log2 - MIN_CLASS_SHIFT;
+}
+
+static inline size_t class_capacity(unsigned int c) {
+    return thread_caching_allocator::MIN_BLOCK_SIZE << c;
+}
+
+/**
+ * state shared by all threads using one thread_caching_allocator.
+ *
+ * Owned jointly by the allocator and all thread caches, since threads may
+ * return their caches after the allocator has been destroyed.
+ */
+struct caching_pool {
+    /// per-class lock-free stacks of free blocks
+    block_header* volatile central[N_SIZE_CLASSES];
+
+    // statistics, modified atomically
+    size_t bytes_in_use;
+    size_t bytes_in_use_peak;
+    size_t bytes_reserved;
+    size_t thread_cache_hits;
+    size_t central_hits;
+    size_t misses;
+
+    const size_t thread_cache_bytes;
+
+    explicit caching_pool(size_t _thread_cache_bytes) :
+            bytes_in_use(0), bytes_in_use_peak(0), bytes_reserved(0),
+            thread_cache_hits(0), central_hits(0), misses(0),
+            thread_cache_bytes(_thread_cache_bytes) {
+        std::fill(central, central + N_SIZE_CLASSES, (block_header*) 0);
+    }
+
+    ~caching_pool() {
+        release_central();
+    }
+
+    block_header* allocate_block(unsigned int c, size_t bytes) {
+        size_t capacity = c == LARGE_CLASS
+                ? (bytes + thread_caching_allocator::ALIGNMENT - 1) / thread_caching_allocator::ALIGNMENT * thread_caching_allocator::ALIGNMENT
+                : class_capacity(c);
+        void* raw = 0;
+        if (posix_memalign(&raw, thread_caching_allocator::ALIGNMENT, capacity + thread_caching_allocator::ALIGNMENT) != 0)
+            throw std::bad_alloc();
+        block_header* b = static_cast<block_header*>(raw);
+        b->size_class = c;
+        b->magic = BLOCK_MAGIC;
+        b->capacity = capacity;
+        b->next = 0;
+        __sync_fetch_and_add(&bytes_reserved, capacity);
+        __sync_fetch_and_add(&misses, (size_t) 1);
+        return b;
+    }
+
+    void free_block(block_header* b) {
+        __sync_fetch_and_sub(&bytes_reserved, b->capacity);
+        free(b);
+    }
+
+    /// lock-free push of a single block or a linked list of blocks onto a shared free list
+    void push_central(unsigned int c, block_header* first, block_header* last) {
+        block_header* old;
+        do {
+            old = central[c];
+            last->next = old;
+        } while (!__sync_bool_compare_and_swap(&central[c], old, first));
+    }
+
+    /// take all blocks of a shared free list. Since blocks are never popped
+    /// one at a time, this does not suffer from the ABA problem.
+    block_header* take_central(unsigned int c) {
+        if (!central[c])
+            return 0;
+        return __sync_lock_test_and_set(&central[c], (block_header*) 0);
+    }
+
+    void release_central() {
+        for (unsigned int c = 0; c < N_SIZE_CLASSES; c++) {
+            block_header* b = take_central(c);
+            while (b) {
+                block_header* next = b->next;
+                free_block(b);
+                b = next;
+            }
+        }
+    }
+
+    void account_alloc(size_t capacity) {
+        size_t now = __sync_add_and_fetch(&bytes_in_use, capacity);
+        size_t peak = bytes_in_use_peak;
+        while (now > peak && !__sync_bool_compare_and_swap(&bytes_in_use_peak, peak, now))
+            peak = bytes_in_use_peak;
+    }
+
+    void account_dealloc(size_t capacity) {
+        __sync_fetch_and_sub(&bytes_in_use, capacity);
+    }
+};
+
+/**
+ * free blocks owned by a single thread, accessed without synchronization.
+ */
+struct thread_cache {
+    boost::shared_ptr<caching_pool> pool;
+    block_header* free_list[N_SIZE_CLASSES];
+    size_t bytes;
+
+    explicit thread_cache(const boost::shared_ptr<caching_pool>& _pool) :
+            pool(_pool), bytes(0) {
+        std::fill(free_list, free_list + N_SIZE_CLASSES, (block_header*) 0);
+    }
+
+    ~thread_cache() {
+        flush();
+    }
+
+    block_header* pop(unsigned int c) {
+        block_header* b = free_list[c];
+        if (b) {
+            free_list[c] = b->next;
+            bytes -= b->capacity;
+            __sync_fetch_and_add(&pool->thread_cache_hits, (size_t) 1);
+            return b;
+        }
+        b = pool->take_central(c);
+        if (b) {
+            // keep the rest of the shared list for subsequent requests
+            free_list[c] = b->next;
+            for (block_header* r = b->next; r; r = r->next)
+                bytes += r->capacity;
+            __sync_fetch_and_add(&pool->central_hits, (size_t) 1);
+            return b;
+        }
+        return 0;
+    }
+
+    void push(block_header* b) {
+        unsigned int c = b->size_class;
+        if (bytes + b->capacity <= pool->thread_cache_bytes) {
+            b->next = free_list[c];
+            free_list[c] = b;
+            bytes += b->capacity;
+        } else {
+            pool->push_central(c, b, b);
+        }
+    }
+
+    /// hand all cached blocks to the shared free lists
+    void flush() {
+        for (unsigned int c = 0; c < N_SIZE_CLASSES; c++) {
+            block_header* first = free_list[c];
+            if (!first)
+                continue;
+            block_header* last = first;
+            while (last->next)
+                last = last->next;
+            pool->push_central(c, first, last);
+            free_list[c] = 0;
+        }
+        bytes = 0;
+    }
+};
+
+}
+
+const size_t thread_caching_allocator::ALIGNMENT;
+const size_t thread_caching_allocator::MIN_BLOCK_SIZE;
+const size_t thread_caching_allocator::MAX_BLOCK_SIZE;
+
+thread_caching_allocator::thread_caching_allocator(const std::string& _name, size_t thread_cache_bytes) :
+        m_name(_name),
+                m_pool(new detail::caching_pool(thread_cache_bytes)),
+                m_cache(),
+                m_dev_alloc(_name) {
+    if (m_name.empty()) {
+        std::ostringstream o;
+        o << this;
+        m_name = o.str();
+    }
+}
+
+thread_caching_allocator::~thread_caching_allocator() {
+    // return this thread's blocks now, other threads return theirs on exit
+    m_cache.reset();
+#ifndef NDEBUG
+    if (m_pool->bytes_in_use != 0) {
+        throw std::runtime_error(
+                (boost::format("detected potential memory leak in thread caching allocator '%s': %d bytes in use")
+                        % m_name % m_pool->bytes_in_use).str());
+    }
+#endif
+    CUV_LOG_DEBUG("deleted thread caching allocator " << m_name);
+}
+
+detail::thread_cache& thread_caching_allocator::local_cache() {
+    detail::thread_cache* cache = m_cache.get();
+    if (!cache || cache->pool != m_pool) {
+        // no cache yet, or a stale one left by a destroyed allocator at the same address
+        cache = new detail::thread_cache(m_pool);
+        m_cache.reset(cache);
+    }
+    return *cache;
+}
+
+void thread_caching_allocator::garbage_collection() {
+    local_cache().flush();
+    m_pool->release_central();
+    m_dev_alloc.garbage_collection();
+
+    CUV_LOG_DEBUG("garbage collection in thread caching allocator " << m_name << ": "
+            << m_pool->bytes_reserved << " bytes still reserved");
+}
+
+void thread_caching_allocator::alloc(void** ptr, size_t memsize, size_t valueSize, host_memory_space) {
+    assert(*ptr == 0);
+    size_t bytes = memsize * valueSize;
+    unsigned int c = detail::size_class_of(bytes);
+
+    detail::block_header* b = 0;
+    if (c != detail::LARGE_CLASS)
+        b = local_cache().pop(c);
+    if (!b)
+        b = m_pool->allocate_block(c, bytes);
+
+    m_pool->account_alloc(b->capacity);
+    *ptr = detail::user_ptr(b);
+}
+
+void thread_caching_allocator::alloc(void** ptr, size_t memsize, size_t valueSize, dev_memory_space m) {
+    m_dev_alloc.alloc(ptr, memsize, valueSize, m);
+}
+
+void thread_caching_allocator::alloc2d(void** ptr, size_t& pitch, size_t height, size_t width, size_t valueSize,
+        host_memory_space m) {
+    pitch = width * valueSize;
+    alloc(ptr, height * width, valueSize, m);
+}
+
+void thread_caching_allocator::alloc2d(void** ptr, size_t& pitch, size_t height, size_t width, size_t valueSize,
+        dev_memory_space m) {
+    m_dev_alloc.alloc2d(ptr, pitch, height, width, valueSize, m);
+}
+
+void thread_caching_allocator::dealloc(void** ptr, host_memory_space) {
+    assert(*ptr != 0);
+    detail::block_header* b = detail::header_of(*ptr);
+    assert(b->magic == detail::BLOCK_MAGIC);
+
+    m_pool->account_dealloc(b->capacity);
+    if (b->size_class == detail::LARGE_CLASS)
+        m_pool->free_block(b);
+    else
+        local_cache().push(b);
+    *ptr = 0;
+}
+
+void thread_caching_allocator::dealloc(void** ptr, dev_memory_space m) {
+    m_dev_alloc.dealloc(ptr, m);
+}
+
+caching_allocator_stats thread_caching_allocator::stats() const {
+    const detail::caching_pool& p = *m_pool;
+    caching_allocator_stats s;
+    s.bytes_in_use = p.bytes_in_use;
+    s.bytes_in_use_peak = p.bytes_in_use_peak;
+    s.bytes_reserved = p.bytes_reserved;
+    s.thread_cache_hits = p.thread_cache_hits;
+    s.central_hits = p.central_hits;
+    s.misses = p.misses;
+    return s;
+}
+
+
+const size_t arena_allocator::ALIGNMENT;
+
+arena_allocator::arena_allocator(size_t chunk_size, const boost::shared_ptr<allocator>& upstream) :
+        m_chunks(), m_chunk(0), m_offset(0), m_used(0), m_live(0),
+                m_chunk_size(chunk_size), m_upstream(upstream) {
+    cuvAssert(m_chunk_size > 0);
+}
+
+arena_allocator::~arena_allocator() {
+    assert(m_live == 0);
+    for (size_t i = 0; i < m_chunks.size(); i++)
+        free(m_chunks[i].ptr);
+}
+
+arena_allocator::mark arena_allocator::get_mark() const {
+    mark m;
+    m.chunk = m_chunk;
+    m.offset = m_offset;
+    m.used = m_used;
+    m.live = m_live;
+    return m;
+}
+
+void arena_allocator::rewind(const mark& m) {
+    // blocks allocated after the mark must have been deallocated
+    assert(m_live <= m.live);
+    m_chunk = m.chunk;
+    m_offset = m.offset;
+    m_used = m.used;
+}
+
+void arena_allocator::reset() {
+    assert(m_live == 0);
+    m_chunk = 0;
+    m_offset = 0;
+    m_used = 0;
+}
+
+void arena_allocator::garbage_collection() {
+    size_t keep = std::min(m_chunks.size(), m_offset > 0 ? m_chunk + 1 : m_chunk);
+    for (size_t i = keep; i < m_chunks.size(); i++)
+        free(m_chunks[i].ptr);
+    m_chunks.resize(keep);
+}
+
+size_t arena_allocator::bytes_reserved() const {
+    size_t sum = 0;
+    for (size_t i = 0; i < m_chunks.size(); i++)
+        sum += m_chunks[i].size;
+    return sum;
+}
+
+void arena_allocator::alloc(void** ptr, size_t memsize, size_t valueSize, host_memory_space) {
+    assert(*ptr == 0);
+    size_t bytes = std::max((size_t) 1, memsize * valueSize);
+    bytes = (bytes + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+
+    if (m_chunk >= m_chunks.size() || m_offset + bytes > m_chunks[m_chunk].size) {
+        // continue in the next chunk, the rest of the current one stays unused until rewinding
+        if (m_chunk < m_chunks.size()) {
+            m_used += m_chunks[m_chunk].size - m_offset;
+            m_chunk++;
+        }
+        m_offset = 0;
+        if (m_chunk < m_chunks.size() && m_chunks[m_chunk].size < bytes) {
+            // chunks behind the current one are unused, replace it by a larger one
+            free(m_chunks[m_chunk].ptr);
+            m_chunks.erase(m_chunks.begin() + m_chunk);
+        }
+        if (m_chunk == m_chunks.size() || m_chunks[m_chunk].size < bytes) {
+            chunk c;
+            c.size = std::max(m_chunk_size, bytes);
+            void* raw = 0;
+            if (posix_memalign(&raw, ALIGNMENT, c.size) != 0)
+                throw std::bad_alloc();
+            c.ptr = static_cast<char*>(raw);
+            m_chunks.insert(m_chunks.begin() + m_chunk, c);
+            CUV_LOG_DEBUG("arena allocated chunk of " << c.size << " bytes");
+        }
+    }
+
+    *ptr = m_chunks[m_chunk].ptr + m_offset;
+    m_offset += bytes;
+    m_used += bytes;
+    m_live++;
+}
+
+void arena_allocator::alloc(void** ptr, size_t memsize, size_t valueSize, dev_memory_space m) {
+    m_upstream->alloc(ptr, memsize, valueSize, m);
+}
+
+void arena_allocator::alloc2d(void** ptr, size_t& pitch, size_t height, size_t width, size_t valueSize,
+        host_memory_space m) {
+    pitch = width * valueSize;
+    alloc(ptr, height * width, valueSize, m);
+}
+
+void arena_allocator::alloc2d(void** ptr, size_t& pitch, size_t height, size_t width, size_t valueSize,
+        dev_memory_space m) {
+    m_upstream->alloc2d(ptr, pitch, height, width, valueSize, m);
+}
+
+void arena_allocator::dealloc(void** ptr, host_memory_space) {
+    // memory is released when rewinding
+    assert(*ptr != 0);
+    assert(m_live > 0);
+    m_live--;
+    *ptr = 0;
+}
+
+void arena_allocator::dealloc(void** ptr, dev_memory_space m) {
+    m_upstream->dealloc(ptr, m);
+}
+
 }
 
 #define CUV_POOLED_CUDA_ALLOCATOR_INST(X) \
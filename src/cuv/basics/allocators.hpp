@@ -4,8 +4,10 @@
 #include <assert.h>
 #include <boost/shared_ptr.hpp>
 #include <boost/thread/recursive_mutex.hpp>
+#include <boost/thread/tss.hpp>
 #include <map>
 #include <string>
+#include <vector>
 
 #ifdef DEBUG_POOLING
 #include <iostream>
@@ -210,6 +212,224 @@ class nan_pooled_cuda_allocator : public pooled_cuda_allocator {
 };
 
 
+namespace detail {
+struct caching_pool;
+struct thread_cache;
+}
+
+/**
+ * @brief usage statistics of a thread_caching_allocator
+ *
+ * All byte counts refer to block capacities, i.e. requests rounded up to their size class.
+ */
+struct caching_allocator_stats {
+    size_t bytes_in_use;       ///< bytes in blocks currently handed out
+    size_t bytes_in_use_peak;  ///< high-water mark of bytes_in_use
+    size_t bytes_reserved;     ///< bytes obtained from the system, in use or cached
+    size_t thread_cache_hits;  ///< allocations served from the calling thread's cache
+    size_t central_hits;       ///< allocations served from the shared free lists
+    size_t misses;             ///< allocations that had to go to the system
+
+    /// fraction of allocations that were served without asking the system
+    double hit_rate() const {
+        size_t n = thread_cache_hits + central_hits + misses;
+        return n == 0 ? 0.0 : (thread_cache_hits + central_hits) / (double) n;
+    }
+};
+
+/**
+ * @brief allocator with power-of-two size classes and per-thread caches for host memory
+ *
+ * Host blocks are rounded up to a power of two (at least MIN_BLOCK_SIZE) and
+ * aligned to ALIGNMENT bytes. Freed blocks go to a cache owned by the
+ * calling thread, which serves later requests of the same class without any
+ * synchronization. When a thread cache holds more than thread_cache_bytes,
+ * blocks are pushed to per-class shared free lists using compare-and-swap, so
+ * neither path takes a lock. Blocks larger than MAX_BLOCK_SIZE are not
+ * cached.
+ *
+ * Device memory is passed on to a pooled_cuda_allocator.
+ *
+ * \ingroup tools
+ */
+class thread_caching_allocator: public allocator {
+public:
+
+    static const size_t ALIGNMENT = 64;              ///< alignment of host blocks in bytes
+    static const size_t MIN_BLOCK_SIZE = 64;         ///< smallest size class in bytes
+    static const size_t MAX_BLOCK_SIZE = 1UL << 28;  ///< largest cached size class in bytes
+
+private:
+
+    std::string m_name;
+    boost::shared_ptr<detail::caching_pool> m_pool;
+    boost::thread_specific_ptr<detail::thread_cache> m_cache;
+    pooled_cuda_allocator m_dev_alloc;
+
+    thread_caching_allocator(const thread_caching_allocator& o);
+    thread_caching_allocator& operator=(const thread_caching_allocator& o);
+
+    detail::thread_cache& local_cache();
+
+public:
+
+    /**
+     * @param _name               name used in log messages
+     * @param thread_cache_bytes  maximum number of bytes each thread keeps for itself
+     */
+    explicit thread_caching_allocator(const std::string& _name = "", size_t thread_cache_bytes = 16UL << 20);
+
+    virtual ~thread_caching_allocator();
+
+    /**
+     * return cached host blocks of the calling thread and of the shared free
+     * lists to the system. Caches of other threads are released when they exit.
+     */
+    virtual void garbage_collection();
+
+    virtual void alloc(void** ptr, size_t memsize, size_t valueSize, host_memory_space);
+
+    virtual void alloc(void** ptr, size_t memsize, size_t valueSize, dev_memory_space);
+
+    virtual void alloc2d(void** ptr, size_t& pitch, size_t height, size_t width, size_t valueSize,
+            host_memory_space);
+
+    virtual void alloc2d(void** ptr, size_t& pitch, size_t height, size_t width, size_t valueSize,
+            dev_memory_space);
+
+    virtual void dealloc(void** ptr, host_memory_space);
+
+    virtual void dealloc(void** ptr, dev_memory_space);
+
+    /// usage statistics of host memory
+    caching_allocator_stats stats() const;
+
+};
+
+/**
+ * @brief bump-pointer allocator for short-lived host temporaries
+ *
+ * Host memory is handed out by advancing a pointer through large chunks,
+ * deallocation does nothing. All memory allocated since a mark is released
+ * at once by rewinding to it, usually through an arena_scope:
+ *
+ * @code
+ * boost::shared_ptr<arena_allocator> arena(new arena_allocator());
+ * for(...){
+ *     arena_scope scope(*arena);
+ *     tensor<float,host_memory_space> tmp(extents[n], arena);
+ *     ...
+ * }   // tmp is destroyed, then all its memory is returned in O(1)
+ * @endcode
+ *
+ * Chunks are kept after rewinding, so after the first iteration an allocation
+ * costs a few pointer increments. Device memory is passed on to the upstream
+ * allocator. An arena must not be used by several threads at the same time.
+ *
+ * \ingroup tools
+ */
+class arena_allocator: public allocator {
+public:
+
+    static const size_t ALIGNMENT = 64;  ///< alignment of host blocks in bytes
+
+    /// position in the arena, see get_mark() and rewind()
+    struct mark {
+        size_t chunk;
+        size_t offset;
+        size_t used;
+        size_t live;
+    };
+
+private:
+
+    struct chunk {
+        char* ptr;
+        size_t size;
+    };
+
+    std::vector<chunk> m_chunks;
+    size_t m_chunk;      ///< index of the chunk currently allocated from
+    size_t m_offset;     ///< first free byte in the current chunk
+    size_t m_used;       ///< bytes handed out, including unused chunk tails
+    size_t m_live;       ///< number of blocks not yet deallocated
+    size_t m_chunk_size;
+    boost::shared_ptr<allocator> m_upstream;
+
+    arena_allocator(const arena_allocator& o);
+    arena_allocator& operator=(const arena_allocator& o);
+
+public:
+
+    /**
+     * @param chunk_size  size of host chunks, larger requests get a chunk of their own
+     * @param upstream    allocator for device memory
+     */
+    explicit arena_allocator(size_t chunk_size = 4UL << 20,
+            const boost::shared_ptr<allocator>& upstream = boost::shared_ptr<allocator>(new default_allocator()));
+
+    virtual ~arena_allocator();
+
+    /// current position, memory allocated afterwards is released by rewind()
+    mark get_mark() const;
+
+    /// release all host memory allocated since m was taken
+    void rewind(const mark& m);
+
+    /// release all host memory allocated so far
+    void reset();
+
+    /// return chunks that are not currently used to the system
+    void garbage_collection();
+
+    /// bytes currently handed out
+    size_t bytes_used() const {
+        return m_used;
+    }
+
+    /// bytes held in chunks
+    size_t bytes_reserved() const;
+
+    virtual void alloc(void** ptr, size_t memsize, size_t valueSize, host_memory_space);
+
+    virtual void alloc(void** ptr, size_t memsize, size_t valueSize, dev_memory_space);
+
+    virtual void alloc2d(void** ptr, size_t& pitch, size_t height, size_t width, size_t valueSize,
+            host_memory_space);
+
+    virtual void alloc2d(void** ptr, size_t& pitch, size_t height, size_t width, size_t valueSize,
+            dev_memory_space);
+
+    virtual void dealloc(void** ptr, host_memory_space);
+
+    virtual void dealloc(void** ptr, dev_memory_space);
+
+};
+
+/**
+ * @brief releases all host memory allocated from an arena during its lifetime
+ *
+ * Tensors using the arena must be destroyed before the scope ends, i.e. they
+ * have to be declared after it.
+ */
+class arena_scope {
+private:
+    arena_allocator& m_arena;
+    arena_allocator::mark m_mark;
+
+    arena_scope(const arena_scope& o);
+    arena_scope& operator=(const arena_scope& o);
+
+public:
+    explicit arena_scope(arena_allocator& arena) :
+            m_arena(arena), m_mark(arena.get_mark()) {
+    }
+
+    ~arena_scope() {
+        m_arena.rewind(m_mark);
+    }
+};
+
 }
 
 #endif
@@ -0,0 +1,208 @@
+//*LB*
+// Copyright (c) 2010, University of Bonn, Institute for Computer Science VI
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+//  * Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//  * Neither the name of the University of Bonn 
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this software without specific prior written
+//    permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//*LE*
+
+
+
+
+/** 
+ * @file bsr_matrix.hpp
+ * @brief sparse matrices in block compressed sparse row (BSR) format
+ * @ingroup data_structures
+ */
+#ifndef __BSR_MATRIX_HPP__
+#define __BSR_MATRIX_HPP__
+#include <iostream>
+#include <cuv/basics/tensor.hpp>
+#include <cuv/basics/matrix.hpp>
+#include <cuv/tools/cuv_general.hpp>
+
+namespace cuv{
+	/** 
+	 * @brief Class for sparse matrices in block compressed sparse row (BSR) format
+	 *
+	 * The matrix is divided into dense blocks of block_h() x block_w()
+	 * entries. Only blocks containing non-zero entries are stored. The
+	 * structure is that of a csr_matrix of blocks: the blocks of block row i
+	 * are blocks row_ptr()[i] to row_ptr()[i+1]-1, col_idx() contains their
+	 * (sorted) block column indices. Every block is stored in row-major order
+	 * in block_h()*block_w() consecutive elements of vals().
+	 *
+	 * Compared to csr_matrix, only one column index is stored per block, and
+	 * products can use dense inner loops over the block.
+	 *
+	 * @ingroup data_structures
+	 */
+	template<class __value_type, class __memory_space_type, class __index_type=unsigned int> 
+	class bsr_matrix 
+	:        public matrix<__value_type, __index_type>{
+	  public:
+		  typedef __value_type           value_type;	///< Type of the entries of matrix
+		  typedef matrix<__value_type, __index_type> 					   base_type; 			///< Basic matrix type
+		  typedef __memory_space_type 									   memory_space_type;	///< Whether this is a host or device matrix
+		  typedef typename base_type::index_type 						   index_type;			///< Type of indices
+		  typedef tensor<value_type,memory_space_type>  		   vec_type; 			///< Type of the vector of stored blocks
+		  typedef tensor<index_type,memory_space_type> 			   idxvec_type; 		///< Type of the vectors of row pointers and column indices
+		  typedef bsr_matrix<value_type,memory_space_type,index_type> 	   my_type;				///< Type of this matix
+
+		  template <class Archive, class V, class I> friend void serialize(Archive&, bsr_matrix<V,host_memory_space, I>&, unsigned int); ///< serialization function to save matrix
+		protected:
+		  index_type  m_block_h;                ///< height of a block
+		  index_type  m_block_w;                ///< width of a block
+		  index_type  m_nnzb;                   ///< number of stored blocks
+		  vec_type    m_vals;                   ///< the stored blocks
+		  idxvec_type m_row_ptr;                ///< first block of every block row (h/block_h+1 entries)
+		  idxvec_type m_col_idx;                ///< block column of every stored block
+		public:
+			bsr_matrix() ///< Empty constructor. Returns empty matrix.
+				: base_type(0,0),
+				 m_block_h(1),
+				 m_block_w(1),
+				 m_nnzb(0){}
+			/** 
+			 * @brief Creates a BSR matrix of given size with space for nnzb blocks.
+			 *
+			 * The structure (row_ptr() and col_idx()) must be filled in by the caller.
+			 * 
+			 * @param h Height of matrix, must be a multiple of bh
+			 * @param w Width of matrix, must be a multiple of bw
+			 * @param bh Height of a block
+			 * @param bw Width of a block
+			 * @param nnzb number of stored blocks
+			 */
+			bsr_matrix(const index_type& h, const index_type& w, const index_type& bh, const index_type& bw, const index_type& nnzb)
+				: base_type(h,w)
+				, m_block_h(bh)
+				, m_block_w(bw)
+				, m_nnzb(nnzb)
+			{
+				cuvAssert(bh > 0 && bw > 0);
+				cuvAssert(h % bh == 0);
+				cuvAssert(w % bw == 0);
+				alloc();
+			}
+			void alloc() ///< Allocate memory for blocks and structure
+			{
+				m_vals.resize(m_nnzb * m_block_h * m_block_w);
+				m_col_idx.resize(m_nnzb);
+				m_row_ptr.resize(this->h() / m_block_h + 1);
+			}
+			void dealloc() ///< Deallocate memory for blocks and structure
+			{
+				m_vals.dealloc();
+				m_col_idx.dealloc();
+				m_row_ptr.dealloc();
+			}
+			/** 
+			 * @brief shape of the matrix, for compatibility with tensor.
+			 *
+			 * @return a vector of height and width
+			 */
+			std::vector<index_type>
+			shape()const{
+				std::vector<index_type> s(2);
+				s[0]=this->h();
+				s[1]=this->w();
+				return s;
+			}
+			inline index_type block_h()const{ return m_block_h; } ///< Return height of a block
+			inline index_type block_w()const{ return m_block_w; } ///< Return width of a block
+			inline index_type block_size()const{ return m_block_h*m_block_w; } ///< Return number of entries in a block
+			inline index_type nnzb()const{ return m_nnzb; } ///< Return number of stored blocks
+			inline index_type nnz()const{ return m_nnzb*block_size(); } ///< Return number of stored entries (including zeros in stored blocks)
+			inline index_type num_block_rows()const{ return this->h()/m_block_h; } ///< Return number of block rows
+			inline const vec_type& vals()const{ return m_vals; } ///< Return the stored blocks
+			inline       vec_type& vals()     { return m_vals; } ///< Return the stored blocks
+			inline const idxvec_type& row_ptr()const{ return m_row_ptr; } ///< Return the first block of every block row
+			inline       idxvec_type& row_ptr()     { return m_row_ptr; } ///< Return the first block of every block row
+			inline const idxvec_type& col_idx()const{ return m_col_idx; } ///< Return the block column of every stored block
+			inline       idxvec_type& col_idx()     { return m_col_idx; } ///< Return the block column of every stored block
+
+			// ******************************
+			// element access
+			// ******************************
+			/** 
+			 * @return the position of the block containing entry (i,j) in col_idx(), or nnzb() if it is not stored
+			 */
+			index_type find_block(const index_type& i, const index_type& j)const{
+				const index_type bi = i / m_block_h, bj = j / m_block_w;
+				index_type lo = m_row_ptr[bi], hi = m_row_ptr[bi+1];
+				while(lo < hi){
+					index_type mid = lo + (hi - lo) / 2;
+					index_type c   = m_col_idx[mid];
+					if(c == bj)     return mid;
+					else if(c < bj) lo = mid + 1;
+					else            hi = mid;
+				}
+				return m_nnzb;
+			}
+			void set(const index_type& i, const index_type& j, const value_type& val) ///< Set matrix entry (i,j) if its block is stored
+			{
+				index_type b = find_block(i,j);
+				if(b == m_nnzb)
+					return;
+				m_vals[b*block_size() + (i%m_block_h)*m_block_w + j%m_block_w] = val;
+			}
+			value_type operator()(const index_type& i, const index_type& j)const ///< Return matrix entry (i,j)
+			{
+				index_type b = find_block(i,j);
+				if(b == m_nnzb)
+					return (value_type) 0;
+				return m_vals[b*block_size() + (i%m_block_h)*m_block_w + j%m_block_w];
+			}
+			bool has(const index_type& i, const index_type& j)const ///< Return whether matrix entry is managed by sparse matrix 
+			{
+				return find_block(i,j) != m_nnzb;
+			}
+	};
+}
+
+namespace std{
+	/** 
+	 * @brief Return stream containing matrix entries for debugging
+	 * 
+	 * @param o Output stream
+	 * @param w2 Matrix to output
+     * @ingroup io
+	 */
+	template<class V, class T, class I>
+	ostream& 
+	operator<<(ostream& o, const cuv::bsr_matrix<V,T,I>& w2){
+		o << "BSR-Matrix: "<<endl;
+		for(I i=0;i<w2.h();i++){
+			for(I j=0;j<w2.w();j++){
+				o << w2(i,j) << " ";
+			}
+			o << endl;
+		}
+		o << endl;
+		return o;
+	}
+}
+
+#endif /* __BSR_MATRIX_HPP__ */
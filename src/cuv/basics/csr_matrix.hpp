@@ -0,0 +1,189 @@
+//*LB*
+// Copyright (c) 2010, University of Bonn, Institute for Computer Science VI
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+//  * Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//  * Neither the name of the University of Bonn 
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this software without specific prior written
+//    permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//*LE*
+
+
+
+
+/** 
+ * @file csr_matrix.hpp
+ * @brief sparse matrices in compressed sparse row (CSR) format
+ * @ingroup data_structures
+ */
+#ifndef __CSR_MATRIX_HPP__
+#define __CSR_MATRIX_HPP__
+#include <iostream>
+#include <cuv/basics/tensor.hpp>
+#include <cuv/basics/matrix.hpp>
+#include <cuv/tools/cuv_general.hpp>
+
+namespace cuv{
+	/** 
+	 * @brief Class for sparse matrices in compressed sparse row (CSR) format
+	 *
+	 * The non-zero entries of row i are stored in vals()[row_ptr()[i]] to
+	 * vals()[row_ptr()[i+1]-1], their column indices in the same positions of
+	 * col_idx(). Column indices within a row are sorted.
+	 *
+	 * In contrast to dia_matrix, memory use and the cost of products are
+	 * proportional to the number of non-zero entries, which makes this format
+	 * suitable for irregular sparsity patterns (e.g. bag-of-words features).
+	 *
+	 * @ingroup data_structures
+	 */
+	template<class __value_type, class __memory_space_type, class __index_type=unsigned int> 
+	class csr_matrix 
+	:        public matrix<__value_type, __index_type>{
+	  public:
+		  typedef __value_type           value_type;	///< Type of the entries of matrix
+		  typedef matrix<__value_type, __index_type> 					   base_type; 			///< Basic matrix type
+		  typedef __memory_space_type 									   memory_space_type;	///< Whether this is a host or device matrix
+		  typedef typename base_type::index_type 						   index_type;			///< Type of indices
+		  typedef tensor<value_type,memory_space_type>  		   vec_type; 			///< Type of the vector of non-zero entries
+		  typedef tensor<index_type,memory_space_type> 			   idxvec_type; 		///< Type of the vectors of row pointers and column indices
+		  typedef csr_matrix<value_type,memory_space_type,index_type> 	   my_type;				///< Type of this matix
+
+		  template <class Archive, class V, class I> friend void serialize(Archive&, csr_matrix<V,host_memory_space, I>&, unsigned int); ///< serialization function to save matrix
+		protected:
+		  index_type  m_nnz;                    ///< number of stored entries
+		  vec_type    m_vals;                   ///< the stored entries
+		  idxvec_type m_row_ptr;                ///< start of every row in m_vals (h+1 entries)
+		  idxvec_type m_col_idx;                ///< column of every stored entry
+		public:
+			csr_matrix() ///< Empty constructor. Returns empty matrix.
+				: base_type(0,0),
+				 m_nnz(0){}
+			/** 
+			 * @brief Creates a CSR matrix of given size with space for nnz entries.
+			 *
+			 * The structure (row_ptr() and col_idx()) must be filled in by the caller.
+			 * 
+			 * @param h Height of matrix 
+			 * @param w Width of matrix
+			 * @param nnz number of stored entries
+			 */
+			csr_matrix(const index_type& h, const index_type& w, const index_type& nnz)
+				: base_type(h,w)
+				, m_nnz(nnz)
+			{
+				alloc();
+			}
+			void alloc() ///< Allocate memory for entries and structure
+			{
+				m_vals.resize(m_nnz);
+				m_col_idx.resize(m_nnz);
+				m_row_ptr.resize(this->h()+1);
+			}
+			void dealloc() ///< Deallocate memory for entries and structure
+			{
+				m_vals.dealloc();
+				m_col_idx.dealloc();
+				m_row_ptr.dealloc();
+			}
+			/** 
+			 * @brief shape of the matrix, for compatibility with tensor.
+			 *
+			 * @return a vector of height and width
+			 */
+			std::vector<index_type>
+			shape()const{
+				std::vector<index_type> s(2);
+				s[0]=this->h();
+				s[1]=this->w();
+				return s;
+			}
+			inline index_type nnz()const{ return m_nnz; } ///< Return number of stored entries
+			inline const vec_type& vals()const{ return m_vals; } ///< Return the stored entries
+			inline       vec_type& vals()     { return m_vals; } ///< Return the stored entries
+			inline const idxvec_type& row_ptr()const{ return m_row_ptr; } ///< Return the start of every row in vals()
+			inline       idxvec_type& row_ptr()     { return m_row_ptr; } ///< Return the start of every row in vals()
+			inline const idxvec_type& col_idx()const{ return m_col_idx; } ///< Return the column of every stored entry
+			inline       idxvec_type& col_idx()     { return m_col_idx; } ///< Return the column of every stored entry
+
+			// ******************************
+			// element access
+			// ******************************
+			/** 
+			 * @return the position of entry (i,j) in vals(), or nnz() if it is not stored
+			 */
+			index_type find(const index_type& i, const index_type& j)const{
+				index_type lo = m_row_ptr[i], hi = m_row_ptr[i+1];
+				while(lo < hi){
+					index_type mid = lo + (hi - lo) / 2;
+					index_type c   = m_col_idx[mid];
+					if(c == j)     return mid;
+					else if(c < j) lo = mid + 1;
+					else           hi = mid;
+				}
+				return m_nnz;
+			}
+			void set(const index_type& i, const index_type& j, const value_type& val) ///< Set matrix entry (i,j) if it is stored
+			{
+				index_type p = find(i,j);
+				if(p == m_nnz)
+					return;
+				m_vals[p] = val;
+			}
+			value_type operator()(const index_type& i, const index_type& j)const ///< Return matrix entry (i,j)
+			{
+				index_type p = find(i,j);
+				if(p == m_nnz)
+					return (value_type) 0;
+				return m_vals[p];
+			}
+			bool has(const index_type& i, const index_type& j)const ///< Return whether matrix entry is managed by sparse matrix 
+			{
+				return find(i,j) != m_nnz;
+			}
+	};
+}
+
+namespace std{
+	/** 
+	 * @brief Return stream containing matrix entries for debugging
+	 * 
+	 * @param o Output stream
+	 * @param w2 Matrix to output
+     * @ingroup io
+	 */
+	template<class V, class T, class I>
+	ostream& 
+	operator<<(ostream& o, const cuv::csr_matrix<V,T,I>& w2){
+		o << "CSR-Matrix: "<<endl;
+		for(I i=0;i<w2.h();i++){
+			for(I j=0;j<w2.w();j++){
+				o << w2(i,j) << " ";
+			}
+			o << endl;
+		}
+		o << endl;
+		return o;
+	}
+}
+
+#endif /* __CSR_MATRIX_HPP__ */
@@ -95,6 +95,8 @@ namespace cuv
 
 			/// @return the wrapped tensor
 			inline const tensor_type& tens()const{ return m_tens; } 
+			/// @return the wrapped tensor
+			inline tensor_type& tens(){ return m_tens; }
 
 			/**
 			 * element access
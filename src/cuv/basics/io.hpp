@@ -40,6 +40,9 @@
 #include <boost/serialization/shared_ptr.hpp>
 #include <boost/serialization/array.hpp>
 #include <boost/serialization/split_free.hpp>
+#include <boost/serialization/version.hpp>
+#include <boost/mpl/int.hpp>
+#include <vector>
 #include <cuv/basics/tensor.hpp>
 
 /// cuv additions to the boost namespace
@@ -74,26 +77,62 @@ namespace boost
 		 *
 		 * @warning This probably will not work in .cu files which are processed by nvcc.
 		 *
+		 * Large tensors are better stored with save_tensor_file (see
+		 * tensor_file.hpp), which can be mapped into memory without copying.
+		 *
 		 * @{
 		 */
 
+        /**
+         * read the elements of a host memory directly from the archive
+         */
+        template<class Archive, class V>
+            void load_memory_data(Archive& ar, V* dst, std::size_t size, cuv::host_memory_space){
+                ar >> make_array(dst, size);
+            }
+        /**
+         * read the elements of a device memory through one host staging buffer
+         */
+        template<class Archive, class V>
+            void load_memory_data(Archive& ar, V* dst, std::size_t size, cuv::dev_memory_space){
+                std::vector<V> tmp(size);
+                ar >> make_array(&tmp[0], size);
+                cuv::detail::copy(dst, &tmp[0], size, cuv::dev_memory_space(), cuv::host_memory_space(), 0);
+            }
+        /**
+         * write the elements of a host memory directly to the archive
+         */
+        template<class Archive, class V>
+            void save_memory_data(Archive& ar, const V* src, std::size_t size, cuv::host_memory_space){
+                ar << make_array(src, size);
+            }
+        /**
+         * write the elements of a device memory through one host staging buffer
+         */
+        template<class Archive, class V>
+            void save_memory_data(Archive& ar, const V* src, std::size_t size, cuv::dev_memory_space){
+                std::vector<V> tmp(size);
+                cuv::detail::copy(&tmp[0], src, size, cuv::host_memory_space(), cuv::dev_memory_space(), 0);
+                ar << make_array(&tmp[0], size);
+            }
+
         /**
          * load a memory
+         *
+         * Host memory is read in place, device memory needs one host buffer
+         * of the same size.
          */
         template<class Archive, class V, class M>
             void load(Archive& ar, cuv::memory<V,M>& m, const unsigned int version ){
                 typename cuv::memory<V,M>::size_type size;
                 ar >> size;
                 if(size){
-                    V* tmp = new V[size];
-                    ar >> make_array(tmp,size);
-                    // copy to dev
                     V* tmpo = NULL;
                     cuv::default_allocator a;
                     a.alloc((void**)&tmpo, size, sizeof(V), M());
-                    cuv::detail::copy(tmpo, tmp, size, M(), cuv::host_memory_space(), 0);
+                    // m owns the memory from here on, even if reading fails
                     m.reset(tmpo, size);
-                    delete[] tmp;
+                    load_memory_data(ar, tmpo, size, M());
                 }
             }
         /**
@@ -101,15 +140,10 @@ namespace boost
          */
         template<class Archive, class V, class M>
             void save(Archive& ar, const cuv::memory<V,M>& m, const unsigned int version ){
-                // copy to host
                 typename cuv::memory<V,M>::size_type size = m.size();
                 ar << size;
-                if(m.size()){
-                    V* tmp = new V[size];
-                    cuv::detail::copy(tmp, m.ptr(), size, cuv::host_memory_space(), M(), 0);
-                    ar << make_array(tmp, size);
-                    delete[] tmp;
-                }
+                if(m.size())
+                    save_memory_data(ar, m.ptr(), size, M());
             }
 		/**
 		 * load/save dev memory (dispatch to load/save)
@@ -157,6 +191,51 @@ namespace boost
 		}
 
 
+		/****************************************************
+		 * serialize shape arrays
+		 ****************************************************/
+		/**
+		 * save a shape_array
+		 *
+		 * @param ar an archive to save to
+		 * @param a the array to be stored
+		 * @param version (unused) protocol version
+		 */
+		template<class Archive, class T, unsigned int N>
+		void save(Archive& ar, const cuv::shape_array<T,N>& a, const unsigned int version){
+			typename cuv::shape_array<T,N>::size_type size = a.size();
+			ar << size;
+			if(size)
+				ar << make_array(a.ptr(), size);
+		}
+		/**
+		 * load a shape_array
+		 *
+		 * @param ar an archive to load from
+		 * @param a the array to be restored
+		 * @param version (unused) protocol version
+		 */
+		template<class Archive, class T, unsigned int N>
+		void load(Archive& ar, cuv::shape_array<T,N>& a, const unsigned int version){
+			typename cuv::shape_array<T,N>::size_type size;
+			ar >> size;
+			a.set_size(size);
+			if(size)
+				ar >> make_array(a.ptr(), size);
+		}
+		/**
+		 * load/save shape_array (dispatch to load/save)
+		 *
+		 * @param ar an archive to save to
+		 * @param a the array to be stored/restored
+		 * @param version (unused) protocol version
+		 */
+		template<class Archive, class T, unsigned int N>
+		void serialize(Archive& ar, cuv::shape_array<T,N>& a, const unsigned int version){
+			boost::serialization::split_free(ar, a, version);
+		}
+
+
 		/****************************************************
 		 * serialize tensor
 		 ****************************************************/
@@ -186,8 +265,20 @@ namespace boost
 		 */
 		template<class Archive, class V, class MS, class ML>
 		void load(Archive& ar, cuv::tensor<V,MS, ML>& t, const unsigned int version){
-			ar >> t.info().host_shape;
-			ar >> t.info().host_stride;
+			if(version == 0){
+				// shape and strides used to be stored in linear_memory
+				typedef typename cuv::tensor<V,MS,ML>::size_type size_type;
+				typedef typename cuv::tensor<V,MS,ML>::index_type index_type;
+				cuv::linear_memory<size_type,cuv::host_memory_space> shape;
+				cuv::linear_memory<index_type,cuv::host_memory_space> stride;
+				ar >> shape;
+				ar >> stride;
+				t.info().host_shape  = cuv::shape_array<size_type>(shape.ptr(), shape.ptr() + shape.size());
+				t.info().host_stride = cuv::shape_array<index_type>(stride.ptr(), stride.ptr() + stride.size());
+			}else{
+				ar >> t.info().host_shape;
+				ar >> t.info().host_stride;
+			}
             ar >> t.mem();
 			if(t.ndim()>0 && t.mem()){
                 long int i;
@@ -208,6 +299,17 @@ namespace boost
 		}
 
 		/** @} */
+
+		/**
+		 * version 1 of the tensor format stores shapes and strides as
+		 * shape_array instead of linear_memory.
+		 */
+		template<class V, class MS, class ML>
+		struct version<cuv::tensor<V,MS,ML> >{
+			typedef mpl::int_<1> type; ///< current version
+			typedef mpl::integral_c_tag tag; ///< tag for boost::mpl
+			BOOST_STATIC_CONSTANT(int, value = version::type::value); ///< current version
+		};
 	}
 }
 #endif /* __CUV_BASICS_IO_HPP__ */
@@ -38,6 +38,10 @@ namespace cuv{
 
 	template<class V, class T, class I>
 	class dia_matrix;
+	template<class V, class T, class I>
+	class csr_matrix;
+	template<class V, class T, class I>
+	class bsr_matrix;
 		
 
 /**
@@ -53,6 +57,8 @@ class matrix
 		  typedef __value_type value_type;	///< Type of the entries of matrix
 		  typedef __index_type index_type;	///< Type of indices
 		  template <class Archive, class V, class I> friend void serialize(Archive&, dia_matrix<V,host_memory_space, I>&, unsigned int) ; ///< serialization function to save matrix
+		  template <class Archive, class V, class I> friend void serialize(Archive&, csr_matrix<V,host_memory_space, I>&, unsigned int) ; ///< serialization function to save matrix
+		  template <class Archive, class V, class I> friend void serialize(Archive&, bsr_matrix<V,host_memory_space, I>&, unsigned int) ; ///< serialization function to save matrix
 	  protected:
 		  index_type m_width; ///< Width of matrix
 		  index_type m_height; ///< Heigth of matrix
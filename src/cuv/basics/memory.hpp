@@ -1,15 +1,17 @@
 #ifndef __CUV_MEMORY_HPP__
 #define __CUV_MEMORY_HPP__
 
+#include <algorithm>
 #include <boost/make_shared.hpp>
 #include <boost/shared_ptr.hpp>
-#include <cuda_runtime_api.h>
 #include <limits>
 #include <numeric>
 #include <stdexcept>
 
 #include "allocators.hpp"
 #include "reference.hpp"
+#include "shape_array.hpp"
+#include <cuv/tools/cuda_compat.hpp>
 
 namespace boost {
 namespace serialization {
@@ -377,8 +379,8 @@ public:
     }
 
     /// set strides for this memory
-    void set_strides(linear_memory<index_type, cuv::host_memory_space>& strides,
-            const linear_memory<size_type, cuv::host_memory_space>& shape, row_major) {
+    void set_strides(shape_array<index_type>& strides,
+            const shape_array<size_type>& shape, row_major) {
         size_t size = 1;
         for (int i = shape.size() - 1; i >= 0; --i) {
             //strides[i] = (shape[i] == 1) ? 0 : size;
@@ -389,8 +391,8 @@ public:
     }
 
     /// set strides for this memory
-    void set_strides(linear_memory<index_type, cuv::host_memory_space>& strides,
-            const linear_memory<size_type, cuv::host_memory_space>& shape, column_major) {
+    void set_strides(shape_array<index_type>& strides,
+            const shape_array<size_type>& shape, column_major) {
         size_t size = 1;
         for (size_t i = 0; i < shape.size(); ++i) {
             //strides[i] = (shape[i] == 1) ? 0 : size;
@@ -639,8 +641,8 @@ private:
      *
      * row major version
      */
-    void set_strides(linear_memory<index_type, cuv::host_memory_space>& strides,
-            const linear_memory<size_type, cuv::host_memory_space>& shape, row_major) {
+    void set_strides(shape_array<index_type>& strides,
+            const shape_array<size_type>& shape, row_major) {
         size_type size = 1;
         assert(shape.size() >= 2);
         const int pitched_dim = shape.size() - 1;
@@ -661,8 +663,8 @@ private:
      *
      * column major version
      */
-    void set_strides(linear_memory<index_type, cuv::host_memory_space>& strides,
-            const linear_memory<size_type, cuv::host_memory_space>& shape, column_major) {
+    void set_strides(shape_array<index_type>& strides,
+            const shape_array<size_type>& shape, column_major) {
         size_type size = 1;
         assert(shape.size() >= 2);
         const size_type pitched_dim = 0;
@@ -698,33 +700,50 @@ namespace detail {
 /**
  * true iff there are no "holes" in memory
  */
-inline bool is_c_contiguous(row_major, const linear_memory<unsigned int, cuv::host_memory_space>& shape,
-        const linear_memory<int, cuv::host_memory_space>& stride) {
-    int shape_size = std::accumulate(shape.ptr(), 
-            shape.ptr() + shape.size(), 1, std::multiplies<int>());
-    int mem_size = stride[0] * shape[0];
-    return shape_size == mem_size;
+inline bool is_c_contiguous(row_major, const shape_array<unsigned int>& shape,
+        const shape_array<int>& stride) {
+    if (std::find(shape.begin(), shape.end(), 0u) != shape.end())
+        return true; // no elements
+    int size = 1;
+    for (int i = shape.size() - 1; i >= 0; --i) {
+        if (shape[i] == 1)
+            continue; // the stride of singleton dimensions does not matter
+        if (stride[i] != size)
+            return false;
+        size *= shape[i];
+    }
+    return true;
 }
 
 /**
  * @overload
  */
-inline bool is_c_contiguous(column_major, const linear_memory<unsigned int, cuv::host_memory_space>& shape,
-        const linear_memory<int, cuv::host_memory_space>& stride) {
-    int shape_size = std::accumulate(shape.ptr(), shape.ptr() + shape.size(), 1, 
-            std::multiplies<int>());
-    int mem_size = stride[stride.size()-1] * shape[shape.size()-1];
-    return shape_size == mem_size;
+inline bool is_c_contiguous(column_major, const shape_array<unsigned int>& shape,
+        const shape_array<int>& stride) {
+    if (std::find(shape.begin(), shape.end(), 0u) != shape.end())
+        return true; // no elements
+    int size = 1;
+    for (unsigned int i = 0; i < shape.size(); ++i) {
+        if (shape[i] == 1)
+            continue; // the stride of singleton dimensions does not matter
+        if (stride[i] != size)
+            return false;
+        size *= shape[i];
+    }
+    return true;
 }
 
 /// returns true iff memory can be copied using copy2d
-inline bool is_2dcopyable(row_major, const linear_memory<unsigned int, cuv::host_memory_space>& shape,
-        const linear_memory<int, cuv::host_memory_space>& stride) {
+inline bool is_2dcopyable(row_major, const shape_array<unsigned int>& shape,
+        const shape_array<int>& stride) {
     bool copyable2d = shape.size()>1;
     int pitched_dim = shape.size()-1; // last dim
     while(shape[pitched_dim]==1 && stride[pitched_dim] == 1) // do not move past the second dimension!
         pitched_dim --;
 
+    if (shape[pitched_dim] > 1 && stride[pitched_dim] != 1)
+        return false; // rows themselves are not contiguous
+
     if (pitched_dim == 0) 
         return true;
 
@@ -745,13 +764,16 @@ inline bool is_2dcopyable(row_major, const linear_memory<unsigned int, cuv::host
 }
 
 /// @overload
-inline bool is_2dcopyable(column_major, const linear_memory<unsigned int, cuv::host_memory_space>& shape,
-        const linear_memory<int, cuv::host_memory_space>& stride) {
+inline bool is_2dcopyable(column_major, const shape_array<unsigned int>& shape,
+        const shape_array<int>& stride) {
     bool copyable2d = shape.size()>1;
     int pitched_dim = 0; 
     while(shape[pitched_dim]==1 && stride[pitched_dim] == 1)
         pitched_dim ++;
 
+    if (shape[pitched_dim] > 1 && stride[pitched_dim] != 1)
+        return false; // columns themselves are not contiguous
+
     if (pitched_dim == (int)shape.size() - 1) 
         return true;
 
@@ -5,16 +5,6 @@
 namespace cuv {
 namespace detail {
 
-template<class value_type>
-void entry_set(value_type* ptr, size_t idx, value_type val, host_memory_space) {
-    ptr[idx] = val;
-}
-
-template<class value_type>
-value_type entry_get(const value_type* ptr, size_t idx, host_memory_space) {
-    return ptr[idx];
-}
-
 template<class value_type>
 void entry_set(value_type* ptr, size_t idx, value_type val, dev_memory_space) {
     thrust::device_ptr<value_type> dev_ptr(ptr);
@@ -38,9 +28,7 @@ std::ostream& operator<<(std::ostream& os, const cuv::reference<T, M>& reference
 
 
 #define CUV_REFERENCE_INST(TYPE) \
-    template void cuv::detail::entry_set(TYPE*, size_t, TYPE, cuv::host_memory_space); \
     template void cuv::detail::entry_set(TYPE*, size_t, TYPE, cuv::dev_memory_space); \
-    template TYPE cuv::detail::entry_get(const TYPE*, size_t, cuv::host_memory_space); \
     template TYPE cuv::detail::entry_get(const TYPE*, size_t, cuv::dev_memory_space); \
     template std::ostream& operator<<(std::ostream& os, const cuv::reference<TYPE, cuv::host_memory_space>& reference); \
     template std::ostream& operator<<(std::ostream& os, const cuv::reference<TYPE, cuv::dev_memory_space>& reference);
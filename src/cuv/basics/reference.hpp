@@ -15,24 +15,32 @@ namespace detail {
 /**
  * @brief Setting entry of host linear_memory at ptr at index idx to value val
  *
+ * Defined inline, so that element access to host tensors compiles to a plain store.
+ *
  * @param ptr Address of array in memory
  * @param idx Index of value to set
  * @param val Value to set linear_memory entry to
  *
  */
 template<class value_type>
-void entry_set(value_type* ptr, size_t idx, value_type val, host_memory_space);
+inline void entry_set(value_type* ptr, size_t idx, value_type val, host_memory_space) {
+    ptr[idx] = val;
+}
 
 /**
  * @brief Getting entry of host linear_memory at ptr at index idx
  *
+ * Defined inline, so that element access to host tensors compiles to a plain load.
+ *
  * @param ptr Address of array in memory
  * @param idx Index of value to get
  *
  * @return
  */
 template<class value_type>
-value_type entry_get(const value_type* ptr, size_t idx, host_memory_space);
+inline value_type entry_get(const value_type* ptr, size_t idx, host_memory_space) {
+    return ptr[idx];
+}
 
 template<class value_type>
 void entry_set(value_type* ptr, size_t idx, value_type val, dev_memory_space);
@@ -0,0 +1,216 @@
+#ifndef __CUV_SHAPE_ARRAY_HPP__
+#define __CUV_SHAPE_ARRAY_HPP__
+
+#include <algorithm>
+#include <iterator>
+#include <ostream>
+#include <vector>
+
+namespace cuv {
+
+/**
+ * @addtogroup data_structures
+ * @{
+ */
+
+/// number of dimensions for which shapes and strides of a tensor are stored without heap allocation
+static const unsigned int SHAPE_ARRAY_INLINE_SIZE = 8;
+
+/**
+ * a small array of shapes or strides which lives on the host.
+ *
+ * Up to N elements are stored inside the object itself, so that copying
+ * tensors, creating views and querying shapes does not touch the heap.
+ * Larger arrays are allocated with new[].
+ *
+ * The interface is a subset of std::vector; shape_array converts implicitly
+ * to std::vector and can be compared with it.
+ */
+template<class T, unsigned int N = SHAPE_ARRAY_INLINE_SIZE>
+class shape_array {
+
+public:
+    typedef T value_type; ///< type of contained values
+    typedef unsigned int size_type; ///< type of the size
+    typedef T* iterator; ///< iterator over elements
+    typedef const T* const_iterator; ///< iterator over elements (const)
+
+private:
+    T m_inline[N]; ///< storage for small arrays
+    T* m_heap; ///< storage for arrays with more than N elements, NULL otherwise
+    size_type m_size; ///< number of elements
+
+public:
+
+    /// construct an empty array
+    shape_array() :
+            m_heap(NULL), m_size(0) {
+    }
+
+    /// construct an array of s (uninitialized) elements
+    explicit shape_array(size_type s) :
+            m_heap(NULL), m_size(0) {
+        set_size(s);
+    }
+
+    /// copy constructor
+    shape_array(const shape_array& o) :
+            m_heap(NULL), m_size(0) {
+        *this = o;
+    }
+
+    /// construct from a range
+    template<class I>
+    shape_array(I begin, I end) :
+            m_heap(NULL), m_size(0) {
+        set_size(std::distance(begin, end));
+        std::copy(begin, end, ptr());
+    }
+
+    ~shape_array() {
+        delete[] m_heap;
+    }
+
+    /// assignment
+    shape_array& operator=(const shape_array& o) {
+        if (this == &o)
+            return *this;
+        set_size(o.size());
+        std::copy(o.begin(), o.end(), begin());
+        return *this;
+    }
+
+    /**
+     * set the number of elements.
+     *
+     * The first min(size(), s) elements are preserved.
+     */
+    void set_size(size_type s) {
+        if (s > N && (!m_heap || s > m_size)) {
+            T* p = new T[s];
+            std::copy(begin(), begin() + std::min(s, m_size), p);
+            delete[] m_heap;
+            m_heap = p;
+        } else if (s <= N && m_heap) {
+            std::copy(m_heap, m_heap + s, m_inline);
+            delete[] m_heap;
+            m_heap = NULL;
+        }
+        m_size = s;
+    }
+
+    /// @return number of elements
+    size_type size() const {
+        return m_size;
+    }
+
+    /// @return true iff there are no elements
+    bool empty() const {
+        return m_size == 0;
+    }
+
+    /// @return pointer to the first element
+    T* ptr() {
+        return m_heap ? m_heap : m_inline;
+    }
+
+    /// @return pointer to the first element (const)
+    const T* ptr() const {
+        return m_heap ? m_heap : m_inline;
+    }
+
+    /// @return iterator to the first element
+    iterator begin() {
+        return ptr();
+    }
+    /// @return iterator behind the last element
+    iterator end() {
+        return ptr() + m_size;
+    }
+    /// @return iterator to the first element (const)
+    const_iterator begin() const {
+        return ptr();
+    }
+    /// @return iterator behind the last element (const)
+    const_iterator end() const {
+        return ptr() + m_size;
+    }
+
+    /// element access
+    T& operator[](size_type i) {
+        return ptr()[i];
+    }
+
+    /// element access (const)
+    const T& operator[](size_type i) const {
+        return ptr()[i];
+    }
+
+    /// @return the last element
+    const T& back() const {
+        return ptr()[m_size - 1];
+    }
+
+    /// reverse the array (for transposing etc)
+    void reverse() {
+        std::reverse(begin(), end());
+    }
+
+    /// convert to std::vector (for backward compatibility)
+    operator std::vector<T>() const {
+        return std::vector<T>(begin(), end());
+    }
+
+    /// @return true iff both arrays contain the same elements
+    bool operator==(const shape_array& o) const {
+        return m_size == o.m_size && std::equal(begin(), end(), o.begin());
+    }
+
+    /// @return true iff the arrays differ
+    bool operator!=(const shape_array& o) const {
+        return !(*this == o);
+    }
+
+    /// @return true iff v contains the same elements
+    bool operator==(const std::vector<T>& v) const {
+        return m_size == v.size() && std::equal(begin(), end(), v.begin());
+    }
+
+    /// @return true iff v differs
+    bool operator!=(const std::vector<T>& v) const {
+        return !(*this == v);
+    }
+};
+
+/// @return true iff v and a contain the same elements
+template<class T, unsigned int N>
+bool operator==(const std::vector<T>& v, const shape_array<T, N>& a) {
+    return a == v;
+}
+
+/// @return true iff v and a differ
+template<class T, unsigned int N>
+bool operator!=(const std::vector<T>& v, const shape_array<T, N>& a) {
+    return a != v;
+}
+
+/** @} */ // data_structures
+}
+
+namespace std {
+/**
+ * print a shape_array to a stream
+ * @param o the stream
+ * @param a the array
+ */
+template<class T, unsigned int N>
+ostream& operator<<(ostream& o, const cuv::shape_array<T, N>& a) {
+    o << "[ ";
+    for (unsigned int i = 0; i < a.size(); i++)
+        o << a[i] << " ";
+    o << "]";
+    return o;
+}
+}
+
+#endif
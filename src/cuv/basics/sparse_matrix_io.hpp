@@ -45,6 +45,8 @@
 #include <boost/archive/binary_oarchive.hpp>
 #include <boost/archive/binary_iarchive.hpp>
 #include <cuv/basics/dia_matrix.hpp>
+#include <cuv/basics/csr_matrix.hpp>
+#include <cuv/basics/bsr_matrix.hpp>
 #include <cuv/basics/io.hpp>
 
 namespace cuv{
@@ -70,11 +72,55 @@ namespace cuv{
 			}
 			ar & m.vec();
 		}
+	/**
+	 * Serialize/deserialize a host-csr-matrix to/from an archive.
+	 *
+	 * @param ar the archive
+	 * @param m  the csr-matrix to serialize
+	 * @param version not used
+	 */
+	template<class Archive, class value_type, class index_type>
+		void serialize(Archive& ar, cuv::csr_matrix<value_type,host_memory_space,index_type>& m, const unsigned int version){
+			ar & m.m_width;
+			ar & m.m_height;
+			ar & m.m_nnz;
+			ar & m.m_vals;
+			ar & m.m_row_ptr;
+			ar & m.m_col_idx;
+		}
+	/**
+	 * Serialize/deserialize a host-bsr-matrix to/from an archive.
+	 *
+	 * @param ar the archive
+	 * @param m  the bsr-matrix to serialize
+	 * @param version not used
+	 */
+	template<class Archive, class value_type, class index_type>
+		void serialize(Archive& ar, cuv::bsr_matrix<value_type,host_memory_space,index_type>& m, const unsigned int version){
+			ar & m.m_width;
+			ar & m.m_height;
+			ar & m.m_block_h;
+			ar & m.m_block_w;
+			ar & m.m_nnzb;
+			ar & m.m_vals;
+			ar & m.m_row_ptr;
+			ar & m.m_col_idx;
+		}
 	/**
 	 * explicit instantiation of serialization for dia-matrices in binary oarchives
 	 */
 	template
 		void serialize(boost::archive::binary_oarchive&, dia_matrix<float, host_memory_space, unsigned int>&, unsigned int);
+	/**
+	 * explicit instantiation of serialization for csr-matrices in binary oarchives
+	 */
+	template
+		void serialize(boost::archive::binary_oarchive&, csr_matrix<float, host_memory_space, unsigned int>&, unsigned int);
+	/**
+	 * explicit instantiation of serialization for bsr-matrices in binary oarchives
+	 */
+	template
+		void serialize(boost::archive::binary_oarchive&, bsr_matrix<float, host_memory_space, unsigned int>&, unsigned int);
 }
 
 #endif
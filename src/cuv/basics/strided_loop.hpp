@@ -0,0 +1,340 @@
+#ifndef __CUV_STRIDED_LOOP_HPP__
+#define __CUV_STRIDED_LOOP_HPP__
+
+#include <algorithm>
+#include <boost/static_assert.hpp>
+#include <cstddef>
+
+#include "memory.hpp"
+#include "shape_array.hpp"
+#include <cuv/tools/cuv_general.hpp>
+#include <cuv/tools/thread_pool.hpp>
+
+namespace cuv {
+
+namespace detail {
+
+/**
+ * @addtogroup data_structures
+ * @{
+ */
+
+/**
+ * a loop nest over K arrays of the same shape but arbitrary strides.
+ *
+ * Elements are visited in row-major order of the shape, i.e. the last
+ * dimension is the innermost loop.  Before iterating, dimensions of extent one
+ * are dropped and neighbouring dimensions are merged if they are laid out
+ * contiguously relative to each other in all K arrays.  A fully contiguous
+ * tensor therefore becomes a single loop, a pitched matrix or a slice along a
+ * non-leading dimension becomes two.
+ *
+ * The innermost loop is handed to a callback as one "run":
+ * @code
+ * void operator()(const strided_loop<K>::offset_type* offset,
+ *                 const strided_loop<K>::offset_type* stride, size_t n);
+ * @endcode
+ * where offset[k] is the position of the first element of the run in array
+ * k and stride[k] the distance between its elements (both in elements).  If
+ * all strides are one, the callback can use a tight loop the compiler can
+ * vectorize.
+ */
+template<unsigned int K>
+class strided_loop {
+
+public:
+    typedef std::ptrdiff_t offset_type; ///< type of offsets and strides (in elements)
+
+private:
+    shape_array<std::size_t> m_shape; ///< extents after merging dimensions
+    shape_array<offset_type> m_stride[K]; ///< strides of every array after merging dimensions
+    std::size_t m_size; ///< total number of elements
+
+    void init(const shape_array<unsigned int>& shape, const shape_array<int>* const* strides) {
+        const unsigned int nd = shape.size();
+        m_size = 1;
+        m_shape.set_size(nd + 1);
+        for (unsigned int k = 0; k < K; k++) {
+            cuvAssert(strides[k]->size() == nd);
+            m_stride[k].set_size(nd + 1);
+        }
+
+        unsigned int n = 0;
+        for (unsigned int d = 0; d < nd; d++) {
+            m_size *= shape[d];
+            if (shape[d] == 1)
+                continue;
+            bool merge = n > 0;
+            for (unsigned int k = 0; k < K && merge; k++)
+                merge = m_stride[k][n - 1] == (offset_type) (*strides[k])[d] * (offset_type) shape[d];
+            if (merge) {
+                m_shape[n - 1] *= shape[d];
+                for (unsigned int k = 0; k < K; k++)
+                    m_stride[k][n - 1] = (*strides[k])[d];
+                continue;
+            }
+            m_shape[n] = shape[d];
+            for (unsigned int k = 0; k < K; k++)
+                m_stride[k][n] = (*strides[k])[d];
+            n++;
+        }
+        if (n == 0) {
+            // a single element (or a tensor without dimensions)
+            m_shape[0] = 1;
+            for (unsigned int k = 0; k < K; k++)
+                m_stride[k][0] = 1;
+            n = 1;
+        }
+        if (m_size == 0)
+            m_shape[0] = 0;
+        m_shape.set_size(n);
+        for (unsigned int k = 0; k < K; k++)
+            m_stride[k].set_size(n);
+    }
+
+public:
+
+    /// loop over a single array
+    strided_loop(const shape_array<unsigned int>& shape, const shape_array<int>& s0) {
+        BOOST_STATIC_ASSERT(K == 1);
+        const shape_array<int>* s[] = { &s0 };
+        init(shape, s);
+    }
+
+    /// loop over two arrays of the same shape
+    strided_loop(const shape_array<unsigned int>& shape, const shape_array<int>& s0, const shape_array<int>& s1) {
+        BOOST_STATIC_ASSERT(K == 2);
+        const shape_array<int>* s[] = { &s0, &s1 };
+        init(shape, s);
+    }
+
+    /// loop over three arrays of the same shape
+    strided_loop(const shape_array<unsigned int>& shape, const shape_array<int>& s0, const shape_array<int>& s1,
+            const shape_array<int>& s2) {
+        BOOST_STATIC_ASSERT(K == 3);
+        const shape_array<int>* s[] = { &s0, &s1, &s2 };
+        init(shape, s);
+    }
+
+    /// @return total number of elements
+    std::size_t size() const {
+        return m_size;
+    }
+
+    /// @return number of dimensions after merging (at least one)
+    unsigned int ndim() const {
+        return m_shape.size();
+    }
+
+    /// @return extent of (merged) dimension d
+    std::size_t shape(unsigned int d) const {
+        return m_shape[d];
+    }
+
+    /// @return stride of array k in (merged) dimension d
+    offset_type stride(unsigned int k, unsigned int d) const {
+        return m_stride[k][d];
+    }
+
+    /// @return true iff the innermost loop is contiguous in all arrays
+    bool inner_contiguous() const {
+        for (unsigned int k = 0; k < K; k++)
+            if (m_stride[k][ndim() - 1] != 1)
+                return false;
+        return true;
+    }
+
+    /**
+     * call f for all runs covering the elements [begin,end) in row-major order.
+     *
+     * Runs never cross the end of the innermost dimension, so f is called
+     * at least once per row.
+     */
+    template<class F>
+    void run(std::size_t begin, std::size_t end, F& f) const {
+        if (begin >= end)
+            return;
+        const unsigned int inner = ndim() - 1;
+        shape_array<std::size_t> idx(ndim());
+        offset_type off[K];
+        offset_type inner_stride[K];
+        for (unsigned int k = 0; k < K; k++) {
+            off[k] = 0;
+            inner_stride[k] = m_stride[k][inner];
+        }
+
+        std::size_t rest = begin;
+        for (int d = inner; d >= 0; --d) {
+            idx[d] = rest % m_shape[d];
+            rest /= m_shape[d];
+            for (unsigned int k = 0; k < K; k++)
+                off[k] += (offset_type) idx[d] * m_stride[k][d];
+        }
+
+        std::size_t pos = begin;
+        for (;;) {
+            std::size_t n = std::min(m_shape[inner] - idx[inner], end - pos);
+            f((const offset_type*) off, (const offset_type*) inner_stride, n);
+            pos += n;
+            if (pos >= end)
+                return;
+
+            // the run ended with the innermost dimension, go to the start of the next row
+            for (unsigned int k = 0; k < K; k++)
+                off[k] -= (offset_type) idx[inner] * inner_stride[k];
+            idx[inner] = 0;
+            for (int d = inner - 1; d >= 0; --d) {
+                for (unsigned int k = 0; k < K; k++)
+                    off[k] += m_stride[k][d];
+                if (++idx[d] < m_shape[d])
+                    break;
+                for (unsigned int k = 0; k < K; k++)
+                    off[k] -= (offset_type) m_shape[d] * m_stride[k][d];
+                idx[d] = 0;
+            }
+        }
+    }
+};
+
+/**
+ * adapts a strided_loop and a run callback to parallel_for
+ */
+template<unsigned int K, class F>
+struct strided_loop_range {
+    const strided_loop<K>& m_loop; ///< the loop nest
+    F& m_f; ///< the run callback
+    /// constructor
+    strided_loop_range(const strided_loop<K>& l, F& f) :
+            m_loop(l), m_f(f) {
+    }
+    /// process elements [begin,end)
+    void operator()(std::size_t begin, std::size_t end) {
+        m_loop.run(begin, end, m_f);
+    }
+};
+
+/**
+ * call f for all runs of loop, possibly in parallel on the host thread pool.
+ *
+ * @see parallel_for
+ * @param loop  the loop nest
+ * @param grain number of elements in one chunk
+ * @param f     run callback, must be safe to call concurrently
+ */
+template<unsigned int K, class F>
+void strided_parallel_for(const strided_loop<K>& loop, std::size_t grain, F& f) {
+    strided_loop_range<K, F> r(loop, f);
+    parallel_for(loop.size(), grain, r);
+}
+
+/**
+ * copies one run of a strided host copy
+ */
+template<class V>
+struct strided_copy_run {
+    V* m_dst; ///< destination base pointer
+    const V* m_src; ///< source base pointer
+    /// constructor
+    strided_copy_run(V* dst, const V* src) :
+            m_dst(dst), m_src(src) {
+    }
+    /// copy n elements
+    void operator()(const std::ptrdiff_t* off, const std::ptrdiff_t* stride, std::size_t n) {
+        V* d = m_dst + off[0];
+        const V* s = m_src + off[1];
+        if (stride[0] == 1 && stride[1] == 1) {
+            std::copy(s, s + n, d);
+        } else {
+            const std::ptrdiff_t ds = stride[0], ss = stride[1];
+            for (std::size_t i = 0; i < n; i++, d += ds, s += ss)
+                *d = *s;
+        }
+    }
+};
+
+/**
+ * copies an arbitrarily strided array to another one of the same shape.
+ *
+ * Shapes and strides are given in row-major order (the last dimension varies
+ * fastest).  Host to host copies run in parallel on the host thread pool.
+ *
+ * @param dst        destination base pointer
+ * @param src        source base pointer
+ * @param shape      shape of both arrays
+ * @param dst_stride strides of dst (in elements)
+ * @param src_stride strides of src (in elements)
+ * @param stream     ignored for host to host copies
+ */
+template<class V>
+void copy_strided(V* dst, const V* src, const shape_array<unsigned int>& shape,
+        const shape_array<int>& dst_stride, const shape_array<int>& src_stride,
+        host_memory_space, host_memory_space, cudaStream_t stream) {
+    strided_loop<2> loop(shape, dst_stride, src_stride);
+    strided_copy_run<V> r(dst, src);
+    strided_parallel_for(loop, host_chunk_size(2 * sizeof(V)), r);
+}
+
+/**
+ * @overload
+ *
+ * copies involving device memory are issued as one copy2d for every 2D plane
+ * of the array (if the innermost dimension is contiguous) or for every row
+ * (otherwise).  Strides must be positive.
+ */
+template<class V, class M, class OM>
+void copy_strided(V* dst, const V* src, const shape_array<unsigned int>& shape,
+        const shape_array<int>& dst_stride, const shape_array<int>& src_stride,
+        M, OM, cudaStream_t stream) {
+    typedef strided_loop<2>::offset_type offset_type;
+    strided_loop<2> loop(shape, dst_stride, src_stride);
+    if (loop.size() == 0)
+        return;
+    const int nd = loop.ndim();
+    const bool contiguous = loop.inner_contiguous();
+    // number of dimensions handled by one copy2d
+    const int n_inner = contiguous ? std::min(2, nd) : 1;
+    std::size_t h, w;
+    offset_type dpitch, spitch;
+    if (contiguous) {
+        w = loop.shape(nd - 1);
+        h = n_inner == 2 ? loop.shape(nd - 2) : 1;
+        dpitch = n_inner == 2 ? loop.stride(0, nd - 2) : w;
+        spitch = n_inner == 2 ? loop.stride(1, nd - 2) : w;
+    } else {
+        w = 1;
+        h = loop.shape(nd - 1);
+        dpitch = loop.stride(0, nd - 1);
+        spitch = loop.stride(1, nd - 1);
+    }
+    cuvAssert(dpitch > 0 && spitch > 0);
+
+    // iterate over the remaining outer dimensions
+    const int n_outer = nd - n_inner;
+    shape_array<std::size_t> idx(std::max(n_outer, 1));
+    std::fill(idx.begin(), idx.end(), 0);
+    offset_type doff = 0, soff = 0;
+    for (;;) {
+        if (h == 1 && contiguous)
+            copy(dst + doff, src + soff, w, M(), OM(), stream);
+        else
+            copy2d(dst + doff, src + soff, dpitch, spitch, h, w, M(), OM(), stream);
+        int d = n_outer - 1;
+        for (; d >= 0; --d) {
+            doff += loop.stride(0, d);
+            soff += loop.stride(1, d);
+            if (++idx[d] < loop.shape(d))
+                break;
+            doff -= (offset_type) loop.shape(d) * loop.stride(0, d);
+            soff -= (offset_type) loop.shape(d) * loop.stride(1, d);
+            idx[d] = 0;
+        }
+        if (d < 0)
+            return;
+    }
+}
+
+/** @} */ // data_structures
+}
+}
+
+#endif
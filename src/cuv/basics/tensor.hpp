@@ -4,6 +4,7 @@
 #include <boost/multi_array/extent_gen.hpp>
 #include <boost/multi_array/index_gen.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/static_assert.hpp>
 #include <iostream>
 #include <limits>
 #include <numeric>
@@ -12,6 +13,7 @@
 
 #include "allocators.hpp"
 #include "memory.hpp"
+#include "strided_loop.hpp"
 #include <cuv/tools/meta_programming.hpp>
 #include <cuv/tools/cuv_general.hpp>
 
@@ -80,6 +82,12 @@ template<class V, class M, class L> class tensor_view;
 template<class V, class M, class L, class S>
 void fill(tensor<V, M, L>& v, const S& p);
 
+template<class E> struct expression;
+
+/// used in implementation of tensor.operator= for lazily evaluated expressions
+template<class V, class M, class L, class E>
+void evaluate(tensor<V, M, L>& dst, const expression<E>& e, bool rebind);
+
 namespace detail {
 
 /**
@@ -90,10 +98,10 @@ namespace detail {
  */
 template<class index_type, class size_type>
 void get_pitched_params(size_type& rows, size_type& cols, size_type& pitch,
-        const linear_memory<size_type, host_memory_space>& shape,
-        const linear_memory<index_type, host_memory_space>& stride, row_major) {
+        const shape_array<size_type>& shape,
+        const shape_array<index_type>& stride, row_major) {
     // strided dimension is the LAST one
-    rows = std::accumulate(shape[0].ptr, shape[0].ptr + shape.size() - 1, 1, std::multiplies<index_type>());
+    rows = std::accumulate(shape.begin(), shape.end() - 1, 1, std::multiplies<index_type>());
     cols = shape[shape.size() - 1];
     pitch = stride[shape.size() - 2];
 }
@@ -103,10 +111,10 @@ void get_pitched_params(size_type& rows, size_type& cols, size_type& pitch,
  */
 template<class index_type, class size_type>
 void get_pitched_params(size_type& rows, size_type& cols, size_type& pitch,
-        const linear_memory<size_type, host_memory_space>& shape,
-        const linear_memory<index_type, host_memory_space>& stride, column_major) {
+        const shape_array<size_type>& shape,
+        const shape_array<index_type>& stride, column_major) {
     // strided dimension is the FIRST one
-    rows = std::accumulate(shape[0].ptr + 1, shape[0].ptr + shape.size(), 1, std::multiplies<index_type>());
+    rows = std::accumulate(shape.begin() + 1, shape.end(), 1, std::multiplies<index_type>());
     cols = shape[0];
     pitch = stride[1];
 }
@@ -114,7 +122,7 @@ void get_pitched_params(size_type& rows, size_type& cols, size_type& pitch,
 }
 
 /**
- * contains infos about shape and stride on host and in the tensor data space.
+ * contains infos about shape and stride of a tensor.
  */
 template<class M, class L>
 class tensor_info {
@@ -127,39 +135,31 @@ public:
 
     boost::shared_ptr<allocator> m_allocator;
 
-    /// shape stored in host memory
-    linear_memory<size_type, host_memory_space> host_shape;
-
-    /// strides stored in host memory
-    linear_memory<index_type, host_memory_space> host_stride;
-
-    /// shape stored in data memory
-    linear_memory<size_type, data_memory_space> data_shape;
+    /// shape stored in host memory (inline for up to SHAPE_ARRAY_INLINE_SIZE dimensions)
+    shape_array<size_type> host_shape;
 
-    /// strides stored in data memory
-    linear_memory<index_type, data_memory_space> data_stride;
+    /// strides stored in host memory (inline for up to SHAPE_ARRAY_INLINE_SIZE dimensions)
+    shape_array<index_type> host_stride;
 
     /// default constructor: does nothing
     tensor_info(const boost::shared_ptr<allocator>& _allocator) :
-            m_allocator(_allocator), host_shape(_allocator), host_stride(_allocator),
-                    data_shape(_allocator), data_stride(_allocator)
+            m_allocator(_allocator)
     {
     }
 
     /// @return the size of the arrays (should all be the same)
-    size_type size() {
+    size_type size() const {
         return host_shape.size();
     }
 
     /// construct with known shape
     tensor_info(size_type s, const boost::shared_ptr<allocator>& _allocator) :
-            m_allocator(_allocator), host_shape(_allocator), host_stride(_allocator),
-                    data_shape(_allocator), data_stride(_allocator)
+            m_allocator(_allocator)
     {
         resize(s);
     }
 
-    /// resize all memories
+    /// resize shape and strides
     void resize(size_type s) {
         host_shape.set_size(s);
         host_stride.set_size(s);
@@ -167,16 +167,14 @@ public:
 
     /// copy-constructor
     tensor_info(const tensor_info<M, L>& o) :
-            m_allocator(o.m_allocator), host_shape(o.host_shape), host_stride(o.host_stride),
-                    data_shape(m_allocator), data_stride(m_allocator)
+            m_allocator(o.m_allocator), host_shape(o.host_shape), host_stride(o.host_stride)
     {
     }
 
     /// copy-construct from other memory space
     template<class OM>
     tensor_info(const tensor_info<OM, L>& o) :
-            m_allocator(o.m_allocator), host_shape(o.host_shape), host_stride(o.host_stride),
-                    data_shape(m_allocator), data_stride(m_allocator)
+            m_allocator(o.m_allocator), host_shape(o.host_shape), host_stride(o.host_stride)
     {
     }
 
@@ -358,7 +356,7 @@ public:
     /** @return the number of stored elements
      */
     size_type size() const {
-        size_t size = std::accumulate(m_info.host_shape[0].ptr, m_info.host_shape[0].ptr + m_info.host_shape.size(), 1,
+        size_t size = std::accumulate(m_info.host_shape.begin(), m_info.host_shape.end(), 1,
                 std::multiplies<size_t>());
 
         check_size_limit(size);
@@ -377,7 +375,7 @@ public:
 #ifndef NDEBUG
         cuvAssert(is_c_contiguous());
 #endif
-        size_t size = std::accumulate(m_info.host_shape[0].ptr, m_info.host_shape[0].ptr + m_info.host_shape.size(), (size_t)sizeof(value_type),
+        size_t size = std::accumulate(m_info.host_shape.begin(), m_info.host_shape.end(), (size_t)sizeof(value_type),
                 std::multiplies<size_type>());
 
         check_size_limit(size);
@@ -385,25 +383,26 @@ public:
         return static_cast<size_type>(size);
     }
 
-    /// return the shape of the tensor (as a vector for backward compatibility)
-    std::vector<size_type> shape() const {
-        if (ndim() == 0)
-            return std::vector<size_type>();
-        return std::vector<size_type>(m_info.host_shape[0].ptr, m_info.host_shape[0].ptr + m_info.host_shape.size());
+    /**
+     * return the shape of the tensor
+     *
+     * The result does not allocate memory for up to SHAPE_ARRAY_INLINE_SIZE
+     * dimensions. It converts to std::vector for backward compatibility.
+     */
+    shape_array<size_type> shape() const {
+        return m_info.host_shape;
     }
 
     /**
-     * return the effective shape of the tensor (as a vector for backward compatibility)
+     * return the effective shape of the tensor
      *
      * the effective shape removes all degenerate dimensions (i.e. shape(i)==1).
      */
-    std::vector<size_type> effective_shape() const {
-        std::vector<size_type> shape;
-        shape.reserve(ndim());
-        if (ndim() == 0)
-            return shape;
-        std::remove_copy_if(m_info.host_shape[0].ptr, m_info.host_shape[0].ptr + m_info.host_shape.size(),
-                std::back_inserter(shape), std::bind2nd(std::equal_to<size_type>(), 1));
+    shape_array<size_type> effective_shape() const {
+        shape_array<size_type> shape(ndim());
+        size_type* end = std::remove_copy_if(m_info.host_shape.begin(), m_info.host_shape.end(),
+                shape.begin(), std::bind2nd(std::equal_to<size_type>(), 1));
+        shape.set_size(end - shape.begin());
         return shape;
     }
 
@@ -437,37 +436,24 @@ public:
      * member access: "flat" access as if memory was linear
      */
     reference_type operator[](index_type idx) {
-        size_type ndim = m_info.host_shape.size();
-        size_type* virtualstride = new size_type[ndim];
+        const int ndim = m_info.host_shape.size();
+        if (ndim == 1)
+            return reference_type(m_ptr + idx * m_info.host_stride[0]);
         size_type pos = 0;
+        size_type rest = idx;
         if (IsSame<L, row_major>::Result::value) {
-            // row major
-            {
-                size_type virt_size = 1;
-                for (int i = ndim - 1; i >= 0; --i) {
-                    virtualstride[i] = virt_size;
-                    virt_size *= m_info.host_shape[i];
-                }
-            }
-            for (size_type i = 0; i < ndim; ++i) {
-                pos += (idx / virtualstride[i]) * m_info.host_stride[i];
-                idx -= (idx / virtualstride[i]) * virtualstride[i];
+            // row major: the last dimension varies fastest
+            for (int i = ndim - 1; i >= 0; --i) {
+                pos += (rest % m_info.host_shape[i]) * m_info.host_stride[i];
+                rest /= m_info.host_shape[i];
             }
         } else {
-            // column major
-            {
-                size_type virt_size = 1;
-                for (unsigned int i = 0; i < ndim; ++i) {
-                    virtualstride[i] = virt_size;
-                    virt_size *= m_info.host_shape[i];
-                }
-            }
-            for (int i = ndim - 1; i >= 0; --i) {
-                pos += (idx / virtualstride[i]) * m_info.host_stride[i];
-                idx -= (idx / virtualstride[i]) * virtualstride[i];
+            // column major: the first dimension varies fastest
+            for (int i = 0; i < ndim; ++i) {
+                pos += (rest % m_info.host_shape[i]) * m_info.host_stride[i];
+                rest /= m_info.host_shape[i];
             }
         }
-        delete[] virtualstride;
         return reference_type(m_ptr + pos);
     }
 
@@ -486,11 +472,9 @@ public:
         cuvAssert(ndim()==1);
         cuvAssert((i0>=0 && (size_type)i0 < shape(0)) || (i0<0 && (size_type)(-i0)<shape(0)+1))
 #endif
-        if (i0 >= 0) {
-            return reference_type(m_ptr + i0);
-        } else {
-            return reference_type(m_ptr + shape(0) - i0);
-        }
+        if (i0 < 0)
+            i0 += shape(0);
+        return reference_type(m_ptr + i0 * m_info.host_stride[0]);
     }
 
     /** @overload */
@@ -570,6 +554,44 @@ public:
     }
 
     /** @} */ // accessing stored values
+
+    /**
+     * @name STL-compatible iterators
+     *
+     * Raw pointers to the elements of a c_contiguous tensor in host memory,
+     * in the order in which they are stored. Loops over them compile to the
+     * same code as loops over ptr(), unlike loops using operator[] or
+     * operator(), which have to compute the position from the strides.
+     * end() computes size(), so in tight loops it should be evaluated once.
+     * @{
+     */
+    typedef V* iterator; ///< iterator over the elements of a host tensor
+    typedef const V* const_iterator; ///< const iterator over the elements of a host tensor
+
+    /// @return iterator to the first element
+    iterator begin() {
+        BOOST_STATIC_ASSERT((IsSame<M, host_memory_space>::Result::value));
+#ifndef NDEBUG
+        cuvAssert(is_c_contiguous());
+#endif
+        return m_ptr;
+    }
+
+    /// @return iterator behind the last element
+    iterator end() {
+        return begin() + size();
+    }
+
+    /// @return const iterator to the first element
+    const_iterator begin() const {
+        return const_cast<tensor&>(*this).begin();
+    }
+
+    /// @return const iterator behind the last element
+    const_iterator end() const {
+        return begin() + size();
+    }
+    /** @} */ // iterators
     /** @name constructors
      * @{
      *
@@ -581,6 +603,17 @@ public:
             m_allocator(_allocator), m_info(_allocator), m_ptr(NULL) {
     }
 
+    /**
+     * construct tensor from a lazily evaluated expression
+     *
+     * @see expression.hpp
+     */
+    template<class E>
+    tensor(const expression<E>& e) :
+            m_allocator(boost::make_shared<default_allocator>()), m_info(m_allocator), m_ptr(NULL) {
+        evaluate(*this, e, true);
+    }
+
     // ****************************************************************
     //        Constructing from other tensor
     // ****************************************************************
@@ -756,6 +789,32 @@ public:
         allocate(*this, pitched_memory_tag());
     }
 
+    /**
+     * construct tensor from a shape
+     */
+    explicit tensor(const shape_array<size_type>& shape,
+            const boost::shared_ptr<allocator> _allocator = boost::make_shared<default_allocator>()) :
+            m_allocator(_allocator),
+                    m_info(_allocator),
+                    m_ptr(NULL) {
+        m_info.resize(shape.size());
+        m_info.host_shape = shape;
+        allocate(*this, linear_memory_tag());
+    }
+
+    /**
+     * construct tensor from a shape (pitched)
+     */
+    explicit tensor(const shape_array<size_type>& shape, pitched_memory_tag,
+            const boost::shared_ptr<allocator> _allocator = boost::make_shared<default_allocator>()) :
+            m_allocator(_allocator),
+                    m_info(_allocator),
+                    m_ptr(NULL) {
+        m_info.resize(shape.size());
+        m_info.host_shape = shape;
+        allocate(*this, pitched_memory_tag());
+    }
+
     /**
      * construct tensor from a shape (pitched)
      */
@@ -899,6 +958,20 @@ public:
         return *this;
     }
 
+    /**
+     * assign from a lazily evaluated expression
+     *
+     * Overwrites the memory of this tensor if it is not shared with another
+     * tensor and has the right shape, otherwise allocates new memory.
+     *
+     * @see expression.hpp
+     */
+    template<class E>
+    tensor& operator=(const expression<E>& e) {
+        evaluate(*this, e, true);
+        return *this;
+    }
+
     /**
      * assign from tensor of different memory space type.
      *
@@ -973,12 +1046,10 @@ public:
         t.m_memory = o.mem();
         t.m_ptr = const_cast<V*>(o.ptr());
 
-        std::vector<int> shapes;
-        std::vector<int> strides;
-        shapes.reserve(D);
-        strides.reserve(D);
+        // the view has at most o.ndim() dimensions
+        t.m_info.resize(o.ndim());
+        unsigned int n = 0;
         //cuvAssert(o.ndim()==D);
-
         for (size_t i = 0; i < D; i++) {
             int start = idx.ranges_[i].get_start(0);
             int finish = idx.ranges_[i].get_finish(o.shape(i));
@@ -995,22 +1066,18 @@ public:
             if (idx.ranges_[i].is_degenerate()) {
                 // skip dimension
             } else {
-                shapes.push_back((finish - start) / stride);
-                strides.push_back(o.stride(i) * stride);
+                t.m_info.host_shape[n] = (finish - start + stride - 1) / stride;
+                t.m_info.host_stride[n] = o.stride(i) * stride;
+                n++;
             }
         }
-
         // adds missing shapes
         for(int i = D; i < o.ndim();i++){
-            shapes.push_back(o.shape(i));
-            strides.push_back(o.stride(i));
+            t.m_info.host_shape[n] = o.shape(i);
+            t.m_info.host_stride[n] = o.stride(i);
+            n++;
         }
-
-        // store in m_info
-        t.m_info.resize(shapes.size());
-
-        std::copy(shapes.begin(), shapes.end(), t.m_info.host_shape[0].ptr);
-        std::copy(strides.begin(), strides.end(), t.m_info.host_stride[0].ptr);
+        t.m_info.resize(n);
         return t; // should not copy mem, only m_info
     }
 
@@ -1023,7 +1090,7 @@ public:
      */
     template<size_t D>
     void reshape(const extent_gen<D>& eg) {
-        std::vector<size_type> shape(D);
+        shape_array<size_type> shape(D);
         for (size_t i = 0; i < D; i++)
             shape[i] = eg.ranges_[i].finish();
         reshape(shape);
@@ -1036,6 +1103,16 @@ public:
      * @param shape new shape
      */
     void reshape(const std::vector<size_type>& shape) {
+        reshape(shape_array<size_type>(shape.begin(), shape.end()));
+    }
+    /**
+     * reshape the tensor (in place)
+     *
+     * works only for c_contiguous memory!
+     *
+     * @param shape new shape
+     */
+    void reshape(const shape_array<size_type>& shape) {
         size_type new_size = std::accumulate(shape.begin(), shape.end(), 1, std::multiplies<size_type>());
         if (!is_c_contiguous())
             throw std::runtime_error("cannot reshape: tensor is not c_contiguous");
@@ -1071,6 +1148,16 @@ public:
      * @param shape new shape
      */
     void resize(const std::vector<size_type>& shape) {
+        resize(shape_array<size_type>(shape.begin(), shape.end()));
+    }
+    /**
+     * resize the tensor (deallocates memory if product changes, otherwise equivalent to reshape)
+     *
+     * @overload
+     *
+     * @param shape new shape
+     */
+    void resize(const shape_array<size_type>& shape) {
         if (ndim() != 0) {
             size_type new_size = std::accumulate(shape.begin(), shape.end(), 1, std::multiplies<size_type>());
             if (is_c_contiguous() && size() == new_size) {
@@ -1092,7 +1179,7 @@ public:
      */
     template<size_t D>
     void resize(const extent_gen<D>& eg) {
-        std::vector<size_type> shape(D);
+        shape_array<size_type> shape(D);
         for (size_t i = 0; i < D; i++)
             shape[i] = eg.ranges_[i].finish();
         resize(shape);
@@ -1124,10 +1211,42 @@ public:
         m_info.host_shape.set_size(0);
     }
 
+    /**
+     * Copies arbitrarily strided memory element by element, see detail::copy_strided.
+     *
+     * The shape of this tensor must equal the shape of src and has not been
+     * reversed yet for different memory layouts.
+     * In that case, elements are copied in the memory order of src, as if src
+     * was contiguous, and this tensor must be contiguous.
+     */
+    template<class OM, class OL>
+    void copy_strided_from(const tensor<V, OM, OL>& src, cudaStream_t stream) {
+        shape_array<size_type> shape = src.info().host_shape;
+        shape_array<index_type> src_stride = src.info().host_stride;
+        shape_array<index_type> dst_stride = info().host_stride;
+        if (!IsSame<L, OL>::Result::value) {
+            if (!is_c_contiguous())
+                throw std::runtime_error("copying strided memory between memory layouts requires a contiguous destination");
+            index_type size = 1;
+            for (int i = shape.size() - 1; i >= 0; --i) {
+                const unsigned int d = IsSame<OL, row_major>::Result::value ? i : shape.size() - 1 - i;
+                dst_stride[d] = size;
+                size *= shape[d];
+            }
+        }
+        if (IsSame<OL, column_major>::Result::value) {
+            // detail::copy_strided expects the fastest varying dimension last
+            shape.reverse();
+            src_stride.reverse();
+            dst_stride.reverse();
+        }
+        detail::copy_strided(m_ptr, src.ptr(), shape, dst_stride, src_stride, memory_space_type(), OM(), stream);
+    }
+
     /** Tries to copy memory w/o reallocation.
      *
-     * Succeeds if shapes match AND both ndarrays are c_contiguous or
-     * 2d-copyable.
+     * Succeeds if shapes match. Memory which is neither c_contiguous nor
+     * 2d-copyable is copied element by element.
      */
     template<class OM, class OL>
     bool copy_memory(const tensor<V, OM, OL>& src, bool force_dst_contiguous, cudaStream_t stream) {
@@ -1165,7 +1284,9 @@ public:
             //m_memory->copy2d_from(src.ptr(), dpitch, spitch, srow, scol, OM(), stream);
             detail::copy2d(m_ptr, src.ptr(), dpitch, spitch, srow, scol, memory_space_type(), OM(), stream);
         } else {
-            throw std::runtime_error("copying of generic strides not implemented yet");
+            if (force_dst_contiguous && !is_c_contiguous())
+                return false;
+            copy_strided_from(src, stream);
         }
 
         if (!IsSame<L, OL>::Result::value) {
@@ -1202,7 +1323,9 @@ public:
             detail::get_pitched_params(row, col, pitch, src.info().host_shape, src.info().host_stride, OL());
             d.copy2d_from(src.ptr(), col, pitch, row, col, OM(), stream);
         } else {
-            throw std::runtime_error("copying arbitrarily strided memory not implemented");
+            // some view onto an array, e.g. a slice along a non-leading dimension
+            m_ptr = d.ptr();
+            copy_strided_from(src, stream);
         }
         mem().reset(new memory<V, M>(d.release(), d.size(), m_allocator));
         m_ptr = mem()->ptr();
@@ -1337,6 +1460,18 @@ public:
         return *this;
     }
 
+    /**
+     * assign from a lazily evaluated expression (always overwrites the viewed memory)
+     *
+     * @param e an expression of the same shape as this view
+     * @see expression.hpp
+     */
+    template<class E>
+    tensor_view& operator=(const expression<E>& e) {
+        evaluate(*this, e, false);
+        return *this;
+    }
+
     /**
      * assignment operator for other memory space type
      *
@@ -1390,10 +1525,9 @@ public:
     {
         m_memory = o.mem();
         m_ptr = const_cast<V*>(o.ptr());
-        std::vector<int> shapes;
-        std::vector<int> strides;
-        shapes.reserve(D);
-        strides.reserve(D);
+        // the view has at most o.ndim() dimensions
+        m_info.resize(o.ndim());
+        unsigned int n = 0;
         //cuvAssert(o.ndim()==D);
         for (size_t i = 0; i < D; i++) {
             int start = idx.ranges_[i].get_start(0);
@@ -1411,19 +1545,18 @@ public:
             if (idx.ranges_[i].is_degenerate()) {
                 // skip dimension
             } else {
-                shapes.push_back((finish - start) / stride);
-                strides.push_back(o.stride(i) * stride);
+                m_info.host_shape[n] = (finish - start + stride - 1) / stride;
+                m_info.host_stride[n] = o.stride(i) * stride;
+                n++;
             }
         }
         // adds missing shapes
         for(int i = D; i < o.ndim();i++){
-            shapes.push_back(o.shape(i));
-            strides.push_back(o.stride(i));
+            m_info.host_shape[n] = o.shape(i);
+            m_info.host_stride[n] = o.stride(i);
+            n++;
         }
-        // store in m_info
-        m_info.resize(shapes.size());
-        std::copy(shapes.begin(), shapes.end(), m_info.host_shape[0].ptr);
-        std::copy(strides.begin(), strides.end(), m_info.host_stride[0].ptr);
+        m_info.resize(n);
     }
 
     /**
@@ -1439,10 +1572,9 @@ public:
     {
         m_memory = o.mem();
         m_ptr = const_cast<V*>(o.ptr());
-        std::vector<int> shapes;
-        std::vector<int> strides;
-        shapes.reserve(D);
-        strides.reserve(D);
+        // the view has at most o.ndim() dimensions
+        m_info.resize(o.ndim());
+        unsigned int n = 0;
         //cuvAssert(o.ndim()==D);
         for (size_t i = 0; i < D; i++) {
             int start = idx.ranges_[i].get_start(0);
@@ -1460,19 +1592,18 @@ public:
             if (idx.ranges_[i].is_degenerate()) {
                 // skip dimension
             } else {
-                shapes.push_back((finish - start) / stride);
-                strides.push_back(o.stride(i) * stride);
+                m_info.host_shape[n] = (finish - start + stride - 1) / stride;
+                m_info.host_stride[n] = o.stride(i) * stride;
+                n++;
             }
         }
         // adds missing shapes
         for(int i = D; i < o.ndim();i++){
-            shapes.push_back(o.shape(i));
-            strides.push_back(o.stride(i));
+            m_info.host_shape[n] = o.shape(i);
+            m_info.host_stride[n] = o.stride(i);
+            n++;
         }
-        // store in m_info
-        m_info.resize(shapes.size());
-        std::copy(shapes.begin(), shapes.end(), m_info.host_shape[0].ptr);
-        std::copy(strides.begin(), strides.end(), m_info.host_stride[0].ptr);
+        m_info.resize(n);
     }
 };
 
@@ -1488,6 +1619,30 @@ bool equal_shape(const tensor<V, M, L>& a, const tensor<V2, M2, L>& b) {
     return a.effective_shape() == b.effective_shape();
 }
 
+#ifdef CUV_NO_CUDA
+namespace detail {
+/**
+ * a host tensor which refers to the memory of a device tensor, without copying.
+ *
+ * Only available if CUV is built without CUDA (see cuda_compat.hpp), where
+ * device memory is host memory.  Device code paths use it to forward to the
+ * host implementation.
+ */
+template<class V, class L>
+tensor<V, host_memory_space, L> host_alias(const tensor<V, dev_memory_space, L>& t) {
+    tensor<V, host_memory_space, L> h(std::vector<unsigned int>(t.shape()), const_cast<V*>(t.ptr()));
+    h.info().host_stride = t.info().host_stride;
+    return h;
+}
+
+/// @overload for code which is instantiated for both memory spaces
+template<class V, class L>
+tensor<V, host_memory_space, L> host_alias(const tensor<V, host_memory_space, L>& t) {
+    return t;
+}
+}
+#endif
+
 /**
  * @addtogroup MetaProgramming
  */
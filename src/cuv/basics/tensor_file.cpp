@@ -0,0 +1,199 @@
+#include "tensor_file.hpp"
+
+#include <boost/format.hpp>
+#include <boost/static_assert.hpp>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <limits>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace cuv {
+
+namespace {
+
+const char TENSOR_FILE_MAGIC[8] = { 'C', 'U', 'V', 'T', 'N', 'S', 'R', '\0' };
+const boost::uint32_t TENSOR_FILE_VERSION = 1;
+const boost::uint64_t TENSOR_FILE_ALIGNMENT = 64;
+
+/// position of the payload in a file with ndim dimensions
+boost::uint64_t tensor_file_data_offset(boost::uint32_t ndim) {
+    const boost::uint64_t end = sizeof(tensor_file_header) + ndim * 2 * sizeof(boost::uint64_t);
+    return (end + TENSOR_FILE_ALIGNMENT - 1) / TENSOR_FILE_ALIGNMENT * TENSOR_FILE_ALIGNMENT;
+}
+
+void throw_errno(const std::string& what, const std::string& filename) {
+    throw std::runtime_error((boost::format("%s '%s': %s") % what % filename % std::strerror(errno)).str());
+}
+
+void throw_invalid(const std::string& filename, const std::string& why) {
+    throw std::runtime_error((boost::format("'%s' is not a valid tensor file: %s") % filename % why).str());
+}
+
+}
+
+mapped_tensor_file::mapped_tensor_file(const std::string& filename, tensor_file_mode mode) :
+        m_filename(filename), m_base(NULL), m_length(0), m_span(0) {
+    BOOST_STATIC_ASSERT(sizeof(tensor_file_header) == 64);
+
+    int fd = ::open(filename.c_str(), mode == TF_READ_WRITE ? O_RDWR : O_RDONLY);
+    if (fd < 0)
+        throw_errno("could not open tensor file", filename);
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw_errno("could not stat tensor file", filename);
+    }
+    m_length = st.st_size;
+    if (m_length < sizeof(tensor_file_header)) {
+        ::close(fd);
+        throw_invalid(filename, "file is too short");
+    }
+
+    const int prot = mode == TF_READ_ONLY ? PROT_READ : PROT_READ | PROT_WRITE;
+    const int flags = mode == TF_COPY_ON_WRITE ? MAP_PRIVATE : MAP_SHARED;
+    m_base = mmap(NULL, m_length, prot, flags, fd, 0);
+    // the mapping stays valid after closing the descriptor
+    ::close(fd);
+    if (m_base == MAP_FAILED) {
+        m_base = NULL;
+        throw_errno("could not map tensor file", filename);
+    }
+
+    try {
+        std::memcpy(&m_header, m_base, sizeof(tensor_file_header));
+        const tensor_file_header& h = m_header;
+        if (std::memcmp(h.magic, TENSOR_FILE_MAGIC, sizeof(TENSOR_FILE_MAGIC)) != 0)
+            throw_invalid(filename, "wrong magic number");
+        if (h.version != TENSOR_FILE_VERSION)
+            throw_invalid(filename, (boost::format("unsupported version %d") % h.version).str());
+        if (h.data_offset % TENSOR_FILE_ALIGNMENT != 0 || h.data_offset < tensor_file_data_offset(h.ndim))
+            throw_invalid(filename, "bad payload offset");
+        if (h.data_offset > m_length || h.data_bytes > m_length - h.data_offset)
+            throw_invalid(filename, "file is truncated");
+
+        const char* dims = static_cast<const char*>(m_base) + sizeof(tensor_file_header);
+        m_shape.set_size(h.ndim);
+        m_stride.set_size(h.ndim);
+        boost::uint64_t size = 1, span = 1;
+        for (unsigned int i = 0; i < h.ndim; i++) {
+            boost::uint64_t s;
+            boost::int64_t d;
+            std::memcpy(&s, dims + i * sizeof(s), sizeof(s));
+            std::memcpy(&d, dims + (h.ndim + i) * sizeof(s), sizeof(d));
+            if (s > (boost::uint64_t) std::numeric_limits<int>::max() || d < 0
+                    || d > (boost::int64_t) std::numeric_limits<int>::max())
+                throw_invalid(filename, "shape or stride out of range");
+            m_shape[i] = s;
+            m_stride[i] = d;
+            size *= s;
+            if (s > 0)
+                span += (s - 1) * d;
+        }
+        if (h.ndim == 0 || size == 0)
+            span = 0;
+        if (span > (boost::uint64_t) std::numeric_limits<int>::max())
+            throw_invalid(filename, "tensor is too large");
+        if (h.elem_size == 0 || span * h.elem_size > h.data_bytes)
+            throw_invalid(filename, "shape and strides exceed the payload");
+        m_span = span;
+    } catch (...) {
+        munmap(m_base, m_length);
+        throw;
+    }
+}
+
+mapped_tensor_file::~mapped_tensor_file() {
+    if (m_base)
+        munmap(m_base, m_length);
+}
+
+void mapped_tensor_file::check_type(boost::uint32_t dtype, boost::uint32_t elem_size, boost::uint32_t layout) const {
+    if (m_header.dtype != dtype || m_header.elem_size != elem_size)
+        throw std::runtime_error(
+                (boost::format("tensor file '%s' stores element type %d of size %d, requested type %d of size %d")
+                        % m_filename % m_header.dtype % m_header.elem_size % dtype % elem_size).str());
+    if (m_header.layout != layout)
+        throw std::runtime_error(
+                (boost::format("tensor file '%s' stores a %s tensor") % m_filename
+                        % (m_header.layout == 0 ? "row-major" : "column-major")).str());
+}
+
+namespace detail {
+
+tensor_file_writer_base::tensor_file_writer_base(const std::string& filename, boost::uint32_t dtype,
+        boost::uint32_t elem_size, boost::uint32_t layout, const shape_array<unsigned int>& shape,
+        const shape_array<int>& stride) :
+        m_filename(filename), m_file(NULL), m_data_bytes(0), m_written(0) {
+    cuvAssert(shape.size() == stride.size());
+    const boost::uint32_t ndim = shape.size();
+
+    tensor_file_header h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, TENSOR_FILE_MAGIC, sizeof(TENSOR_FILE_MAGIC));
+    h.version = TENSOR_FILE_VERSION;
+    h.dtype = dtype;
+    h.elem_size = elem_size;
+    h.layout = layout;
+    h.ndim = ndim;
+    h.data_offset = tensor_file_data_offset(ndim);
+    boost::uint64_t size = ndim > 0 ? 1 : 0;
+    for (unsigned int i = 0; i < ndim; i++)
+        size *= shape[i];
+    h.data_bytes = size * elem_size;
+    m_data_bytes = h.data_bytes;
+
+    std::vector<char> head(h.data_offset, 0);
+    std::memcpy(&head[0], &h, sizeof(h));
+    for (unsigned int i = 0; i < ndim; i++) {
+        const boost::uint64_t s = shape[i];
+        const boost::int64_t d = stride[i];
+        std::memcpy(&head[sizeof(h) + i * sizeof(s)], &s, sizeof(s));
+        std::memcpy(&head[sizeof(h) + (ndim + i) * sizeof(s)], &d, sizeof(d));
+    }
+
+    m_file = std::fopen(filename.c_str(), "wb");
+    if (!m_file)
+        throw_errno("could not create tensor file", filename);
+    if (std::fwrite(&head[0], 1, head.size(), m_file) != head.size()) {
+        std::fclose(m_file);
+        m_file = NULL;
+        throw_errno("could not write tensor file", filename);
+    }
+}
+
+tensor_file_writer_base::~tensor_file_writer_base() {
+    if (m_file)
+        std::fclose(m_file);
+}
+
+void tensor_file_writer_base::write_bytes(const void* ptr, size_t n) {
+    if (!m_file)
+        throw std::runtime_error((boost::format("tensor file '%s' is already closed") % m_filename).str());
+    if (n > m_data_bytes - m_written)
+        throw std::runtime_error(
+                (boost::format("writing %d bytes exceeds the size of tensor file '%s' (%d bytes missing)") % n
+                        % m_filename % (m_data_bytes - m_written)).str());
+    if (n && std::fwrite(ptr, 1, n, m_file) != n)
+        throw_errno("could not write tensor file", m_filename);
+    m_written += n;
+}
+
+void tensor_file_writer_base::close() {
+    if (!m_file)
+        return;
+    const int res = std::fclose(m_file);
+    m_file = NULL;
+    if (res != 0)
+        throw_errno("could not write tensor file", m_filename);
+    if (m_written != m_data_bytes)
+        throw std::runtime_error(
+                (boost::format("tensor file '%s' is incomplete: %d of %d bytes written") % m_filename % m_written
+                        % m_data_bytes).str());
+}
+
+}
+
+}
@@ -0,0 +1,453 @@
+#ifndef __CUV_TENSOR_FILE_HPP__
+#define __CUV_TENSOR_FILE_HPP__
+
+#include <algorithm>
+#include <boost/cstdint.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "allocators.hpp"
+#include "tensor.hpp"
+
+namespace cuv {
+
+/**
+ * @addtogroup io
+ *
+ * \section sec_tensor_file Memory-mapped tensor files
+ *
+ * Besides boost::serialization (see io.hpp), tensors can be stored in a
+ * native binary format which can be mapped into memory without copying.
+ * A file consists of
+ *  - a 64 byte tensor_file_header (magic, version, element type, layout,
+ *    number of dimensions, position and size of the payload),
+ *  - ndim shapes (uint64) followed by ndim strides (int64, in elements),
+ *  - zero padding up to the next multiple of 64 bytes,
+ *  - the payload, elements in native byte order.
+ *
+ * Shapes and strides are stored in the same order as in tensor::info(), the
+ * layout field records whether they belong to a row_major or a column_major
+ * tensor.
+ *
+ * Example usage:
+ * @code
+ * tensor<float,host_memory_space> m(extents[1000][784]);
+ * save_tensor_file("weights.cuvt", m);
+ *
+ * // no copy, pages are shared with all other processes mapping the file
+ * tensor<float,host_memory_space> w = open_tensor_file<float>("weights.cuvt");
+ *
+ * // streaming: never holds more than one chunk in memory
+ * tensor_file_writer<float> out("data.cuvt", extents[n_batches * 128][784]);
+ * for (int b = 0; b < n_batches; b++)
+ *     out.write(batch(b)); // a [128][784] tensor
+ * out.close();
+ * @endcode
+ *
+ * @{
+ */
+
+/**
+ * how the payload of a tensor file is mapped into memory
+ */
+enum tensor_file_mode {
+    TF_READ_ONLY, ///< shared read-only pages, writing to the tensor crashes
+    TF_COPY_ON_WRITE, ///< private pages, changes are not written back to the file
+    TF_READ_WRITE ///< shared writable pages, changes are written back to the file
+};
+
+/**
+ * fixed-size header at the start of every tensor file
+ */
+struct tensor_file_header {
+    char magic[8]; ///< "CUVTNSR" followed by a zero byte
+    boost::uint32_t version; ///< version of the file format
+    boost::uint32_t dtype; ///< element type code, see tensor_file_dtype
+    boost::uint32_t elem_size; ///< size of one element in bytes
+    boost::uint32_t layout; ///< 0 for row_major, 1 for column_major
+    boost::uint32_t ndim; ///< number of dimensions
+    boost::uint32_t flags; ///< reserved, zero
+    boost::uint64_t data_offset; ///< position of the payload in the file (multiple of 64)
+    boost::uint64_t data_bytes; ///< size of the payload in bytes
+    boost::uint64_t reserved[2]; ///< reserved, zero
+};
+
+/**
+ * element type code stored in a tensor file.
+ *
+ * Only specialized for the types which can be stored.
+ */
+template<class V>
+struct tensor_file_dtype;
+
+/// @cond
+#define CUV_TENSOR_FILE_DTYPE(V, CODE) \
+    template<> struct tensor_file_dtype<V> { static const boost::uint32_t value = CODE; };
+CUV_TENSOR_FILE_DTYPE(float, 1)
+CUV_TENSOR_FILE_DTYPE(double, 2)
+CUV_TENSOR_FILE_DTYPE(signed char, 3)
+CUV_TENSOR_FILE_DTYPE(char, 3)
+CUV_TENSOR_FILE_DTYPE(unsigned char, 4)
+CUV_TENSOR_FILE_DTYPE(short, 5)
+CUV_TENSOR_FILE_DTYPE(unsigned short, 6)
+CUV_TENSOR_FILE_DTYPE(int, 7)
+CUV_TENSOR_FILE_DTYPE(unsigned int, 8)
+#undef CUV_TENSOR_FILE_DTYPE
+/// @endcond
+
+/**
+ * layout code stored in a tensor file
+ */
+template<class L>
+struct tensor_file_layout {
+    static const boost::uint32_t value = 0; ///< row_major
+};
+/// @overload
+template<>
+struct tensor_file_layout<column_major> {
+    static const boost::uint32_t value = 1; ///< column_major
+};
+
+/**
+ * a tensor file mapped into memory.
+ *
+ * The mapping is released when the object is destroyed.  Tensors returned by
+ * open_tensor_file keep a shared_ptr to it in their allocator.
+ */
+class mapped_tensor_file: boost::noncopyable {
+private:
+    std::string m_filename; ///< for error messages
+    void* m_base; ///< start of the mapping
+    size_t m_length; ///< length of the mapping in bytes
+    tensor_file_header m_header; ///< copy of the header
+    shape_array<unsigned int> m_shape; ///< shape of the stored tensor
+    shape_array<int> m_stride; ///< strides of the stored tensor (in elements)
+    size_t m_span; ///< number of elements between the first and after the last one
+
+public:
+    /**
+     * map a tensor file and check its header.
+     *
+     * @throw std::runtime_error if the file cannot be mapped or is not a valid tensor file
+     */
+    mapped_tensor_file(const std::string& filename, tensor_file_mode mode = TF_READ_ONLY);
+
+    /// unmaps the file
+    ~mapped_tensor_file();
+
+    /// @return the header of the file
+    const tensor_file_header& header() const {
+        return m_header;
+    }
+
+    /// @return shape of the stored tensor
+    const shape_array<unsigned int>& shape() const {
+        return m_shape;
+    }
+
+    /// @return strides of the stored tensor
+    const shape_array<int>& stride() const {
+        return m_stride;
+    }
+
+    /// @return number of elements addressed by shape and strides (including gaps)
+    size_t span() const {
+        return m_span;
+    }
+
+    /// @return the payload
+    void* data() const {
+        return static_cast<char*>(m_base) + m_header.data_offset;
+    }
+
+    /// @return true iff ptr points into the payload
+    bool contains(const void* ptr) const {
+        const char* p = static_cast<const char*>(ptr);
+        const char* d = static_cast<const char*>(data());
+        return p >= d && p < d + m_header.data_bytes;
+    }
+
+    /**
+     * check that the file stores elements of type V in layout L
+     *
+     * @throw std::runtime_error otherwise
+     */
+    void check_type(boost::uint32_t dtype, boost::uint32_t elem_size, boost::uint32_t layout) const;
+};
+
+/**
+ * allocator of tensors which live in a mapped tensor file.
+ *
+ * Deallocating the payload does nothing, the mapping is released with the
+ * last copy of this allocator.  All other (de)allocations, e.g. when a
+ * mapped tensor is resized, are handled by the default_allocator.
+ */
+class mapped_tensor_file_allocator: public default_allocator {
+private:
+    boost::shared_ptr<mapped_tensor_file> m_file; ///< keeps the mapping alive
+
+public:
+    /// constructor
+    explicit mapped_tensor_file_allocator(const boost::shared_ptr<mapped_tensor_file>& file) :
+            m_file(file) {
+    }
+
+    virtual ~mapped_tensor_file_allocator() {
+    }
+
+    /// @return the mapped file
+    const boost::shared_ptr<mapped_tensor_file>& file() const {
+        return m_file;
+    }
+
+    virtual void dealloc(void** ptr, host_memory_space m) {
+        if (m_file->contains(*ptr))
+            *ptr = NULL;
+        else
+            default_allocator::dealloc(ptr, m);
+    }
+
+    virtual void dealloc(void** ptr, dev_memory_space m) {
+        default_allocator::dealloc(ptr, m);
+    }
+};
+
+/**
+ * map a tensor file into memory and return a tensor viewing its payload.
+ *
+ * No element is copied or read until it is accessed.  With TF_READ_ONLY (the
+ * default), all processes opening the same file share the same physical
+ * pages.  The returned tensor keeps the file mapped until it and all tensors
+ * sharing its memory are destroyed.
+ *
+ * @param filename the file written by save_tensor_file or tensor_file_writer
+ * @param mode     how the file is mapped
+ * @throw std::runtime_error if the file does not contain a tensor of value type V and layout L
+ */
+template<class V, class L>
+tensor<V, host_memory_space, L> open_tensor_file(const std::string& filename, tensor_file_mode mode = TF_READ_ONLY) {
+    boost::shared_ptr<mapped_tensor_file> file = boost::make_shared<mapped_tensor_file>(filename, mode);
+    file->check_type(tensor_file_dtype<V>::value, sizeof(V), tensor_file_layout<L>::value);
+
+    typedef tensor<V, host_memory_space, L> tensor_type;
+    if (file->shape().size() == 0)
+        return tensor_type();
+    if (file->span() == 0)
+        return tensor_type(file->shape());
+    boost::shared_ptr<allocator> alloc = boost::make_shared<mapped_tensor_file_allocator>(file);
+    V* ptr = static_cast<V*>(file->data());
+    tensor_type t(std::vector<unsigned int>(file->shape().begin(), file->shape().end()), ptr, alloc);
+    t.info().host_stride = file->stride();
+    t.mem().reset(new memory<V, host_memory_space>(ptr, file->span(), alloc));
+    t.set_ptr_offset(0);
+    return t;
+}
+
+/**
+ * @overload
+ *
+ * opens row-major tensors
+ */
+template<class V>
+tensor<V, host_memory_space> open_tensor_file(const std::string& filename, tensor_file_mode mode = TF_READ_ONLY) {
+    return open_tensor_file<V, row_major>(filename, mode);
+}
+
+/**
+ * load a tensor file into a tensor of arbitrary memory space.
+ *
+ * The file is mapped and copied once, directly into the memory of t.
+ *
+ * @param t        the tensor to load into, it is resized if needed
+ * @param filename the file to load from
+ */
+template<class V, class M, class L>
+void load_tensor_file(tensor<V, M, L>& t, const std::string& filename) {
+    tensor<V, host_memory_space, L> src = open_tensor_file<V, L>(filename, TF_READ_ONLY);
+    if (src.ndim() == 0) {
+        t = tensor<V, M, L>();
+        return;
+    }
+    if (t.ndim() != src.ndim() || t.shape() != src.shape())
+        t.resize(src.shape());
+    t.assign(src);
+}
+
+namespace detail {
+
+/**
+ * writes the header of a tensor file and appends the payload in pieces.
+ *
+ * Does not know about element types, see tensor_file_writer.
+ */
+class tensor_file_writer_base: boost::noncopyable {
+private:
+    std::string m_filename; ///< for error messages
+    FILE* m_file; ///< the file being written
+    boost::uint64_t m_data_bytes; ///< size of the payload
+    boost::uint64_t m_written; ///< number of payload bytes written so far
+
+protected:
+    /**
+     * create the file and write everything but the payload
+     *
+     * @throw std::runtime_error if the file cannot be written
+     */
+    tensor_file_writer_base(const std::string& filename, boost::uint32_t dtype, boost::uint32_t elem_size,
+            boost::uint32_t layout, const shape_array<unsigned int>& shape, const shape_array<int>& stride);
+
+    /// closes the file, incomplete files are left behind
+    ~tensor_file_writer_base();
+
+    /**
+     * append n bytes to the payload
+     *
+     * @throw std::runtime_error if writing fails or the payload would become too long
+     */
+    void write_bytes(const void* ptr, size_t n);
+
+public:
+    /// @return number of payload bytes still missing
+    boost::uint64_t remaining_bytes() const {
+        return m_data_bytes - m_written;
+    }
+
+    /**
+     * flush and close the file
+     *
+     * @throw std::runtime_error if the payload is incomplete or the file cannot be written
+     */
+    void close();
+};
+
+}
+
+/**
+ * writes a tensor file piece by piece.
+ *
+ * The shape is fixed at construction, the elements are then appended in
+ * memory order of L (i.e. the last dimension varies fastest for row_major,
+ * the first for column_major).  Only the chunk passed to write() needs to be
+ * in memory.
+ */
+template<class V, class L = row_major>
+class tensor_file_writer: public detail::tensor_file_writer_base {
+private:
+    typedef detail::tensor_file_writer_base super;
+
+    /// dense strides of a tensor with layout L
+    static shape_array<int> dense_stride(const shape_array<unsigned int>& shape) {
+        shape_array<int> stride(shape.size());
+        int size = 1;
+        if (IsSame<L, row_major>::Result::value)
+            for (int i = shape.size() - 1; i >= 0; i--) {
+                stride[i] = size;
+                size *= shape[i];
+            }
+        else
+            for (unsigned int i = 0; i < shape.size(); i++) {
+                stride[i] = size;
+                size *= shape[i];
+            }
+        return stride;
+    }
+
+public:
+    /**
+     * create a file for a tensor of the given shape
+     */
+    tensor_file_writer(const std::string& filename, const shape_array<unsigned int>& shape) :
+            super(filename, tensor_file_dtype<V>::value, sizeof(V), tensor_file_layout<L>::value, shape,
+                    dense_stride(shape)) {
+    }
+
+    /// @overload
+    tensor_file_writer(const std::string& filename, const std::vector<unsigned int>& shape) :
+            super(filename, tensor_file_dtype<V>::value, sizeof(V), tensor_file_layout<L>::value,
+                    shape_array<unsigned int>(shape.begin(), shape.end()),
+                    dense_stride(shape_array<unsigned int>(shape.begin(), shape.end()))) {
+    }
+
+    /// @overload
+    template<size_t D>
+    tensor_file_writer(const std::string& filename, const extent_gen<D>& eg) :
+            super(filename, tensor_file_dtype<V>::value, sizeof(V), tensor_file_layout<L>::value,
+                    extent_shape(eg), dense_stride(extent_shape(eg))) {
+    }
+
+    /// append n elements from host memory
+    void write(const V* ptr, size_t n) {
+        write_bytes(ptr, n * sizeof(V));
+    }
+
+    /**
+     * append all elements of a tensor.
+     *
+     * Contiguous host tensors are written directly, others are copied to a
+     * temporary host tensor of the same size first.
+     */
+    template<class M>
+    void write(const tensor<V, M, L>& chunk) {
+        if (IsSame<M, host_memory_space>::Result::value && chunk.is_c_contiguous())
+            write_bytes(chunk.ptr(), chunk.size() * sizeof(V));
+        else {
+            tensor<V, host_memory_space, L> tmp(chunk, linear_memory_tag());
+            write_bytes(tmp.ptr(), tmp.size() * sizeof(V));
+        }
+    }
+
+private:
+    template<size_t D>
+    static shape_array<unsigned int> extent_shape(const extent_gen<D>& eg) {
+        shape_array<unsigned int> shape(D);
+        for (size_t i = 0; i < D; i++)
+            shape[i] = eg.ranges_[i].finish();
+        return shape;
+    }
+};
+
+/**
+ * save a tensor in a tensor file.
+ *
+ * Contiguous host tensors are written without any copy.  Device tensors are
+ * streamed through a host buffer of at most 16 MB, non-contiguous tensors are
+ * made contiguous first.
+ *
+ * @param filename the file to write
+ * @param t        the tensor to save
+ */
+template<class V, class M, class L>
+void save_tensor_file(const std::string& filename, const tensor<V, M, L>& t) {
+    if (t.ndim() > 0 && t.size() > 0 && !t.is_c_contiguous()) {
+        tensor<V, M, L> tmp(t, linear_memory_tag());
+        save_tensor_file(filename, tmp);
+        return;
+    }
+    tensor_file_writer<V, L> out(filename, t.info().host_shape);
+    if (t.ndim() == 0 || t.size() == 0) {
+        out.close();
+        return;
+    }
+    if (IsSame<M, host_memory_space>::Result::value) {
+        out.write(t.ptr(), t.size());
+    } else {
+        const size_t chunk = std::min((size_t) t.size(), std::max((size_t) 1, (size_t) (16 << 20) / sizeof(V)));
+        std::vector<V> buf(chunk);
+        for (size_t i = 0; i < t.size(); i += chunk) {
+            const size_t n = std::min(chunk, t.size() - i);
+            detail::copy(&buf[0], t.ptr() + i, n, host_memory_space(), M(), 0);
+            out.write(&buf[0], n);
+        }
+    }
+    out.close();
+}
+
+/** @} */ // io
+}
+
+#endif
@@ -29,8 +29,12 @@
 
 
 
+#include <algorithm>
+#include <vector>
 #include <cuv/tensor_ops/tensor_ops.cuh>
 #include <cuv/basics/dia_matrix.hpp>
+#include <cuv/basics/csr_matrix.hpp>
+#include <cuv/basics/bsr_matrix.hpp>
 #include <cuv/convert/convert.hpp>
 
 namespace cuv{
@@ -111,6 +115,278 @@ namespace cuv{
                 dst.post_update_offsets();
             }
 
+        /*
+         * Host Dense -> Host CSR (all non-zero entries are stored)
+         */
+        template<class __value_type, class __mem_layout_type, class __index_type>
+            static void
+            convert(      csr_matrix<__value_type, host_memory_space, __index_type>& dst, 
+                    const tensor<__value_type, host_memory_space, __mem_layout_type>& src){
+                cuvAssert(src.ndim()==2);
+                const __index_type h = src.shape()[0], w = src.shape()[1];
+                __index_type nnz = 0;
+                for(__index_type i=0;i<h;i++)
+                    for(__index_type j=0;j<w;j++)
+                        if(src(i,j) != (__value_type)0)
+                            nnz++;
+                dst = csr_matrix<__value_type,host_memory_space,__index_type>(h,w,nnz);
+                __index_type p = 0;
+                for(__index_type i=0;i<h;i++){
+                    dst.row_ptr()[i] = p;
+                    for(__index_type j=0;j<w;j++){
+                        __value_type v = src(i,j);
+                        if(v == (__value_type)0)
+                            continue;
+                        dst.col_idx()[p] = j;
+                        dst.vals()[p++]  = v;
+                    }
+                }
+                dst.row_ptr()[h] = p;
+            }
+
+        /*
+         * Host CSR -> Host Dense
+         */
+        template<class __value_type, class __mem_layout_type, class __index_type>
+            static void
+            convert(      tensor<__value_type, host_memory_space, __mem_layout_type>& dst, 
+                    const csr_matrix<__value_type, host_memory_space, __index_type>& src){
+                if(        dst.ndim() != 2
+                        || dst.shape()[0] != src.h()
+                        || dst.shape()[1] != src.w()
+                  ){
+                    tensor<__value_type,host_memory_space,  __mem_layout_type> d(extents[src.h()][src.w()]);
+                    dst = d;
+                }
+                fill(dst,0);
+                for(__index_type i=0;i<src.h();i++)
+                    for(__index_type p=src.row_ptr()[i];p<src.row_ptr()[i+1];p++)
+                        dst(i,src.col_idx()[p]) = src.vals()[p];
+            }
+
+        /*
+         * Host Dia -> Host CSR
+         */
+        template<class __value_type, class __index_type>
+            static void
+            convert(      csr_matrix<__value_type, host_memory_space, __index_type>& dst, 
+                    const dia_matrix<__value_type, host_memory_space, __index_type>& src){
+                const __index_type h = src.h(), w = src.w();
+                const int rf = src.row_fact();
+                // the stored diagonals, sorted by column
+                std::vector<int> off(src.num_dia());
+                for(int d=0;d<src.num_dia();d++)
+                    off[d] = src.get_offset(d);
+                std::sort(off.begin(), off.end());
+                __index_type nnz = 0;
+                for(__index_type i=0;i<h;i++)
+                    for(unsigned int d=0;d<off.size();d++){
+                        int j = off[d] + (int)i/rf;
+                        if(j >= 0 && j < (int)w)
+                            nnz++;
+                    }
+                dst = csr_matrix<__value_type,host_memory_space,__index_type>(h,w,nnz);
+                __index_type p = 0;
+                for(__index_type i=0;i<h;i++){
+                    dst.row_ptr()[i] = p;
+                    for(unsigned int d=0;d<off.size();d++){
+                        int j = off[d] + (int)i/rf;
+                        if(j < 0 || j >= (int)w)
+                            continue;
+                        dst.col_idx()[p] = j;
+                        dst.vals()[p++]  = src(i,j);
+                    }
+                }
+                dst.row_ptr()[h] = p;
+            }
+
+        /*
+         * Host CSR -> Host Dia (row_fact 1, one diagonal for every offset occurring in src)
+         */
+        template<class __value_type, class __index_type>
+            static void
+            convert(      dia_matrix<__value_type, host_memory_space, __index_type>& dst, 
+                    const csr_matrix<__value_type, host_memory_space, __index_type>& src){
+                const __index_type h = src.h(), w = src.w();
+                std::vector<bool> used(h + w, false); // offset k is at position k+h
+                for(__index_type i=0;i<h;i++)
+                    for(__index_type p=src.row_ptr()[i];p<src.row_ptr()[i+1];p++)
+                        used[(int)src.col_idx()[p] - (int)i + (int)h] = true;
+                std::vector<int> off;
+                for(unsigned int k=0;k<used.size();k++)
+                    if(used[k])
+                        off.push_back((int)k - (int)h);
+                dst.dealloc();
+                dst = dia_matrix<__value_type,host_memory_space,__index_type>(h,w,off.size(),std::max(h,w),1);
+                dst.set_offsets(off);
+                fill(dst.vec(),0);
+                for(__index_type i=0;i<h;i++)
+                    for(__index_type p=src.row_ptr()[i];p<src.row_ptr()[i+1];p++)
+                        dst.set(i,src.col_idx()[p],src.vals()[p]);
+            }
+
+        /*
+         * Host Dense -> Host BSR (the block size of dst is kept, all blocks containing non-zero entries are stored)
+         */
+        template<class __value_type, class __mem_layout_type, class __index_type>
+            static void
+            convert(      bsr_matrix<__value_type, host_memory_space, __index_type>& dst, 
+                    const tensor<__value_type, host_memory_space, __mem_layout_type>& src){
+                cuvAssert(src.ndim()==2);
+                const __index_type h = src.shape()[0], w = src.shape()[1];
+                const __index_type bh = dst.block_h(), bw = dst.block_w();
+                cuvAssert(h % bh == 0);
+                cuvAssert(w % bw == 0);
+                const __index_type nbr = h/bh, nbc = w/bw;
+                std::vector<bool> used(nbr*nbc, false);
+                __index_type nnzb = 0;
+                for(__index_type i=0;i<h;i++)
+                    for(__index_type j=0;j<w;j++){
+                        __index_type b = (i/bh)*nbc + j/bw;
+                        if(!used[b] && src(i,j) != (__value_type)0){
+                            used[b] = true;
+                            nnzb++;
+                        }
+                    }
+                dst = bsr_matrix<__value_type,host_memory_space,__index_type>(h,w,bh,bw,nnzb);
+                __index_type p = 0;
+                for(__index_type bi=0;bi<nbr;bi++){
+                    dst.row_ptr()[bi] = p;
+                    for(__index_type bj=0;bj<nbc;bj++){
+                        if(!used[bi*nbc + bj])
+                            continue;
+                        dst.col_idx()[p] = bj;
+                        for(__index_type i=0;i<bh;i++)
+                            for(__index_type j=0;j<bw;j++)
+                                dst.vals()[p*bh*bw + i*bw + j] = src(bi*bh+i, bj*bw+j);
+                        p++;
+                    }
+                }
+                dst.row_ptr()[nbr] = p;
+            }
+
+        /*
+         * Host BSR -> Host Dense
+         */
+        template<class __value_type, class __mem_layout_type, class __index_type>
+            static void
+            convert(      tensor<__value_type, host_memory_space, __mem_layout_type>& dst, 
+                    const bsr_matrix<__value_type, host_memory_space, __index_type>& src){
+                if(        dst.ndim() != 2
+                        || dst.shape()[0] != src.h()
+                        || dst.shape()[1] != src.w()
+                  ){
+                    tensor<__value_type,host_memory_space,  __mem_layout_type> d(extents[src.h()][src.w()]);
+                    dst = d;
+                }
+                fill(dst,0);
+                const __index_type bh = src.block_h(), bw = src.block_w();
+                for(__index_type bi=0;bi<src.num_block_rows();bi++)
+                    for(__index_type p=src.row_ptr()[bi];p<src.row_ptr()[bi+1];p++){
+                        const __index_type bj = src.col_idx()[p];
+                        for(__index_type i=0;i<bh;i++)
+                            for(__index_type j=0;j<bw;j++)
+                                dst(bi*bh+i, bj*bw+j) = src.vals()[p*bh*bw + i*bw + j];
+                    }
+            }
+
+        /*
+         * Host BSR -> Host CSR (explicit zeros inside stored blocks are dropped)
+         */
+        template<class __value_type, class __index_type>
+            static void
+            convert(      csr_matrix<__value_type, host_memory_space, __index_type>& dst, 
+                    const bsr_matrix<__value_type, host_memory_space, __index_type>& src){
+                const __index_type bh = src.block_h(), bw = src.block_w(), bs = bh*bw;
+                __index_type nnz = 0;
+                for(__index_type k=0;k<src.nnz();k++)
+                    if(src.vals()[k] != (__value_type)0)
+                        nnz++;
+                dst = csr_matrix<__value_type,host_memory_space,__index_type>(src.h(),src.w(),nnz);
+                __index_type q = 0;
+                for(__index_type bi=0;bi<src.num_block_rows();bi++)
+                    for(__index_type i=0;i<bh;i++){
+                        dst.row_ptr()[bi*bh+i] = q;
+                        for(__index_type p=src.row_ptr()[bi];p<src.row_ptr()[bi+1];p++)
+                            for(__index_type j=0;j<bw;j++){
+                                __value_type v = src.vals()[p*bs + i*bw + j];
+                                if(v == (__value_type)0)
+                                    continue;
+                                dst.col_idx()[q] = src.col_idx()[p]*bw + j;
+                                dst.vals()[q++]  = v;
+                            }
+                    }
+                dst.row_ptr()[src.h()] = q;
+            }
+
+        /*
+         * Host CSR -> Host BSR (the block size of dst is kept)
+         */
+        template<class __value_type, class __index_type>
+            static void
+            convert(      bsr_matrix<__value_type, host_memory_space, __index_type>& dst, 
+                    const csr_matrix<__value_type, host_memory_space, __index_type>& src){
+                const __index_type bh = dst.block_h(), bw = dst.block_w(), bs = bh*bw;
+                cuvAssert(src.h() % bh == 0);
+                cuvAssert(src.w() % bw == 0);
+                const __index_type nbr = src.h()/bh, nbc = src.w()/bw;
+                // position of block column bj in the current block row, or nnzb if not stored
+                std::vector<__index_type> pos(nbc);
+                std::vector<__index_type> cols;
+                std::vector<__index_type> row_ptr(nbr+1, 0);
+                for(__index_type bi=0;bi<nbr;bi++){
+                    std::vector<__index_type> row;
+                    for(__index_type i=bi*bh;i<(bi+1)*bh;i++)
+                        for(__index_type p=src.row_ptr()[i];p<src.row_ptr()[i+1];p++)
+                            row.push_back(src.col_idx()[p]/bw);
+                    std::sort(row.begin(), row.end());
+                    row.erase(std::unique(row.begin(), row.end()), row.end());
+                    cols.insert(cols.end(), row.begin(), row.end());
+                    row_ptr[bi+1] = cols.size();
+                }
+                dst = bsr_matrix<__value_type,host_memory_space,__index_type>(src.h(),src.w(),bh,bw,cols.size());
+                fill(dst.vals(),0);
+                for(__index_type bi=0;bi<nbr;bi++){
+                    dst.row_ptr()[bi] = row_ptr[bi];
+                    for(__index_type p=row_ptr[bi];p<row_ptr[bi+1];p++){
+                        dst.col_idx()[p] = cols[p];
+                        pos[cols[p]] = p;
+                    }
+                    for(__index_type i=bi*bh;i<(bi+1)*bh;i++)
+                        for(__index_type p=src.row_ptr()[i];p<src.row_ptr()[i+1];p++){
+                            const __index_type j = src.col_idx()[p];
+                            dst.vals()[pos[j/bw]*bs + (i-bi*bh)*bw + j%bw] = src.vals()[p];
+                        }
+                }
+                dst.row_ptr()[nbr] = row_ptr[nbr];
+            }
+
+        /*
+         * CSR between memory spaces
+         */
+        template<class __value_type, class __index_type, class __memory_space, class __memory_space2>
+            static void
+            convert(      csr_matrix<__value_type, __memory_space, __index_type>& dst, 
+                    const csr_matrix<__value_type, __memory_space2, __index_type>& src){
+                dst = csr_matrix<__value_type,__memory_space,__index_type>(src.h(),src.w(),src.nnz());
+                dst.vals()    = src.vals();
+                dst.row_ptr() = src.row_ptr();
+                dst.col_idx() = src.col_idx();
+            }
+
+        /*
+         * BSR between memory spaces
+         */
+        template<class __value_type, class __index_type, class __memory_space, class __memory_space2>
+            static void
+            convert(      bsr_matrix<__value_type, __memory_space, __index_type>& dst, 
+                    const bsr_matrix<__value_type, __memory_space2, __index_type>& src){
+                dst = bsr_matrix<__value_type,__memory_space,__index_type>(src.h(),src.w(),src.block_h(),src.block_w(),src.nnzb());
+                dst.vals()    = src.vals();
+                dst.row_ptr() = src.row_ptr();
+                dst.col_idx() = src.col_idx();
+            }
+
         /**
          * value type conversion
          */
@@ -244,6 +520,75 @@ CONV_VALUE_TYPE(float,signed char,row_major);
         DIA_DENSE_CONV(float,row_major,unsigned int)
         DIA_HOST_DEV_CONV(float,unsigned int)
 
+#define CSR_DENSE_CONV(X,Y,Z) \
+    template <>                           \
+    void convert(tensor<X,host_memory_space,Y>& dst, const csr_matrix<X,host_memory_space,Z>& src)     \
+    {                                                                                \
+        convert_impl::convert(dst,src);  \
+    };                                \
+    template <>                           \
+    void convert(csr_matrix<X,host_memory_space,Z>& dst, const tensor<X,host_memory_space,Y>& src)     \
+    {                                                                                \
+        convert_impl::convert(dst,src);  \
+    };                                \
+    template <>                           \
+    void convert(tensor<X,host_memory_space,Y>& dst, const bsr_matrix<X,host_memory_space,Z>& src)     \
+    {                                                                                \
+        convert_impl::convert(dst,src);  \
+    };                                \
+    template <>                           \
+    void convert(bsr_matrix<X,host_memory_space,Z>& dst, const tensor<X,host_memory_space,Y>& src)     \
+    {                                                                                \
+        convert_impl::convert(dst,src);  \
+    };
+#define CSR_SPARSE_CONV(X,Z) \
+    template <>                           \
+    void convert(csr_matrix<X,host_memory_space,Z>& dst, const dia_matrix<X,host_memory_space,Z>& src)     \
+    {                                                                                \
+        convert_impl::convert(dst,src);  \
+    };                                \
+    template <>                           \
+    void convert(dia_matrix<X,host_memory_space,Z>& dst, const csr_matrix<X,host_memory_space,Z>& src)     \
+    {                                                                                \
+        convert_impl::convert(dst,src);  \
+    };                                \
+    template <>                           \
+    void convert(csr_matrix<X,host_memory_space,Z>& dst, const bsr_matrix<X,host_memory_space,Z>& src)     \
+    {                                                                                \
+        convert_impl::convert(dst,src);  \
+    };                                \
+    template <>                           \
+    void convert(bsr_matrix<X,host_memory_space,Z>& dst, const csr_matrix<X,host_memory_space,Z>& src)     \
+    {                                                                                \
+        convert_impl::convert(dst,src);  \
+    };
+#define CSR_HOST_DEV_CONV(X,Z) \
+    template <>                           \
+    void convert(csr_matrix<X,dev_memory_space,Z>& dst, const csr_matrix<X,host_memory_space,Z>& src)     \
+    {                                                                                \
+        convert_impl::convert(dst,src);  \
+    };                                \
+    template <>                           \
+    void convert(csr_matrix<X,host_memory_space,Z>& dst, const csr_matrix<X,dev_memory_space,Z>& src)     \
+    {                                                                                \
+        convert_impl::convert(dst,src);  \
+    };                                \
+    template <>                           \
+    void convert(bsr_matrix<X,dev_memory_space,Z>& dst, const bsr_matrix<X,host_memory_space,Z>& src)     \
+    {                                                                                \
+        convert_impl::convert(dst,src);  \
+    };                                \
+    template <>                           \
+    void convert(bsr_matrix<X,host_memory_space,Z>& dst, const bsr_matrix<X,dev_memory_space,Z>& src)     \
+    {                                                                                \
+        convert_impl::convert(dst,src);  \
+    };
+
+    CSR_DENSE_CONV(float,column_major,unsigned int)
+        CSR_DENSE_CONV(float,row_major,unsigned int)
+        CSR_SPARSE_CONV(float,unsigned int)
+        CSR_HOST_DEV_CONV(float,unsigned int)
+
 
 } // namespace cuv
 
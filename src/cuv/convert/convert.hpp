@@ -52,7 +52,7 @@ namespace cuv{
 	 * Converts between:
 	 * 	- Column major an row major
 	 * 	- Host and device matrices
-	 * 	- dense and DIA format
+	 * 	- dense, DIA, CSR and BSR format
 	 * 	- ...
 	 */
 	template<class Dst, class Src>
@@ -38,17 +38,22 @@
  * @date 2010-03-21
  */
 
+#include <algorithm>
 #include <boost/scoped_ptr.hpp>
 #include <cuv/basics/tensor.hpp>
 #include <cuv/convert/convert.hpp>
 #include <cuv/matrix_ops/matrix_ops.hpp>
 #include <cuv/tensor_ops/tensor_ops.hpp>
 #include <cuv/random/random.hpp>
+#include <cuv/tools/thread_pool.hpp>
+#ifndef CUV_NO_CUDA
 #include <3rd_party/cudaconv2/include/cudaconv2/conv_util.cuh>
 #include <3rd_party/cudaconv2/include/cudaconv2/cudaconv2.cuh>
 #include <3rd_party/cudaconv2/include/nvmatrix/nvmatrix.cuh>
+#endif
 /*#include <3rd_party/cudaconv2/include/convCPU.h>*/
 #include <cuv/convolution_ops/convolution_ops.hpp>
+#include <cuv/convolution_ops/convolution_ops_host.hpp>
 
 #define NVView1D(X)  \
         (const_cast<float*>(X.ptr()), 1, X.shape(0), X.shape(0), false)
@@ -83,102 +88,56 @@ template<class V,class M, class T>
         dst.reshape(extents[src.shape(3)][src.shape(0)][src.shape(1)][src.shape(2)]);
     }
 
-/*
- * hidActs:     (numFilters, numModules, numImages)
- * filters:     (numFilterColors, filterPixels, numFilters)               if conv
- *              (numModules, numFilterColors, filterPixels, numFilters)   otherwise
- * targets:     (numImageColors, imgPixels, numImages)
+/**
+ * geometry of a convolution for the host implementation in convolution_ops_host.cpp
  */
-void cpuImgActs(const float* hidActs, const float* filters, float* targets,
-               int numModulesX,  int numImages,  int numFilters,
-               int filterSize,  int imgSize,  int moduleStart,
-               int moduleStride, int numImgColors, int numGroups, bool conv) {
-    int filterPixles = filterSize * filterSize;
-    int imgPixels = imgSize * imgSize;
-    int numModules = numModulesX * numModulesX;
-    int numFiltersPerGroup = numFilters / numGroups;
-    int numFilterColors = numImgColors / numGroups;
-    for (int py = 0; py < imgSize; py++) {
-        for (int px = 0; px < imgSize; px++) {
-            for (int my = 0; my < numModulesX; my++) {
-                int moduleTop = moduleStart + my * moduleStride;
-                int moduleBottom = moduleTop + filterSize;
-                for (int mx = 0; mx < numModulesX; mx++) {
-                    int m = my * numModulesX + mx;
-                    int moduleLeft = moduleStart + mx * moduleStride;
-                    int moduleRight = moduleLeft + filterSize;
-                    int pixInModuleX = px - moduleLeft;
-                    int pixInModuleY = py - moduleTop;
-                    int pixInModule = pixInModuleY * filterSize + pixInModuleX;
-                    if (py >= moduleTop && py < moduleBottom && px >= moduleLeft && px < moduleRight) {
-                        for (int f = 0; f < numFilters; f++) {
-                            int g = f / numFiltersPerGroup; // filter's group idx
-                            for (int i = 0; i < numImages; i++) {
-                                for (int c = 0; c < numFilterColors; c++) {
-                                    float w = filters[(conv ? 0 : m * numFilterColors * filterPixles * numFilters) 
-                                                      + c * numFilters * filterPixles + pixInModule * numFilters + f];
-                                    float h = hidActs[m * numImages + f * numModules * numImages + i];
-                                    targets[(c + g * numFilterColors) * imgPixels * numImages + i] += w * h;
-                                }
-                            }
-
-                        }
-                    }
-                }
-            }
-            targets += numImages;
-        }
-    }
+detail::host_conv_geometry host_geometry(unsigned int nImgChan, unsigned int nImgPixY, unsigned int nImgPixX, unsigned int nImg,
+        unsigned int nFiltChan, unsigned int nFiltPix, unsigned int nFilt, unsigned int nModulesY, unsigned int nModulesX,
+        int paddingStart, unsigned int moduleStride, unsigned int nGroups, const int* colorIndices){
+    unsigned int filtSize = sqrt(nFiltPix);
+    cuvAssert(filtSize*filtSize == nFiltPix);
+    cuvAssert(moduleStride > 0);
+    cuvAssert(nGroups > 0);
+    detail::host_conv_geometry g;
+    g.nImgChan     = nImgChan;
+    g.nImgPixY     = nImgPixY;
+    g.nImgPixX     = nImgPixX;
+    g.nImg         = nImg;
+    g.nFiltChan    = nFiltChan;
+    g.filtSize     = filtSize;
+    g.nFilt        = nFilt;
+    g.nModulesY    = nModulesY;
+    g.nModulesX    = nModulesX;
+    g.paddingStart = paddingStart;
+    g.moduleStride = moduleStride;
+    g.nGroups      = nGroups;
+    g.colorIndices = colorIndices;
+    return g;
 }
 
-/*
- * images:      (numImgColors, imgPixels, numImages) with stride given
- * filters:     (numFilterColors, filterPixels, numFilters)             if conv
- *              (numModules, numFilterColors, filterPixels, numFilters) otherwise
+/**
+ * true if tensors in memory space M are processed by the host implementation.
  *
- * targets:     (numFilters, numModules, numImages)
+ * Without CUDA, device memory is host memory and the device tensors are
+ * processed on the host, too.
  */
-void cpuFilterActs(const float* images, const float* filters, float* targets,
-                       int numImages, int numFilters,
-                       int imgSize, int filterSize, int paddingStart,
-                       int moduleStride, int numModulesX,
-                       int numImgColors, int numGroups, bool conv, float scaleTargets, float scaleOutput) {
-    int filterPixels = filterSize * filterSize;
-    int numFilterColors = numImgColors / numGroups;
-    int numModules = numModulesX * numModulesX;
-    int imgPixels = imgSize * imgSize;
-    int groupColorStride = numGroups == 1 ? 0 : (numImgColors - numFilterColors) / (numGroups - 1);
-    int filtersPerGroup = numFilters / numGroups;
-    for (int my = 0; my < numModulesX; my++) {
-        int mStartY = paddingStart + my * moduleStride;
-        for (int mx = 0; mx < numModulesX; mx++) {
-            int mStartX = paddingStart + mx * moduleStride;
-            int m = (my * numModulesX + mx);
-            for (int f = 0; f < numFilters; f++) {
-                int g = f / filtersPerGroup; // filter group
-                for (int i = 0; i < numImages; i++) {
-                    float prod = 0;
-                    for (int c = 0; c < numFilterColors; c++) {
-                        for (int y = 0; y < filterSize; y++) {
-                            for (int x = 0; x < filterSize; x++) {
-                                float imgVal = mStartY + y >= 0 && mStartY + y < imgSize && mStartX + x >= 0 && mStartX + x < imgSize
-                                            ? images[(c + g * groupColorStride) * imgPixels * numImages + i + ((mStartY+y) * imgSize + mStartX+x) * numImages]
-                                            : 0;
-                                float fVal = filters[c * filterPixels * numFilters + f + (y * filterSize + x) * numFilters
-                                                     + (conv ? 0 : m * numFilters * filterPixels * numFilterColors)];
-                                prod += fVal * imgVal;
-                            }
-                        }
-                    }
-
-                    targets[f * numModules * numImages + m * numImages + i] = scaleTargets*targets[f * numModules * numImages + m * numImages + i] + scaleOutput* prod;
-                }
-            }
-        }
-    }
+template<class M>
+bool use_host_impl(){
+#ifdef CUV_NO_CUDA
+    return true;
+#else
+    return IsSame<M,host_memory_space>::Result::value;
+#endif
 }
 
-
+#ifdef CUV_NO_CUDA
+/**
+ * called by functions which are only implemented in cudaconv2.
+ */
+void cudaconv2_only(const char* name){
+    throw std::runtime_error(std::string(name) + ": only implemented in cudaconv2, and CUV was built without CUDA");
+}
+#endif
 
 
 template<class V, class M, class T>
@@ -209,6 +168,15 @@ template<class V, class M, class T>
         unsigned int nModulesX = dst.shape(2);
         cuvAssert(dst.shape(3)==nImg);
 
+        if(use_host_impl<M>()){
+            detail::host_filter_acts(dst.ptr(), img.ptr(), filter.ptr(),
+                    host_geometry(nImgChan, nImgPixY, nImgPixX, nImg, nFiltChan, nFiltPix, nFilt, nModulesY, nModulesX,
+                        paddingStart, moduleStride, nGroups, NULL),
+                    factNew, factOld);
+            return;
+        }
+
+#ifndef CUV_NO_CUDA
         // make NVMatrices with this data
         NVMatrix nv_dst    NVView4D(dst);
         NVMatrix nv_img    NVView4D(img);
@@ -222,19 +190,9 @@ template<class V, class M, class T>
             sequence(colorIndices);
             convFilterActsSparse(nv_img, nv_filter, nv_dst, colorIndices.ptr(), nImgPixY, nModulesY, nModulesX, paddingStart, moduleStride, nImgChan, nFiltChan, nGroups,factOld,factNew);
         }{
-            if(IsSame<M,dev_memory_space>::Result::value){
-                convFilterActs(nv_img, nv_filter, nv_dst, nImgPixY, nModulesY, nModulesX, paddingStart, moduleStride, nImgChan, nGroups, factOld,factNew);
-            }else{
-                unsigned int filtX  = sqrt(nFiltPix);
-                cuvAssert(filtX*filtX == nFiltPix);
-
-                cpuFilterActs(img.ptr(), filter.ptr(), dst.ptr(), 
-                        nImg, nFilt, 
-                        nImgPixX, filtX, paddingStart,
-                        moduleStride, nModulesX, 
-                        nImgChan, nGroups, true, factOld,factNew);
-            }
+            convFilterActs(nv_img, nv_filter, nv_dst, nImgPixY, nModulesY, nModulesX, paddingStart, moduleStride, nImgChan, nGroups, factOld,factNew);
         }
+#endif
     }
 template<class V, class M, class T>
     void 
@@ -270,16 +228,22 @@ template<class V, class M, class T>
         /*cuvAssert(indices.shape(1) == nImgChan * nFiltChan);*/
         cuvAssert(indices.shape(1) == overSample * nImgChan);
 
+        if(use_host_impl<M>()){
+            detail::host_filter_acts(dst.ptr(), img.ptr(), filter.ptr(),
+                    host_geometry(nImgChan, nImgPixY, nImgPixX, nImg, nFiltChan, nFiltPix, nFilt, nModulesY, nModulesX,
+                        paddingStart, moduleStride, nGroups, indices.ptr()),
+                    factNew, factOld);
+            return;
+        }
+
+#ifndef CUV_NO_CUDA
         // make NVMatrices with this data
         NVMatrix nv_dst    NVView4D(dst);
         NVMatrix nv_img    NVView4D(img);
         NVMatrix nv_filter NVView3D(filter);
 
-        if(IsSame<M,dev_memory_space>::Result::value){
-            convFilterActsSparse(nv_img, nv_filter, nv_dst, const_cast<int*>(indices.ptr()),      nImgPixY, nModulesY, nModulesX, paddingStart, moduleStride, nImgChan, nFiltChan, nGroups, factOld,factNew);
-        }else{
-            throw std::runtime_error("CPU version of convFilterActsSparse not implemented!");
-        }
+        convFilterActsSparse(nv_img, nv_filter, nv_dst, const_cast<int*>(indices.ptr()),      nImgPixY, nModulesY, nModulesX, paddingStart, moduleStride, nImgChan, nFiltChan, nGroups, factOld,factNew);
+#endif
     }
 
 template<class V, class M, class L>
@@ -307,27 +271,24 @@ template<class V, class M, class L>
         unsigned int nImgPixX  = dst.shape(2);
         cuvAssert(dst.shape(3) == nImg);
 
-        if(IsSame<M,dev_memory_space>::Result::value){
-            NVMatrix nv_dst    NVView4D(dst);
-            NVMatrix nv_delta  NVView4D(delta);
-            NVMatrix nv_filter NVView3D(filter);
-
-            /*void convImgActs(NVMatrix& hidActs, NVMatrix& filters, NVMatrix& targets,*/
-            /*    int imgSize, int paddingStart, int moduleStride, int numImgColors, int numGroups);*/
-            convImgActs(nv_delta, nv_filter, nv_dst,
-                    nImgPixY, nImgPixX, nModulesY, paddingStart, moduleStride, nImgChan, nGroups,factOld,factNew);
-        }else{
-            /*void cpuImgActs(float* hidActs, float* filters, float* targets,*/
-                           /*int numModulesX,  int numImages,  int numFilters,*/
-                           /*int filterSize,  int imgSize,  int moduleStart,*/
-                           /*int moduleStride, int numImgColors, int numGroups, bool conv) */
-            if(factOld == 0.f)
-                dst = 0.f;
-            cpuImgActs(delta.ptr(), filter.ptr(), dst.ptr(),
-                    nModulesX, nImg, nFilt, 
-                    sqrt(nFiltPix), nImgPixX, paddingStart,
-                    moduleStride, nImgChan, nGroups,true);
+        if(use_host_impl<M>()){
+            detail::host_img_acts(dst.ptr(), delta.ptr(), filter.ptr(),
+                    host_geometry(nImgChan, nImgPixY, nImgPixX, nImg, nFiltChan, nFiltPix, nFilt, nModulesY, nModulesX,
+                        paddingStart, moduleStride, nGroups, NULL),
+                    factNew, factOld);
+            return;
         }
+
+#ifndef CUV_NO_CUDA
+        NVMatrix nv_dst    NVView4D(dst);
+        NVMatrix nv_delta  NVView4D(delta);
+        NVMatrix nv_filter NVView3D(filter);
+
+        /*void convImgActs(NVMatrix& hidActs, NVMatrix& filters, NVMatrix& targets,*/
+        /*    int imgSize, int paddingStart, int moduleStride, int numImgColors, int numGroups);*/
+        convImgActs(nv_delta, nv_filter, nv_dst,
+                nImgPixY, nImgPixX, nModulesY, paddingStart, moduleStride, nImgChan, nGroups,factOld,factNew);
+#endif
     }
 template<class V, class M, class L>
 	void d_conv2d_dimg(tensor<V,M,L>& dst,
@@ -355,16 +316,24 @@ template<class V, class M, class L>
         unsigned int nImgPixX  = dst.shape(2);
         cuvAssert(dst.shape(3) == nImg);
 
-        if(IsSame<M,dev_memory_space>::Result::value){
-            NVMatrix nv_dst    NVView4D(dst);
-            NVMatrix nv_delta  NVView4D(delta);
-            NVMatrix nv_filter NVView3D(filter);
-
-            /*void convImgActsSparse(NVMatrix& hidActs, NVMatrix& filters, NVMatrix& targets, int* dColorIndices,*/
-            /*        int imgSizeY, int imgSizeX, int numModulesY, int paddingStart, int moduleStride, int numImgColors, int numFilterColors, int numGroups)*/
-            convImgActsSparse(nv_delta, nv_filter, nv_dst, const_cast<int*>(indices.ptr()),
-                          nImgPixY,     nImgPixX,       nModulesY,     paddingStart,     moduleStride,         nImgChan, nFiltChan, nGroups, factOld, factNew);
+        if(use_host_impl<M>()){
+            detail::host_img_acts(dst.ptr(), delta.ptr(), filter.ptr(),
+                    host_geometry(nImgChan, nImgPixY, nImgPixX, nImg, nFiltChan, nFiltPix, nFilt, nModulesY, nModulesX,
+                        paddingStart, moduleStride, nGroups, indices.ptr()),
+                    factNew, factOld);
+            return;
         }
+
+#ifndef CUV_NO_CUDA
+        NVMatrix nv_dst    NVView4D(dst);
+        NVMatrix nv_delta  NVView4D(delta);
+        NVMatrix nv_filter NVView3D(filter);
+
+        /*void convImgActsSparse(NVMatrix& hidActs, NVMatrix& filters, NVMatrix& targets, int* dColorIndices,*/
+        /*        int imgSizeY, int imgSizeX, int numModulesY, int paddingStart, int moduleStride, int numImgColors, int numFilterColors, int numGroups)*/
+        convImgActsSparse(nv_delta, nv_filter, nv_dst, const_cast<int*>(indices.ptr()),
+                      nImgPixY,     nImgPixX,       nModulesY,     paddingStart,     moduleStride,         nImgChan, nFiltChan, nGroups, factOld, factNew);
+#endif
     }
 template<class V, class M, class L>
 	void d_conv2d_dfilt(tensor<V,M,L>& dst_,
@@ -372,11 +341,6 @@ template<class V, class M, class L>
 			  const tensor<V,M,L>&   input,
               int paddingStart,
             unsigned int moduleStride, unsigned int nGroups, unsigned int partialSum, float factNew, float factOld){
-        if(IsSame<M,host_memory_space>::Result::value){
-            std::cout << "warning: host version of d_conv2d_dfilt not implemented"<<std::endl;
-            return;
-        }
-
         cuvAssert(dst_.ndim()==3);
         unsigned int nFiltChan = dst_.shape(0);
         unsigned int nFiltPix  = dst_.shape(1);
@@ -394,18 +358,28 @@ template<class V, class M, class L>
         unsigned int nModulesX = delta.shape(2);
         unsigned int nImg      = delta.shape(3);
 
-        cuv::tensor<float,M> dst; // make 3D for NVView3D
-        if(partialSum > 0){
-            assert((nModulesX * nModulesY) % partialSum == 0);
-            dst.resize(extents[(nModulesX*nModulesY)/partialSum][nFiltChan*nFiltPix][nFilt]); // make 3D for NVView3D
-        }
-
         cuvAssert(input.ndim()==4);
         unsigned int nImgChan = input.shape(0);
         unsigned int nImgPixY = input.shape(1);
         unsigned int nImgPixX = input.shape(2);
         cuvAssert(input.shape(3) == nImg);
 
+        if(use_host_impl<M>()){
+            // partialSum only determines how the device splits the work
+            detail::host_weight_acts(dst_.ptr(), delta.ptr(), input.ptr(),
+                    host_geometry(nImgChan, nImgPixY, nImgPixX, nImg, nFiltChan, nFiltPix, nFilt, nModulesY, nModulesX,
+                        paddingStart, moduleStride, nGroups, NULL),
+                    factNew, factOld);
+            return;
+        }
+
+#ifndef CUV_NO_CUDA
+        cuv::tensor<float,M> dst; // make 3D for NVView3D
+        if(partialSum > 0){
+            assert((nModulesX * nModulesY) % partialSum == 0);
+            dst.resize(extents[(nModulesX*nModulesY)/partialSum][nFiltChan*nFiltPix][nFilt]); // make 3D for NVView3D
+        }
+
         /*void convWeightActs(NVMatrix& images, NVMatrix& hidActs, NVMatrix& targets,*/
         /*                    int numModulesX, int filterSize, int paddingStart,*/
         /*                    int moduleStride, int numImgColors, int numGroups, int partialSum);*/
@@ -423,6 +397,7 @@ template<class V, class M, class L>
             cuv::reduce_to_row(dst_,dst, cuv::RF_ADD, factNew, factOld);
             dst_.reshape(extents[nFiltChan][nFiltPix][nFilt]);
         }
+#endif
     }
 
 template<class V, class M, class L>
@@ -432,11 +407,6 @@ template<class V, class M, class L>
               const tensor<int,M,L>& indices,
               int paddingStart,
             unsigned int moduleStride, unsigned int nGroups, unsigned int partialSum, float factNew, float factOld){
-        if(IsSame<M,host_memory_space>::Result::value){
-            std::cout << "warning: host version of d_conv2d_dfilt not implemented"<<std::endl;
-            return;
-        }
-
         cuvAssert(dst_.ndim()==3);
         unsigned int nFiltChan = dst_.shape(0);
         unsigned int nFiltPix  = dst_.shape(1);
@@ -454,6 +424,21 @@ template<class V, class M, class L>
         unsigned int nModulesX = delta.shape(2);
         unsigned int nImg      = delta.shape(3);
 
+        cuvAssert(input.ndim()==4);
+        unsigned int nImgChan = input.shape(0);
+        unsigned int nImgPixY = input.shape(1);
+        unsigned int nImgPixX = input.shape(2);
+        cuvAssert(input.shape(3) == nImg);
+
+        if(use_host_impl<M>()){
+            detail::host_weight_acts(dst_.ptr(), delta.ptr(), input.ptr(),
+                    host_geometry(nImgChan, nImgPixY, nImgPixX, nImg, nFiltChan, nFiltPix, nFilt, nModulesY, nModulesX,
+                        paddingStart, moduleStride, nGroups, indices.ptr()),
+                    factNew, factOld);
+            return;
+        }
+
+#ifndef CUV_NO_CUDA
         boost::scoped_ptr<cuv::tensor<float, M> > dst;
         if(partialSum > 0){
             assert((nModulesX * nModulesY) % partialSum == 0);
@@ -465,12 +450,6 @@ template<class V, class M, class L>
             dst_ = 0.f;
         }
 
-        cuvAssert(input.ndim()==4);
-        unsigned int nImgChan = input.shape(0);
-        unsigned int nImgPixY = input.shape(1);
-        unsigned int nImgPixX = input.shape(2);
-        cuvAssert(input.shape(3) == nImg);
-
         NVMatrix nv_dst   NVView3D((partialSum > 0 ? *dst : dst_));
         NVMatrix nv_delta NVView4D(delta);
         NVMatrix nv_input NVView4D(input);
@@ -489,18 +468,211 @@ template<class V, class M, class L>
             cuv::reduce_to_row(dst_,*dst, cuv::RF_ADD, factNew, factOld);
             dst_.reshape(extents[nFiltChan][nFiltPix][nFilt]);
         }
+#endif
+    }
+
+
+/// number of images processed together by the host pooling kernels, accumulators for one block stay in L1
+#define POOL_HOST_IMG_BLOCK 256
+
+/**
+ * host implementation of local pooling.
+ *
+ * Processes whole rows (filter, output y) of the target. Ranges are given in
+ * elements of the target, and are multiples of the row size.
+ */
+template<pool_type Pooler>
+struct local_pool_host{
+    float* m_dst;
+    const float* m_img;
+    int m_nImgPixY, m_nImgPixX, m_nImg, m_nOutPixY, m_nOutPixX;
+    int m_subsX, m_startX, m_strideX;
+    float m_divisor;
+
+    local_pool_host(float* dst, const float* img, int nImgPixY, int nImgPixX, int nImg, int nOutPixY, int nOutPixX,
+            int subsX, int startX, int strideX, float divisor)
+        : m_dst(dst), m_img(img), m_nImgPixY(nImgPixY), m_nImgPixX(nImgPixX), m_nImg(nImg),
+          m_nOutPixY(nOutPixY), m_nOutPixX(nOutPixX), m_subsX(subsX), m_startX(startX), m_strideX(strideX),
+          m_divisor(divisor){}
+
+    void operator()(size_t begin, size_t end){
+        const size_t row_size = (size_t) m_nOutPixX * m_nImg;
+        float acc[POOL_HOST_IMG_BLOCK];
+        for(size_t row = begin / row_size; row < end / row_size; row++){
+            const int f  = row / m_nOutPixY;
+            const int oy = row % m_nOutPixY;
+            const float* img = m_img + (size_t) f * m_nImgPixY * m_nImgPixX * m_nImg;
+            const int y0 = std::max(0, m_startX + oy * m_strideX);
+            const int y1 = std::min(m_nImgPixY, m_startX + oy * m_strideX + m_subsX);
+            for(int ox = 0; ox < m_nOutPixX; ox++){
+                const int x0 = std::max(0, m_startX + ox * m_strideX);
+                const int x1 = std::min(m_nImgPixX, m_startX + ox * m_strideX + m_subsX);
+                float* dst = m_dst + (row * m_nOutPixX + ox) * m_nImg;
+                for(int i0 = 0; i0 < m_nImg; i0 += POOL_HOST_IMG_BLOCK){
+                    const int n = std::min(POOL_HOST_IMG_BLOCK, m_nImg - i0);
+                    for(int i = 0; i < n; i++)
+                        acc[i] = Pooler == PT_MAX ? -2e38f : 0.f; // base value of MaxPooler
+                    for(int y = y0; y < y1; y++){
+                        for(int x = x0; x < x1; x++){
+                            const float* src = img + ((size_t) y * m_nImgPixX + x) * m_nImg + i0;
+                            if(Pooler == PT_MAX){
+                                for(int i = 0; i < n; i++)
+                                    acc[i] = src[i] > acc[i] ? src[i] : acc[i];
+                            }else{
+                                for(int i = 0; i < n; i++)
+                                    acc[i] += src[i];
+                            }
+                        }
+                    }
+                    if(Pooler == PT_MAX){
+                        for(int i = 0; i < n; i++)
+                            dst[i0 + i] = acc[i];
+                    }else{
+                        for(int i = 0; i < n; i++)
+                            dst[i0 + i] = acc[i] / m_divisor;
+                    }
+                }
+            }
+        }
     }
+};
 
+/**
+ * host implementation of the derivative of local max/avg pooling.
+ *
+ * Every image pixel gathers the gradients of all outputs whose pooling
+ * region contains it, so rows (filter, image y) of the target can be
+ * processed independently.
+ */
+template<bool IsMax>
+struct local_pool_grad_host{
+    float* m_dst;
+    const float* m_img;       ///< only used for max pooling
+    const float* m_acts;      ///< only used for max pooling
+    const float* m_grads;
+    int m_nImgPixY, m_nImgPixX, m_nImg, m_nOutPixY, m_nOutPixX;
+    int m_subsX, m_startX, m_strideX;
+    float m_factNew, m_factOld;
+
+    local_pool_grad_host(float* dst, const float* img, const float* acts, const float* grads,
+            int nImgPixY, int nImgPixX, int nImg, int nOutPixY, int nOutPixX,
+            int subsX, int startX, int strideX, float factNew, float factOld)
+        : m_dst(dst), m_img(img), m_acts(acts), m_grads(grads), m_nImgPixY(nImgPixY), m_nImgPixX(nImgPixX), m_nImg(nImg),
+          m_nOutPixY(nOutPixY), m_nOutPixX(nOutPixX), m_subsX(subsX), m_startX(startX), m_strideX(strideX),
+          m_factNew(factNew), m_factOld(factOld){}
+
+    void operator()(size_t begin, size_t end){
+        const size_t row_size = (size_t) m_nImgPixX * m_nImg;
+        const size_t nOut = (size_t) m_nOutPixY * m_nOutPixX;
+        const int regionEndY = m_startX + m_strideX * (m_nOutPixY - 1) + m_subsX;
+        const int regionEndX = m_startX + m_strideX * (m_nOutPixX - 1) + m_subsX;
+        const float divisor = IsMax ? 1.f : (float) (m_subsX * m_subsX);
+        float acc[POOL_HOST_IMG_BLOCK];
+        for(size_t row = begin / row_size; row < end / row_size; row++){
+            const int f = row / m_nImgPixY;
+            const int y = row % m_nImgPixY;
+            const bool insideY = y >= m_startX && y < regionEndY;
+            const int oy0 = y - m_startX < m_subsX ? 0 : 1 + (y - m_startX - m_subsX) / m_strideX;
+            const int oy1 = insideY ? std::min(m_nOutPixY, 1 + (y - m_startX) / m_strideX) : 0;
+            const float* grads = m_grads + f * nOut * m_nImg;
+            const float* acts  = IsMax ? m_acts + f * nOut * m_nImg : NULL;
+            for(int x = 0; x < m_nImgPixX; x++){
+                const bool inside = insideY && x >= m_startX && x < regionEndX;
+                const int ox0 = x - m_startX < m_subsX ? 0 : 1 + (x - m_startX - m_subsX) / m_strideX;
+                const int ox1 = inside ? std::min(m_nOutPixX, 1 + (x - m_startX) / m_strideX) : 0;
+                const size_t offset = (row * m_nImgPixX + x) * m_nImg;
+                float* dst = m_dst + offset;
+                const float* img = IsMax ? m_img + offset : NULL;
+                for(int i0 = 0; i0 < m_nImg; i0 += POOL_HOST_IMG_BLOCK){
+                    const int n = std::min(POOL_HOST_IMG_BLOCK, m_nImg - i0);
+                    for(int i = 0; i < n; i++)
+                        acc[i] = 0.f;
+                    for(int oy = oy0; oy < oy1; oy++){
+                        for(int ox = ox0; ox < ox1; ox++){
+                            const size_t o = ((size_t) oy * m_nOutPixX + ox) * m_nImg + i0;
+                            if(IsMax){
+                                for(int i = 0; i < n; i++)
+                                    acc[i] += (img[i0 + i] == acts[o + i]) * grads[o + i];
+                            }else{
+                                for(int i = 0; i < n; i++)
+                                    acc[i] += grads[o + i];
+                            }
+                        }
+                    }
+                    if(m_factOld == 0.f && m_factNew == 1.f){
+                        for(int i = 0; i < n; i++)
+                            dst[i0 + i] = acc[i] / divisor;
+                    }else if(m_factOld == 0.f){
+                        for(int i = 0; i < n; i++)
+                            dst[i0 + i] = m_factNew * acc[i] / divisor;
+                    }else{
+                        for(int i = 0; i < n; i++)
+                            dst[i0 + i] = m_factOld * dst[i0 + i] + m_factNew * acc[i] / divisor;
+                    }
+                }
+            }
+        }
+    }
+};
+
+/**
+ * run a host kernel which processes rows of row_size elements on the host thread pool.
+ * Chunks consist of whole rows and are about host_chunk_size() elements large.
+ */
+template<class F>
+void parallel_for_rows(size_t rows, size_t row_size, F& f){
+    size_t rows_per_chunk = std::max((size_t) 1, host_chunk_size(sizeof(float)) / std::max((size_t) 1, row_size));
+    parallel_for(rows * row_size, rows_per_chunk * row_size, f);
+}
 
 template<>
     void local_pool(tensor<float,host_memory_space>& target,
             const tensor<float,host_memory_space>& images,
             int subsX, int startX, int strideX, int outputsX, pool_type pooler){
+
+        cuvAssert(images.ndim()==4);
+        unsigned int nFilt    = images.shape(0);
+        unsigned int nImgPixY = images.shape(1);
+        unsigned int nImgPixX = images.shape(2);
+        unsigned int nImg     = images.shape(3);
+
+        cuvAssert(target.ndim()==4);
+        cuvAssert(target.shape(0) == nFilt);
+        unsigned int nOutPixY = target.shape(1);
+        unsigned int nOutPixX = target.shape(2);
+        cuvAssert(target.shape(3) == nImg);
+        cuvAssert(nOutPixX == (unsigned int) outputsX);
+        cuvAssert(images.is_c_contiguous() && target.is_c_contiguous());
+
+        // the average is taken w.r.t. the same number of pixels as on the device
+        unsigned int poolSize = nImgPixY / nOutPixY;
+
+        size_t rows = nFilt * nOutPixY, row_size = nOutPixX * nImg;
+        switch(pooler){
+            case PT_MAX:
+                {
+                    local_pool_host<PT_MAX> k(target.ptr(), images.ptr(), nImgPixY, nImgPixX, nImg, nOutPixY, nOutPixX,
+                        subsX, startX, strideX, 1.f);
+                    parallel_for_rows(rows, row_size, k);
+                }
+                break;
+            case PT_AVG:
+                {
+                    local_pool_host<PT_AVG> k(target.ptr(), images.ptr(), nImgPixY, nImgPixX, nImg, nOutPixY, nOutPixX,
+                        subsX, startX, strideX, (float) (poolSize * poolSize));
+                    parallel_for_rows(rows, row_size, k);
+                }
+                break;
+        }
     }
 template<>
     void local_pool(tensor<float,dev_memory_space>& target,
             const tensor<float,dev_memory_space>& images,
             int subsX, int startX, int strideX, int outputsX, pool_type pooler){
+#ifdef CUV_NO_CUDA
+        tensor<float,host_memory_space> htarget = cuv::detail::host_alias(target);
+        local_pool(htarget, cuv::detail::host_alias(images), subsX, startX, strideX, outputsX, pooler);
+#else
 
         cuvAssert(images.ndim()==4);
         unsigned int nFilt    = images.shape(0);
@@ -531,14 +703,46 @@ template<>
                         subsX, startX, strideX, nOutPixX, AvgPooler(poolSize*poolSize));
                 break;
         }
+#endif
     }
 template<>
     void local_max_pool_grad(tensor<float,host_memory_space>& target, const tensor<float,host_memory_space>& images, const tensor<float,host_memory_space>& maxGrads,
             const tensor<float,host_memory_space>& maxActs, int subsX, int startX, int strideX, float factNew,float factOld){
+
+        cuvAssert(target.ndim()==4);
+        unsigned int nImgChan  = target.shape(0);
+        unsigned int nImgPixY  = target.shape(1);
+        unsigned int nImgPixX  = target.shape(2);
+        unsigned int nImg      = target.shape(3);
+
+        cuvAssert(images.ndim()==4);
+        cuvAssert(nImgChan  == images.shape(0));
+        cuvAssert(nImgPixY  == images.shape(1));
+        cuvAssert(nImgPixX  == images.shape(2));
+        cuvAssert(nImg      == images.shape(3));
+
+        cuvAssert(maxGrads.ndim()==4);
+        cuvAssert(nImgChan == maxGrads.shape(0));
+        unsigned int nOutPixY = maxGrads.shape(1);
+        unsigned int nOutPixX = maxGrads.shape(2);
+        cuvAssert(nImg     == maxGrads.shape(3));
+
+        cuvAssert(maxActs.ndim()==4);
+        cuvAssert(maxActs.shape() == maxGrads.shape());
+        cuvAssert(strideX <= subsX);
+
+        local_pool_grad_host<true> k(target.ptr(), images.ptr(), maxActs.ptr(), maxGrads.ptr(),
+            nImgPixY, nImgPixX, nImg, nOutPixY, nOutPixX, subsX, startX, strideX, factNew, factOld);
+        parallel_for_rows(nImgChan * nImgPixY, nImgPixX * nImg, k);
     }
 template<>
     void local_max_pool_grad(tensor<float,dev_memory_space>& target, const tensor<float,dev_memory_space>& images, const tensor<float,dev_memory_space>& maxGrads,
             const tensor<float,dev_memory_space>& maxActs, int subsX, int startX, int strideX, float factNew,float factOld){
+#ifdef CUV_NO_CUDA
+        tensor<float,host_memory_space> htarget = cuv::detail::host_alias(target);
+        local_max_pool_grad(htarget, cuv::detail::host_alias(images), cuv::detail::host_alias(maxGrads), cuv::detail::host_alias(maxActs),
+                subsX, startX, strideX, factNew, factOld);
+#else
 
 /*
  * imgs:        (numFilters, imgPixels, numImages)
@@ -580,15 +784,37 @@ template<>
 /*                      int subsX, int startX, int strideX, int outputsX);*/
         convLocalMaxUndo(nv_images,nv_maxGrads, nv_maxActs, nv_target, 
                 subsX,startX,strideX,nOutPixX,factOld,factNew);
+#endif
     }
 
 template<>
     void local_avg_pool_grad(tensor<float,host_memory_space>& target, const tensor<float,host_memory_space>& avgGrads,
-            int subsX, int startX, int strideX){
+            int subsX, int startX, int strideX, float factNew, float factOld){
+
+        cuvAssert(target.ndim()==4);
+        unsigned int nImgChan  = target.shape(0);
+        unsigned int nImgPixY  = target.shape(1);
+        unsigned int nImgPixX  = target.shape(2);
+        unsigned int nImg      = target.shape(3);
+
+        cuvAssert(avgGrads.ndim()==4);
+        cuvAssert(nImgChan == avgGrads.shape(0));
+        unsigned int nOutPixY = avgGrads.shape(1);
+        unsigned int nOutPixX = avgGrads.shape(2);
+        cuvAssert(nImg == avgGrads.shape(3));
+        cuvAssert(strideX <= subsX);
+
+        local_pool_grad_host<false> k(target.ptr(), NULL, NULL, avgGrads.ptr(),
+            nImgPixY, nImgPixX, nImg, nOutPixY, nOutPixX, subsX, startX, strideX, factNew, factOld);
+        parallel_for_rows(nImgChan * nImgPixY, nImgPixX * nImg, k);
     }
 template<>
     void local_avg_pool_grad(tensor<float,dev_memory_space>& target, const tensor<float,dev_memory_space>& avgGrads,
-            int subsX, int startX, int strideX){
+            int subsX, int startX, int strideX, float factNew, float factOld){
+#ifdef CUV_NO_CUDA
+        tensor<float,host_memory_space> htarget = cuv::detail::host_alias(target);
+        local_avg_pool_grad(htarget, cuv::detail::host_alias(avgGrads), subsX, startX, strideX, factNew, factOld);
+#else
 
 
         cuvAssert(target.ndim()==4);
@@ -606,7 +832,8 @@ template<>
         NVMatrix nv_target NVView4D(target);
         NVMatrix nv_avgGrads NVView4D(avgGrads);
         
-        convLocalAvgUndo(nv_avgGrads, nv_target, subsX,startX,strideX,nOutPixX,nImgPixX);
+        convLocalAvgUndo(nv_avgGrads, nv_target, subsX,startX,strideX,nOutPixX,nImgPixX,factOld,factNew);
+#endif
     }
 template<class V, class M, class T>
 void response_normalization(tensor<V,M,T>& target, tensor<V,M,T>& denoms, const tensor<V,M,T>& images, int patchSize, float addScale, float powScale){
@@ -621,10 +848,14 @@ void response_normalization(tensor<V,M,T>& target, tensor<V,M,T>& denoms, const
         throw std::runtime_error("response_normalization: target must have same shape as denoms");
 #endif
 
+#ifdef CUV_NO_CUDA
+    cudaconv2_only("response_normalization");
+#else
     NVMatrix nv_target NVView4D(target);
     NVMatrix nv_denoms NVView4D(denoms);
     NVMatrix nv_images NVView4D(images);
     convResponseNorm(nv_images, nv_denoms, nv_target, target.shape(0), patchSize, addScale, powScale);
+#endif
 }
 template<class V, class M, class T>
 void response_normalization_grad(tensor<V,M,T>& input_gradients, tensor<V,M,T>& original_outputs, const tensor<V,M,T>& original_inputs,
@@ -650,12 +881,16 @@ void response_normalization_grad(tensor<V,M,T>& input_gradients, tensor<V,M,T>&
         throw std::runtime_error("response_normalization_grad: input_gradients/denoms shapes do not match.");
 #endif
 
+#ifdef CUV_NO_CUDA
+    cudaconv2_only("response_normalization_grad");
+#else
     NVMatrix nv_input_grad NVView4D(input_gradients);
     NVMatrix nv_orig_out NVView4D(original_outputs);
     NVMatrix nv_orig_in  NVView4D(original_inputs);
     NVMatrix nv_delta NVView4D(delta);
     NVMatrix nv_denoms NVView4D(denoms);
     convResponseNormUndo(nv_delta, nv_denoms, nv_orig_in, nv_orig_out, nv_input_grad, input_gradients.shape(0), patchSize, addScale, powScale, factOld, factNew);
+#endif
 }
 
 template<class V, class M, class T>
@@ -671,6 +906,9 @@ void contrast_normalization(tensor<V,M,T>& target, tensor<V,M,T>& denoms, const
         throw std::runtime_error("response_normalization: target must have same shape as denoms");
 #endif
 
+#ifdef CUV_NO_CUDA
+    cudaconv2_only("contrast_normalization");
+#else
     NVMatrix nv_target NVView4D(target);
     NVMatrix nv_denoms NVView4D(denoms);
     NVMatrix nv_meandiffs NVView4D(meanDiffs);
@@ -680,6 +918,7 @@ void contrast_normalization(tensor<V,M,T>& target, tensor<V,M,T>& denoms, const
     convLocalPool(nv_images, nv_meandiffs, images.shape(0), patchSize, -patchSize/2, 1, images.shape(1), AvgPooler(patchSize*patchSize));
     nv_meandiffs.add(nv_images, -1, 1);
     convContrastNorm(nv_images,nv_meandiffs, nv_denoms,nv_target, target.shape(0), patchSize, addScale, powScale);
+#endif
 }
 template<class V, class M, class T>
 void contrast_normalization_grad(tensor<V,M,T>& input_gradients, tensor<V,M,T>& original_outputs, const tensor<V,M,T>& meanDiffs, 
@@ -705,6 +944,9 @@ void contrast_normalization_grad(tensor<V,M,T>& input_gradients, tensor<V,M,T>&
         throw std::runtime_error("response_normalization_grad: input_gradients/denoms shapes do not match.");
 #endif
 
+#ifdef CUV_NO_CUDA
+    cudaconv2_only("contrast_normalization_grad");
+#else
     NVMatrix nv_input_grad NVView4D(input_gradients);
     NVMatrix nv_orig_out NVView4D(original_outputs);
     NVMatrix nv_meandiffs  NVView4D(meanDiffs);
@@ -715,6 +957,7 @@ void contrast_normalization_grad(tensor<V,M,T>& input_gradients, tensor<V,M,T>&
     // "spread" delta from above according to mean
     convLocalAvgUndo(nv_delta, nv_orig_out, patchSize, -patchSize/2, 1, input_gradients.shape(1), input_gradients.shape(1));
     nv_input_grad.add(nv_orig_out, 1,-1);
+#endif
 }
 
 template<class V, class M, class T>
@@ -731,10 +974,14 @@ void gaussian_blur(tensor<V,M,T>& target, const tensor<V,M,T>& images, const ten
     if(target.shape() != images.shape())
         throw std::runtime_error("gaussian_blur: images and targets must have same shape.");
 #endif
+#ifdef CUV_NO_CUDA
+    cudaconv2_only("gaussian_blur");
+#else
     NVMatrix nv_images NVView4D(images);
     NVMatrix nv_target NVView4D(target);
     NVMatrix nv_filter NVView1D(filter);
     convGaussianBlur(nv_images, nv_filter, nv_target, horiz, images.shape(0), factOld, factNew);
+#endif
 }
 
 template<class V, class M, class T>
@@ -747,9 +994,13 @@ void bed_of_nails(tensor<V,M,T>& target, const tensor<V,M,T>& images, int startX
     if(target.shape(1) != images.shape(1) / strideX)
         throw std::runtime_error("bed_of_nails: images and targets shapes must relate by strideX.");
 #endif
+#ifdef CUV_NO_CUDA
+    cudaconv2_only("bed_of_nails");
+#else
     NVMatrix nv_images NVView4D(images);
     NVMatrix nv_target NVView4D(target);
     convBedOfNails(nv_images, nv_target, images.shape(0), images.shape(1), startX, strideX, factOld, factNew);
+#endif
 }
 
 template<class V, class M, class T>
@@ -762,21 +1013,32 @@ void bed_of_nails_grad(tensor<V,M,T>& target, const tensor<V,M,T>& delta, int st
     if(delta.shape(1) != target.shape(1) / strideX)
         throw std::runtime_error("bed_of_nails_grad: deltas and targets shapes must relate by strideX.");
 #endif
+#ifdef CUV_NO_CUDA
+    cudaconv2_only("bed_of_nails_grad");
+#else
     NVMatrix nv_delta NVView4D(delta);
     NVMatrix nv_target NVView4D(target);
     convBedOfNailsUndo(nv_delta, nv_target, target.shape(0), target.shape(1), startX, strideX, factOld, factNew);
+#endif
 }
 
 template<class V, class M, class T>
 void crop(tensor<V,M,T>& cropped, const tensor<V,M,T>& images, int startY, int startX){
+#ifdef CUV_NO_CUDA
+    cudaconv2_only("crop");
+#else
     NVMatrix nv_cropped NVView4D(cropped);
     NVMatrix nv_images NVView4D(images);
 
     convCrop(nv_images, nv_cropped, images.shape(1), cropped.shape(1), startY, startX);
+#endif
 }
 
 template<class V, class M, class T>
 void project_to_ball(tensor<V,M,T>& filters, float ball){
+#ifdef CUV_NO_CUDA
+    cudaconv2_only("project_to_ball");
+#else
     if(filters.ndim() == 3){
         // n_modules = 1
         NVMatrix nv_filters NVView3D(filters);
@@ -787,14 +1049,19 @@ void project_to_ball(tensor<V,M,T>& filters, float ball){
     }else{
         throw std::runtime_error("project_to_ball: don't know how to normalize your supplied filters. dim!=3 and dim!=4");
     }
+#endif
 }
 
 template<class V, class M, class T>
 void resize_bilinear(tensor<V,M,T>& dest, const tensor<V,M,T>& images, float scale){
+#ifdef CUV_NO_CUDA
+    cudaconv2_only("resize_bilinear");
+#else
     NVMatrix nv_dest NVView4D(dest);
     NVMatrix nv_images NVView4D(images);
 
     convResizeBilinear(nv_images, nv_dest, images.shape(1), dest.shape(1), scale);
+#endif
 }
 
 template<class V, class M, class T>
@@ -810,10 +1077,14 @@ void response_norm_cross_map(tensor<V,M,T>& target, tensor<V,M,T>& denoms, const
         throw std::runtime_error("response_norm_cross_map: target must have same shape as denoms");
 #endif
 
+#ifdef CUV_NO_CUDA
+    cudaconv2_only("response_norm_cross_map");
+#else
     NVMatrix nv_target NVView4D(target);
     NVMatrix nv_denoms NVView4D(denoms);
     NVMatrix nv_images NVView4D(images);
     convResponseNormCrossMap(nv_images,nv_denoms,nv_target, target.shape(0), sizeF, addScale, powScale, blocked);
+#endif
 }
 
 template<class V, class M, class T>
@@ -840,17 +1111,22 @@ void response_norm_cross_map_grad(tensor<V,M,T>& input_gradients, tensor<V,M,T>&
         throw std::runtime_error("response_norm_cross_map_grad: input_gradients/denoms shapes do not match.");
 #endif
 
+#ifdef CUV_NO_CUDA
+    cudaconv2_only("response_norm_cross_map_grad");
+#else
     NVMatrix nv_input_grad NVView4D(input_gradients);
     NVMatrix nv_orig_out NVView4D(original_outputs);
     NVMatrix nv_orig_in  NVView4D(original_inputs);
     NVMatrix nv_delta NVView4D(delta);
     NVMatrix nv_denoms NVView4D(denoms);
     convResponseNormCrossMapUndo(nv_delta,nv_denoms,nv_orig_in, nv_orig_out, nv_input_grad, input_gradients.shape(0), sizeF, addScale, powScale, blocked, factOld, factNew);
+#endif
 }
 
 
 
 
+#ifndef CUV_NO_CUDA
 template<bool FirstDim, tuplewise_op_functor to,class T>
 __global__
 void tuplewise_op_kernel(T* dst, const T* src, unsigned int dst_rows, unsigned int dst_cols, unsigned int subspace_size, float eps){
@@ -1097,6 +1373,7 @@ void tuplewise_op_grad_kernel(T* dst, const T* src, const T* delta, unsigned int
         }
     }
 }
+#endif /* CUV_NO_CUDA */
 
 
 
@@ -1195,7 +1472,7 @@ template<class V,class M, class T>
         
 
 
-        if(IsSame<M,host_memory_space>::Result::value){
+        if(use_host_impl<M>()){
             switch(to){
                 case TO_NORM:
                     if(dim == 0){
@@ -1235,6 +1512,7 @@ template<class V,class M, class T>
                     break;
             }
         }else{
+#ifndef CUV_NO_CUDA
             // device: run kernel
             unsigned int num_threads = min(512, int(32 * ceil( items / 32. )));
 
@@ -1291,6 +1569,7 @@ template<class V,class M, class T>
                     break;
             }
             cuvSafeCall(cudaThreadSynchronize());
+#endif
         }
     }
 
@@ -1458,7 +1737,7 @@ template<class V,class M, class T>
 
         unsigned int items = delta.size() / delta.shape(dim);
         unsigned int lines = delta.shape(dim);
-        if(IsSame<M,host_memory_space>::Result::value){
+        if(use_host_impl<M>()){
             switch(to){
                 case TO_NORM:
                     if(dim == 0){
@@ -1501,6 +1780,7 @@ template<class V,class M, class T>
                     break;
             }
         }else{
+#ifndef CUV_NO_CUDA
             // device: run kernel
             unsigned int num_threads = min(512, int(32 * ceil( items / 32. )));
 
@@ -1556,6 +1836,7 @@ template<class V,class M, class T>
                     break;
             }
             cuvSafeCall(cudaThreadSynchronize());
+#endif
         }
     }
 
@@ -1619,6 +1900,7 @@ for (int i = 0; i < channels; i++)
 }
 
 
+#ifndef CUV_NO_CUDA
 /*
  * - one block -> szChunk x szChunk
  * - no restrictions on dimensions
@@ -1738,6 +2020,7 @@ __global__ void kUpscaleGrad(float* dest_grad, float* src_grad, int channels,
 		}
 	}
 }
+#endif /* CUV_NO_CUDA */
 
 template<class V, class M, class T>
 void upscaleOp(tensor<V,M,T>& dst, const tensor<V,M,T>& src, int factor) {
@@ -1748,6 +2031,10 @@ void upscaleOp(tensor<V,M,T>& dst, const tensor<V,M,T>& src, int factor) {
   const int nr_images = src.shape(3);
 
 
+#ifdef CUV_NO_CUDA
+	kUpscale_host<V,M,T>( dst,
+			src, channels, height, width, nr_images, factor);
+#else
 	const int chunkSize = 4;
 	dim3 threads(32, chunkSize*chunkSize); // 4x4 WARPS
 
@@ -1765,6 +2052,7 @@ void upscaleOp(tensor<V,M,T>& dst, const tensor<V,M,T>& src, int factor) {
 			const_cast<float*>(src.ptr()), channels, height, width, nr_images, factor);
 
     cuvSafeCall(cudaDeviceSynchronize());
+#endif
 }
 
 
@@ -1776,6 +2064,10 @@ void upscaleGrad(tensor<V,M,T>& dst, const tensor<V,M,T>& src, int factor) {
   const int nr_images = dst.shape(3);
 
 
+#ifdef CUV_NO_CUDA
+	kUpscaleGrad_host<V,M,T>(dst,
+			src, channels, height, width, nr_images, factor);
+#else
 	const int chunkSize = 4;
 	dim3 threads(32, chunkSize*chunkSize); // 4x4 WARPS
 
@@ -1793,6 +2085,7 @@ void upscaleGrad(tensor<V,M,T>& dst, const tensor<V,M,T>& src, int factor) {
 			const_cast<float*>(src.ptr()), channels, height, width, nr_images, factor);
 
    cuvSafeCall(cudaDeviceSynchronize());
+#endif
 }
 
 #define INSTOUT(V,M,T) \
@@ -170,6 +170,8 @@ void local_pool(tensor<V,M,T>& dst, const tensor<V,M,T>& images,
 
 /**
  * derivative of local max-pooling
+ *
+ * target = factOld * target + factNew * gradient
  */
 template<class V, class M, class T>
 void local_max_pool_grad(tensor<V,M,T>& target, const tensor<V,M,T>& images, const tensor<V,M,T>& maxGrads,
@@ -177,10 +179,12 @@ void local_max_pool_grad(tensor<V,M,T>& target, const tensor<V,M,T>& images, con
 
 /**
  * derivative of local avg-pooling
+ *
+ * target = factOld * target + factNew * gradient
  */
 template<class V, class M, class T>
 void local_avg_pool_grad(tensor<V,M,T>& target, const tensor<V,M,T>& avgGrads, 
-        int subsX, int startX, int strideX);
+        int subsX, int startX, int strideX, float factNew=1.f, float factOld=0.f);
 
 /**
  * response normalization.
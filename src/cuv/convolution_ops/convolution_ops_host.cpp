@@ -0,0 +1,315 @@
+//*LB*
+// Copyright (c) 2010, University of Bonn, Institute for Computer Science VI
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+//  * Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//  * Neither the name of the University of Bonn 
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this software without specific prior written
+//    permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//*LE*
+
+
+
+
+/**
+ * @file convolution_ops_host.cpp
+ * @brief host implementation of convolutions using im2col and cblas_sgemm
+ * @ingroup convolution_ops
+ */
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include <cblas.h>
+#include <cuv/tools/cuv_general.hpp>
+#include <cuv/tools/thread_pool.hpp>
+#include <cuv/convolution_ops/convolution_ops_host.hpp>
+
+namespace cuv{ namespace alex_conv{ namespace detail{
+
+namespace{
+    /// size in bytes of the im2col matrix of one tile (about the size of L2 cache)
+    const size_t CONV_HOST_TILE_BYTES = 256 * 1024;
+
+    /// minimum number of columns of a tile, smaller products are too inefficient
+    const int CONV_HOST_MIN_COLS = 32;
+
+    /**
+     * divides the columns (module, image) of the lowered convolution into tiles
+     * of nMod consecutive modules and nImg consecutive images for each group.
+     */
+    struct tiling{
+        const host_conv_geometry& g;
+        int K;            ///< rows of the im2col matrix: nFiltChan * filter pixels
+        int nModules;
+        int filtPerGroup;
+        int tileImg, tileMod;
+        int nTilesImg, nTilesMod;
+
+        /**
+         * @param maxTileImg upper bound for the number of images in a tile
+         */
+        tiling(const host_conv_geometry& _g, int maxTileImg)
+            :g(_g)
+        {
+            cuvAssert(g.nGroups > 0);
+            cuvAssert(g.nFilt % g.nGroups == 0);
+            cuvAssert(g.colorIndices || g.nFiltChan * g.nGroups <= g.nImgChan);
+            K            = g.nFiltChan * g.filtSize * g.filtSize;
+            nModules     = g.nModulesY * g.nModulesX;
+            filtPerGroup = g.nFilt / g.nGroups;
+            int cols     = std::max(CONV_HOST_MIN_COLS, (int)(CONV_HOST_TILE_BYTES / (sizeof(float) * K)));
+            tileImg      = std::max(1, std::min(std::min(g.nImg, maxTileImg), cols));
+            tileMod      = std::max(1, std::min(nModules, cols / tileImg));
+            nTilesImg    = (g.nImg + tileImg - 1) / tileImg;
+            nTilesMod    = (nModules + tileMod - 1) / tileMod;
+        }
+        int color(int grp, int c)const{
+            return g.colorIndices ? g.colorIndices[grp * g.nFiltChan + c] : grp * g.nFiltChan + c;
+        }
+
+        /**
+         * copy the receptive fields of modules [m0,m0+nm) and images [i0,i0+ni)
+         * of group grp to the columns of col (K x nm*ni).
+         */
+        void im2col(float* col, const float* img, int grp, int m0, int nm, int i0, int ni)const{
+            const int fs = g.filtSize, ncols = nm * ni;
+            for(int c = 0; c < g.nFiltChan; c++){
+                const float* imgc = img + (size_t) color(grp, c) * g.nImgPixY * g.nImgPixX * g.nImg + i0;
+                for(int y = 0; y < fs; y++){
+                    for(int x = 0; x < fs; x++){
+                        float* row = col + (size_t) ((c * fs + y) * fs + x) * ncols;
+                        for(int mm = 0; mm < nm; mm++){
+                            const int m  = m0 + mm;
+                            const int py = g.paddingStart + (m / g.nModulesX) * g.moduleStride + y;
+                            const int px = g.paddingStart + (m % g.nModulesX) * g.moduleStride + x;
+                            float* dst = row + mm * ni;
+                            if(py >= 0 && py < g.nImgPixY && px >= 0 && px < g.nImgPixX)
+                                std::memcpy(dst, imgc + ((size_t) py * g.nImgPixX + px) * g.nImg, ni * sizeof(float));
+                            else
+                                std::fill(dst, dst + ni, 0.f);
+                        }
+                    }
+                }
+            }
+        }
+
+        /**
+         * add the columns of col (K x nm*ni) to the receptive fields in img,
+         * the reverse operation of im2col.
+         */
+        void col2im(float* img, const float* col, int grp, int m0, int nm, int i0, int ni)const{
+            const int fs = g.filtSize, ncols = nm * ni;
+            for(int c = 0; c < g.nFiltChan; c++){
+                float* imgc = img + (size_t) color(grp, c) * g.nImgPixY * g.nImgPixX * g.nImg + i0;
+                for(int y = 0; y < fs; y++){
+                    for(int x = 0; x < fs; x++){
+                        const float* row = col + (size_t) ((c * fs + y) * fs + x) * ncols;
+                        for(int mm = 0; mm < nm; mm++){
+                            const int m  = m0 + mm;
+                            const int py = g.paddingStart + (m / g.nModulesX) * g.moduleStride + y;
+                            const int px = g.paddingStart + (m % g.nModulesX) * g.moduleStride + x;
+                            if(py < 0 || py >= g.nImgPixY || px < 0 || px >= g.nImgPixX)
+                                continue;
+                            float* dst = imgc + ((size_t) py * g.nImgPixX + px) * g.nImg;
+                            const float* src = row + mm * ni;
+                            for(int i = 0; i < ni; i++)
+                                dst[i] += src[i];
+                        }
+                    }
+                }
+            }
+        }
+
+        /// copy hidden units of group grp, modules [m0,m0+nm), images [i0,i0+ni) to packed (filtPerGroup x nm*ni)
+        void pack_hidden(float* packed, const float* hid, int grp, int m0, int nm, int i0, int ni)const{
+            for(int f = 0; f < filtPerGroup; f++){
+                const float* src = hid + ((size_t) (grp * filtPerGroup + f) * nModules + m0) * g.nImg + i0;
+                float* dst = packed + (size_t) f * nm * ni;
+                for(int mm = 0; mm < nm; mm++)
+                    std::memcpy(dst + mm * ni, src + (size_t) mm * g.nImg, ni * sizeof(float));
+            }
+        }
+
+        /// hid = factOld * hid + packed for group grp, modules [m0,m0+nm), images [i0,i0+ni)
+        void unpack_hidden(float* hid, const float* packed, int grp, int m0, int nm, int i0, int ni, float factOld)const{
+            for(int f = 0; f < filtPerGroup; f++){
+                float* dst = hid + ((size_t) (grp * filtPerGroup + f) * nModules + m0) * g.nImg + i0;
+                const float* src = packed + (size_t) f * nm * ni;
+                for(int mm = 0; mm < nm; mm++, dst += g.nImg, src += ni){
+                    if(factOld == 0.f)
+                        std::memcpy(dst, src, ni * sizeof(float));
+                    else
+                        for(int i = 0; i < ni; i++)
+                            dst[i] = factOld * dst[i] + src[i];
+                }
+            }
+        }
+    };
+
+    /// forward pass, tiles are (group, module tile, image tile) and write disjoint parts of dst
+    struct filter_acts_tiles{
+        const tiling& t;
+        float* dst;
+        const float *img, *filter;
+        float factNew, factOld;
+        filter_acts_tiles(const tiling& _t, float* _dst, const float* _img, const float* _filter, float _factNew, float _factOld)
+            :t(_t), dst(_dst), img(_img), filter(_filter), factNew(_factNew), factOld(_factOld){}
+
+        void operator()(size_t begin, size_t end){
+            std::vector<float> col((size_t) t.K * t.tileMod * t.tileImg);
+            std::vector<float> out((size_t) t.filtPerGroup * t.tileMod * t.tileImg);
+            for(size_t tile = begin; tile < end; tile++){
+                const int grp = tile / (t.nTilesMod * t.nTilesImg);
+                const int mt  = (tile / t.nTilesImg) % t.nTilesMod;
+                const int it  = tile % t.nTilesImg;
+                const int m0 = mt * t.tileMod, nm = std::min(t.tileMod, t.nModules - m0);
+                const int i0 = it * t.tileImg, ni = std::min(t.tileImg, t.g.nImg - i0);
+                const int ncols = nm * ni;
+                t.im2col(&col[0], img, grp, m0, nm, i0, ni);
+                // out (filtPerGroup x ncols) = filter_grp^T (filtPerGroup x K) * col (K x ncols)
+                cblas_sgemm(CblasRowMajor, CblasTrans, CblasNoTrans, t.filtPerGroup, ncols, t.K,
+                        factNew, filter + grp * t.filtPerGroup, t.g.nFilt, &col[0], ncols,
+                        0.f, &out[0], ncols);
+                t.unpack_hidden(dst, &out[0], grp, m0, nm, i0, ni, factOld);
+            }
+        }
+    };
+
+    /**
+     * derivative w.r.t. images. Receptive fields of different modules and
+     * groups overlap, so tiles only run in parallel over images.
+     */
+    struct img_acts_tiles{
+        const tiling& t;
+        float* dst;
+        const float *delta, *filter;
+        float factNew, factOld;
+        img_acts_tiles(const tiling& _t, float* _dst, const float* _delta, const float* _filter, float _factNew, float _factOld)
+            :t(_t), dst(_dst), delta(_delta), filter(_filter), factNew(_factNew), factOld(_factOld){}
+
+        void operator()(size_t begin, size_t end){
+            const host_conv_geometry& g = t.g;
+            std::vector<float> col((size_t) t.K * t.tileMod * t.tileImg);
+            std::vector<float> hid((size_t) t.filtPerGroup * t.tileMod * t.tileImg);
+            for(size_t it = begin; it < end; it++){
+                const int i0 = it * t.tileImg, ni = std::min(t.tileImg, g.nImg - i0);
+                for(size_t p = 0; p < (size_t) g.nImgChan * g.nImgPixY * g.nImgPixX; p++){
+                    float* d = dst + p * g.nImg + i0;
+                    if(factOld == 0.f)
+                        std::fill(d, d + ni, 0.f);
+                    else if(factOld != 1.f)
+                        for(int i = 0; i < ni; i++)
+                            d[i] *= factOld;
+                }
+                for(int grp = 0; grp < g.nGroups; grp++){
+                    for(int mt = 0; mt < t.nTilesMod; mt++){
+                        const int m0 = mt * t.tileMod, nm = std::min(t.tileMod, t.nModules - m0);
+                        const int ncols = nm * ni;
+                        t.pack_hidden(&hid[0], delta, grp, m0, nm, i0, ni);
+                        // col (K x ncols) = filter_grp (K x filtPerGroup) * hid (filtPerGroup x ncols)
+                        cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, t.K, ncols, t.filtPerGroup,
+                                factNew, filter + grp * t.filtPerGroup, g.nFilt, &hid[0], ncols,
+                                0.f, &col[0], ncols);
+                        t.col2im(dst, &col[0], grp, m0, nm, i0, ni);
+                    }
+                }
+            }
+        }
+    };
+
+    /**
+     * derivative w.r.t. filters. Every part accumulates the tiles
+     * [begin,end) into its own copy of the filters.
+     */
+    struct weight_acts_tiles{
+        const tiling& t;
+        const float *delta, *img;
+        std::vector<std::vector<float> >& partial;
+        size_t tilesPerPart;
+        weight_acts_tiles(const tiling& _t, const float* _delta, const float* _img, std::vector<std::vector<float> >& _partial, size_t _tilesPerPart)
+            :t(_t), delta(_delta), img(_img), partial(_partial), tilesPerPart(_tilesPerPart){}
+
+        void operator()(size_t begin, size_t end){
+            const host_conv_geometry& g = t.g;
+            const size_t nTiles = (size_t) g.nGroups * t.nTilesMod * t.nTilesImg;
+            std::vector<float> col((size_t) t.K * t.tileMod * t.tileImg);
+            std::vector<float> hid((size_t) t.filtPerGroup * t.tileMod * t.tileImg);
+            for(size_t part = begin; part < end; part++){
+                std::vector<float>& acc = partial[part];
+                acc.assign((size_t) t.K * g.nFilt, 0.f);
+                for(size_t tile = part * tilesPerPart; tile < std::min(nTiles, (part + 1) * tilesPerPart); tile++){
+                    const int grp = tile / (t.nTilesMod * t.nTilesImg);
+                    const int mt  = (tile / t.nTilesImg) % t.nTilesMod;
+                    const int it  = tile % t.nTilesImg;
+                    const int m0 = mt * t.tileMod, nm = std::min(t.tileMod, t.nModules - m0);
+                    const int i0 = it * t.tileImg, ni = std::min(t.tileImg, g.nImg - i0);
+                    const int ncols = nm * ni;
+                    t.im2col(&col[0], img, grp, m0, nm, i0, ni);
+                    t.pack_hidden(&hid[0], delta, grp, m0, nm, i0, ni);
+                    // acc_grp (K x filtPerGroup) += col (K x ncols) * hid^T (ncols x filtPerGroup)
+                    cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasTrans, t.K, t.filtPerGroup, ncols,
+                            1.f, &col[0], ncols, &hid[0], ncols,
+                            1.f, &acc[grp * t.filtPerGroup], g.nFilt);
+                }
+            }
+        }
+    };
+}
+
+void host_filter_acts(float* dst, const float* img, const float* filter,
+        const host_conv_geometry& g, float factNew, float factOld){
+    tiling t(g, g.nImg);
+    filter_acts_tiles f(t, dst, img, filter, factNew, factOld);
+    parallel_tasks((size_t) g.nGroups * t.nTilesMod * t.nTilesImg, f);
+}
+
+void host_img_acts(float* dst, const float* delta, const float* filter,
+        const host_conv_geometry& g, float factNew, float factOld){
+    // split images such that every thread gets some work
+    unsigned int nThreads = cuv::detail::host_thread_limit(0);
+    tiling t(g, (g.nImg + nThreads - 1) / nThreads);
+    img_acts_tiles f(t, dst, delta, filter, factNew, factOld);
+    parallel_tasks(t.nTilesImg, f);
+}
+
+void host_weight_acts(float* dst, const float* delta, const float* img,
+        const host_conv_geometry& g, float factNew, float factOld){
+    tiling t(g, g.nImg);
+    size_t nTiles = (size_t) g.nGroups * t.nTilesMod * t.nTilesImg;
+    size_t nParts = std::min(nTiles, (size_t) cuv::detail::host_thread_limit(0));
+    size_t tilesPerPart = (nTiles + nParts - 1) / nParts;
+    nParts = (nTiles + tilesPerPart - 1) / tilesPerPart;
+    std::vector<std::vector<float> > partial(nParts);
+    weight_acts_tiles f(t, delta, img, partial, tilesPerPart);
+    parallel_tasks(nParts, f);
+
+    // dst = factOld * dst + factNew * sum of parts
+    const size_t n = (size_t) t.K * g.nFilt;
+    for(size_t i = 0; i < n; i++){
+        float s = 0.f;
+        for(size_t p = 0; p < nParts; p++)
+            s += partial[p][i];
+        dst[i] = (factOld == 0.f ? 0.f : factOld * dst[i]) + factNew * s;
+    }
+}
+
+} } }
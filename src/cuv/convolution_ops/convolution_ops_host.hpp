@@ -0,0 +1,100 @@
+//*LB*
+// Copyright (c) 2010, University of Bonn, Institute for Computer Science VI
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+//  * Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//  * Neither the name of the University of Bonn 
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this software without specific prior written
+//    permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//*LE*
+
+
+
+
+/**
+ * @file convolution_ops_host.hpp
+ * @brief host (CPU) implementation of the convolutions in convolution_ops.hpp
+ * @ingroup convolution_ops
+ *
+ * The convolutions are lowered to matrix products (cblas_sgemm): the
+ * receptive fields of a tile of modules and images are copied into the
+ * columns of a matrix (im2col) which is multiplied with the filters of a
+ * group. Tiles are sized to fit into L2 cache and processed on the host
+ * thread pool.
+ */
+#ifndef __CONVOLUTION_OPS_HOST_HPP__
+#define __CONVOLUTION_OPS_HOST_HPP__
+
+namespace cuv{ namespace alex_conv{ namespace detail{
+
+/**
+ * geometry of a convolution, in the memory layout of convolution_ops.hpp:
+ *
+ * - images:   (nImgChan, nImgPixY, nImgPixX, nImg)
+ * - filters:  (nFiltChan, filtSize*filtSize, nFilt)
+ * - hidden:   (nFilt, nModulesY, nModulesX, nImg)
+ *
+ * Filters are divided into nGroups groups of consecutive filters. Channel c
+ * of the filters in group g is applied to image channel
+ * colorIndices[g*nFiltChan + c], or to g*nFiltChan + c if colorIndices is NULL.
+ */
+struct host_conv_geometry{
+    int nImgChan, nImgPixY, nImgPixX, nImg;
+    int nFiltChan, filtSize, nFilt;
+    int nModulesY, nModulesX;
+    int paddingStart, moduleStride, nGroups;
+    const int* colorIndices;
+};
+
+/**
+ * dst = factOld * dst + factNew * convolution(img, filter)
+ *
+ * @param dst    hidden   (nFilt, nModulesY, nModulesX, nImg)
+ * @param img    images   (nImgChan, nImgPixY, nImgPixX, nImg)
+ * @param filter filters  (nFiltChan, nFiltPix, nFilt)
+ */
+void host_filter_acts(float* dst, const float* img, const float* filter,
+        const host_conv_geometry& g, float factNew, float factOld);
+
+/**
+ * dst = factOld * dst + factNew * (derivative of convolution w.r.t. images)
+ *
+ * @param dst    images   (nImgChan, nImgPixY, nImgPixX, nImg)
+ * @param delta  hidden   (nFilt, nModulesY, nModulesX, nImg)
+ * @param filter filters  (nFiltChan, nFiltPix, nFilt)
+ */
+void host_img_acts(float* dst, const float* delta, const float* filter,
+        const host_conv_geometry& g, float factNew, float factOld);
+
+/**
+ * dst = factOld * dst + factNew * (derivative of convolution w.r.t. filters)
+ *
+ * @param dst    filters  (nFiltChan, nFiltPix, nFilt)
+ * @param delta  hidden   (nFilt, nModulesY, nModulesX, nImg)
+ * @param img    images   (nImgChan, nImgPixY, nImgPixX, nImg)
+ */
+void host_weight_acts(float* dst, const float* delta, const float* img,
+        const host_conv_geometry& g, float factNew, float factOld);
+
+} } }
+
+#endif /* __CONVOLUTION_OPS_HOST_HPP__ */
@@ -73,7 +73,7 @@ namespace cuv{
 					T4 tmp;
 					tmp = plus4(                   tex(u0    , v0 + i) , tex(u0 + 4, v0 + i));
 					tmp = plus4(tmp, mul4(4, plus4(tex(u0 + 1, v0 + i) , tex(u0 + 3, v0 + i))));
-					tmp = plus4(tmp, mul4(6,       tex(u0 + 2, v0 + 2)));
+					tmp = plus4(tmp, mul4(6,       tex(u0 + 2, v0 + i)));
 					buf[i] = tmp;
 				}
 
@@ -110,7 +110,7 @@ namespace cuv{
 					buf[i] = 
 						(    tex(u0    , v0 + i) + tex(u0 + 4, v0 + i)) + 
 						4 * (tex(u0 + 1, v0 + i) + tex(u0 + 3, v0 + i)) +
-						6 *  tex(u0 + 2, v0 + 2);
+						6 *  tex(u0 + 2, v0 + i);
 				}
 
 				downLevel[y * downLevelPitch + x] = (buf[0] + buf[4] + 4*(buf[1] + buf[3]) + 6 * buf[2]) * NORM_FACTOR;
@@ -141,7 +141,7 @@ namespace cuv{
 					buf[i] = 
 						(    tex(u0    , v0 + i) + tex(u0 + 4, v0 + i)) + 
 						4 * (tex(u0 + 1, v0 + i) + tex(u0 + 3, v0 + i)) +
-						6 *  tex(u0 + 2, v0 + 2);
+						6 *  tex(u0 + 2, v0 + i);
 				}
 
 				dst[y * dstPitch + x] = (buf[0] + buf[4] + 4*(buf[1] + buf[3]) + 6 * buf[2]) * NORM_FACTOR;
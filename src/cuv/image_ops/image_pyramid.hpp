@@ -38,11 +38,35 @@
 #ifndef __IMAGE_PYRAMID_HPP__
 #define __IMAGE_PYRAMID_HPP__
 
+#include <algorithm>
+#include <boost/static_assert.hpp>
+#include <boost/type_traits/is_same.hpp>
 #include <cuv/tensor_ops/tensor_ops.hpp>
 #include <cuv/basics/cuda_array.hpp>
 
 namespace cuv{
 
+	namespace detail{
+		/**
+		 * blur images with the 5x5 binomial filter and sample every step-th pixel.
+		 *
+		 * dst(y,x) = sum_{i,j} k[i] k[j] src(step*y-2+i, step*x-2+j) with
+		 * k = [1 4 6 4 1]/16, pixels outside of the image are clamped to the
+		 * border. The full-resolution blurred image is never stored.
+		 *
+		 * @param dst          n*out_channels planes of dst_h x dst_w pixels
+		 * @param src          n images of src_h x src_w pixels with channels interleaved values each
+		 * @param channels     number of interleaved channels in src
+		 * @param out_channels the first out_channels channels are written to dst (non-interleaved)
+		 * @param n            number of images
+		 * @param step         1 to blur only, 2 to sample down by a factor of 2
+		 */
+		template<class T>
+		void host_blur_decimate(T* dst, const T* src,
+				unsigned int src_h, unsigned int src_w, unsigned int dst_h, unsigned int dst_w,
+				unsigned int channels, unsigned int out_channels, unsigned int n, unsigned int step);
+	}
+
 	/**
 	 * @addtogroup image_ops Operations on Images
 	 * @{
@@ -50,6 +74,10 @@ namespace cuv{
 
 	/**
 	 * @brief image pyramid decreasing in size logarithmically.
+	 *
+	 * All levels are views on a single allocation. Pyramids of host matrices
+	 * are built on the host, level by level, with all channels of a level
+	 * processed in parallel.
 	 */
 	template <class __matrix_type>
 	class image_pyramid
@@ -69,6 +97,7 @@ namespace cuv{
 		 * @param dim   the pixel dimension (can be 1 or 3)
 		 */
 		image_pyramid( int img_h, int img_w, int depth, int dim );
+		~image_pyramid();
 		/**
 		 * Get a view on a channel in the pyramid.
 		 * @param depth    level of the pyramid
@@ -89,6 +118,23 @@ namespace cuv{
 		 */
 		template<class __arg_matrix_type>
 		void build(const __arg_matrix_type& src, const unsigned int interleaved_channels){
+			build(src, interleaved_channels, typename __arg_matrix_type::memory_space_type());
+		}
+	private:
+		/// build on the host
+		template<class __arg_matrix_type>
+		void build(const __arg_matrix_type& src, const unsigned int interleaved_channels, host_memory_space){
+			BOOST_STATIC_ASSERT((boost::is_same<typename matrix_type::memory_space_type, host_memory_space>::value));
+			build_host(src.ptr(), src.shape()[0], src.shape()[1], interleaved_channels);
+		}
+
+		/// build on the device using cuda_array
+		template<class __arg_matrix_type>
+		void build(const __arg_matrix_type& src, const unsigned int interleaved_channels, dev_memory_space){
+#ifdef CUV_NO_CUDA
+			// device memory is host memory
+			build_host(src.ptr(), src.shape()[0], src.shape()[1], interleaved_channels);
+#else
 			typedef typename __arg_matrix_type::value_type   argval_type;
 			typedef typename __arg_matrix_type::memory_space_type argmemspace_type;
 			typedef typename __arg_matrix_type::index_type   argindex_type;
@@ -101,7 +147,7 @@ namespace cuv{
 				&& src.shape()[1] == m_base_width
 			){
 				//std::cout << "Copycase"<<std::endl;
-					*m_matrices[0]=src;
+					m_matrices[0]->assign(src);
 			}
 			else if(   interleaved_channels == 4
 					&& m_dim                == 3
@@ -116,7 +162,7 @@ namespace cuv{
 			){
 				//std::cout << "Multichannel case"<<std::endl;
 				for(int i=0;i<m_dim;i++){
-					const __arg_matrix_type view(indices[index_range(0,src.shape()[0]/m_dim)][index_range(0,src.shape()[1])],(argval_type*)src.ptr());
+					const __arg_matrix_type view(indices[index_range(0,src.shape()[0]/m_dim)][index_range(0,src.shape()[1])],(argval_type*)src.ptr()+i*src.shape()[0]/m_dim*src.shape()[1]);
 					argca_type cpy(view);
 					matrix_type* dstview = get(0,i);
 					gaussian_pyramid_downsample(*dstview, cpy,1);
@@ -139,13 +185,54 @@ namespace cuv{
 					delete srcview;
 				}
 			}
+#endif
+		}
+
+		/**
+		 * build from a row-major host image of src_h rows and src_w elements.
+		 */
+		template<class argval_type>
+		void build_host(const argval_type* src, unsigned int src_h, unsigned int src_w, const unsigned int interleaved_channels){
+			BOOST_STATIC_ASSERT((boost::is_same<argval_type, value_type>::value));
+			value_type* base = m_matrices[0]->ptr();
+			if(    src_h == m_base_height*m_dim // the image dimensions match the input --> just copy.
+				&& src_w == m_base_width
+			){
+				std::copy(src, src + (size_t)src_h * src_w, base);
+			}
+			else if(   interleaved_channels == 4
+					&& m_dim                == 3
+			){
+				detail::host_blur_decimate(base, src, src_h, src_w/4, m_base_height, m_base_width, 4, 3, 1, 2);
+			}
+			else if(src_h > m_base_height*m_dim  // the image dimensions are too large: downsample to 1st level of pyramid
+				&&  src_w > m_base_width
+			){
+				detail::host_blur_decimate(base, src, src_h/m_dim, src_w, m_base_height, m_base_width, 1, 1, m_dim, 2);
+			}else{
+				cuvAssert(false);
+			}
 
+			// fill upper levels, all channels at once
+			for(unsigned int i=1;i<m_matrices.size();i++){
+				const matrix_type& s = *m_matrices[i-1];
+				matrix_type&       d = *m_matrices[i];
+				detail::host_blur_decimate(d.ptr(), s.ptr(),
+						s.shape()[0]/m_dim, s.shape()[1], d.shape()[0]/m_dim, d.shape()[1], 1, 1, m_dim, 2);
+			}
 		}
-	private:
-		std::vector<matrix_type*> m_matrices;
+
+		matrix_type m_storage;                ///< memory of all levels
+		std::vector<matrix_type*> m_matrices; ///< views on the levels in m_storage
 		unsigned int m_dim;
 		unsigned int m_base_width;
 		unsigned int m_base_height;
+
+		/// prohibit copying, the views in m_matrices are owned by the pyramid
+		image_pyramid(const image_pyramid&);
+
+		/// prohibit copying
+		image_pyramid& operator=(const image_pyramid&);
 	};
 	
 	template <class __matrix_type>
@@ -174,15 +261,29 @@ namespace cuv{
 	,m_base_width(img_w)
 	,m_dim(dim)
 	{
-        for(unsigned int i=0;i<m_matrices.size();i++)
-            delete m_matrices[i];
-		m_matrices.clear();
-		for(unsigned int i=0; i<depth;i++){
-			//std::cout << "Creating Pyramid Level: "<< img_h<<"*"<<m_dim<<"x"<<img_w<<std::endl;
-			m_matrices.push_back(new matrix_type(extents[img_h*m_dim][img_w]));
+		cuvAssert(depth > 0);
+		std::vector<unsigned int> heights, widths;
+		size_t size = 0;
+		for(int i=0; i<depth;i++){
+			heights.push_back(img_h);
+			widths.push_back(img_w);
+			size += (size_t)img_h*m_dim*img_w;
 			img_h=ceil(img_h/2.f);
 			img_w=ceil(img_w/2.f);
 		}
+		m_storage = matrix_type(extents[size]);
+		value_type* ptr = m_storage.ptr();
+		for(int i=0; i<depth;i++){
+			//std::cout << "Creating Pyramid Level: "<< heights[i]<<"*"<<m_dim<<"x"<<widths[i]<<std::endl;
+			m_matrices.push_back(new matrix_type(indices[index_range(0,heights[i]*m_dim)][index_range(0,widths[i])],ptr));
+			ptr += (size_t)heights[i]*m_dim*widths[i];
+		}
+	}
+
+	template <class __matrix_type>
+	image_pyramid<__matrix_type>::~image_pyramid(){
+		for(unsigned int i=0;i<m_matrices.size();i++)
+			delete m_matrices[i];
 	}
 
 /**
@@ -218,6 +319,56 @@ void gaussian(
 	const cuda_array<T,S,I>& src
 );
 
+/**
+ * @brief sample down a host image by a factor of 2
+ *
+ * The image is blurred with a 5x5 binomial filter and sampled in one pass.
+ *
+ * @param dst     target matrix; when interleaved_channels is 4,
+ *                this should be a matrix which is 3 times as high as src
+ *                and receives the R, G and B channels one below the other
+ * @param src     source matrix; when interleaved_channels is 4, rows contain RGBA values
+ * @param interleaved_channels can be 1 (grayscale) or 4 (RGBA)
+ */
+template<class T>
+void gaussian_pyramid_downsample(
+	tensor<T,host_memory_space,row_major>& dst,
+	const tensor<T,host_memory_space,row_major>& src,
+	const unsigned int interleaved_channels
+);
+
+/**
+ * @brief sample up a host image with bilinear interpolation
+ */
+template<class T>
+void gaussian_pyramid_upsample(
+	tensor<T,host_memory_space,row_major>& dst,
+	const tensor<T,host_memory_space,row_major>& src
+);
+
+/**
+ * @brief classify the pixels of a host image by the direction of least color change
+ *
+ * @param dst   RGBA image, 4 values per pixel
+ * @param src   smoothed image of 3 channels one below the other
+ * @param scale_fact size of dst relative to src
+ */
+template<class TDest, class T>
+void get_pixel_classes(
+	tensor<TDest,host_memory_space,row_major>& dst,
+	const tensor<T,host_memory_space,row_major>& src,
+	float scale_fact
+);
+
+/**
+ * @brief blur a host image with a 5x5 binomial filter
+ */
+template<class T>
+void gaussian(
+	tensor<T,host_memory_space,row_major>& dst,
+	const tensor<T,host_memory_space,row_major>& src
+);
+
 /** @} */ // end group image_ops
 
 }
@@ -0,0 +1,323 @@
+//*LB*
+// Copyright (c) 2010, University of Bonn, Institute for Computer Science VI
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+//  * Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//  * Neither the name of the University of Bonn 
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this software without specific prior written
+//    permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//*LE*
+
+
+
+
+/** 
+ * @file image_pyramid_host.cpp
+ * @brief host implementations of the image pyramid operations
+ * @ingroup image_ops
+ */
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <cuv/tools/cuv_general.hpp>
+#include <cuv/tools/thread_pool.hpp>
+#include <cuv/image_ops/image_pyramid.hpp>
+
+namespace cuv{
+
+	namespace{
+		/// binomial filter, applied along rows and columns
+		const float PYR_KERNEL[5] = { 1.f, 4.f, 6.f, 4.f, 1.f };
+
+		/// normalization of the 5x5 filter, 1/(16^2)
+		const float PYR_NORM_FACTOR = 0.00390625f;
+
+		/// i clamped to [0,n)
+		inline int clamp_index(int i, int n){
+			return i < 0 ? 0 : (i >= n ? n - 1 : i);
+		}
+
+		/**
+		 * blurs and samples rows of the output planes, used by parallel_tasks.
+		 * Task r is row r % dst_h of image r / dst_h.
+		 */
+		template<class T>
+		struct blur_decimate_rows{
+			T* dst;
+			const T* src;
+			unsigned int src_h, src_w, dst_h, dst_w, channels, out_channels, step;
+
+			void operator()(size_t begin, size_t end)const{
+				const unsigned int c   = channels;
+				const unsigned int row = src_w * c;
+				// columns -2 .. max(src_w, step*(dst_w-1)+3)+1 of a row after the vertical pass,
+				// clamped to the border
+				const unsigned int span = std::max(src_w, step * (dst_w - 1) + 3) + 2;
+				std::vector<float> line((span + 2) * c);
+				float* center = &line[2 * c];
+
+				for(size_t r = begin; r < end; r++){
+					const unsigned int img = r / dst_h;
+					const unsigned int y   = r % dst_h;
+					const T* s = src + (size_t)img * src_h * row;
+
+					// vertical pass over all pixels and channels of the row
+					const T* rows[5];
+					for(int i = 0; i < 5; i++)
+						rows[i] = s + (size_t)clamp_index((int)(step * y) - 2 + i, src_h) * row;
+					for(unsigned int k = 0; k < row; k++)
+						center[k] = PYR_KERNEL[0] * rows[0][k];
+					for(int i = 1; i < 5; i++){
+						const float ki = PYR_KERNEL[i];
+						const T* l = rows[i];
+						for(unsigned int k = 0; k < row; k++)
+							center[k] += ki * l[k];
+					}
+					for(unsigned int k = 0; k < 2 * c; k++)
+						line[k] = center[k % c];
+					for(unsigned int k = row; k < span * c; k++)
+						center[k] = center[row - c + k % c];
+
+					// horizontal pass at every step-th pixel
+					for(unsigned int ch = 0; ch < out_channels; ch++){
+						T* d = dst + ((size_t)(img * out_channels + ch) * dst_h + y) * dst_w;
+						const float* l = &line[ch];
+						for(unsigned int x = 0; x < dst_w; x++){
+							const float* p = l + step * x * c;
+							d[x] = (T)(PYR_NORM_FACTOR * (
+									PYR_KERNEL[0] * p[0]     + PYR_KERNEL[1] * p[c] +
+									PYR_KERNEL[2] * p[2 * c] + PYR_KERNEL[3] * p[3 * c] +
+									PYR_KERNEL[4] * p[4 * c]));
+						}
+					}
+				}
+			}
+		};
+
+		/**
+		 * value of src at (u,v) in texture coordinates with bilinear
+		 * interpolation, as a CUDA texture with linear filtering and clamped
+		 * addressing: pixel (x,y) covers [x,x+1) x [y,y+1).
+		 */
+		template<class T>
+		float bilinear(const T* src, unsigned int h, unsigned int w, float u, float v){
+			u -= 0.5f;
+			v -= 0.5f;
+			const float fu = floorf(u), fv = floorf(v);
+			const float a  = u - fu,    b  = v - fv;
+			const int x0 = clamp_index((int)fu, w), x1 = clamp_index((int)fu + 1, w);
+			const int y0 = clamp_index((int)fv, h), y1 = clamp_index((int)fv + 1, h);
+			const T* r0 = src + (size_t)y0 * w;
+			const T* r1 = src + (size_t)y1 * w;
+			return (1.f - b) * ((1.f - a) * r0[x0] + a * r0[x1])
+				+        b  * ((1.f - a) * r1[x0] + a * r1[x1]);
+		}
+
+		/// bilinear upsampling of rows, used by parallel_tasks
+		template<class T>
+		struct upsample_rows{
+			T* dst;
+			const T* src;
+			unsigned int src_h, src_w, dst_w;
+
+			void operator()(size_t begin, size_t end)const{
+				for(size_t y = begin; y < end; y++){
+					T* d = dst + y * dst_w;
+					for(unsigned int x = 0; x < dst_w; x++)
+						d[x] = (T) bilinear(src, src_h, src_w, x / 2.f, y / 2.f);
+				}
+			}
+		};
+
+		/// squared color distance of two positions, summed over three channels at the given offset
+		template<class T>
+		float colordist(const T* src, unsigned int h, unsigned int w, float u0, float v0, float u1, float v1, float offset){
+			float d0 = 0.f;
+			for(unsigned int i = 0; i < 3; i++){
+				const float f = bilinear(src, h, w, u0, v0) - bilinear(src, h, w, u1, v1);
+				d0 += f * f;
+				v0 += offset;
+				v1 += offset;
+			}
+			return d0;
+		}
+
+		/// pixel classes of rows, used by parallel_tasks
+		template<class TDest, class T>
+		struct pixel_class_rows{
+			TDest* dst;
+			const T* src;
+			unsigned int src_h, src_w, dst_w; ///< dst_w is the number of RGBA pixels in a row
+			float offset, scale_fact;
+
+			void operator()(size_t begin, size_t end)const{
+				const float N = 1.f;
+				for(size_t y = begin; y < end; y++){
+					TDest* d = dst + y * dst_w * 4;
+					for(unsigned int x = 0; x < dst_w; x++){
+						const float u0 = x / scale_fact;
+						const float v0 = y / scale_fact;
+						const float du[4] = { N,  N, -N, -N };
+						const float dv[4] = { N, -N,  N, -N };
+						unsigned char arg_min_cd = 0;
+						float min_cd = 0.f, sum = 0.f;
+						for(unsigned char i = 0; i < 4; i++){
+							const float val = colordist(src, src_h, src_w, u0, v0, u0 + du[i], v0 + dv[i], offset);
+							if(i == 0 || val < min_cd){
+								min_cd = val;
+								arg_min_cd = i;
+							}
+							sum += val;
+						}
+						d[4 * x + 0] = (TDest)(arg_min_cd % 2 ? 255 : 0);
+						d[4 * x + 1] = (TDest)(arg_min_cd > 1 ? 255 : 0);
+						d[4 * x + 2] = (TDest)0;
+						d[4 * x + 3] = (TDest)(unsigned char)std::max(0.f, std::min(255.f, sum - 4 * min_cd));
+					}
+				}
+			}
+		};
+
+		/// run f on n rows of a total of work elements, in parallel if worthwhile
+		template<class F>
+		void run_rows(F& f, size_t n, size_t work){
+			if(work < get_host_parallel_threshold())
+				f(0, n);
+			else
+				parallel_tasks(n, f);
+		}
+	}
+
+	namespace detail{
+		template<class T>
+		void host_blur_decimate(T* dst, const T* src,
+				unsigned int src_h, unsigned int src_w, unsigned int dst_h, unsigned int dst_w,
+				unsigned int channels, unsigned int out_channels, unsigned int n, unsigned int step){
+			cuvAssert(out_channels <= channels);
+			cuvAssert(step == 1 || step == 2);
+			if(n == 0 || dst_h == 0 || dst_w == 0)
+				return;
+			cuvAssert(src_h > 0 && src_w > 0);
+			blur_decimate_rows<T> rows = { dst, src, src_h, src_w, dst_h, dst_w, channels, out_channels, step };
+			run_rows(rows, (size_t)n * dst_h, (size_t)n * dst_h * src_w * channels * 5);
+		}
+	}
+
+	template<class V>
+		void gaussian(
+				tensor<V,host_memory_space,row_major>& dst,
+				const tensor<V,host_memory_space,row_major>& src){
+			cuvAssert(dst.ndim()==2);
+			cuvAssert(src.ndim()==2);
+			cuvAssert(dst.shape()[1] == src.shape()[1]);
+			cuvAssert(dst.shape()[0] == src.shape()[0]);
+			cuvAssert(dst.is_c_contiguous() && src.is_c_contiguous());
+			cuvAssert(dst.ptr() != src.ptr());
+			detail::host_blur_decimate(dst.ptr(), src.ptr(), src.shape()[0], src.shape()[1],
+					dst.shape()[0], dst.shape()[1], 1, 1, 1, 1);
+		}
+
+	template<class V>
+		void gaussian_pyramid_downsample(
+				tensor<V,host_memory_space,row_major>& dst,
+				const tensor<V,host_memory_space,row_major>& src,
+				const unsigned int interleaved_channels){
+			cuvAssert(dst.ndim()==2);
+			cuvAssert(src.ndim()==2);
+			cuvAssert(dst.is_c_contiguous() && src.is_c_contiguous());
+			switch(interleaved_channels){
+				case 1: // deals with a single channel
+					cuvAssert(dst.shape()[1] < src.shape()[1]);
+					cuvAssert(dst.shape()[0] < src.shape()[0]);
+					detail::host_blur_decimate(dst.ptr(), src.ptr(), src.shape()[0], src.shape()[1],
+							dst.shape()[0], dst.shape()[1], 1, 1, 1, 2);
+					break;
+				case 4: // deals with 4 interleaved channels (and writes to 3(!))
+					cuvAssert(src.shape()[1] % 4 == 0);
+					cuvAssert(dst.shape()[1]   < src.shape()[1] / 4);
+					cuvAssert(dst.shape()[0] / 3 < src.shape()[0]);
+					cuvAssert(dst.shape()[0] % 3 == 0); // three channels in destination (non-interleaved)
+					detail::host_blur_decimate(dst.ptr(), src.ptr(), src.shape()[0], src.shape()[1] / 4,
+							dst.shape()[0] / 3, dst.shape()[1], 4, 3, 1, 2);
+					break;
+				default:
+					cuvAssert(false);
+			}
+		}
+
+	template<class V>
+		void gaussian_pyramid_upsample(
+				tensor<V,host_memory_space,row_major>& dst,
+				const tensor<V,host_memory_space,row_major>& src){
+			cuvAssert(dst.ndim()==2);
+			cuvAssert(src.ndim()==2);
+			cuvAssert(dst.shape()[1] > src.shape()[1]);
+			cuvAssert(dst.shape()[0] > src.shape()[0]);
+			cuvAssert(dst.is_c_contiguous() && src.is_c_contiguous());
+			upsample_rows<V> rows = { dst.ptr(), src.ptr(), src.shape()[0], src.shape()[1], dst.shape()[1] };
+			run_rows(rows, dst.shape()[0], dst.size() * 4);
+		}
+
+	template<class VDest, class V>
+		void get_pixel_classes(
+			tensor<VDest,host_memory_space,row_major>& dst,
+			const tensor<V,host_memory_space,row_major>& src_smooth,
+			float scale_fact
+		){
+			cuvAssert(dst.ndim()==2);
+			cuvAssert(src_smooth.ndim()==2);
+			cuvAssert(dst.is_c_contiguous() && src_smooth.is_c_contiguous());
+			cuvAssert(src_smooth.shape()[0] % 3 == 0);
+			cuvAssert(dst.shape()[1] % 4 == 0); // RGBA
+			// as on the device, the channels are not offset against each other
+			const float offset = 0.f;
+			pixel_class_rows<VDest,V> rows = { dst.ptr(), src_smooth.ptr(), src_smooth.shape()[0], src_smooth.shape()[1],
+				dst.shape()[1] / 4, offset, scale_fact };
+			run_rows(rows, dst.shape()[0], dst.size() * 24);
+		}
+
+	// explicit instantiation
+#define INSTANTIATE_HOST_PYRAMID(V) \
+	template void detail::host_blur_decimate(V*, const V*, unsigned int, unsigned int, unsigned int, unsigned int, \
+			unsigned int, unsigned int, unsigned int, unsigned int); \
+	template void gaussian(tensor<V,host_memory_space,row_major>&, const tensor<V,host_memory_space,row_major>&); \
+	template void gaussian_pyramid_downsample(tensor<V,host_memory_space,row_major>&, \
+			const tensor<V,host_memory_space,row_major>&, const unsigned int); \
+	template void gaussian_pyramid_upsample(tensor<V,host_memory_space,row_major>&, \
+			const tensor<V,host_memory_space,row_major>&);
+
+	INSTANTIATE_HOST_PYRAMID(float)
+	INSTANTIATE_HOST_PYRAMID(unsigned char)
+
+	template void get_pixel_classes(
+			tensor<unsigned char,host_memory_space,row_major>& dst,
+			const tensor<unsigned char,host_memory_space,row_major>& src,
+			float scale_fact);
+	template void get_pixel_classes(
+			tensor<float,host_memory_space,row_major>& dst,
+			const tensor<float,host_memory_space,row_major>& src,
+			float scale_fact);
+	template void get_pixel_classes(
+			tensor<unsigned char,host_memory_space,row_major>& dst,
+			const tensor<float,host_memory_space,row_major>& src,
+			float scale_fact);
+}
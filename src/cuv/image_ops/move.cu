@@ -32,8 +32,11 @@
 
 
 #include <iostream>
+#include <vector>
+#ifndef CUV_NO_CUDA
 #include <cuda.h>
 #include <cuv/tools/texture.h>
+#endif
 #include <stdexcept>
 #include <cuv/tools/cuv_general.hpp>
 
@@ -42,6 +45,8 @@
 #include <cuv/image_ops/move.hpp>
 using namespace std;
 
+#ifndef CUV_NO_CUDA
+
 
 /** 
  * @brief convert four rgb pixels to gray simultaenously
@@ -286,12 +291,45 @@ move_image_kernel(dst_pixel* dst, const pixel* src, char xshift, char yshift, un
 			,    dst +    wholeimgsize*patidx + 2*iw*iw, iw*mapy + mapx, ipx);
 }
 
+#endif /* CUV_NO_CUDA */
 
 #define V(X) #X << "=" <<(X) << ", "
 namespace cuv
 {
 	namespace image_move_impl
 	{
+		template<class __value_typeA, class __value_typeB>
+		void image_move(tensor<__value_typeA,host_memory_space,column_major>& dst, const tensor<__value_typeB,host_memory_space,column_major>& src, 
+			const unsigned int& src_image_size, 
+			const unsigned int& dst_image_size,
+			const unsigned int& src_num_maps,
+			const char& xshift, 
+			const char& yshift){
+
+			const unsigned char dst_num_maps = src_num_maps == 4 ? 3 : 1;
+
+			cuvAssert(src.shape()[1] == dst.shape()[1]);
+			cuvAssert(src.shape()[0] % (src_image_size*src_image_size*src_num_maps) == 0);
+			cuvAssert(dst.shape()[0] % (dst_image_size*dst_image_size*dst_num_maps) == 0);
+			cuvAssert(dst.is_c_contiguous() && src.is_c_contiguous());
+
+			const std::vector<int> xs(src.shape()[1], xshift), ys(src.shape()[1], yshift);
+			detail::host_image_move(dst.ptr(), src.ptr(), src.shape()[1], dst.shape()[0], src.shape()[0],
+					src_image_size, dst_image_size, src_num_maps,
+					xs.empty() ? NULL : &xs[0], ys.empty() ? NULL : &ys[0]);
+		}
+#ifdef CUV_NO_CUDA
+		template<class __value_typeA, class __value_typeB>
+		void image_move(tensor<__value_typeA,dev_memory_space,column_major>& dst, const tensor<__value_typeB,dev_memory_space,column_major>& src, 
+			const unsigned int& src_image_size, 
+			const unsigned int& dst_image_size,
+			const unsigned int& src_num_maps,
+			const char& xshift, 
+			const char& yshift){
+			tensor<__value_typeA,host_memory_space,column_major> hdst = detail::host_alias(dst);
+			image_move(hdst, detail::host_alias(src), src_image_size, dst_image_size, src_num_maps, xshift, yshift);
+		}
+#else
 		template<class __value_typeA, class __value_typeB>
 		void image_move(tensor<__value_typeA,dev_memory_space,column_major>& dst, const tensor<__value_typeB,dev_memory_space,column_major>& src, 
 			const unsigned int& src_image_size, 
@@ -334,10 +372,7 @@ namespace cuv
 			}
 			cuvSafeCall(cudaThreadSynchronize());
 		}
-		template<class __value_typeA, class __value_typeB>
-		void image_move(tensor<__value_typeA,host_memory_space,column_major>& dst, const tensor<__value_typeB,host_memory_space,column_major>& src, const unsigned int& image_width, const unsigned int& image_height, const unsigned int& num_maps, const char& xshift, const char& yshift){
-			throw std::runtime_error("not implemented");
-		}
+#endif /* CUV_NO_CUDA */
 		
 	};
 	template<class __value_typeA, class __value_typeB, class __memory_space_type, class __memory_layout_type>
@@ -69,6 +69,42 @@ namespace cuv
 	template<class __value_typeA, class __value_typeB, class __memory_space_type, class __memory_layout_type>
 	void image_move(tensor<__value_typeA,__memory_space_type,__memory_layout_type>& dst, const tensor<__value_typeB,__memory_space_type,__memory_layout_type>& src, const unsigned int& image_width, const unsigned int& image_height, const unsigned int& num_maps, const int& xshift, const int& yshift);
 
+	/** 
+	 * @brief Shift every image by its own amount (host only)
+	 *
+	 * Like image_move, but image i is shifted by xshift[i] and yshift[i].
+	 * 
+	 * @param dst where the moved images are written
+	 * @param src unsigned char where original images are taken from
+	 * @param src_image_size  width and height of image in source
+	 * @param dst_image_size  width and height of image in destination
+	 * @param src_num_maps  how many maps there are in src
+	 * @param xshift how much to shift right, one entry per image (column of src)
+	 * @param yshift how much to shift down, one entry per image (column of src)
+	 */
+	template<class __value_typeA, class __value_typeB>
+	void image_move(tensor<__value_typeA,host_memory_space,column_major>& dst, const tensor<__value_typeB,host_memory_space,column_major>& src, const unsigned int& src_image_size, const unsigned int& dst_image_size, const unsigned int& src_num_maps, const tensor<int,host_memory_space>& xshift, const tensor<int,host_memory_space>& yshift);
+
+	namespace detail{
+		/**
+		 * moves n images of src_image_size x src_image_size pixels on the host.
+		 *
+		 * Image i is column i of src and dst, shifted by xshift[i] and
+		 * yshift[i] and scaled to dst_image_size x dst_image_size pixels
+		 * with bilinear interpolation. RGBA images (num_maps=4) are written
+		 * as three decorrelated color maps, grayscale images (num_maps=1) as
+		 * one map.
+		 *
+		 * @param dst_stride distance of the images in dst (in elements)
+		 * @param src_stride distance of the images in src (in bytes)
+		 */
+		template<class T>
+		void host_image_move(T* dst, const unsigned char* src, unsigned int n,
+				unsigned int dst_stride, unsigned int src_stride,
+				unsigned int src_image_size, unsigned int dst_image_size, unsigned int num_maps,
+				const int* xshift, const int* yshift);
+	}
+
 	/** @} */
 };
 
@@ -0,0 +1,225 @@
+//*LB*
+// Copyright (c) 2010, University of Bonn, Institute for Computer Science VI
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+//  * Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//  * Neither the name of the University of Bonn 
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this software without specific prior written
+//    permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//*LE*
+
+
+
+
+/** 
+ * @file move_host.cpp
+ * @brief host implementation of image_move
+ * @ingroup image_ops
+ */
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+#include <vector>
+#include <cuv/tools/cuv_general.hpp>
+#include <cuv/tools/thread_pool.hpp>
+#include <cuv/image_ops/move.hpp>
+
+namespace cuv{
+
+	namespace{
+		/**
+		 * moves rows of the output images, used by parallel_tasks.
+		 * Task t is row t % dst_size of image t / dst_size.
+		 *
+		 * A row is done in two passes: the color values of all its pixels
+		 * are determined first, then they are converted to the output maps.
+		 */
+		template<class T>
+		struct move_rows{
+			T* dst;
+			const unsigned char* src;
+			unsigned int dst_stride, src_stride;
+			int src_size, dst_size;
+			unsigned int num_maps;
+			const int* xshift;
+			const int* yshift;
+
+			/// color channel ch of pixel (x,y) of img
+			inline float pixel(const unsigned char* img, int x, int y, unsigned int ch)const{
+				return img[(y * src_size + x) * num_maps + ch];
+			}
+
+			/**
+			 * the color of a pixel at (px,py), which is not in the source image:
+			 * the closest pixel of the image (not at its border), faded to
+			 * the color of the first pixel with the distance to it.
+			 */
+			inline unsigned char outside_color(const unsigned char* img, int px, int py, unsigned int ch)const{
+				const int xn = std::max(1, std::min(px, src_size - 2));
+				const int yn = std::max(1, std::min(py, src_size - 2));
+				const float d = std::min(1.f, std::max(0.f, 0.13f * (float)(std::abs(px - xn) + std::abs(py - yn))));
+				return (unsigned char)(d * img[ch] + (1.f - d) * pixel(img, xn, yn, ch));
+			}
+
+			void operator()(size_t begin, size_t end)const{
+				const unsigned int channels = num_maps == 4 ? 3 : 1;
+				const bool enlarge = dst_size != src_size;
+				std::vector<float> color(channels * dst_size);
+				std::vector<int>   px(dst_size);
+				std::vector<float> fx(dst_size);
+
+				for(size_t t = begin; t < end; t++){
+					const unsigned int i = t / dst_size;
+					const int y  = t % dst_size;
+					const int xs = xshift[i], ys = yshift[i];
+					const unsigned char* img = src + (size_t)i * src_stride;
+
+					// position of the row in the source image and the pixels which are inside
+					int py, x0, x1;
+					float fy = 0.f;
+					bool in_y;
+					if(enlarge){
+						const float pyf = ((float)(y - ys) / dst_size) * src_size;
+						py = (int)pyf;
+						fy = pyf - py;
+						in_y = y >= ys && y < dst_size + ys;
+						x0 = std::max(0, xs);
+						x1 = std::min(dst_size, dst_size + xs);
+					}else{
+						py = y - ys;
+						in_y = py >= 0 && py < src_size;
+						x0 = std::max(0, xs);
+						x1 = std::min(dst_size, src_size + xs);
+					}
+					if(!in_y || x1 < x0)
+						x1 = x0;
+					for(int x = 0; x < dst_size; x++){
+						if(enlarge){
+							const float pxf = ((float)(x - xs) / dst_size) * src_size;
+							px[x] = (int)pxf;
+							fx[x] = pxf - px[x];
+						}else{
+							px[x] = x - xs;
+						}
+					}
+
+					for(unsigned int ch = 0; ch < channels; ch++){
+						float* c = &color[ch * dst_size];
+						// pixels outside of the source image
+						for(int x = 0; x < dst_size; x++){
+							if(x == x0)
+								x = x1;
+							if(x >= dst_size)
+								break;
+							const float v = outside_color(img, px[x], py, ch);
+							c[x] = enlarge
+								? (float)(unsigned char)((1.f - fy) * ((1.f - fx[x]) * v + fx[x] * v) + fy * ((1.f - fx[x]) * v + fx[x] * v))
+								: v;
+						}
+						// pixels inside of the source image
+						if(enlarge){
+							const unsigned char* r0 = img + (size_t)py * src_size * num_maps + ch;
+							const unsigned char* r1 = img + (size_t)std::min(py + 1, src_size - 1) * src_size * num_maps + ch;
+							for(int x = x0; x < x1; x++){
+								const int a = px[x] * num_maps;
+								const int b = std::min(px[x] + 1, src_size - 1) * num_maps;
+								const float f = fx[x];
+								c[x] = (float)(unsigned char)((1.f - fy) * ((1.f - f) * r0[a] + f * r0[b]) + fy * ((1.f - f) * r1[a] + f * r1[b]));
+							}
+						}else{
+							const unsigned char* r0 = img + (size_t)py * src_size * num_maps + ch;
+							for(int x = x0; x < x1; x++)
+								c[x] = r0[(x - xs) * num_maps];
+						}
+					}
+
+					T* d = dst + (size_t)i * dst_stride + (size_t)y * dst_size;
+					if(channels == 1){
+						const float* g = &color[0];
+						for(int x = 0; x < dst_size; x++)
+							d[x] = (T)g[x];
+					}else{
+						// decorrelated color maps
+						const size_t mapsize = (size_t)dst_size * dst_size;
+						T* d1 = d;
+						T* d2 = d + mapsize;
+						T* d3 = d + 2 * mapsize;
+						const float* r = &color[0];
+						const float* g = &color[dst_size];
+						const float* b = &color[2 * dst_size];
+						for(int x = 0; x < dst_size; x++){
+							d1[x] = (T)((-0.5525f*r[x] - 0.5719f*g[x] - 0.6063f*b[x] + 441.3285f) * 0.004531772f - 1.0f);
+							d2[x] = (T)(( 0.7152f*r[x] + 0.0483f*g[x] - 0.6973f*b[x] + 177.8115f) * 0.005369070f - 1.0f);
+							d3[x] = (T)((-0.4281f*r[x] + 0.8189f*g[x] - 0.3823f*b[x] + 206.6520f) * 0.004813808f - 1.0f);
+						}
+					}
+				}
+			}
+		};
+	}
+
+	namespace detail{
+		template<class T>
+		void host_image_move(T* dst, const unsigned char* src, unsigned int n,
+				unsigned int dst_stride, unsigned int src_stride,
+				unsigned int src_image_size, unsigned int dst_image_size, unsigned int num_maps,
+				const int* xshift, const int* yshift){
+			if(num_maps != 4 && num_maps != 1)
+				throw std::runtime_error("wrong image format: Need RGBA interleaved _or_ grayscale");
+			cuvAssert(src_image_size >= 2);
+			if(n == 0 || dst_image_size == 0)
+				return;
+			move_rows<T> rows = { dst, src, dst_stride, src_stride, (int)src_image_size, (int)dst_image_size,
+				num_maps, xshift, yshift };
+			const size_t n_rows = (size_t)n * dst_image_size;
+			if(n_rows * dst_image_size * num_maps < get_host_parallel_threshold())
+				rows(0, n_rows);
+			else
+				parallel_tasks(n_rows, rows);
+		}
+	}
+
+	template<class __value_typeA, class __value_typeB>
+	void image_move(tensor<__value_typeA,host_memory_space,column_major>& dst, const tensor<__value_typeB,host_memory_space,column_major>& src, const unsigned int& src_image_size, const unsigned int& dst_image_size, const unsigned int& src_num_maps, const tensor<int,host_memory_space>& xshift, const tensor<int,host_memory_space>& yshift){
+		cuvAssert(dst.ndim()==2);
+		cuvAssert(src.ndim()==2);
+		const unsigned int dst_num_maps = src_num_maps == 4 ? 3 : 1;
+		cuvAssert(src.shape(1) == dst.shape(1));
+		cuvAssert(src.shape(0) % (src_image_size*src_image_size*src_num_maps) == 0);
+		cuvAssert(dst.shape(0) % (dst_image_size*dst_image_size*dst_num_maps) == 0);
+		cuvAssert(xshift.size() == src.shape(1));
+		cuvAssert(yshift.size() == src.shape(1));
+		cuvAssert(dst.is_c_contiguous() && src.is_c_contiguous());
+		cuvAssert(xshift.is_c_contiguous() && yshift.is_c_contiguous());
+		detail::host_image_move(dst.ptr(), src.ptr(), src.shape(1), dst.shape(0), src.shape(0),
+				src_image_size, dst_image_size, src_num_maps, xshift.ptr(), yshift.ptr());
+	}
+
+#define INST(A,B) \
+	template      \
+	void detail::host_image_move(A*, const B*, unsigned int, unsigned int, unsigned int, unsigned int, unsigned int, unsigned int, const int*, const int*); \
+	template      \
+	void image_move(tensor<A,host_memory_space,column_major>&,const tensor<B,host_memory_space,column_major>&, const unsigned int&, const unsigned int&, const unsigned int&, const tensor<int,host_memory_space>&, const tensor<int,host_memory_space>&); \
+
+	INST(float,unsigned char);
+	INST(unsigned char,unsigned char);
+}
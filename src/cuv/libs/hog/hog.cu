@@ -32,6 +32,9 @@
 #include <cuv/libs/separable_conv/separable_convolution.hpp>
 #include <cuv/libs/nlmeans/conv3d.hpp>
 #include "hog.hpp"
+#include "hog_host.hpp"
+
+#ifndef CUV_NO_CUDA
 
 template<class V, class I>
 __global__
@@ -84,12 +87,14 @@ void orientation_binning_kernel(V*dst, const V* norms, const V* angles, const un
 	// this slightly suboptimal operation saves lots of juggling with shared memory.
 	dst[0*w*h + id] += lowerbinval;
 }
+#endif /* CUV_NO_CUDA */
 
 
 
 namespace cuv{ namespace libs{ namespace hog{
 
 	namespace detail{
+#ifndef CUV_NO_CUDA
 		inline unsigned int __host__ __device__ divup(unsigned int a, unsigned int b)
 		{
 			if (a % b)  /* does a divide b leaving a remainder? */
@@ -240,11 +245,18 @@ namespace cuv{ namespace libs{ namespace hog{
 				apply_scalar_functor(norms,SF_SQRT);
 				matrix_divide_row(bins,norms);
 
-				bins.reshape(extents[steps][width][height]);
+				bins.reshape(extents[steps][height][width]);
+			}
+#else
+		template<class V>
+			void hog(cuv::tensor<V, dev_memory_space>& bins, const cuv::tensor<V,dev_memory_space>& src, unsigned int spatialpool){
+				// device memory is host memory
+				host_hog(bins.ptr(), src.ptr(), src.shape(0), src.shape(1), src.shape(2), bins.shape(0), spatialpool);
 			}
+#endif /* CUV_NO_CUDA */
 		template<class V>
-			void hog(cuv::tensor<V, host_memory_space>& dst, const cuv::tensor<V,host_memory_space>& src, unsigned int spatialpool){
-				throw std::runtime_error("not implemented");
+			void hog(cuv::tensor<V, host_memory_space>& bins, const cuv::tensor<V,host_memory_space>& src, unsigned int spatialpool){
+				host_hog(bins.ptr(), src.ptr(), src.shape(0), src.shape(1), src.shape(2), bins.shape(0), spatialpool);
 			}
 	}
 	template<class V, class M>
@@ -255,6 +267,8 @@ namespace cuv{ namespace libs{ namespace hog{
 		cuvAssert(src.shape()[0]==3);
 		cuvAssert(src.shape()[1]==dst.shape()[1]);
 		cuvAssert(src.shape()[2]==dst.shape()[2]);
+		cuvAssert(src.is_c_contiguous());
+		cuvAssert(dst.is_c_contiguous());
 
 		detail::hog(dst,src, spatialpool);
 	}
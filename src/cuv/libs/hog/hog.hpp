@@ -45,6 +45,12 @@ namespace cuv{ namespace libs{
 
 	/**
 	 * calculate hog descriptor of src
+	 *
+	 * Gradients of the color channel with the largest magnitude are binned
+	 * by orientation, pooled with a gaussian and normalized per pixel (L2,
+	 * clipped at 0.2, L2 again). On the host, all steps are fused and run
+	 * on tiles of the image in parallel.
+	 *
 	 * @param dst   bins x h x w descriptors
 	 * @param src   chan x h x w image
 	 * @param spatialpool kernel radius for spatial pooling
@@ -0,0 +1,249 @@
+//*LB*
+// Copyright (c) 2010, University of Bonn, Institute for Computer Science VI
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+//  * Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//  * Neither the name of the University of Bonn 
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this software without specific prior written
+//    permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//*LE*
+
+
+
+
+/**
+ * @file hog_host.cpp
+ * @brief host implementation of the HOG descriptor
+ * @ingroup hog
+ */
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <cuv/tools/cuv_general.hpp>
+#include <cuv/tools/thread_pool.hpp>
+#include <cuv/libs/hog/hog_host.hpp>
+
+namespace cuv{ namespace libs{ namespace hog{ namespace detail{
+
+namespace{
+	/// number of rows of a tile
+	const unsigned int HOG_HOST_TILE_H = 32;
+
+	/// number of columns of a tile, the histograms of a tile and its border stay in L2 cache
+	const unsigned int HOG_HOST_TILE_W = 128;
+
+	/// added to the squared norm of a descriptor before normalization
+	const float HOG_NORM_EPS = 0.0001f;
+
+	/// normalized descriptor entries are clipped to this value and normalized again
+	const float HOG_CLIP = 0.2f;
+
+	/**
+	 * x[s*n+i] /= sqrt(sum_s x[s*n+i]^2 + HOG_NORM_EPS) for i in [0,n)
+	 */
+	void normalize_columns(float* x, float* norm, unsigned int steps, unsigned int n){
+		std::fill(norm, norm + n, HOG_NORM_EPS);
+		for(unsigned int s = 0; s < steps; s++){
+			const float* xs = x + s * n;
+			for(unsigned int i = 0; i < n; i++)
+				norm[i] += xs[i] * xs[i];
+		}
+		for(unsigned int i = 0; i < n; i++)
+			norm[i] = 1.f / sqrtf(norm[i]);
+		for(unsigned int s = 0; s < steps; s++){
+			float* xs = x + s * n;
+			for(unsigned int i = 0; i < n; i++)
+				xs[i] *= norm[i];
+		}
+	}
+
+	/**
+	 * determines the descriptors of tiles of HOG_HOST_TILE_H x HOG_HOST_TILE_W
+	 * pixels, used by parallel_tasks. Task t is tile t % n_tx of tile row t / n_tx.
+	 */
+	struct hog_tasks{
+		float* dst;
+		const float* src;
+		unsigned int channels, h, w, steps;
+		const float* kernel;  ///< 2r+1 coefficients of the pooling filter
+		unsigned int r;       ///< radius of the pooling filter
+		unsigned int n_tx, n_ty; ///< number of tiles along x and y
+
+		hog_tasks(float* _dst, const float* _src, unsigned int c, unsigned int _h, unsigned int _w,
+				unsigned int _steps, const float* k, unsigned int _r)
+			:dst(_dst), src(_src), channels(c), h(_h), w(_w), steps(_steps), kernel(k), r(_r)
+		{
+			n_tx = (w + HOG_HOST_TILE_W - 1) / HOG_HOST_TILE_W;
+			n_ty = (h + HOG_HOST_TILE_H - 1) / HOG_HOST_TILE_H;
+		}
+
+		size_t n_tasks()const{ return (size_t)n_tx * n_ty; }
+
+		/**
+		 * gradient of the channel with the largest gradient magnitude for
+		 * the pixels [x0,x0+n) of row y.
+		 *
+		 * Gradients are centered derivatives, pixels outside of the image
+		 * are zero. The orientation is in [0,pi), disregarding polarity.
+		 */
+		void gradients(float* mag, float* ang, float* gx, float* gy, unsigned int y, unsigned int x0, unsigned int n,
+				const float* zeros)const{
+			for(unsigned int c = 0; c < channels; c++){
+				const float* row  = src + ((size_t)c * h + y) * w;
+				const float* up   = y > 0     ? row - w : zeros;
+				const float* down = y + 1 < h ? row + w : zeros;
+				for(unsigned int i = 0; i < n; i++){
+					const unsigned int x = x0 + i;
+					const float left  = x > 0     ? row[x - 1] : 0.f;
+					const float right = x + 1 < w ? row[x + 1] : 0.f;
+					const float dx = 0.5f * (right - left);
+					const float dy = 0.5f * (down[x] - up[x]);
+					const float m  = dx * dx + dy * dy;
+					if(c == 0 || m > mag[i]){
+						mag[i] = m;
+						gx[i]  = dx;
+						gy[i]  = dy;
+					}
+				}
+			}
+			for(unsigned int i = 0; i < n; i++){
+				float phi = atan2f(gy[i], gx[i]);
+				if(phi < 0)
+					phi += (float)M_PI;
+				ang[i] = phi;
+				mag[i] = sqrtf(mag[i]);
+			}
+		}
+
+		void operator()(size_t begin, size_t end)const{
+			const unsigned int ew = HOG_HOST_TILE_W + 2 * r;
+			const unsigned int eh = HOG_HOST_TILE_H + 2 * r;
+			std::vector<float> hist((size_t)steps * eh * ew);
+			std::vector<float> mag(ew), ang(ew), gx(ew), gy(ew);
+			std::vector<float> tmp(ew), out((size_t)steps * HOG_HOST_TILE_W), norm(HOG_HOST_TILE_W);
+			std::vector<float> zeros(w, 0.f);
+			const float bins_per_rad = steps / (float)M_PI;
+
+			for(size_t t = begin; t < end; t++){
+				const unsigned int y0 = (t / n_tx) * HOG_HOST_TILE_H;
+				const unsigned int x0 = (t % n_tx) * HOG_HOST_TILE_W;
+				const unsigned int ny = std::min(h, y0 + HOG_HOST_TILE_H) - y0;
+				const unsigned int nx = std::min(w, x0 + HOG_HOST_TILE_W) - x0;
+				const unsigned int tw = nx + 2 * r; // width of the tile and its border
+
+				// orientation histograms of rows y0-r .. y0+ny+r and columns x0-r .. x0+nx+r,
+				// bin s of row k is at hist[(s*eh + k)*ew]. Outside of the image, they are zero.
+				const int ex0 = (int)x0 - (int)r;
+				const unsigned int xa = std::max(ex0, 0);
+				const unsigned int xb = std::min(x0 + nx + r, w);
+				for(unsigned int k = 0; k < ny + 2 * r; k++){
+					for(unsigned int s = 0; s < steps; s++){
+						float* hs = &hist[((size_t)s * eh + k) * ew];
+						std::fill(hs, hs + tw, 0.f);
+					}
+					const int y = (int)(y0 + k) - (int)r;
+					if(y < 0 || y >= (int)h)
+						continue;
+					gradients(&mag[0], &ang[0], &gx[0], &gy[0], y, xa, xb - xa, &zeros[0]);
+
+					// linear interpolation between the two closest bins
+					float* hk = &hist[(size_t)k * ew + (xa - ex0)];
+					for(unsigned int i = 0; i < xb - xa; i++){
+						const float pos  = ang[i] * bins_per_rad;
+						unsigned int s   = std::min((unsigned int)pos, steps);
+						const float frac = pos - s;
+						if(s == steps)
+							s = 0;
+						const unsigned int s1 = s + 1 == steps ? 0 : s + 1;
+						hk[(size_t)s  * eh * ew + i] += mag[i] * (1.f - frac);
+						hk[(size_t)s1 * eh * ew + i] += mag[i] * frac;
+					}
+				}
+
+				// spatial pooling and normalization, row by row
+				for(unsigned int k = 0; k < ny; k++){
+					for(unsigned int s = 0; s < steps; s++){
+						const float* hs = &hist[((size_t)s * eh + k) * ew];
+						for(unsigned int i = 0; i < tw; i++)
+							tmp[i] = kernel[2 * r] * hs[i];
+						for(unsigned int j = 1; j <= 2 * r; j++){
+							const float kj  = kernel[2 * r - j];
+							const float* hj = hs + (size_t)j * ew;
+							for(unsigned int i = 0; i < tw; i++)
+								tmp[i] += kj * hj[i];
+						}
+						float* os = &out[(size_t)s * nx];
+						for(unsigned int i = 0; i < nx; i++)
+							os[i] = kernel[2 * r] * tmp[i];
+						for(unsigned int j = 1; j <= 2 * r; j++){
+							const float kj = kernel[2 * r - j];
+							const float* l = &tmp[j];
+							for(unsigned int i = 0; i < nx; i++)
+								os[i] += kj * l[i];
+						}
+					}
+
+					normalize_columns(&out[0], &norm[0], steps, nx);
+					for(unsigned int i = 0; i < steps * nx; i++)
+						out[i] = std::min(out[i], HOG_CLIP);
+					normalize_columns(&out[0], &norm[0], steps, nx);
+
+					for(unsigned int s = 0; s < steps; s++)
+						std::copy(&out[(size_t)s * nx], &out[(size_t)s * nx] + nx,
+								dst + ((size_t)s * h + y0 + k) * w + x0);
+				}
+			}
+		}
+	};
+}
+
+void host_hog(float* dst, const float* src, unsigned int channels, unsigned int h, unsigned int w,
+		unsigned int steps, unsigned int spatialpool){
+	cuvAssert(channels > 0);
+	cuvAssert(steps > 0);
+	if(h == 0 || w == 0)
+		return;
+
+	// gaussian pooling filter, normalized to sum one
+	const unsigned int r = spatialpool;
+	std::vector<float> kernel(2 * r + 1, 1.f);
+	if(r > 0){
+		const float sigma = r / 2.f;
+		float sum = 0.f;
+		for(unsigned int i = 0; i < 2 * r + 1; i++){
+			const float dist = (float)((int)i - (int)r);
+			kernel[i] = expf(- dist * dist / (2 * sigma * sigma));
+			sum += kernel[i];
+		}
+		for(unsigned int i = 0; i < 2 * r + 1; i++)
+			kernel[i] /= sum;
+	}
+
+	hog_tasks task(dst, src, channels, h, w, steps, &kernel[0], r);
+	const size_t work = (size_t)h * w * (channels + steps * (2 * r + 1));
+	if(work < get_host_parallel_threshold())
+		task(0, task.n_tasks());
+	else
+		parallel_tasks(task.n_tasks(), task);
+}
+
+} } } }
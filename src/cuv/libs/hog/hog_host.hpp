@@ -0,0 +1,66 @@
+//*LB*
+// Copyright (c) 2010, University of Bonn, Institute for Computer Science VI
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+//  * Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//  * Neither the name of the University of Bonn 
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this software without specific prior written
+//    permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//*LE*
+
+
+
+
+/**
+ * @file hog_host.hpp
+ * @brief host (CPU) implementation of the HOG descriptor in hog.hpp
+ * @ingroup hog
+ *
+ * The device version runs gradients, orientation binning, spatial pooling
+ * and normalization as separate passes over whole images. On the host,
+ * these steps are fused and run on tiles of the image: the orientation
+ * histograms of a tile and its pooling border are determined in a buffer
+ * which fits into L2 cache, then pooled and normalized row by row.
+ * Tiles are processed on the host thread pool.
+ */
+#ifndef __HOG_HOST_HPP__
+#define __HOG_HOST_HPP__
+
+namespace cuv{ namespace libs{ namespace hog{ namespace detail{
+
+/**
+ * hog descriptor of a row-major image.
+ *
+ * @param dst         steps x h x w contiguous descriptors
+ * @param src         channels x h x w contiguous image
+ * @param channels    number of color channels of src
+ * @param h           height of the image
+ * @param w           width of the image
+ * @param steps       number of orientation bins in [0,pi)
+ * @param spatialpool radius of the gaussian used for spatial pooling
+ */
+void host_hog(float* dst, const float* src, unsigned int channels, unsigned int h, unsigned int w,
+		unsigned int steps, unsigned int spatialpool);
+
+} } } }
+
+#endif /* __HOG_HOST_HPP__ */
@@ -6,6 +6,7 @@
 
 using namespace std;
 
+#ifndef CUV_NO_CUDA
 ////////////////////////////////////////////////////////////////////////////////
 //! for every row in A, every column in B, calculate sum of squared differences
 //! wA is A's width and wB is B's width
@@ -69,11 +70,19 @@ pairwise_distance_kernel( __distance_type* C,const  __value_type* A, const __val
     int c = __mul24(__mul24(hB , BLOCK_DIM) , by) + __mul24(BLOCK_DIM , bx);
     C[c + __mul24(hB , ty) + tx] = Csub;
 }
+#endif /* CUV_NO_CUDA */
 
 namespace cuv{
 namespace libs{	
 	namespace kernels{
             namespace detail{
+#ifdef CUV_NO_CUDA
+                template <class V>
+                void pairwise_distance_impl(tensor<V,dev_memory_space,row_major>& result, const tensor<V,dev_memory_space,row_major>& A, const tensor<V,dev_memory_space,row_major>& B){
+                    // the kernel determines squared distances, too
+                    pairwise_distance_l2(result, A, B, true);
+                }
+#else
                 template <class V>
                 void pairwise_distance_impl(tensor<V,dev_memory_space,row_major>& result, const tensor<V,dev_memory_space,row_major>& A, const tensor<V,dev_memory_space,row_major>& B){
 		const int BLOCK_DIM = 32;
@@ -92,6 +101,7 @@ namespace libs{
 		checkCudaError("kernel sqDiff invocation");
                    
                }
+#endif /* CUV_NO_CUDA */
             }
         template <class __value_type, class __memory_space_type, class __memory_layout_type>
         void pairwise_distance_custom(tensor<__value_type,__memory_space_type,__memory_layout_type>& result, const tensor<__value_type,__memory_space_type,__memory_layout_type>& A, const tensor<__value_type,__memory_space_type,__memory_layout_type>& B){
@@ -115,8 +125,8 @@ namespace libs{
                 cuvAssert(B.shape()[0] == result.shape()[1]);
                 
                 typedef tensor<__value_type, __memory_space_type> tensortype;
-                tensortype A_sqr_norm(A.shape(0));
-                tensortype B_sqr_norm(B.shape(0));
+                tensortype A_sqr_norm(A.shape(0), result.m_allocator);
+                tensortype B_sqr_norm(B.shape(0), result.m_allocator);
                 reduce_to_col(A_sqr_norm,A,RF_ADD_SQUARED);
                 reduce_to_col(B_sqr_norm,B,RF_ADD_SQUARED);
                 prod(result,A,B,'n','t',-2.,0.);
@@ -20,6 +20,8 @@ namespace libs{
          * @param A      first  matrix    (n_rows_A times K)
          * @param B      second matrix    (n_rows_B times K)
          * @param squared if true, do not determine square root of the distance
+         *
+         * Temporaries are obtained from the allocator of result.
          */
 	template <class __value_type, class __memory_space_type, class __memory_layout_type>
 	void pairwise_distance_l2(tensor<__value_type,__memory_space_type,__memory_layout_type>& result, const tensor<__value_type,__memory_space_type,__memory_layout_type>& A, const tensor<__value_type,__memory_space_type,__memory_layout_type>& B, const bool & squared=false);
@@ -42,6 +44,9 @@ namespace libs{
          * @param squared if true, do not determine square root of the distance
          *
          * @return distance matrix (n_rows_A times n_rows_B)
+         *
+         * The result outlives the call and uses the default allocator,
+         * not the allocator of A (which may be an arena).
          */
 	template <class __value_type, class __memory_space_type, class __memory_layout_type>
 	tensor<__value_type,__memory_space_type,__memory_layout_type> pairwise_distance_l2(const tensor<__value_type,__memory_space_type,__memory_layout_type>& A, const tensor<__value_type,__memory_space_type,__memory_layout_type>& B, const bool & squared=false){
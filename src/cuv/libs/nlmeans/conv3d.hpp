@@ -52,6 +52,31 @@ namespace cuv{
 					const cuv::tensor<float,dev_memory_space>& d_Src,
 					const cuv::tensor<float,dev_memory_space> &kernel
 					);
+            /**
+             * convolve along the last axis (rows) of a 3D array on the host
+             *
+             * pixels outside of the array are zero.
+             * @param d_Dst where to write results, must have the shape of d_Src
+             * @param d_Src source array
+             * @param kernel coefficients, kernel size = 2*r+1 for radius r
+             */
+			void convolutionRows(
+					cuv::tensor<float,host_memory_space> &d_Dst,
+					const cuv::tensor<float,host_memory_space> &d_Src,
+					const cuv::tensor<float,host_memory_space> &kernel
+					);
+            /// @overload convolve along the middle axis (columns) on the host
+			void convolutionColumns(
+					cuv::tensor<float,host_memory_space> & d_Dst,
+					const cuv::tensor<float,host_memory_space> & d_Src,
+					const cuv::tensor<float,host_memory_space> &kernel
+					);
+            /// @overload convolve along the first axis (slices) on the host
+			void convolutionDepth(
+					cuv::tensor<float,host_memory_space>& d_Dst,
+					const cuv::tensor<float,host_memory_space>& d_Src,
+					const cuv::tensor<float,host_memory_space> &kernel
+					);
             /**
              * determine hessian magnitude of 3D array
              *
@@ -48,6 +48,29 @@ namespace cuv{
 				void filter_nlmean(cuv::tensor<T,dev_memory_space>& dst, const cuv::tensor<T,dev_memory_space>& src, bool threeDim=false);
 			template<class T>
 				void filter_nlmean(cuv::tensor<T,dev_memory_space,row_major>& dst, const cuv::tensor<T,dev_memory_space,row_major>& src, int search_radius, int filter_radius, float sigma, float dist_sigma=0.f, float step_size=1.f, bool threeDim=false, bool verbose=false);
+			/**
+			 * non-local means filter on the host.
+			 *
+			 * Every pixel becomes the weighted mean of the pixels p+o for
+			 * search offsets o in [-search_radius,search_radius] (in steps
+			 * of step_size, rounded down) in each dimension. The weight is
+			 * exp(-D/sigma^2 - |o|^2/dist_sigma^2), where D is the mean squared
+			 * difference of the patches of radius filter_radius around p and p+o,
+			 * pixels outside of the image are zero. Offsets for which a
+			 * patch pixel would be shifted outside of the image get weight zero.
+			 * The distance term is dropped if dist_sigma is zero.
+			 *
+			 * Patch differences are computed with running sums, the cost does
+			 * not depend on filter_radius.
+			 *
+			 * @param dst the result, resized to the shape of src if necessary
+			 * @param src an image (h x w) or a stack of d images (d x h x w)
+			 * @param threeDim if true, src is filtered as a volume. Otherwise,
+			 *        the images of a stack are channels which share their weights.
+			 * @param verbose ignored on the host
+			 */
+			template<class T>
+				void filter_nlmean(cuv::tensor<T,host_memory_space,row_major>& dst, const cuv::tensor<T,host_memory_space,row_major>& src, int search_radius, int filter_radius, float sigma, float dist_sigma=0.f, float step_size=1.f, bool threeDim=false, bool verbose=false);
 			/**
 			 * @}
 			 * @}
@@ -0,0 +1,426 @@
+//*LB*
+// Copyright (c) 2010, University of Bonn, Institute for Computer Science VI
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+//  * Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//  * Neither the name of the University of Bonn 
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this software without specific prior written
+//    permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//*LE*
+
+
+
+
+/**
+ * @file nlmeans_host.cpp
+ * @brief host implementations of non-local means and the 3D convolutions
+ * @ingroup nlmeans
+ *
+ * For every search offset, the squared differences of a volume and its
+ * shifted copy are summed over the patches of all pixels at once: rows
+ * are summed up with prefix sums, columns and slices with running sums of
+ * rows.  The cost per pixel and offset thus does not depend on the patch
+ * size.  The volume is divided into blocks of slices and rows which are
+ * processed on the host thread pool; a block loops over all offsets, so
+ * that its buffers stay in cache.
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+#include <cuv/tools/cuv_general.hpp>
+#include <cuv/tools/thread_pool.hpp>
+#include <cuv/libs/separable_conv/separable_convolution_host.hpp>
+#include <cuv/libs/nlmeans/nlmeans.hpp>
+#include <cuv/libs/nlmeans/conv3d.hpp>
+
+namespace cuv{ namespace libs{ namespace nlmeans{
+
+namespace{
+	/// number of slices of a block (3D filtering only)
+	const int NLM_HOST_BLOCK_D = 8;
+
+	/// number of rows of a block
+	const int NLM_HOST_BLOCK_H = 32;
+
+	/// a shift of the search window and its prior log-weight
+	struct nlm_offset{
+		int z, y, x;
+		float prior;
+	};
+
+	/**
+	 * filters blocks of NLM_HOST_BLOCK_D slices and NLM_HOST_BLOCK_H rows,
+	 * used by parallel_tasks. Task t is block t % n_by of slice block t / n_by.
+	 *
+	 * The volume consists of c channels of d x h x w voxels. Patches have
+	 * radius r along rows and columns and rz along slices, the squared
+	 * differences of all channels are summed.
+	 */
+	struct nlm_tasks{
+		float* dst;
+		const float* src;
+		int c, d, h, w;
+		int r, rz;
+		float scale;                        ///< multiplies patch distances
+		const std::vector<nlm_offset>& offsets;
+		int bd, n_bz, n_by;
+
+		nlm_tasks(float* _dst, const float* _src, int _c, int _d, int _h, int _w, int _r, int _rz,
+				float _scale, const std::vector<nlm_offset>& _offsets)
+			:dst(_dst), src(_src), c(_c), d(_d), h(_h), w(_w), r(_r), rz(_rz), scale(_scale), offsets(_offsets)
+		{
+			bd   = d > 1 ? NLM_HOST_BLOCK_D : 1;
+			n_bz = (d + bd - 1) / bd;
+			n_by = (h + NLM_HOST_BLOCK_H - 1) / NLM_HOST_BLOCK_H;
+		}
+
+		size_t n_tasks()const{ return (size_t)n_bz * n_by; }
+
+		/**
+		 * for the row at src_row, out[x] for x in [x0,x1) is the sum of
+		 * the squared differences in [x-r,x+r] clipped to [s0,s1).
+		 */
+		void row_distances(float* out, const float* src_row, const float* shifted_row, size_t plane,
+				int s0, int s1, int x0, int x1, float* sq, double* prefix)const{
+			for(int x = s0; x < s1; x++)
+				sq[x] = 0.f;
+			for(int k = 0; k < c; k++){
+				const float* a = src_row + k * plane;
+				const float* b = shifted_row + k * plane;
+				for(int x = s0; x < s1; x++){
+					const float v = a[x] - b[x];
+					sq[x] += v * v;
+				}
+			}
+			prefix[s0] = 0.0;
+			for(int x = s0; x < s1; x++)
+				prefix[x + 1] = prefix[x] + sq[x];
+			for(int x = x0; x < x1; x++)
+				out[x] = (float)(prefix[std::min(s1, x + r + 1)] - prefix[std::max(s0, x - r)]);
+		}
+
+		/**
+		 * out[i][x] = sum of in[j][x] for j in [i-radius,i+radius] clipped
+		 * to [0,n_in), for i in [0,n_out) and x in [x0,x1).
+		 *
+		 * Row i of out is centered at row i+first of in, first must not
+		 * exceed radius.
+		 */
+		static void box_rows(float* out, const float* in, size_t pitch, int n_in, int n_out, int first,
+				int radius, int x0, int x1, double* acc){
+			for(int x = x0; x < x1; x++)
+				acc[x] = 0.0;
+			for(int j = 0; j < std::min(n_in, first + radius); j++){
+				const float* row = in + j * pitch;
+				for(int x = x0; x < x1; x++)
+					acc[x] += row[x];
+			}
+			for(int i = 0; i < n_out; i++){
+				const int add = i + first + radius;
+				const int sub = i + first - radius - 1;
+				if(add < n_in){
+					const float* row = in + add * pitch;
+					for(int x = x0; x < x1; x++)
+						acc[x] += row[x];
+				}
+				if(sub >= 0){
+					const float* row = in + sub * pitch;
+					for(int x = x0; x < x1; x++)
+						acc[x] -= row[x];
+				}
+				float* o = out + i * pitch;
+				for(int x = x0; x < x1; x++)
+					o[x] = (float)acc[x];
+			}
+		}
+
+		/**
+		 * [lo,hi) is the range of centers for which the shift by o of all
+		 * pixels of the patch stays inside [0,n), intersected with [b0,b1).
+		 */
+		static bool valid_range(int& lo, int& hi, int o, int radius, int n, int b0, int b1){
+			lo = std::max(b0, o < 0 ? radius - o : 0);
+			hi = std::min(b1, o > 0 ? n - o - radius : n);
+			return lo < hi;
+		}
+
+		void operator()(size_t begin, size_t end)const{
+			const size_t plane  = (size_t)d * h * w;
+			const size_t pitch  = w;
+			const size_t slice  = (size_t)h * w;
+			const int    max_ey = NLM_HOST_BLOCK_H + 2 * r;
+			const int    max_ez = bd + 2 * rz;
+			const size_t bslice = (size_t)NLM_HOST_BLOCK_H * w;
+
+			std::vector<float>  rows_buf((size_t)max_ez * max_ey * w);
+			std::vector<float>  cols_buf((size_t)max_ez * bslice);
+			std::vector<float>  dist_buf(rz > 0 ? (size_t)bd * bslice : 0);
+			std::vector<float>  weights((size_t)bd * bslice);
+			std::vector<float>  acc((size_t)c * bd * bslice);
+			std::vector<float>  sq(w);
+			std::vector<float>  wgt(w);
+			std::vector<double> prefix(w + 1);
+			std::vector<double> line(w);
+
+			for(size_t t = begin; t < end; t++){
+				const int z0 = (int)(t / n_by) * bd;
+				const int y0 = (int)(t % n_by) * NLM_HOST_BLOCK_H;
+				const int z1 = std::min(d, z0 + bd);
+				const int y1 = std::min(h, y0 + NLM_HOST_BLOCK_H);
+				std::fill(weights.begin(), weights.end(), 0.f);
+				std::fill(acc.begin(), acc.end(), 0.f);
+
+				for(size_t oi = 0; oi < offsets.size(); oi++){
+					const nlm_offset& o = offsets[oi];
+					int vz0, vz1, vy0, vy1, vx0, vx1;
+					if(!valid_range(vz0, vz1, o.z, rz, d, z0, z1)
+					|| !valid_range(vy0, vy1, o.y, r,  h, y0, y1)
+					|| !valid_range(vx0, vx1, o.x, r,  w, 0,  w))
+						continue;
+					// the pixels in the patches of the valid centers
+					const int sz0 = std::max(0, vz0 - rz), sz1 = std::min(d, vz1 + rz);
+					const int sy0 = std::max(0, vy0 - r),  sy1 = std::min(h, vy1 + r);
+					const int sx0 = std::max(0, vx0 - r),  sx1 = std::min(w, vx1 + r);
+					const int nz = sz1 - sz0, ny = sy1 - sy0, nvz = vz1 - vz0, nvy = vy1 - vy0;
+					const ptrdiff_t shift = ((ptrdiff_t)o.z * h + o.y) * w + o.x;
+
+					// sums along rows
+					for(int z = sz0; z < sz1; z++)
+						for(int y = sy0; y < sy1; y++){
+							const float* s = src + z * slice + y * pitch;
+							row_distances(&rows_buf[((size_t)(z - sz0) * max_ey + (y - sy0)) * w], s, s + shift,
+									plane, sx0, sx1, vx0, vx1, &sq[0], &prefix[0]);
+						}
+					// sums along columns
+					for(int z = 0; z < nz; z++)
+						box_rows(&cols_buf[(size_t)z * bslice], &rows_buf[(size_t)z * max_ey * w], pitch,
+								ny, nvy, vy0 - sy0, r, vx0, vx1, &line[0]);
+					// sums along slices
+					const float* dist = &cols_buf[0];
+					if(rz > 0){
+						for(int y = 0; y < nvy; y++)
+							box_rows(&dist_buf[(size_t)y * w], &cols_buf[(size_t)y * w], bslice,
+									nz, nvz, vz0 - sz0, rz, vx0, vx1, &line[0]);
+						dist = &dist_buf[0];
+					}
+
+					for(int z = vz0; z < vz1; z++)
+						for(int y = vy0; y < vy1; y++){
+							const size_t bofs = (size_t)(z - z0) * bslice + (size_t)(y - y0) * w;
+							const float* di = dist + (size_t)(z - vz0) * bslice + (size_t)(y - vy0) * w;
+							float* wi = &weights[bofs];
+							for(int x = vx0; x < vx1; x++){
+								wgt[x] = expf(di[x] * scale + o.prior);
+								wi[x] += wgt[x];
+							}
+							const float* s = src + z * slice + y * pitch + shift;
+							for(int k = 0; k < c; k++){
+								float* a = &acc[(size_t)k * bd * bslice + bofs];
+								const float* sk = s + k * plane;
+								for(int x = vx0; x < vx1; x++)
+									a[x] += wgt[x] * sk[x];
+							}
+						}
+				}
+
+				for(int k = 0; k < c; k++)
+					for(int z = z0; z < z1; z++)
+						for(int y = y0; y < y1; y++){
+							const size_t bofs = (size_t)(z - z0) * bslice + (size_t)(y - y0) * w;
+							const size_t ofs  = k * plane + z * slice + y * pitch;
+							const float* wi = &weights[bofs];
+							const float* a  = &acc[(size_t)k * bd * bslice + bofs];
+							for(int x = 0; x < w; x++)
+								dst[ofs + x] = wi[x] > 0.f ? a[x] / wi[x] : src[ofs + x];
+						}
+			}
+		}
+	};
+
+	/// the shifts of the search window, in the order of the device implementation
+	std::vector<nlm_offset> search_offsets(int search_radius, float step_size, float dist_sigma, bool three_dim){
+		cuvAssert(step_size > 0.f);
+		std::vector<float> steps;
+		for(float v = -search_radius; v <= search_radius; v += step_size)
+			steps.push_back(v);
+		const float ds2 = dist_sigma * dist_sigma;
+		std::vector<nlm_offset> offsets;
+		for(size_t i = 0; i < (three_dim ? steps.size() : 1); i++)
+			for(size_t j = 0; j < steps.size(); j++)
+				for(size_t k = 0; k < steps.size(); k++){
+					// in 2D, the outer loop of the device implementation runs over x
+					const float vz = three_dim ? steps[i] : 0.f;
+					const float vy = three_dim ? steps[j] : steps[k];
+					const float vx = three_dim ? steps[k] : steps[j];
+					nlm_offset o;
+					o.z = (int)floorf(vz);
+					o.y = (int)floorf(vy);
+					o.x = (int)floorf(vx);
+					o.prior = dist_sigma > 0.f ? -(vz * vz + vy * vy + vx * vx) / ds2 : 0.f;
+					offsets.push_back(o);
+				}
+		return offsets;
+	}
+
+	/// geometry of a 3D volume for host_separable_convolve, filtering along rows and columns of slices
+	sep_conv::detail::host_sep_geometry slice_geometry(const tensor<float,host_memory_space>& t){
+		cuvAssert(t.ndim() == 3);
+		cuvAssert(t.is_c_contiguous());
+		sep_conv::detail::host_sep_geometry g;
+		g.n = t.shape(0);
+		g.h = t.shape(1);
+		g.w = t.shape(2);
+		g.channels = 1;
+		g.src_pitch  = g.dst_pitch  = g.w;
+		g.src_stride = g.dst_stride = g.h * g.w;
+		return g;
+	}
+
+	/// radius of a kernel of odd size
+	unsigned int kernel_radius(const tensor<float,host_memory_space>& kernel){
+		cuvAssert(kernel.ndim() == 1 && kernel.size() % 2 == 1);
+		cuvAssert(kernel.is_c_contiguous());
+		return (kernel.size() - 1) / 2;
+	}
+}
+
+void convolutionRows(
+		cuv::tensor<float,host_memory_space> &dst,
+		const cuv::tensor<float,host_memory_space> &src,
+		const cuv::tensor<float,host_memory_space> &kernel
+		){
+	cuvAssert(equal_shape(dst,src));
+	const unsigned int r = kernel_radius(kernel);
+	sep_conv::detail::host_sep_geometry g = slice_geometry(src);
+	cuvAssert(dst.is_c_contiguous());
+	sep_conv::detail::host_separable_convolve(dst.ptr(), src.ptr(), g, kernel.ptr(), r, NULL, 0);
+}
+
+void convolutionColumns(
+		cuv::tensor<float,host_memory_space> &dst,
+		const cuv::tensor<float,host_memory_space> &src,
+		const cuv::tensor<float,host_memory_space> &kernel
+		){
+	cuvAssert(equal_shape(dst,src));
+	const unsigned int r = kernel_radius(kernel);
+	sep_conv::detail::host_sep_geometry g = slice_geometry(src);
+	cuvAssert(dst.is_c_contiguous());
+	sep_conv::detail::host_separable_convolve(dst.ptr(), src.ptr(), g, NULL, 0, kernel.ptr(), r);
+}
+
+void convolutionDepth(
+		cuv::tensor<float,host_memory_space> &dst,
+		const cuv::tensor<float,host_memory_space> &src,
+		const cuv::tensor<float,host_memory_space> &kernel
+		){
+	cuvAssert(equal_shape(dst,src));
+	const unsigned int r = kernel_radius(kernel);
+	sep_conv::detail::host_sep_geometry g = slice_geometry(src);
+	cuvAssert(dst.is_c_contiguous());
+	// slices are the rows of a single image
+	g.h = g.n;
+	g.w = g.src_stride;
+	g.n = 1;
+	g.src_pitch = g.dst_pitch = g.src_stride;
+	sep_conv::detail::host_separable_convolve(dst.ptr(), src.ptr(), g, NULL, 0, kernel.ptr(), r);
+}
+
+template<class T>
+void filter_nlmean(cuv::tensor<T,host_memory_space,row_major>& dst, const cuv::tensor<T,host_memory_space,row_major>& src, int search_radius, int filter_radius, float sigma, float dist_sigma, float step_size, bool threeDim, bool /*verbose*/){
+	cuvAssert(src.ndim()==2 || src.ndim()==3);
+	cuvAssert(!threeDim || src.ndim()==3);
+	cuvAssert(src.is_c_contiguous());
+	cuvAssert(search_radius >= 0 && filter_radius >= 0);
+	if(!equal_shape(dst,src))
+		dst = cuv::tensor<T,host_memory_space,row_major>(src.shape());
+	cuvAssert(dst.is_c_contiguous());
+	cuvAssert(dst.ptr() != src.ptr());
+
+	const bool d3 = src.ndim()==3;
+	const int w = src.shape(d3 ? 2 : 1), h = src.shape(d3 ? 1 : 0);
+	const int slices = d3 ? src.shape(0) : 1;
+	if(slices == 0 || h == 0 || w == 0)
+		return;
+	// in 2D, the slices are channels which share their weights
+	const int c  = threeDim ? 1 : slices;
+	const int d  = threeDim ? slices : 1;
+	const int rz = threeDim ? filter_radius : 0;
+
+	const std::vector<nlm_offset> offsets = search_offsets(search_radius, step_size, dist_sigma, threeDim);
+	// patch distances are means over the patch and the channels
+	float patch = 2 * filter_radius + 1;
+	patch *= patch * (threeDim ? 2 * filter_radius + 1 : 1);
+	const float scale = -1.f / (patch * c * sigma * sigma);
+
+	nlm_tasks task(dst.ptr(), src.ptr(), c, d, h, w, filter_radius, rz, scale, offsets);
+	const size_t work = (size_t)c * d * h * w * offsets.size();
+	if(work < get_host_parallel_threshold())
+		task(0, task.n_tasks());
+	else
+		parallel_tasks(task.n_tasks(), task);
+}
+
+template void filter_nlmean(cuv::tensor<float,host_memory_space,row_major>& dst, const cuv::tensor<float,host_memory_space,row_major>& src, int,int,float,float,float,bool,bool);
+
+#ifdef CUV_NO_CUDA
+// device memory is host memory, forward to the host implementations.
+
+void convolutionRows(
+		cuv::tensor<float,dev_memory_space> &dst,
+		const cuv::tensor<float,dev_memory_space> &src,
+		const cuv::tensor<float,dev_memory_space> &kernel
+		){
+	cuv::tensor<float,host_memory_space> hdst = cuv::detail::host_alias(dst);
+	convolutionRows(hdst, cuv::detail::host_alias(src), cuv::detail::host_alias(kernel));
+}
+
+void convolutionColumns(
+		cuv::tensor<float,dev_memory_space> &dst,
+		const cuv::tensor<float,dev_memory_space> &src,
+		const cuv::tensor<float,dev_memory_space> &kernel
+		){
+	cuv::tensor<float,host_memory_space> hdst = cuv::detail::host_alias(dst);
+	convolutionColumns(hdst, cuv::detail::host_alias(src), cuv::detail::host_alias(kernel));
+}
+
+void convolutionDepth(
+		cuv::tensor<float,dev_memory_space> &dst,
+		const cuv::tensor<float,dev_memory_space> &src,
+		const cuv::tensor<float,dev_memory_space> &kernel
+		){
+	cuv::tensor<float,host_memory_space> hdst = cuv::detail::host_alias(dst);
+	convolutionDepth(hdst, cuv::detail::host_alias(src), cuv::detail::host_alias(kernel));
+}
+
+template<class T>
+void filter_nlmean(cuv::tensor<T,dev_memory_space,row_major>& dst, const cuv::tensor<T,dev_memory_space,row_major>& src, int search_radius, int filter_radius, float sigma, float dist_sigma, float step_size, bool threeDim, bool verbose){
+	if(!equal_shape(dst,src))
+		dst = cuv::tensor<T,dev_memory_space,row_major>(src.shape());
+	cuv::tensor<T,host_memory_space,row_major> hdst = cuv::detail::host_alias(dst);
+	filter_nlmean(hdst, cuv::detail::host_alias(src), search_radius, filter_radius, sigma, dist_sigma, step_size, threeDim, verbose);
+}
+
+template void filter_nlmean(cuv::tensor<float,dev_memory_space,row_major>& dst, const cuv::tensor<float,dev_memory_space,row_major>& src, int,int,float,float,float,bool,bool);
+#endif /* CUV_NO_CUDA */
+
+} } }
@@ -12,6 +12,7 @@ namespace cuv { namespace libs { namespace opt {
 
 
 namespace impl{
+#ifndef CUV_NO_CUDA
     /**
       This is for patterns in the second dimension, and is more efficient.
       */
@@ -113,6 +114,7 @@ namespace impl{
                     grads[tidx] = v;
             }
         }
+#endif /* CUV_NO_CUDA */
 
         template<class V, class M, class L>
             void softmax_derivative(cuv::tensor<V, M, L>& dst, const cuv::tensor<V, M, L>& softmax_act, const cuv::tensor<V,M,L>& residual,  unsigned int vardim, float fact_old){
@@ -150,7 +152,7 @@ namespace impl{
         typedef typename cuv::tensor<V, M, L>::index_type index_type;
         const index_type n_variables = dst.shape( vardim);
 
-        cuv::tensor<V,M> red(cuv::extents[n_variables]);
+        cuv::tensor<V,M> red(cuv::extents[n_variables], dst.m_allocator);
         if(vardim==1) cuv::reduce_to_row(red, src, RF_LOGADDEXP, -1.f);
         else          cuv::reduce_to_col(red, src, RF_LOGADDEXP, -1.f);
 
@@ -163,6 +165,7 @@ namespace impl{
     }
 
 
+#ifndef CUV_NO_CUDA
     template<class T>
         __global__ void adagrad_kernel(T* Wptr, const T* dWptr, T* sWptr, T learnrate, T delta, T decay, T sparsedecay, unsigned int size) {
             const unsigned int idx = blockIdx.x * blockDim.x + threadIdx.x;
@@ -175,6 +178,7 @@ namespace impl{
                 Wptr[i] = sgn(f) * max(0.f, fabs(f) - lr * sparsedecay);
             }
         }
+#endif /* CUV_NO_CUDA */
 
     template<class V, class L>
         void adagrad(tensor<V,host_memory_space, L>& W, const tensor<V,host_memory_space, L>& dW, tensor<V,host_memory_space, L>& sW, const float& learnrate, const float& delta, const float& decay, const float& sparsedecay){
@@ -190,6 +194,15 @@ namespace impl{
                 Wptr[i] = sgn(f) * max(0.f, fabs(f) - learnrate * sparsedecay/lr);
             }
         }
+#ifdef CUV_NO_CUDA
+    template<class V, class L>
+        void adagrad(tensor<V,dev_memory_space,L>& W, const tensor<V,dev_memory_space,L>& dW, tensor<V,dev_memory_space,L>& sW, const float& learnrate, const float& delta, const float& decay, const float& sparsedecay){
+            // device memory is host memory, use the host implementation
+            tensor<V,host_memory_space,L> hW = cuv::detail::host_alias(W);
+            tensor<V,host_memory_space,L> hsW = cuv::detail::host_alias(sW);
+            adagrad(hW, cuv::detail::host_alias(dW), hsW, learnrate, delta, decay, sparsedecay);
+        }
+#else
     template<class V, class L>
         void adagrad(tensor<V,dev_memory_space,L>& W, const tensor<V,dev_memory_space,L>& dW, tensor<V,dev_memory_space,L>& sW, const float& learnrate, const float& delta, const float& decay, const float& sparsedecay){
             unsigned int size = dW.size();
@@ -198,7 +211,9 @@ namespace impl{
             adagrad_kernel<<< num_threads, num_blocks>>>(W.ptr(), dW.ptr(), sW.ptr(), learnrate,delta,decay,sparsedecay, size);
             cuvSafeCall(cudaThreadSynchronize());
         }
+#endif /* CUV_NO_CUDA */
 
+#ifndef CUV_NO_CUDA
     template<class T>
         __global__ void rmsprop_kernel(T* Wptr, const T* dWptr, T* sWptr, T learnrate, T delta, T decay, T sparsedecay, unsigned int size, float grad_avg) {
             const unsigned int idx = blockIdx.x * blockDim.x + threadIdx.x;
@@ -211,6 +226,7 @@ namespace impl{
                 Wptr[i] = sgn(f) * max(0.f, fabs(f) - learnrate * sparsedecay/lr);
             }
         }
+#endif /* CUV_NO_CUDA */
 
     template<class V, class L>
         void rmsprop(tensor<V,host_memory_space, L>& W, const tensor<V,host_memory_space, L>& dW, tensor<V,host_memory_space, L>& sW, const float& learnrate, const float& delta, const float& decay, const float& sparsedecay, const float& grad_avg){
@@ -226,6 +242,15 @@ namespace impl{
                 Wptr[i] = sgn(f) * max(0.f, fabs(f) - learnrate * sparsedecay/lr);
             }
         }
+#ifdef CUV_NO_CUDA
+    template<class V, class L>
+        void rmsprop(tensor<V,dev_memory_space,L>& W, const tensor<V,dev_memory_space,L>& dW, tensor<V,dev_memory_space,L>& sW, const float& learnrate, const float& delta, const float& decay, const float& sparsedecay, const float& grad_avg){
+            // device memory is host memory, use the host implementation
+            tensor<V,host_memory_space,L> hW = cuv::detail::host_alias(W);
+            tensor<V,host_memory_space,L> hsW = cuv::detail::host_alias(sW);
+            rmsprop(hW, cuv::detail::host_alias(dW), hsW, learnrate, delta, decay, sparsedecay, grad_avg);
+        }
+#else
     template<class V, class L>
         void rmsprop(tensor<V,dev_memory_space,L>& W, const tensor<V,dev_memory_space,L>& dW, tensor<V,dev_memory_space,L>& sW, const float& learnrate, const float& delta, const float& decay, const float& sparsedecay, const float& grad_avg){
             unsigned int size = dW.size();
@@ -234,7 +259,9 @@ namespace impl{
             rmsprop_kernel<<< num_threads, num_blocks>>>(W.ptr(), dW.ptr(), sW.ptr(), learnrate,delta,decay,sparsedecay, size, grad_avg);
             cuvSafeCall(cudaThreadSynchronize());
         }
+#endif /* CUV_NO_CUDA */
 
+#ifndef CUV_NO_CUDA
     template<class T>
         __global__ void na_rmsprop(T* Wptr, const T* dWptr, T* oldWptr, T* sWptr, T* lrptr, T momentum, T grad_avg, T step_adapt, T delta, T lr_max, T lr_min, unsigned int size) {
             const unsigned int idx = blockIdx.x * blockDim.x + threadIdx.x;
@@ -260,6 +287,7 @@ namespace impl{
                     lrptr[i] = lr;
             }
         }
+#endif /* CUV_NO_CUDA */
     template<class V, class L>
         void na_rmsprop(tensor<V,host_memory_space, L>& W, const tensor<V,host_memory_space, L>& dW, tensor<V,host_memory_space, L>& oldW, tensor<V,host_memory_space, L>& sW, tensor<V,host_memory_space, L>& learnrates, const float& momentum, const float& grad_avg, const float& step_adapt, const float& delta, const float& lr_max, const float& lr_min){
             unsigned int size = W.size();
@@ -289,6 +317,17 @@ namespace impl{
                     lrptr[i] = lr;
             }
         }
+#ifdef CUV_NO_CUDA
+    template<class V, class L>
+        void na_rmsprop(tensor<V,dev_memory_space,L>& W, const tensor<V,dev_memory_space,L>& dW, tensor<V,dev_memory_space,L>& oldW, tensor<V,dev_memory_space,L>& sW, tensor<V,dev_memory_space,L>& learnrates, const float& momentum, const float& grad_avg, const float& step_adapt, const float& delta, const float& lr_max, const float& lr_min){
+            // device memory is host memory, use the host implementation
+            tensor<V,host_memory_space,L> hW = cuv::detail::host_alias(W);
+            tensor<V,host_memory_space,L> holdW = cuv::detail::host_alias(oldW);
+            tensor<V,host_memory_space,L> hsW = cuv::detail::host_alias(sW);
+            tensor<V,host_memory_space,L> hlearnrates = cuv::detail::host_alias(learnrates);
+            na_rmsprop(hW, cuv::detail::host_alias(dW), holdW, hsW, hlearnrates, momentum, grad_avg, step_adapt, delta, lr_max, lr_min);
+        }
+#else
     template<class V, class L>
         void na_rmsprop(tensor<V,dev_memory_space,L>& W, const tensor<V,dev_memory_space,L>& dW, tensor<V,dev_memory_space,L>& oldW, tensor<V,dev_memory_space,L>& sW, tensor<V,dev_memory_space,L>& learnrates, const float& momentum, const float& grad_avg, const float& step_adapt, const float& delta, const float& lr_max, const float& lr_min){
             unsigned int size = dW.size();
@@ -297,6 +336,7 @@ namespace impl{
             na_rmsprop<<< num_threads, num_blocks>>>(W.ptr(), dW.ptr(), oldW.ptr(), sW.ptr(), learnrates.ptr(), momentum, grad_avg, step_adapt, delta, lr_max, lr_min, size);
             cuvSafeCall(cudaThreadSynchronize());
         }
+#endif /* CUV_NO_CUDA */
 }
 
 template<class V, class V2, class M, class L>
@@ -306,6 +346,9 @@ std::pair<float, float> multinomial_logistic_loss(
         const cuv::tensor<V2, M, L>& Y, 
         int pattern_axis,
         boost::shared_ptr<allocator> alloc){
+#ifdef CUV_NO_CUDA
+    throw std::runtime_error("multinomial_logistic_loss: not implemented without CUDA");
+#else
 
     int n_patterns = X.shape(pattern_axis);
     int n_labels = X.size() / n_patterns;
@@ -364,6 +407,7 @@ std::pair<float, float> multinomial_logistic_loss(
     retval.first = -cuv::mean(true_label_log_probs);
     retval.second = 1.f - cuv::mean(correct_probs);
     return retval;
+#endif
 }
 template<class V, class V2, class M, class L>
 void multinomial_logistic_loss_grad(
@@ -372,6 +416,9 @@ void multinomial_logistic_loss_grad(
         const cuv::tensor<V2, M, L>& Y, 
         int pattern_axis, bool add
         ){
+#ifdef CUV_NO_CUDA
+    throw std::runtime_error("multinomial_logistic_loss_grad: not implemented without CUDA");
+#else
     int n_patterns = X.shape(pattern_axis);
     int n_labels = X.size() / n_patterns;
     cuvAssert(X.shape() == dmll_dX.shape());
@@ -402,6 +449,7 @@ void multinomial_logistic_loss_grad(
             multinomial_logistic_loss_grad_kernel<true><<<blocks, threads>>>(dmll_dX.ptr(),
                     X.ptr(), Y.ptr(), n_patterns, n_labels, -1.f);
     }
+#endif
 }
     
 template<class V, class M, class L>
@@ -94,6 +94,8 @@ namespace cuv{ namespace libs{
 		 * @param dst     the value of \f$ S(\vec x) \f$ of size \f$ n\times m\f$
 		 * @param src     the input values to be softmaxed
          * @param vardim  the dimension in which the variables are stored
+         *
+         * Temporaries are obtained from the allocator of dst.
 		 */
 		template<class V, class M, class L>
 		void softmax(cuv::tensor<V, M,L>& dst, const cuv::tensor<V, M,L>& src, unsigned int vardim=1);
@@ -6,15 +6,18 @@
 #include <cuv/tensor_ops/tensor_ops.hpp>
 #include <cuv/tensor_ops/functors.hpp>
 #include <cuv/libs/separable_conv/separable_convolution.hpp>
+#include <cuv/libs/separable_conv/separable_convolution_host.hpp>
 
 namespace cuv{
 
 	namespace sep_conv{
 
 
-#define PITCH(PTR,PITCH,Y,X) ((typeof(PTR))((char*)PTR + PITCH*Y) + X)
 #define MAX_KERNEL_RADIUS 8
 #define      MAX_KERNEL_W (2 * MAX_KERNEL_RADIUS + 1)
+
+#ifndef CUV_NO_CUDA
+#define PITCH(PTR,PITCH,Y,X) ((typeof(PTR))((char*)PTR + PITCH*Y) + X)
 		__device__ __constant__ float c_Kernel[MAX_KERNEL_W];
 
 		////////////////////////////////////////////////////////////////////////////////
@@ -198,22 +201,112 @@ namespace cuv{
 				default: cuvAssert(false);
 			}
 		}
+#endif /* CUV_NO_CUDA */
+
+		/**
+		 * determine the coefficients of a separable filter
+		 *
+		 * @param kernel the 2r+1 coefficients, applied both along rows and columns
+		 * @return the radius r of the filter
+		 */
+		unsigned int filter_kernel(cuv::tensor<float,host_memory_space>& kernel, const separable_filter& filt,
+				const unsigned int& filter_radius, const float& param){
+			if(filt == SP_GAUSS){
+				const int kernel_w = 2*filter_radius+1;
+				kernel = cuv::tensor<float, host_memory_space>(kernel_w);
+				for(int i = 0; i < kernel_w; i++){
+					float dist = (float)(i - (int)filter_radius);
+					kernel[i]  = expf(- dist * dist / (2*param*param));
+				}
+				kernel /= cuv::sum(kernel);
+				return filter_radius;
+			}else if(filt == SP_CENTERED_DERIVATIVE){
+				kernel = cuv::tensor<float, host_memory_space>(3);
+				kernel[0]=-0.5;
+				kernel[1]= 0;
+				kernel[2]= 0.5;
+				return 1;
+			}else if(filt == SP_BOX){
+				const int kernel_w = 2*filter_radius+1;
+				kernel = cuv::tensor<float, host_memory_space>(kernel_w);
+				cuv::fill(kernel, 1.f / kernel_w);
+				return filter_radius;
+			}
+			throw std::runtime_error("separable convolution: unknown filter");
+		}
+
+		/**
+		 * run the host implementation on a 2D tensor (an image) or a 3D
+		 * tensor (a stack of images).
+		 *
+		 * For SP_ORIENTATION_AND_MAGNITUDE, dst has an additional leading
+		 * dimension of size two for orientation and magnitude.
+		 *
+		 * @param channels distance of neighbouring pixels in a row
+		 */
 		template<class DstV, class SrcV, class M>
+		void host_convolve(       tensor<DstV,M,row_major>& dst,
+				    const tensor<SrcV,M,row_major>& src,
+				    unsigned int channels,
+				    const unsigned int& filter_radius,
+				    const separable_filter& filt, int axis,
+				    const float& param){
+			const unsigned int D = src.ndim();
+			const unsigned int o = dst.ndim() - D;
+			cuvAssert(src.stride(D-1) == 1);
+			cuvAssert(dst.stride(o+D-1) == 1);
+			detail::host_sep_geometry g;
+			g.n          = D == 3 ? src.shape(0) : 1;
+			g.h          = src.shape(D-2);
+			g.w          = src.shape(D-1);
+			g.channels   = channels;
+			g.src_pitch  = src.stride(D-2);
+			g.dst_pitch  = dst.stride(o+D-2);
+			g.src_stride = D == 3 ? src.stride(0) : 0;
+			g.dst_stride = D == 3 ? dst.stride(o) : 0;
+
+			if(filt == SP_ORIENTATION_AND_MAGNITUDE){
+				detail::host_orientation_and_magnitude(dst.ptr(), dst.ptr() + dst.stride(0), src.ptr(), g);
+				return;
+			}
+			cuv::tensor<float,host_memory_space> kernel;
+			const unsigned int r = filter_kernel(kernel, filt, filter_radius, param);
+			if(filt == SP_CENTERED_DERIVATIVE){
+				cuvAssert(axis==0 || axis==1);
+				detail::host_separable_convolve(dst.ptr(), src.ptr(), g,
+						axis == 0 ? kernel.ptr() : NULL, r,
+						axis == 1 ? kernel.ptr() : NULL, r);
+			}else
+				detail::host_separable_convolve(dst.ptr(), src.ptr(), g, kernel.ptr(), r, kernel.ptr(), r);
+		}
+
+		template<class DstV, class SrcV>
 		void
-		convolve(       tensor<DstV,M,row_major>& dst,
-			  const tensor<SrcV,M,row_major>& src,
+		convolve_dispatch(       tensor<DstV,host_memory_space,row_major>& dst,
+			  const tensor<SrcV,host_memory_space,row_major>& src,
 			  const unsigned int&   filter_radius,
-			  const separable_filter& filt, int axis, 
+			  const separable_filter& filt, int axis,
 			  const float& param ){
+			host_convolve(dst,src,1,filter_radius,filt,axis,param);
+		}
 
-			typedef tensor<DstV,M,row_major> result_type;
-			typedef tensor<SrcV,M,row_major>    src_type;
+		template<class DstV, class SrcV>
+		void
+		convolve_dispatch(       tensor<DstV,dev_memory_space,row_major>& dst,
+			  const tensor<SrcV,dev_memory_space,row_major>& src,
+			  const unsigned int&   filter_radius,
+			  const separable_filter& filt, int axis,
+			  const float& param ){
+#ifdef CUV_NO_CUDA
+			// device memory is host memory
+			host_convolve(dst,src,1,filter_radius,filt,axis,param);
+#else
+			typedef tensor<DstV,dev_memory_space,row_major> result_type;
+			typedef tensor<SrcV,dev_memory_space,row_major>    src_type;
 			cuvAssert(filter_radius <= MAX_KERNEL_RADIUS);
-                        cuvAssert(src.ndim()==2 || src.ndim()==3);
 
-			if(!equal_shape(dst,src)){
-				dst = result_type(src.shape());
-			}
+			if(filt == SP_ORIENTATION_AND_MAGNITUDE)
+				throw std::runtime_error("separable convolution: SP_ORIENTATION_AND_MAGNITUDE is only implemented on the host");
 
 			if(src.ndim()==3){
 				const std::vector<typename src_type::size_type>& s = src.shape();
@@ -225,57 +318,69 @@ namespace cuv{
 				return;
 			}
 
-			if(filt == SP_GAUSS){
-				const int kernel_w = 2*filter_radius+1;
-				cuv::tensor<float, host_memory_space> kernel(kernel_w);
-				for(int i = 0; i < kernel_w; i++){
-					float dist = (float)(i - (int)filter_radius);
-					kernel[i]  = expf(- dist * dist / (2*param*param));
-				}
-				kernel /= cuv::sum(kernel);
-				cuvSafeCall( cudaMemcpyToSymbol(c_Kernel, kernel.ptr(), kernel.memsize()) );
-				result_type tmp(extents[src.shape()[0]][src.shape()[1]]);
-				radius_dispatch(filter_radius,tmp,src,0);
-				radius_dispatch(filter_radius,dst,tmp,1);
-			}else if(filt == SP_CENTERED_DERIVATIVE){
+			cuv::tensor<float, host_memory_space> kernel;
+			const unsigned int r = filter_kernel(kernel, filt, filter_radius, param);
+			cuvSafeCall( cudaMemcpyToSymbol(c_Kernel, kernel.ptr(), kernel.memsize()) );
+			if(filt == SP_CENTERED_DERIVATIVE){
 				cuvAssert(axis==0 || axis==1);
-				cuv::tensor<float, host_memory_space> kernel(3);
-				kernel[0]=-0.5;
-				kernel[1]= 0;
-				kernel[2]= 0.5;
-				cuvSafeCall( cudaMemcpyToSymbol(c_Kernel, kernel.ptr(), kernel.memsize()) );
-				radius_dispatch(1,dst,src,axis);
-			}else if(filt == SP_BOX){
-				const int kernel_w = 2*filter_radius+1;
-				cuv::tensor<float, host_memory_space> kernel(kernel_w);
-				cuv::fill(kernel, 1.f / kernel_w);
-				cuvSafeCall( cudaMemcpyToSymbol(c_Kernel, kernel.ptr(), kernel.memsize()) );
+				radius_dispatch(r,dst,src,axis);
+			}else{
 				result_type tmp(extents[src.shape()[0]][src.shape()[1]]);
-				radius_dispatch(filter_radius,tmp,src,0);
-				radius_dispatch(filter_radius,dst,tmp,1);
+				radius_dispatch(r,tmp,src,0);
+				radius_dispatch(r,dst,tmp,1);
 			}
+#endif
 		}
 
-		template<int Channels,class DstV, class SrcV, class M>
+		template<class DstV, class SrcV, class M>
 		void
-		convolve(       interleaved_image<Channels,DstV,M>& dst,
-			  const interleaved_image<Channels,SrcV,M>& src,
+		convolve(       tensor<DstV,M,row_major>& dst,
+			  const tensor<SrcV,M,row_major>& src,
 			  const unsigned int&   filter_radius,
 			  const separable_filter& filt, int axis, 
 			  const float& param ){
 
-			typedef interleaved_image<Channels,DstV,M> result_type;
-			typedef interleaved_image<Channels,SrcV,M>    src_type;
+			typedef tensor<DstV,M,row_major> result_type;
+                        cuvAssert(src.ndim()==2 || src.ndim()==3);
+
+			if(filt == SP_ORIENTATION_AND_MAGNITUDE){
+				std::vector<unsigned int> shape = src.shape();
+				shape.insert(shape.begin(), 2);
+				if((size_t)dst.ndim() != shape.size() || !std::equal(shape.begin(), shape.end(), dst.shape().begin()))
+					dst = result_type(shape);
+			}else if(!equal_shape(dst,src)){
+				dst = result_type(src.shape());
+			}
+			convolve_dispatch(dst,src,filter_radius,filt,axis,param);
+		}
+
+		template<int Channels,class DstV, class SrcV>
+		void
+		convolve_dispatch(       interleaved_image<Channels,DstV,host_memory_space>& dst,
+			  const interleaved_image<Channels,SrcV,host_memory_space>& src,
+			  const unsigned int&   filter_radius,
+			  const separable_filter& filt, int axis,
+			  const float& param ){
+			host_convolve(dst.tens(),src.tens(),Channels,filter_radius,filt,axis,param);
+		}
+
+		template<int Channels,class DstV, class SrcV>
+		void
+		convolve_dispatch(       interleaved_image<Channels,DstV,dev_memory_space>& dst,
+			  const interleaved_image<Channels,SrcV,dev_memory_space>& src,
+			  const unsigned int&   filter_radius,
+			  const separable_filter& filt, int axis,
+			  const float& param ){
+#ifdef CUV_NO_CUDA
+			// device memory is host memory
+			host_convolve(dst.tens(),src.tens(),Channels,filter_radius,filt,axis,param);
+#else
+			typedef interleaved_image<Channels,DstV,dev_memory_space> result_type;
 			cuvAssert(filter_radius <= MAX_KERNEL_RADIUS);
 
 			if(filt == SP_GAUSS){
-				const int kernel_w = 2*filter_radius+1;
-				cuv::tensor<float, host_memory_space> kernel(kernel_w);
-				for(int i = 0; i < kernel_w; i++){
-					float dist = (float)(i - (int)filter_radius);
-					kernel[i]  = expf(- dist * dist / (2*param*param));
-				}
-				kernel /= cuv::sum(kernel);
+				cuv::tensor<float, host_memory_space> kernel;
+				filter_kernel(kernel, filt, filter_radius, param);
 				cuvSafeCall( cudaMemcpyToSymbol(c_Kernel, kernel.ptr(), kernel.memsize()) );
 				result_type tmp(src.height(), src.width(), src.channels());
 
@@ -287,6 +392,23 @@ namespace cuv{
 				/*radius_dispatch(filter_radius,tmp,src,0);*/
 				/*radius_dispatch(filter_radius,dst,tmp,1);*/
 			}	
+#endif
+		}
+
+		template<int Channels,class DstV, class SrcV, class M>
+		void
+		convolve(       interleaved_image<Channels,DstV,M>& dst,
+			  const interleaved_image<Channels,SrcV,M>& src,
+			  const unsigned int&   filter_radius,
+			  const separable_filter& filt, int axis, 
+			  const float& param ){
+
+			typedef interleaved_image<Channels,DstV,M> result_type;
+			cuvAssert(filt != SP_ORIENTATION_AND_MAGNITUDE);
+
+			if(dst.height() != src.height() || dst.width() != src.width())
+				dst = result_type(src.height(), src.width(), src.channels());
+			convolve_dispatch(dst,src,filter_radius,filt,axis,param);
 		}
 		
 		// instantiations
@@ -304,8 +426,10 @@ namespace cuv{
 				const unsigned int&,                     \
 				const separable_filter&, int axis, \
 				const float&);
+		INST(float,float,host_memory_space);
 		INST(float,float,dev_memory_space);
 
+		INST_IL(4,float,float,host_memory_space);
 		INST_IL(4,float,float,dev_memory_space);
 	} // namespace separable convolution
 } // namespace cuv
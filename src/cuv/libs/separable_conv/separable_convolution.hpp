@@ -31,7 +31,7 @@ namespace cuv{
          *
          * @param dst result matrix
          * @param src source (image)
-         * @param radius filter radius (filter size is 2r+1 for radius r)
+         * @param radius filter radius (filter size is 2r+1 for radius r), at most 8 on the device
          * @param filt type of separable filter
          * @param axis the image dimension to apply this filter on
          * @param param optional filter parameter
@@ -52,7 +52,7 @@ namespace cuv{
          *
          * @param dst result image
          * @param src source image
-         * @param radius filter radius (filter size is 2r+1 for radius r)
+         * @param radius filter radius (filter size is 2r+1 for radius r), at most 8 on the device
          * @param filt type of separable filter
          * @param axis the image dimension to apply this filter on
          * @param param optional filter parameter
@@ -0,0 +1,308 @@
+//*LB*
+// Copyright (c) 2010, University of Bonn, Institute for Computer Science VI
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+//  * Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//  * Neither the name of the University of Bonn 
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this software without specific prior written
+//    permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//*LE*
+
+
+
+
+/**
+ * @file separable_convolution_host.cpp
+ * @brief host implementation of separable convolutions
+ * @ingroup sep_conv
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include <cuv/tools/cuv_general.hpp>
+#include <cuv/tools/thread_pool.hpp>
+#include <cuv/libs/separable_conv/separable_convolution_host.hpp>
+
+namespace cuv{ namespace sep_conv{ namespace detail{
+
+namespace{
+	/// number of rows of a tile
+	const unsigned int SEP_HOST_TILE_H = 64;
+
+	/// number of elements in a row of a tile, (SEP_HOST_TILE_H + 2r) rows of it stay in L2 cache
+	const unsigned int SEP_HOST_TILE_W = 256;
+
+	/**
+	 * dst[i] = sum_{j=-r}^{r} line[i + (r+j)*c] * k[r-j] for i in [0,n)
+	 *
+	 * line points r*c elements before the first source element of the row.
+	 *
+	 * @tparam R the radius r, or 0 to use radius
+	 */
+	template<int R>
+	void row_pass(float* dst, const float* line, unsigned int n, unsigned int c, const float* k, int radius){
+		const int r = R > 0 ? R : radius;
+		const float k0 = k[2 * r];
+		for(unsigned int i = 0; i < n; i++)
+			dst[i] = k0 * line[i];
+		for(int j = -r + 1; j <= r; j++){
+			const float kj = k[r - j];
+			const float* l = line + (r + j) * c;
+			for(unsigned int i = 0; i < n; i++)
+				dst[i] += kj * l[i];
+		}
+	}
+
+	/**
+	 * dst[i] = sum_{j=-r}^{r} rows[r+j][i] * k[r-j] for i in [0,n)
+	 *
+	 * @tparam R the radius r, or 0 to use radius
+	 */
+	template<int R>
+	void col_pass(float* dst, const float* const* rows, unsigned int n, const float* k, int radius){
+		const int r = R > 0 ? R : radius;
+		const float k0 = k[2 * r];
+		const float* l0 = rows[0];
+		for(unsigned int i = 0; i < n; i++)
+			dst[i] = k0 * l0[i];
+		for(int j = -r + 1; j <= r; j++){
+			const float kj = k[r - j];
+			const float* l = rows[r + j];
+			for(unsigned int i = 0; i < n; i++)
+				dst[i] += kj * l[i];
+		}
+	}
+
+	typedef void (*row_pass_t)(float*, const float*, unsigned int, unsigned int, const float*, int);
+	typedef void (*col_pass_t)(float*, const float* const*, unsigned int, const float*, int);
+
+	/// @return the row pass specialized for radius
+	row_pass_t row_pass_for(unsigned int radius){
+		switch(radius){
+			case 1: return row_pass<1>;
+			case 2: return row_pass<2>;
+			case 3: return row_pass<3>;
+			case 4: return row_pass<4>;
+			case 5: return row_pass<5>;
+			case 6: return row_pass<6>;
+			case 7: return row_pass<7>;
+			case 8: return row_pass<8>;
+			default: return row_pass<0>;
+		}
+	}
+
+	/// @return the column pass specialized for radius
+	col_pass_t col_pass_for(unsigned int radius){
+		switch(radius){
+			case 1: return col_pass<1>;
+			case 2: return col_pass<2>;
+			case 3: return col_pass<3>;
+			case 4: return col_pass<4>;
+			case 5: return col_pass<5>;
+			case 6: return col_pass<6>;
+			case 7: return col_pass<7>;
+			case 8: return col_pass<8>;
+			default: return col_pass<0>;
+		}
+	}
+
+	/**
+	 * filters tiles of SEP_HOST_TILE_H rows and SEP_HOST_TILE_W elements,
+	 * used by parallel_tasks. Task t is tile t % tiles_per_image of image
+	 * t / tiles_per_image.
+	 */
+	struct sep_conv_tasks{
+		float* dst;
+		const float* src;
+		const host_sep_geometry& g;
+		const float* row_kernel;
+		unsigned int row_radius;
+		const float* col_kernel;
+		unsigned int col_radius;
+		unsigned int n_tx, n_ty; ///< number of tiles along x and y
+		row_pass_t rowf;
+		col_pass_t colf;
+
+		sep_conv_tasks(float* _dst, const float* _src, const host_sep_geometry& _g,
+				const float* rk, unsigned int rr, const float* ck, unsigned int cr)
+			:dst(_dst), src(_src), g(_g), row_kernel(rk), row_radius(rr), col_kernel(ck), col_radius(cr)
+		{
+			n_tx = (g.w + SEP_HOST_TILE_W - 1) / SEP_HOST_TILE_W;
+			n_ty = (g.h + SEP_HOST_TILE_H - 1) / SEP_HOST_TILE_H;
+			rowf = row_pass_for(rr);
+			colf = col_pass_for(cr);
+		}
+
+		size_t n_tasks()const{ return (size_t)g.n * n_tx * n_ty; }
+
+		/**
+		 * row pass over the elements [x0,x0+n) of a source row.
+		 *
+		 * line is a buffer of n + 2*pad elements, used if the filter
+		 * reaches beyond the borders of the row.
+		 */
+		void filter_row(float* out, const float* srow, unsigned int x0, unsigned int n, float* line)const{
+			const unsigned int pad = row_radius * g.channels;
+			const float* l;
+			if(x0 >= pad && x0 + n + pad <= g.w)
+				l = srow + x0 - pad;
+			else{
+				// copy [x0-pad, x0+n+pad) of the row, zero outside of it
+				const int begin = (int)x0 - (int)pad;
+				const int end   = (int)(x0 + n + pad);
+				const int cb    = std::max(begin, 0);
+				const int ce    = std::min(end, (int)g.w);
+				std::fill(line, line + (cb - begin), 0.f);
+				std::copy(srow + cb, srow + ce, line + (cb - begin));
+				std::fill(line + (ce - begin), line + (end - begin), 0.f);
+				l = line;
+			}
+			rowf(out, l, n, g.channels, row_kernel, row_radius);
+		}
+
+		void operator()(size_t begin, size_t end)const{
+			const unsigned int halo = col_kernel ? col_radius : 0;
+			const unsigned int pad  = row_kernel ? row_radius * g.channels : 0;
+			std::vector<float> line(SEP_HOST_TILE_W + 2 * pad);
+			std::vector<float> buf(row_kernel && col_kernel ? (SEP_HOST_TILE_H + 2 * halo) * SEP_HOST_TILE_W : 1);
+			std::vector<float> zeros(SEP_HOST_TILE_W, 0.f);
+			std::vector<const float*> rows(SEP_HOST_TILE_H + 2 * halo);
+
+			for(size_t t = begin; t < end; t++){
+				const unsigned int img = t / (n_tx * n_ty);
+				const unsigned int ty  = (t / n_tx) % n_ty;
+				const unsigned int tx  = t % n_tx;
+				const unsigned int y0  = ty * SEP_HOST_TILE_H;
+				const unsigned int y1  = std::min(g.h, y0 + SEP_HOST_TILE_H);
+				const unsigned int x0  = tx * SEP_HOST_TILE_W;
+				const unsigned int nx  = std::min(g.w, x0 + SEP_HOST_TILE_W) - x0;
+				const float* s = src + (size_t)img * g.src_stride;
+				float*       d = dst + (size_t)img * g.dst_stride;
+
+				if(!col_kernel){
+					// only filter rows, directly into dst
+					for(unsigned int y = y0; y < y1; y++)
+						filter_row(d + (size_t)y * g.dst_pitch + x0, s + (size_t)y * g.src_pitch, x0, nx, &line[0]);
+					continue;
+				}
+
+				// rows y0-halo .. y1+halo after the row pass (or of the source)
+				for(unsigned int k = 0; k < y1 - y0 + 2 * halo; k++){
+					const int y = (int)(y0 + k) - (int)halo;
+					if(y < 0 || y >= (int)g.h)
+						rows[k] = &zeros[0];
+					else if(!row_kernel)
+						rows[k] = s + (size_t)y * g.src_pitch + x0;
+					else{
+						float* b = &buf[(size_t)k * SEP_HOST_TILE_W];
+						filter_row(b, s + (size_t)y * g.src_pitch, x0, nx, &line[0]);
+						rows[k] = b;
+					}
+				}
+				for(unsigned int y = y0; y < y1; y++)
+					colf(d + (size_t)y * g.dst_pitch + x0, &rows[y - y0], nx, col_kernel, col_radius);
+			}
+		}
+	};
+
+	/**
+	 * gradient orientation and magnitude of a range of rows of all images,
+	 * used by parallel_for.
+	 */
+	struct orientation_rows{
+		float* angle;
+		float* magnitude;
+		const float* src;
+		const host_sep_geometry& g;
+
+		orientation_rows(float* a, float* m, const float* s, const host_sep_geometry& _g)
+			:angle(a), magnitude(m), src(s), g(_g){}
+
+		void operator()(size_t begin, size_t end)const{
+			const unsigned int c = g.channels;
+			std::vector<float> gx(g.w), gy(g.w), zeros(g.w, 0.f);
+			for(size_t r = begin; r < end; r++){
+				const unsigned int img = r / g.h;
+				const unsigned int y   = r % g.h;
+				const float* s  = src + (size_t)img * g.src_stride + (size_t)y * g.src_pitch;
+				const size_t dofs = (size_t)img * g.dst_stride + (size_t)y * g.dst_pitch;
+
+				// centered derivatives, zero outside of the image
+				for(unsigned int x = 0; x < g.w; x++){
+					const float left  = x >= c      ? s[x - c] : 0.f;
+					const float right = x + c < g.w ? s[x + c] : 0.f;
+					gx[x] = 0.5f * (right - left);
+				}
+				const float* up   = y > 0       ? s - g.src_pitch : &zeros[0];
+				const float* down = y + 1 < g.h ? s + g.src_pitch : &zeros[0];
+				for(unsigned int x = 0; x < g.w; x++)
+					gy[x] = 0.5f * (down[x] - up[x]);
+
+				float* a = angle + dofs;
+				float* m = magnitude + dofs;
+				for(unsigned int x = 0; x < g.w; x++){
+					float phi = atan2f(gy[x], gx[x]);
+					if(phi < 0)
+						phi += (float)M_PI;
+					a[x] = phi;
+					m[x] = sqrtf(gx[x] * gx[x] + gy[x] * gy[x]);
+				}
+			}
+		}
+	};
+}
+
+void host_separable_convolve(float* dst, const float* src, const host_sep_geometry& g,
+		const float* row_kernel, unsigned int row_radius,
+		const float* col_kernel, unsigned int col_radius){
+	cuvAssert(dst != src);
+	cuvAssert(g.channels > 0);
+	if(g.n == 0 || g.h == 0 || g.w == 0)
+		return;
+	if(!row_kernel && !col_kernel){
+		for(unsigned int i = 0; i < g.n; i++)
+			for(unsigned int y = 0; y < g.h; y++)
+				std::memcpy(dst + (size_t)i * g.dst_stride + (size_t)y * g.dst_pitch,
+				            src + (size_t)i * g.src_stride + (size_t)y * g.src_pitch, g.w * sizeof(float));
+		return;
+	}
+	sep_conv_tasks task(dst, src, g, row_kernel, row_radius, col_kernel, col_radius);
+	const size_t taps = (row_kernel ? 2 * row_radius + 1 : 0) + (col_kernel ? 2 * col_radius + 1 : 0);
+	if((size_t)g.n * g.h * g.w * taps < get_host_parallel_threshold())
+		task(0, task.n_tasks());
+	else
+		parallel_tasks(task.n_tasks(), task);
+}
+
+void host_orientation_and_magnitude(float* angle, float* magnitude, const float* src,
+		const host_sep_geometry& g){
+	cuvAssert(g.channels > 0);
+	orientation_rows rows(angle, magnitude, src, g);
+	const size_t n_rows = (size_t)g.n * g.h;
+	if(n_rows * g.w < get_host_parallel_threshold())
+		rows(0, n_rows);
+	else
+		parallel_tasks(n_rows, rows);
+}
+
+} } }
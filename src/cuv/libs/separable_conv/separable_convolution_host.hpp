@@ -0,0 +1,88 @@
+//*LB*
+// Copyright (c) 2010, University of Bonn, Institute for Computer Science VI
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+//  * Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//  * Neither the name of the University of Bonn 
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this software without specific prior written
+//    permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//*LE*
+
+
+
+
+/**
+ * @file separable_convolution_host.hpp
+ * @brief host (CPU) implementation of the separable convolutions in separable_convolution.hpp
+ * @ingroup sep_conv
+ *
+ * Images are divided into tiles of rows and columns. For a tile, the row
+ * filter is applied to the rows needed by the column filter, the result is
+ * kept in a buffer which fits into L2 cache and filtered along the columns.
+ * Both passes are vectorized over the pixels of a row, the filter radius is
+ * a template parameter. Tiles of all images are processed on the host
+ * thread pool.
+ */
+#ifndef __SEPARABLE_CONVOLUTION_HOST_HPP__
+#define __SEPARABLE_CONVOLUTION_HOST_HPP__
+
+namespace cuv{ namespace sep_conv{ namespace detail{
+
+/**
+ * geometry of a stack of n row-major images.
+ *
+ * Elements of a row are contiguous, interleaved images with c channels
+ * have rows of c times their width elements.
+ */
+struct host_sep_geometry{
+	unsigned int n;             ///< number of images
+	unsigned int h;             ///< height of an image
+	unsigned int w;             ///< number of elements in a row (width times channels)
+	unsigned int channels;      ///< distance of horizontally neighbouring pixels (in elements)
+	int src_pitch, dst_pitch;   ///< distance of rows (in elements)
+	int src_stride, dst_stride; ///< distance of images (in elements)
+};
+
+/**
+ * dst = src filtered along rows with row_kernel, then along columns with col_kernel.
+ *
+ * A kernel has 2r+1 coefficients for radius r, and
+ * dst[x] = sum_{j=-r}^{r} src[x+j] * kernel[r-j], where pixels outside of
+ * the image are zero. Either kernel may be NULL to skip its pass. dst and
+ * src must not overlap.
+ */
+void host_separable_convolve(float* dst, const float* src, const host_sep_geometry& g,
+		const float* row_kernel, unsigned int row_radius,
+		const float* col_kernel, unsigned int col_radius);
+
+/**
+ * gradient orientation (in [0,pi], disregarding polarity) and magnitude.
+ *
+ * The gradient is determined with centered derivatives, pixels outside of
+ * the image are zero. angle and magnitude use the pitch and stride of dst.
+ */
+void host_orientation_and_magnitude(float* angle, float* magnitude, const float* src,
+		const host_sep_geometry& g);
+
+} } }
+
+#endif /* __SEPARABLE_CONVOLUTION_HOST_HPP__ */
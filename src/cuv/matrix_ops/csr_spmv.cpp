@@ -0,0 +1,379 @@
+//*LB*
+// Copyright (c) 2010, University of Bonn, Institute for Computer Science VI
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+//  * Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//  * Neither the name of the University of Bonn 
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this software without specific prior written
+//    permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//*LE*
+
+
+
+
+/**
+ * @file csr_spmv.cpp
+ * @brief multi-threaded host products of CSR and BSR matrices with dense matrices and vectors
+ * @ingroup blas3
+ */
+#include <algorithm>
+#include <vector>
+#include <cuv/basics/csr_matrix.hpp>
+#include <cuv/basics/bsr_matrix.hpp>
+#include <cuv/matrix_ops/matrix_ops.hpp>
+#include <cuv/tools/thread_pool.hpp>
+
+#define CSR_HOST_COLS       4   // number of columns of B processed together on the host
+#define CSR_TASKS_PER_THREAD 4  // number of row ranges per thread, the pool balances the rest
+
+namespace cuv{
+	namespace csr_impl{
+		/**
+		 * operands of C = factC * C + factAB * A * B.
+		 *
+		 * B and C are dense and given by their base pointer and the strides
+		 * (in elements) between consecutive rows and columns, which covers
+		 * both memory layouts as well as vectors.
+		 */
+		template<class value_type>
+			struct dense_operands{
+				const value_type* B;
+				std::ptrdiff_t brs, bcs;
+				value_type* C;
+				std::ptrdiff_t crs, ccs;
+				unsigned int n_cols;
+				value_type factAB, factC;
+			};
+
+		/// C(r,k) = factC * C(r,k) + factAB * acc[k] for k < nb
+		template<class value_type>
+			inline void store_row(value_type* c, std::ptrdiff_t ccs, const value_type* acc, unsigned int nb, const value_type& factAB, const value_type& factC){
+				if(factC == (value_type)0)
+					for(unsigned int k = 0; k < nb; k++)
+						c[k*ccs] = factAB * acc[k];
+				else
+					for(unsigned int k = 0; k < nb; k++)
+						c[k*ccs] = factC * c[k*ccs] + factAB * acc[k];
+			}
+
+		/**
+		 * rows [r0,r1) of C for NB columns of B, starting at column c0.
+		 */
+		template<int NB, class value_type, class index_type>
+			void csr_rows(const value_type* vals, const index_type* row_ptr, const index_type* col_idx,
+					const dense_operands<value_type>& o, unsigned int c0, index_type r0, index_type r1){
+				const value_type* B = o.B + c0 * o.bcs;
+				value_type*       C = o.C + c0 * o.ccs;
+				const std::ptrdiff_t brs = o.brs, bcs = o.bcs;
+				value_type acc[NB];
+				for(index_type r = r0; r < r1; r++){
+					for(int k = 0; k < NB; k++)
+						acc[k] = 0;
+					const index_type end = row_ptr[r+1];
+					for(index_type p = row_ptr[r]; p < end; p++){
+						const value_type  a = vals[p];
+						const value_type* b = B + col_idx[p] * brs;
+						for(int k = 0; k < NB; k++)
+							acc[k] += a * b[k*bcs];
+					}
+					store_row(C + r * o.crs, o.ccs, acc, NB, o.factAB, o.factC);
+				}
+			}
+
+		/**
+		 * block rows [r0,r1) of C for NB columns of B, starting at column c0.
+		 *
+		 * @param acc scratch space for bh*NB values
+		 */
+		template<int NB, class value_type, class index_type>
+			void bsr_rows(const value_type* vals, const index_type* row_ptr, const index_type* col_idx,
+					index_type bh, index_type bw, const dense_operands<value_type>& o, unsigned int c0,
+					index_type r0, index_type r1, value_type* acc){
+				const value_type* B = o.B + c0 * o.bcs;
+				value_type*       C = o.C + c0 * o.ccs;
+				const std::ptrdiff_t brs = o.brs, bcs = o.bcs;
+				const index_type bs = bh * bw;
+				for(index_type r = r0; r < r1; r++){
+					std::fill(acc, acc + bh*NB, (value_type)0);
+					const index_type end = row_ptr[r+1];
+					for(index_type p = row_ptr[r]; p < end; p++){
+						const value_type* blk = vals + p * bs;
+						const value_type* b0  = B + col_idx[p] * bw * brs;
+						for(index_type i = 0; i < bh; i++){
+							value_type* ai = acc + i*NB;
+							for(index_type j = 0; j < bw; j++){
+								const value_type  a = blk[i*bw + j];
+								const value_type* b = b0 + j * brs;
+								for(int k = 0; k < NB; k++)
+									ai[k] += a * b[k*bcs];
+							}
+						}
+					}
+					for(index_type i = 0; i < bh; i++)
+						store_row(C + (r*bh + i) * o.crs, o.ccs, acc + i*NB, NB, o.factAB, o.factC);
+				}
+			}
+
+		/**
+		 * splits the (block) rows into ranges of about equal cost.
+		 *
+		 * The cost of a row is its number of stored entries plus one, so that
+		 * a few dense rows do not end up in a single task and empty rows are
+		 * not free.
+		 *
+		 * @param row_ptr the row pointers (n_rows+1 entries)
+		 * @param n_rows  number of rows
+		 * @param n_tasks maximum number of ranges
+		 * @param bounds  receives the first row of every range and n_rows
+		 */
+		template<class index_type>
+			void balanced_rows(const index_type* row_ptr, index_type n_rows, size_t n_tasks, std::vector<index_type>& bounds){
+				const size_t total = (size_t)row_ptr[n_rows] - row_ptr[0] + n_rows;
+				bounds.clear();
+				bounds.push_back(0);
+				for(size_t t = 1; t < n_tasks; t++){
+					const size_t target = total * t / n_tasks;
+					// first row r with cost(0..r) >= target
+					index_type lo = bounds.back(), hi = n_rows;
+					while(lo < hi){
+						index_type mid = lo + (hi - lo) / 2;
+						if((size_t)row_ptr[mid] - row_ptr[0] + mid < target) lo = mid + 1;
+						else                                                 hi = mid;
+					}
+					if(lo > bounds.back() && lo < n_rows)
+						bounds.push_back(lo);
+				}
+				bounds.push_back(n_rows);
+			}
+
+		/**
+		 * processes row ranges of a CSR or BSR product (one task per range)
+		 */
+		template<class value_type, class index_type>
+			struct sparse_rows_task{
+				const value_type* vals;
+				const index_type* row_ptr;
+				const index_type* col_idx;
+				index_type bh, bw; ///< block size, 1x1 for CSR
+				const dense_operands<value_type>& o;
+				const std::vector<index_type>& bounds;
+				sparse_rows_task(const value_type* _vals, const index_type* _row_ptr, const index_type* _col_idx,
+						index_type _bh, index_type _bw, const dense_operands<value_type>& _o, const std::vector<index_type>& _bounds)
+					:vals(_vals),row_ptr(_row_ptr),col_idx(_col_idx),bh(_bh),bw(_bw),o(_o),bounds(_bounds){}
+				void operator()(size_t begin, size_t end){
+					if(bh == 1 && bw == 1){
+						for(size_t t = begin; t < end; t++){
+							unsigned int c = 0;
+							for(; c + CSR_HOST_COLS <= o.n_cols; c += CSR_HOST_COLS)
+								csr_rows<CSR_HOST_COLS>(vals, row_ptr, col_idx, o, c, bounds[t], bounds[t+1]);
+							for(; c < o.n_cols; c++)
+								csr_rows<1>(vals, row_ptr, col_idx, o, c, bounds[t], bounds[t+1]);
+						}
+						return;
+					}
+					std::vector<value_type> acc(bh * CSR_HOST_COLS);
+					for(size_t t = begin; t < end; t++){
+						unsigned int c = 0;
+						for(; c + CSR_HOST_COLS <= o.n_cols; c += CSR_HOST_COLS)
+							bsr_rows<CSR_HOST_COLS>(vals, row_ptr, col_idx, bh, bw, o, c, bounds[t], bounds[t+1], &acc[0]);
+						for(; c < o.n_cols; c++)
+							bsr_rows<1>(vals, row_ptr, col_idx, bh, bw, o, c, bounds[t], bounds[t+1], &acc[0]);
+					}
+				}
+			};
+
+		/**
+		 * C = factC * C + factAB * A * B where A is given in (block) CSR format.
+		 *
+		 * The rows are split into ranges of equal cost (see balanced_rows),
+		 * which are processed in parallel on the host thread pool.
+		 */
+		template<class value_type, class index_type>
+			void sparse_prod_host(const value_type* vals, const index_type* row_ptr, const index_type* col_idx,
+					index_type n_block_rows, index_type bh, index_type bw, index_type nnz, const dense_operands<value_type>& o){
+				if(n_block_rows == 0 || o.n_cols == 0)
+					return;
+				const size_t work = ((size_t)nnz + n_block_rows * bh) * o.n_cols;
+				const unsigned int n_threads = work < get_host_parallel_threshold() ? 1 : detail::host_thread_limit(0);
+				std::vector<index_type> bounds;
+				balanced_rows(row_ptr, n_block_rows, n_threads < 2 ? 1 : n_threads * CSR_TASKS_PER_THREAD, bounds);
+				sparse_rows_task<value_type,index_type> task(vals, row_ptr, col_idx, bh, bw, o, bounds);
+				if(bounds.size() < 3)
+					task(0, bounds.size() - 1);
+				else
+					parallel_tasks(bounds.size() - 1, task);
+			}
+
+		/**
+		 * the structure of the transpose of a (block) CSR matrix with n_rows
+		 * (block) rows and n_cols (block) columns, computed by a counting sort
+		 * of the column indices in O(nnz + n_cols).
+		 *
+		 * @param perm receives for every entry of the transpose the position of the entry in the original matrix
+		 */
+		template<class index_type>
+			void transpose_structure(const index_type* row_ptr, const index_type* col_idx, index_type n_rows, index_type n_cols,
+					std::vector<index_type>& t_row_ptr, std::vector<index_type>& t_col_idx, std::vector<index_type>& perm){
+				const index_type nnz = row_ptr[n_rows];
+				t_row_ptr.assign(n_cols + 1, 0);
+				t_col_idx.resize(nnz);
+				perm.resize(nnz);
+				for(index_type p = 0; p < nnz; p++)
+					t_row_ptr[col_idx[p] + 1]++;
+				for(index_type c = 0; c < n_cols; c++)
+					t_row_ptr[c+1] += t_row_ptr[c];
+				std::vector<index_type> next(t_row_ptr.begin(), t_row_ptr.end() - 1);
+				for(index_type r = 0; r < n_rows; r++)
+					for(index_type p = row_ptr[r]; p < row_ptr[r+1]; p++){
+						const index_type q = next[col_idx[p]]++;
+						t_col_idx[q] = r;
+						perm[q]      = p;
+					}
+			}
+
+		template<class value_type, class index_type>
+			void prod(const csr_matrix<value_type,host_memory_space,index_type>& A, char transA, const dense_operands<value_type>& o){
+				if(transA != 't'){
+					sparse_prod_host(A.vals().ptr(), A.row_ptr().ptr(), A.col_idx().ptr(), A.h(), (index_type)1, (index_type)1, A.nnz(), o);
+					return;
+				}
+				std::vector<index_type> t_row_ptr, t_col_idx, perm;
+				transpose_structure(A.row_ptr().ptr(), A.col_idx().ptr(), A.h(), A.w(), t_row_ptr, t_col_idx, perm);
+				const value_type* vals = A.vals().ptr();
+				// one spare element, so that the vectors can be dereferenced when empty
+				std::vector<value_type> t_vals(A.nnz() + 1);
+				for(index_type q = 0; q < A.nnz(); q++)
+					t_vals[q] = vals[perm[q]];
+				t_col_idx.resize(A.nnz() + 1);
+				sparse_prod_host(&t_vals[0], &t_row_ptr[0], &t_col_idx[0], A.w(), (index_type)1, (index_type)1, A.nnz(), o);
+			}
+
+		template<class value_type, class index_type>
+			void prod(const bsr_matrix<value_type,host_memory_space,index_type>& A, char transA, const dense_operands<value_type>& o){
+				const index_type bh = A.block_h(), bw = A.block_w();
+				if(transA != 't'){
+					sparse_prod_host(A.vals().ptr(), A.row_ptr().ptr(), A.col_idx().ptr(), A.num_block_rows(), bh, bw, A.nnz(), o);
+					return;
+				}
+				std::vector<index_type> t_row_ptr, t_col_idx, perm;
+				transpose_structure(A.row_ptr().ptr(), A.col_idx().ptr(), A.num_block_rows(), A.w() / bw, t_row_ptr, t_col_idx, perm);
+				// the transpose consists of the transposed blocks
+				const value_type* vals = A.vals().ptr();
+				const index_type bs = A.block_size();
+				std::vector<value_type> t_vals(A.nnz() + 1);
+				for(index_type q = 0; q < A.nnzb(); q++){
+					const value_type* src = vals + perm[q] * bs;
+					value_type*       dst = &t_vals[q * bs];
+					for(index_type i = 0; i < bw; i++)
+						for(index_type j = 0; j < bh; j++)
+							dst[i*bh + j] = src[j*bw + i];
+				}
+				t_col_idx.resize(A.nnzb() + 1);
+				sparse_prod_host(&t_vals[0], &t_row_ptr[0], &t_col_idx[0], A.w() / bw, bw, bh, A.nnz(), o);
+			}
+
+		/// strides of a dense host matrix
+		template<class value_type>
+			void set_strides(const tensor<value_type,host_memory_space,column_major>& m, std::ptrdiff_t& rs, std::ptrdiff_t& cs){
+				rs = 1;
+				cs = m.shape()[0];
+			}
+		/// strides of a dense host matrix
+		template<class value_type>
+			void set_strides(const tensor<value_type,host_memory_space,row_major>& m, std::ptrdiff_t& rs, std::ptrdiff_t& cs){
+				rs = m.shape()[1];
+				cs = 1;
+			}
+
+		template<class value_type, class L, class Mat>
+			void prod(tensor<value_type,host_memory_space,L>& C, const Mat& A, const tensor<value_type,host_memory_space,L>& B, char transA, char transB, const float& factAB, const float& factC){
+				cuvAssert(C.ndim() == 2);
+				cuvAssert(B.ndim() == 2);
+				cuvAssert(transB == 'n');
+				cuvAssert(C.shape()[1] == B.shape()[1]);
+				if(transA == 't'){
+					cuvAssert(A.w() == C.shape()[0]);
+					cuvAssert(A.h() == B.shape()[0]);
+				}else{
+					cuvAssert(A.h() == C.shape()[0]);
+					cuvAssert(A.w() == B.shape()[0]);
+				}
+				dense_operands<value_type> o;
+				o.B = B.ptr();
+				o.C = C.ptr();
+				set_strides(B, o.brs, o.bcs);
+				set_strides(C, o.crs, o.ccs);
+				o.n_cols = C.shape()[1];
+				o.factAB = factAB;
+				o.factC  = factC;
+				prod(A, transA, o);
+			}
+
+		template<class value_type, class Mat>
+			void spmv(tensor<value_type,host_memory_space>& dst, const Mat& A, const tensor<value_type,host_memory_space>& v, char transA, const float& factAv, const float& factC){
+				if(transA == 't'){
+					cuvAssert(A.h() == v.size());
+					cuvAssert(A.w() == dst.size());
+				}else{
+					cuvAssert(A.w() == v.size());
+					cuvAssert(A.h() == dst.size());
+				}
+				dense_operands<value_type> o;
+				o.B = v.ptr();
+				o.C = dst.ptr();
+				o.brs = o.crs = 1;
+				o.bcs = o.ccs = 0;
+				o.n_cols = 1;
+				o.factAB = factAv;
+				o.factC  = factC;
+				prod(A, transA, o);
+			}
+	}
+
+	template<class V, class M, class L>
+		void prod(tensor<V,M,L>& C, const csr_matrix<V,M>& A, const tensor<V,M,L>& B, char transA, char transB, const float& factAB, const float& factC){
+			csr_impl::prod(C, A, B, transA, transB, factAB, factC);
+		}
+	template<class V, class M, class L>
+		void prod(tensor<V,M,L>& C, const bsr_matrix<V,M>& A, const tensor<V,M,L>& B, char transA, char transB, const float& factAB, const float& factC){
+			csr_impl::prod(C, A, B, transA, transB, factAB, factC);
+		}
+	template<class V, class M>
+		void spmv(tensor<V,M>& dst, const csr_matrix<V,M>& A, const tensor<V,M>& v, char transA, const float& factAv, const float& factC){
+			csr_impl::spmv(dst, A, v, transA, factAv, factC);
+		}
+	template<class V, class M>
+		void spmv(tensor<V,M>& dst, const bsr_matrix<V,M>& A, const tensor<V,M>& v, char transA, const float& factAv, const float& factC){
+			csr_impl::spmv(dst, A, v, transA, factAv, factC);
+		}
+
+#define CSR_PROD_INST(V,L) \
+	template void prod(tensor<V,host_memory_space,L>&, const csr_matrix<V,host_memory_space>&, const tensor<V,host_memory_space,L>&, char, char, const float&, const float&); \
+	template void prod(tensor<V,host_memory_space,L>&, const bsr_matrix<V,host_memory_space>&, const tensor<V,host_memory_space,L>&, char, char, const float&, const float&);
+#define CSR_SPMV_INST(V) \
+	template void spmv(tensor<V,host_memory_space>&, const csr_matrix<V,host_memory_space>&, const tensor<V,host_memory_space>&, char, const float&, const float&); \
+	template void spmv(tensor<V,host_memory_space>&, const bsr_matrix<V,host_memory_space>&, const tensor<V,host_memory_space>&, char, const float&, const float&);
+
+	CSR_PROD_INST(float,column_major);
+	CSR_PROD_INST(float,row_major);
+	CSR_SPMV_INST(float);
+}
@@ -28,12 +28,17 @@
 //*LE*
 
 
+#include <algorithm>
 #include <cmath>
 #include <iostream>
+#include <vector>
+#ifndef CUV_NO_CUDA
 #include <thrust/device_ptr.h>
 #include <thrust/host_vector.h>
+#endif
 #include <cuv/basics/tensor.hpp>
 #include <cuv/matrix_ops/densedense_to_sparse.hpp>
+#include <cuv/tools/thread_pool.hpp>
 
 // stuff from NVIDIA SDK
 #define DIVIDE_INTO(x,y) ((x + y - 1)/y)
@@ -44,9 +49,13 @@
 #define BS(i, j) Bs[i][j]
 
 #define BLOCKS_LARGE_GRID_Y 4
+#define DD2DIA_HOST_TILE     256  // number of rows of C processed together on the host
+#define DD2DIA_HOST_DIAS     16   // number of diagonals of C processed together on the host
+#define DD2DIA_HOST_COLS     64   // number of columns of A and B applied to all diagonals of a task at once
 
 using namespace std;
 
+#ifndef CUV_NO_CUDA
 // multiply two dense matrices and put the result in an existing sparse DIA-formated matrix
 template <bool wantFactAB, bool wantFactC, class value_type, class index_type>                                                                        
 __global__                                                                                                            
@@ -118,12 +127,18 @@ dense2dia_mm( value_type* C, const value_type* A, const value_type* B, index_typ
 			C[ idx ]  = Csub;
 	}
 }   
+#endif /* CUV_NO_CUDA */
 
 namespace cuv{
 	template<class V, class I>
 		dev_block_descriptor<V,I>::dev_block_descriptor(const diamat_type& mat)
 		{
 			m_blocks.ptr = NULL;
+#ifdef CUV_NO_CUDA
+			// densedense_to_dia uses the host implementation, which needs no blocks
+			(void)mat;
+			m_blocks.len = 0;
+#else
 			thrust::host_vector<int> dia_offsets(
 					thrust::device_ptr<const int>(mat.get_offsets().ptr()),
 					thrust::device_ptr<const int>(mat.get_offsets().ptr()+mat.get_offsets().size()));
@@ -168,15 +183,19 @@ namespace cuv{
 			m_blocks.len = blocks.size();
 			/*cout << "Final Block-Set  Ptr: "<< m_blocks.ptr<<endl;*/
 			/*cout << "Final Block-Set Size: "<< blocks.size()<<endl;*/
+#endif /* CUV_NO_CUDA */
 		}
 	template<class V,class I>
 		dev_block_descriptor<V,I>::~dev_block_descriptor(){
+#ifndef CUV_NO_CUDA
 			if(m_blocks.ptr)
 				cuvSafeCall(cudaFree(m_blocks.ptr));
+#endif
 			m_blocks.ptr = NULL;
 		}
 
 	namespace densedense_to_dia_impl{
+#ifndef CUV_NO_CUDA
 		/*
 		 *  For a given number of blocks, return a 2D grid large enough to contain them
 		 *  FROM NVIDIA SDK
@@ -201,12 +220,142 @@ namespace cuv{
 				return dim3(side,side);
 			}
 		}
-		template<class value_type, class index_type>
-			void densedense_to_dia(
-					dia_matrix<value_type,host_memory_space,index_type>& dst,
-					const host_block_descriptor<value_type,index_type>& bd,
-					const tensor<value_type,cuv::host_memory_space,column_major>& A,
-					const tensor<value_type,cuv::host_memory_space,column_major>& B,
+#endif /* CUV_NO_CUDA */
+
+		/**
+		 * adds the products of the columns [l0,l1) of A and B to the rows [r0,r1) of the diagonals [d0,d1) of C = A * B^T.
+		 *
+		 * The sums are accumulated in acc, which holds tile values for every
+		 * diagonal (indexed by row-r0). The inner loop runs along a
+		 * diagonal, which is contiguous in the columns of A and B. RF is
+		 * the row factor of C, or zero if it is only known at runtime; for
+		 * a fixed RF, one element of B is loaded for RF rows.
+		 *
+		 * M is host_memory_space, or dev_memory_space if CUV is built without CUDA.
+		 */
+		template<int RF, class value_type, class M, class index_type>
+			void dd2dia_host_tile(const dia_matrix<value_type,M,index_type>& C,
+					const value_type* A, int Ah, const value_type* B, int Bh,
+					int l0, int l1, int d0, int d1, int r0, int r1, int tile, value_type* acc){
+				const int Ch = C.h(), Cw = C.w();
+				const int rf = RF ? RF : C.row_fact();
+				for(int dia = d0; dia < d1; dia++){
+					const int k = C.get_offset(dia);  //diagonal offset
+					const int row_start = rf*std::max((int)0,-k);
+					const int col_start =  1*std::max((int)0, k);
+					const int N  = std::min(Ch - row_start, rf*(Cw - col_start));
+					const int lo = std::max(r0, row_start);
+					const int hi = std::min(r1, row_start + N);
+					if(lo >= hi)
+						continue;
+					// s is indexed by the row, b by the row relative to the start of the diagonal divided by rf
+					value_type* s = acc + (dia-d0)*tile - r0;
+					for(int l = l0; l < l1; l++){
+						const value_type* a = A + l*Ah;
+						const value_type* b = B + l*Bh + col_start;
+						if(RF == 1){
+							for(int r = lo; r < hi; r++)
+								s[r] += a[r] * b[r - row_start];
+							continue;
+						}
+						int r = lo;
+						for(; r < hi && (r - row_start) % rf; r++)
+							s[r] += a[r] * b[(r - row_start) / rf];
+						const int nb = (hi - r) / rf;
+						value_type*       sp = s + r;
+						const value_type* ap = a + r;
+						const value_type* bp = b + (r - row_start) / rf;
+						for(int g = 0; g < nb; g++, sp += rf, ap += rf){
+							const value_type bv = bp[g];
+							for(int q = 0; q < rf; q++)
+								sp[q] += ap[q] * bv;
+						}
+						r += nb * rf;
+						for(; r < hi; r++)
+							s[r] += a[r] * b[(r - row_start) / rf];
+					}
+				}
+			}
+
+		/// selects the specialization of dd2dia_host_tile for the row factor of C
+		template<class value_type, class M, class index_type>
+			void dd2dia_host_tile(const dia_matrix<value_type,M,index_type>& C,
+					const value_type* A, int Ah, const value_type* B, int Bh,
+					int l0, int l1, int d0, int d1, int r0, int r1, int tile, value_type* acc){
+				switch(C.row_fact()){
+					case 1:  dd2dia_host_tile<1>(C,A,Ah,B,Bh,l0,l1,d0,d1,r0,r1,tile,acc); break;
+					case 2:  dd2dia_host_tile<2>(C,A,Ah,B,Bh,l0,l1,d0,d1,r0,r1,tile,acc); break;
+					case 3:  dd2dia_host_tile<3>(C,A,Ah,B,Bh,l0,l1,d0,d1,r0,r1,tile,acc); break;
+					case 4:  dd2dia_host_tile<4>(C,A,Ah,B,Bh,l0,l1,d0,d1,r0,r1,tile,acc); break;
+					default: dd2dia_host_tile<0>(C,A,Ah,B,Bh,l0,l1,d0,d1,r0,r1,tile,acc); break;
+				}
+			}
+
+		/**
+		 * computes the diagonals of C = factC * C + factAB * A * B^T for
+		 * tiles of rows and groups of diagonals, used by parallel_tasks.
+		 *
+		 * Within a task, blocks of DD2DIA_HOST_COLS columns of A and B are
+		 * applied to all diagonals of the group before moving on, so the
+		 * block of A stays in cache and the neighbouring diagonals share
+		 * most of the rows of B they read.
+		 */
+		template<class value_type, class M, class index_type>
+			struct dd2dia_host_tasks{
+				dia_matrix<value_type,M,index_type>& C;
+				const value_type* A;
+				const value_type* B;
+				int Ah, Bh, K, n_tiles;
+				value_type factAB, factC;
+				dd2dia_host_tasks(dia_matrix<value_type,M,index_type>& _C,
+						const value_type* _A, int _Ah, const value_type* _B, int _Bh, int _K, int _n_tiles,
+						const value_type& _factAB, const value_type& _factC)
+					:C(_C),A(_A),B(_B),Ah(_Ah),Bh(_Bh),K(_K),n_tiles(_n_tiles),factAB(_factAB),factC(_factC){}
+				void operator()(size_t begin, size_t end){
+					const int tile = DD2DIA_HOST_TILE;
+					std::vector<value_type> acc(DD2DIA_HOST_DIAS * tile);
+					for(size_t t = begin; t < end; t++){
+						const int r0 = (t % n_tiles) * tile;
+						const int r1 = std::min((int)C.h(), r0 + tile);
+						const int d0 = (t / n_tiles) * DD2DIA_HOST_DIAS;
+						const int d1 = std::min(C.num_dia(), d0 + DD2DIA_HOST_DIAS);
+						std::fill(acc.begin(), acc.end(), (value_type)0);
+						for(int l = 0; l < K; l += DD2DIA_HOST_COLS)
+							dd2dia_host_tile(C, A, Ah, B, Bh, l, std::min(K, l + DD2DIA_HOST_COLS), d0, d1, r0, r1, tile, &acc[0]);
+
+						// store the stored part of the diagonals within the tile
+						const int rf = C.row_fact();
+						for(int dia = d0; dia < d1; dia++){
+							const int k = C.get_offset(dia);
+							const int row_start = rf*std::max((int)0,-k);
+							const int col_start =  1*std::max((int)0, k);
+							const int N  = std::min((int)C.h() - row_start, rf*((int)C.w() - col_start));
+							const int lo = std::max(r0, row_start);
+							const int hi = std::min(r1, row_start + N);
+							value_type* d = C.vec().ptr() + dia*C.stride();
+							const value_type* s = &acc[(dia-d0)*tile] - r0;
+							if(factC == (value_type)0)
+								for(int r = lo; r < hi; r++)
+									d[r] = factAB * s[r];
+							else
+								for(int r = lo; r < hi; r++)
+									d[r] = factC * d[r] + factAB * s[r];
+						}
+					}
+				}
+			};
+
+		/**
+		 * C = factC * C + factAB * A * B^T on the diagonals of C, in tasks of
+		 * tiles of rows and groups of diagonals on the host thread pool.
+		 *
+		 * M is host_memory_space, or dev_memory_space if CUV is built without CUDA.
+		 */
+		template<class value_type, class M, class index_type>
+			void densedense_to_dia_host(
+					dia_matrix<value_type,M,index_type>& dst,
+					const tensor<value_type,M,column_major>& A,
+					const tensor<value_type,M,column_major>& B,
 					const value_type& factAB,
 					const value_type& factC){
                                 cuvAssert(A.shape().size()==2);
@@ -214,41 +363,25 @@ namespace cuv{
 				cuvAssert(dst.w() == B.shape()[0]);
 				cuvAssert(dst.h() == A.shape()[0]);
 				cuvAssert(A.shape()[1]   == B.shape()[1]);
-				value_type *dst_diabase = dst.vec().ptr();
-				const index_type Ah = A.shape()[0], Aw = A.shape()[1], Bh = B.shape()[0], Bw = B.shape()[1], Ch = dst.h(), Cw = dst.w();
-				const int rf = dst.row_fact();
-				for(int dia=0;dia<dst.num_dia();dia++, dst_diabase += dst.stride()){
-						const int k = dst.get_offset(dia);  //diagonal offset
-
-						const index_type row_start = rf*std::max((int)0,-k);
-						const index_type col_start =  1*std::max((int)0, k);
-
-						// number of elements to process
-						const index_type N   = std::min(Ch - row_start, rf*(Cw - col_start));
-
-						// data vectors
-						value_type *const d_base = dst_diabase + row_start;
-						const value_type *const a_base = A.ptr() + row_start;
-						const value_type *const b_base = B.ptr() + col_start;
-						const value_type *a = a_base;
-						const value_type *b = b_base;
-
-						// now the main loop: move along the columns of A and B
-						// and update the corresponding data point on the diagonal
-						// this is better than finishing one diagonal element and then move to the next,
-						// since in that case, one has to move in Ah-sized steps.
-						const value_type*const a_end = a_base+Aw*Ah;
-						const value_type*const d_end = d_base+N;
-						for(;a<a_end; a+=Ah,b+=Bh){
-							value_type* d = d_base;
-							while(d<d_end){
-								for(int row_fact=1;row_fact<rf;row_fact++) // TODO: inefficient, needs explicit instantiation for fixed rf
-									*d++  += (*a++)  *  (*b);
-								*d++  += (*a++)  *  (*b++);
-							}
-							a-=N;   b-=N/rf;
-						}
-				}
+				if(dst.h() == 0 || dst.num_dia() == 0)
+					return;
+				const int n_tiles  = (dst.h() + DD2DIA_HOST_TILE - 1) / DD2DIA_HOST_TILE;
+				const int n_groups = (dst.num_dia() + DD2DIA_HOST_DIAS - 1) / DD2DIA_HOST_DIAS;
+				dd2dia_host_tasks<value_type,M,index_type> task(dst, A.ptr(), A.shape()[0], B.ptr(), B.shape()[0], A.shape()[1], n_tiles, factAB, factC);
+				if((size_t)dst.h() * dst.num_dia() * std::max((size_t)1, (size_t)A.shape()[1]) < get_host_parallel_threshold())
+					task(0, n_tiles * n_groups);
+				else
+					parallel_tasks(n_tiles * n_groups, task);
+			}
+		template<class value_type, class index_type>
+			void densedense_to_dia(
+					dia_matrix<value_type,host_memory_space,index_type>& dst,
+					const host_block_descriptor<value_type,index_type>& /*bd*/,
+					const tensor<value_type,cuv::host_memory_space,column_major>& A,
+					const tensor<value_type,cuv::host_memory_space,column_major>& B,
+					const value_type& factAB,
+					const value_type& factC){
+				densedense_to_dia_host(dst,A,B,factAB,factC);
 			}
 		template<class value_type, class index_type>
 			void densedense_to_dia(
@@ -259,6 +392,11 @@ namespace cuv{
 					const value_type& factAB,
 					const value_type& factC
 					){
+#ifdef CUV_NO_CUDA
+				// device memory is host memory, the block descriptor is not needed
+				(void)bd;
+				densedense_to_dia_host(dst,A,B,factAB,factC);
+#else
                                 cuvAssert(A.shape().size()==2);
                                 cuvAssert(B.shape().size()==2);
 				dim3 block(SPARSE_DIA_BLOCK_SIZE, SPARSE_DIA_BLOCK_SIZE);
@@ -293,6 +431,7 @@ namespace cuv{
 					dense2dia_mm<true,true,value_type><<<grid,block>>>(dst.ptr(), A.ptr(), B.ptr(), A.shape()[1], A.shape()[0], B.shape()[0], bd.blocks().ptr, dst.stride(),factAB,factC,dst.row_fact());
 
 				cuvSafeCall(cudaThreadSynchronize());
+#endif /* CUV_NO_CUDA */
 			}
 	}
 
@@ -28,8 +28,11 @@
 //*LE*
 
 
+#include <algorithm>
 #include <stdexcept>
+#ifndef CUV_NO_CUDA
 #include <cublas.h>
+#endif
 #include <cblas.h>
 #include <stdio.h>
 #include <float.h>
@@ -38,8 +41,12 @@
 #include <thrust/functional.h>
 
 #include <cuv/tools/cuv_general.hpp>
+#include <cuv/tools/thread_pool.hpp>
+#ifndef CUV_NO_CUDA
 #include <3rd_party/CudaConv/nvmatrix.cuh>
+#endif
 #include <cuv/matrix_ops/matrix_ops.hpp>
+#include <cuv/matrix_ops/transpose_host.hpp>
 #include <cuv/tensor_ops/functors.hpp>
 
 #ifdef __CDT_PARSER__
@@ -73,6 +80,7 @@
 	 * tx indicates the y-dimension in the matrix; ty indicates the x-dimension in the matrix
 	 */
 
+#ifndef CUV_NO_CUDA
 // "coalesced transpose" with no bank conflicts, example from SDK
 // potential speedup by 5 possible for "fine-grained transpose"
 template<int BLOCK_SIZE, class T, class I>
@@ -131,6 +139,7 @@ __global__ void transposeNoBankConflicts(T *dst, const T *src,
 			*PITCH(dstp,dpitch,i,0) = tile[threadIdx.x][threadIdx.y+i];
 	}
 }
+#endif /* CUV_NO_CUDA */
 namespace cuv {
 template<class __value_type, class __memory_space_type, class __index_type>
 tensor<__value_type , __memory_space_type,column_major>*blockview(
@@ -173,6 +182,20 @@ tensor<__value_type,__memory_space_type,__memory_layout>* blockview(
 
 
 
+#ifdef CUV_NO_CUDA
+// device products forward to these
+template<>
+void prod(tensor<float,host_memory_space,column_major>& dst,
+		const tensor<float,host_memory_space,column_major>& A,
+		const tensor<float,host_memory_space,column_major>& B,
+		char transA, char transB, const float& factAB, const float& factC);
+template<>
+void prod(tensor<float,host_memory_space,row_major>& dst,
+		const tensor<float,host_memory_space,row_major>& A,
+		const tensor<float,host_memory_space,row_major>& B,
+		char transA, char transB, const float& factAB, const float& factC);
+#endif
+
 /// column major blas3
 template<>
 void prod(tensor<float,dev_memory_space,column_major>& dst,
@@ -197,9 +220,14 @@ void prod(tensor<float,dev_memory_space,column_major>& dst,
 	cuvAssert(B.ptr());
 	cuvAssert(dst.ptr());
 
+#ifdef CUV_NO_CUDA
+	tensor<float,host_memory_space,column_major> hdst = detail::host_alias(dst);
+	prod(hdst, detail::host_alias(A), detail::host_alias(B), transA, transB, factAB, factC);
+#else
 	cublasSgemm(transA, transB, m, n, k1, factAB, A.ptr(), A.shape(0),B.ptr(), B.shape(0), factC, dst.ptr(), dst.shape(0));
 	cuvAssert( cublasGetError() == CUBLAS_STATUS_SUCCESS );
 	cuvSafeCall(cudaThreadSynchronize());
+#endif
 }
 
 template<>
@@ -267,10 +295,15 @@ void prod(tensor<float,dev_memory_space,row_major>& dst,
 	cuvAssert(A.ptr());
 	cuvAssert(B.ptr());
 	cuvAssert(dst.ptr());
+#ifdef CUV_NO_CUDA
+	tensor<float,host_memory_space,row_major> hdst = detail::host_alias(dst);
+	prod(hdst, detail::host_alias(A), detail::host_alias(B), transA, transB, factAB, factC);
+#else
 	cublasSgemm(transB, transA, m, n, k1, factAB, B.ptr(), B.shape(1),A.ptr(), A.shape(1), factC, dst.ptr(), dst.shape(1));
 
 	cuvAssert( cublasGetError() == CUBLAS_STATUS_SUCCESS );
 	cuvSafeCall(cudaThreadSynchronize());
+#endif
 }
 
 template<>
@@ -303,6 +336,7 @@ void prod(tensor<float,host_memory_space,row_major>& dst,
 			factAB, A.ptr(), A.shape(1),B.ptr(), B.shape(1), factC, dst.ptr(), dst.shape(1));
 }
 
+#ifndef CUV_NO_CUDA
 template<bool UseFactNew, bool UseFactOld, class V, class I, class V2, class OP>
 __global__
 void matrix_plus_vector_kernel_column_major(V* Dst, const V*Src, const V2* v,I w,I h, OP op, float factNew, float factOld) {
@@ -359,8 +393,92 @@ void matrix_plus_vector_kernel_row_major (V *Dst, const V* Src, const V2* v, I h
 		__syncthreads(); // necessary, otherwise the threads use different values of scalar!
 	}
 }
+#endif /* CUV_NO_CUDA */
 
 namespace matrix_op_col_impl {
+	// ====================  host ======================
+	/**
+	 * dst = factOld * dst + factNew * op(src, v[f]) for a contiguous array of shape dim0 x dim1 x dim2,
+	 * where f is the index in the middle dimension.
+	 *
+	 * Processes the elements [begin,end) for parallel_for. The factors are
+	 * selected at compile time, so the inner loops are simple enough to be
+	 * vectorized.
+	 */
+	template<bool UseFactNew, bool UseFactOld, class V, class V2, class OP>
+	struct matrix_op_middle_range{
+		V* dst;
+		const V* src;
+		const V2* v;
+		OP op;
+		size_t dim1, dim2;
+		float factNew, factOld;
+		matrix_op_middle_range(V* d, const V* s, const V2* _v, const OP& o, size_t d1, size_t d2, float fn, float fo)
+			:dst(d),src(s),v(_v),op(o),dim1(d1),dim2(d2),factNew(fn),factOld(fo){}
+
+		inline V combine(const V& d, const V& r)const{
+			if(!UseFactOld && !UseFactNew)
+				return r;
+			else if(!UseFactOld && UseFactNew)
+				return r * factNew;
+			else if(UseFactOld && !UseFactNew)
+				return d * factOld + r;
+			else
+				return d * factOld + r * factNew;
+		}
+		void operator()(size_t begin, size_t end){
+			size_t i = begin;
+			if(dim2 == 1){
+				// v runs along the innermost dimension
+				while(i < end){
+					size_t f = i % dim1;
+					size_t n = std::min(dim1 - f, end - i);
+					V* d = dst + i;
+					const V* s = src + i;
+					const V2* w = v + f;
+					for(size_t k = 0; k < n; k++)
+						d[k] = combine(d[k], op(s[k], w[k]));
+					i += n;
+				}
+			}else{
+				// one element of v for each contiguous row of dim2 elements
+				while(i < end){
+					size_t n = std::min(dim2 - i % dim2, end - i);
+					const V2 el = v[(i / dim2) % dim1];
+					V* d = dst + i;
+					const V* s = src + i;
+					for(size_t k = 0; k < n; k++)
+						d[k] = combine(d[k], op(s[k], el));
+					i += n;
+				}
+			}
+		}
+	};
+
+	/**
+	 * applies op to a contiguous host array of shape dim0 x dim1 x dim2 and a vector v of length dim1,
+	 * in parallel on the host thread pool.
+	 */
+	template<class V, class V2, class OP>
+	void matrix_op_middle_host(V* dst, const V* src, const V2* v, const OP& op, size_t dim0, size_t dim1, size_t dim2, float factNew, float factOld){
+		const size_t n = dim0 * dim1 * dim2;
+		const size_t grain = host_chunk_size(2*sizeof(V));
+		if(factNew == 1.f && factOld == 0.f){
+			matrix_op_middle_range<false,false,V,V2,OP> r(dst, src, v, op, dim1, dim2, factNew, factOld);
+			parallel_for(n, grain, r);
+		}else if(factOld == 0.f){
+			matrix_op_middle_range<true,false,V,V2,OP> r(dst, src, v, op, dim1, dim2, factNew, factOld);
+			parallel_for(n, grain, r);
+		}else if(factNew == 1.f){
+			matrix_op_middle_range<false,true,V,V2,OP> r(dst, src, v, op, dim1, dim2, factNew, factOld);
+			parallel_for(n, grain, r);
+		}else{
+			matrix_op_middle_range<true,true,V,V2,OP> r(dst, src, v, op, dim1, dim2, factNew, factOld);
+			parallel_for(n, grain, r);
+		}
+	}
+
+#ifndef CUV_NO_CUDA
 	template<class V, class V2, class OP>
 	void matrix_op_col(tensor<V,dev_memory_space,row_major>& Dst, const tensor<V,dev_memory_space,row_major>& Src, const tensor<V2,dev_memory_space>& v, const OP& op, float factNew, float factOld) {
 		cuvAssert(Src.shape(0) == v.size());
@@ -393,80 +511,27 @@ namespace matrix_op_col_impl {
             matrix_plus_vector_kernel_column_major2<true,true><<<num_blocks,num_threads>>>(Dst.ptr(), Src.ptr(), v.ptr(), Src.shape(0), other_dim, op, factNew, factOld);
 		cuvSafeCall(cudaThreadSynchronize());
 	}
+#endif /* CUV_NO_CUDA */
 	template<class V, class V2, class OP>
 	void matrix_op_col(tensor<V,host_memory_space,column_major>& Dst, const tensor<V,host_memory_space,column_major>& Src, const tensor<V2,host_memory_space>& v, const OP& op, float factNew, float factOld) {
 		cuvAssert(Src.shape(0) == v.size());
-        unsigned int other_dim = Src.size()/Src.shape(0);
-		const V2* v_ptr = v.ptr();
-		const V * Src_ptr = Src.ptr();
-		V * Dst_ptr = Dst.ptr();
-        unsigned int Srcshape0 = Src.shape(0);
-
-        // move src ptr, dst ptr and vptr at the same time
-
-        if(factOld == 0.f){
-            if(factNew == 1.f)
-                for(int j=0;j<other_dim;j++) {
-                    v_ptr = v.ptr();
-                    for(int i=0;i<Srcshape0;i++,Src_ptr++,v_ptr++,Dst_ptr++)
-                        *Dst_ptr = op(*Src_ptr,*v_ptr);
-                }
-            else
-                for(int j=0;j<other_dim;j++) {
-                    v_ptr = v.ptr();
-                    for(int i=0;i<Srcshape0;i++,Src_ptr++,v_ptr++,Dst_ptr++)
-                        *Dst_ptr = factNew * op(*Src_ptr,*v_ptr);
-                }
-        }else{
-            if(factNew == 1.f)
-                for(int j=0;j<other_dim;j++) {
-                    v_ptr = v.ptr();
-                    for(int i=0;i<Srcshape0;i++,Src_ptr++,v_ptr++,Dst_ptr++)
-                        *Dst_ptr = *Dst_ptr * factOld + op(*Src_ptr,*v_ptr);
-                }
-            else
-                for(int j=0;j<other_dim;j++) {
-                    v_ptr = v.ptr();
-                    for(int i=0;i<Srcshape0;i++,Src_ptr++,v_ptr++,Dst_ptr++)
-                        *Dst_ptr = *Dst_ptr * factOld + factNew * op(*Src_ptr,*v_ptr);
-                }
-        }
+		// v runs along the innermost dimension
+		matrix_op_middle_host(Dst.ptr(), Src.ptr(), v.ptr(), op, Src.size()/Src.shape(0), Src.shape(0), 1, factNew, factOld);
 	}
 	template<class V, class V2, class OP>
 	void matrix_op_col(tensor<V,host_memory_space,row_major>& Dst, const tensor<V,host_memory_space,row_major>& Src, const tensor<V2,host_memory_space>& v, const OP& op, float factNew, float factOld) {
 		cuvAssert(Src.shape(0) == v.size());
-        unsigned int other_dim = Src.size()/Src.shape(0);
-		const V2* v_ptr = v.ptr();
-		const V * Src_ptr = Src.ptr();
-		V * Dst_ptr = Dst.ptr();
-        unsigned int Srcshape0 = Src.shape(0);
-
-        // in this version, we only move along src+dst horizontally, but keep pos in column vector v constant
-
-        if(factOld == 0.f){
-            if(factNew == 1.f )
-                for(int i=0;i<Srcshape0;i++, v_ptr++) {
-                    for(int j=0;j<other_dim;j++)
-                        *Dst_ptr++ = op(*Src_ptr++,*v_ptr);
-                }
-            else
-                for(int i=0;i<Srcshape0;i++, v_ptr++) {
-                    for(int j=0;j<other_dim;j++)
-                        *Dst_ptr++ = *Dst_ptr * factOld + factNew * op(*Src_ptr++,*v_ptr);
-                }
-        }else{
-            if(factNew == 1.f)
-                for(int i=0;i<Srcshape0;i++, v_ptr++) {
-                    for(int j=0;j<other_dim;j++)
-                        *Dst_ptr++ = *Dst_ptr * factOld + op(*Src_ptr++,*v_ptr);
-                }
-            else
-                for(int i=0;i<Srcshape0;i++, v_ptr++) {
-                    for(int j=0;j<other_dim;j++)
-                        *Dst_ptr++ = *Dst_ptr * factOld + factNew * op(*Src_ptr++,*v_ptr);
-                }
-        }
+		// every element of v is combined with one contiguous row
+		matrix_op_middle_host(Dst.ptr(), Src.ptr(), v.ptr(), op, 1, Src.shape(0), Src.size()/Src.shape(0), factNew, factOld);
 	}
+#ifdef CUV_NO_CUDA
+	/// device memory is host memory, use the host implementation
+	template<class V, class V2, class L, class OP>
+	void matrix_op_col(tensor<V,dev_memory_space,L>& Dst, const tensor<V,dev_memory_space,L>& Src, const tensor<V2,dev_memory_space>& v, const OP& op, float factNew, float factOld) {
+		tensor<V,host_memory_space,L> hDst = detail::host_alias(Dst);
+		matrix_op_col(hDst, detail::host_alias(Src), detail::host_alias(v), op, factNew, factOld);
+	}
+#endif
 	// ====================  row ======================
 	template<class V, class V2, class T, class M, class OP>
 	void matrix_op_row(tensor<V,T,M>& Dst, const tensor<V,T,M>& Src, const tensor<V2,T>& v, const OP& op, float factNew, float factOld) {
@@ -475,6 +540,7 @@ namespace matrix_op_col_impl {
 	}
 
 	// ====================  middle ======================
+#ifndef CUV_NO_CUDA
     template<bool UseFactNew, bool UseFactOld,class T, class OP>
        __global__
        void matrix_op_middle_kernel(T* dst, const T* src, const T* v, OP op, const unsigned int dim0, const unsigned int dim1, const unsigned int dim2, float factNew, float factOld){
@@ -513,32 +579,7 @@ namespace matrix_op_col_impl {
               }
            }
        }
-
-    template<bool UseFactNew, bool UseFactOld,class T, class OP>
-        void matrix_op_middle_host(T* dst, const T* src, const T* v, OP op,  unsigned int dim0, unsigned int dim1, unsigned int dim2, float factNew, float factOld){
-            T* dst0;
-            const T* src0;
-            dst0 = dst;
-            src0 = src;
-            for(unsigned int f = 0; f < dim1; f++){
-                unsigned int offset_dim1 = f * dim2;
-                for(unsigned int d0 = 0; d0 < dim0; d0++){
-                    unsigned int offset = d0 * dim1 * dim2 + offset_dim1;
-                    for(unsigned int d2 = 0; d2 < dim2; ++d2){
-                        T el = v[f];
-                        unsigned int index = offset + d2;
-                        if(!UseFactOld && !UseFactNew)
-                            dst0[index] = op(src0[index], el);
-                        else if(!UseFactOld && UseFactNew)
-                            dst0[index] = op(src0[index],el)*factNew;
-                        else if(UseFactOld && !UseFactNew)
-                            dst0[index] = factOld * dst0[index] + op(src0[index],el);
-                        else if(UseFactOld && UseFactNew)
-                            dst0[index] = factOld * dst0[index] + op(src0[index],el)*factNew;
-                    }
-                }
-            }
-        }
+#endif /* CUV_NO_CUDA */
 
     template<class V,class M, class T, class OP>
         void matrix_op_middle(tensor<V,M,T>& dst, const tensor<V,M,T>& src, const tensor<V,M,row_major>& v, unsigned int dim, const OP& op, float factNew, float factOld){
@@ -557,31 +598,16 @@ namespace matrix_op_col_impl {
             }
 
             if(IsSame<M,host_memory_space>::Result::value){
-                if(IsSame<T,row_major>::Result::value){
-                    if(factNew == 1.f && factOld == 0.f)
-                        matrix_op_middle_host<false,false>(dst.ptr(), src.ptr(), v.ptr(), op, dim0, dim1, dim2, factNew, factOld);
-                    else if(                  factOld == 0.f)
-                        matrix_op_middle_host<true,false>(dst.ptr(), src.ptr(), v.ptr(), op, dim0, dim1, dim2, factNew, factOld);
-                    else if(factNew == 1.f                  )
-                        matrix_op_middle_host<false,true>(dst.ptr(), src.ptr(), v.ptr(), op, dim0, dim1, dim2, factNew, factOld);
-                    else // if(factNew == 1.f && factOld == 0.f)
-                        matrix_op_middle_host<true,true>(dst.ptr(), src.ptr(), v.ptr(), op, dim0, dim1, dim2, factNew, factOld);
-                }else{
+                if(IsSame<T,row_major>::Result::value)
+                    matrix_op_middle_host(dst.ptr(), src.ptr(), v.ptr(), op, dim0, dim1, dim2, factNew, factOld);
+                else
                     // in the case of column mayor, only dim0 and dim2 are swiched
-                    unsigned int temp = dim2;
-                    dim2 = dim0;
-                    dim0 = temp;
-
-                    if(factNew == 1.f && factOld == 0.f)
-                        matrix_op_middle_host<false,false>(dst.ptr(), src.ptr(), v.ptr(), op, dim0, dim1, dim2, factNew, factOld);
-                    else if(                  factOld == 0.f)
-                        matrix_op_middle_host<true,false>(dst.ptr(), src.ptr(), v.ptr(), op, dim0, dim1, dim2, factNew, factOld);
-                    else if(factNew == 1.f                  )
-                        matrix_op_middle_host<false,true>(dst.ptr(), src.ptr(), v.ptr(), op, dim0, dim1, dim2, factNew, factOld);
-                    else // if(factNew == 1.f && factOld == 0.f)
-                        matrix_op_middle_host<true,true>(dst.ptr(), src.ptr(), v.ptr(), op, dim0, dim1, dim2, factNew, factOld);
-                }
+                    matrix_op_middle_host(dst.ptr(), src.ptr(), v.ptr(), op, dim2, dim1, dim0, factNew, factOld);
             }else{
+#ifdef CUV_NO_CUDA
+                tensor<V,host_memory_space,T> hdst = detail::host_alias(dst);
+                matrix_op_middle(hdst, detail::host_alias(src), detail::host_alias(v), dim, op, factNew, factOld);
+#else
                 // device: run kernel
                 unsigned int num_threads = min(512, int(32 * ceil(dim2 / 32. )));
 
@@ -613,6 +639,7 @@ namespace matrix_op_col_impl {
                 }
 
                 cuvSafeCall(cudaThreadSynchronize());
+#endif /* CUV_NO_CUDA */
             }
         }
 
@@ -717,6 +744,7 @@ void matrix_divide_row(tensor<__value_type,__memory_space_type,__memory_layout_t
 }
 
 namespace transpose_impl{
+#ifndef CUV_NO_CUDA
 	template<class V>
 	void transpose(tensor<V, dev_memory_space, column_major>& dst,
 			 const tensor<V, dev_memory_space, column_major>& src) {
@@ -754,6 +782,7 @@ namespace transpose_impl{
 		transpose_kernel<BLOCK_SIZE><<<gridSize, blockSize>>>(dst.ptr(), src.ptr(), width, height,dst.stride(0),src.stride(0));
 		cuvSafeCall(cudaThreadSynchronize());
 	}
+#endif /* CUV_NO_CUDA */
 
 	template<class V>
 	void transpose(tensor<V,host_memory_space,column_major>& dst,
@@ -762,14 +791,8 @@ namespace transpose_impl{
                 cuvAssert(src.ndim()==2);
 		cuvAssert(dst.shape(1) == src.shape(0));
 		cuvAssert(dst.shape(0) == src.shape(1));
-		V* dst_ptr = dst.ptr();
-		const V* src_ptr = src.ptr();
-		for(int i=0; i<dst.shape(1); i++) {
-			for(int j=0; j<dst.shape(0); j++) {
-				*dst_ptr++ = src_ptr[j*src.shape(0)];
-			}
-			src_ptr++;
-		}
+		// column major (n,m) is row major (m,n) in memory
+		detail::host_transpose(dst.ptr(), src.ptr(), src.shape(1), src.shape(0), dst.stride(1), src.stride(1), sizeof(V));
 	}
 
 	template<class V>
@@ -779,14 +802,33 @@ namespace transpose_impl{
                 cuvAssert(src.ndim()==2);
 		cuvAssert(dst.shape(1) == src.shape(0));
 		cuvAssert(dst.shape(0) == src.shape(1));
-		V* dst_ptr = dst.ptr();
-		const V* src_ptr = src.ptr();
-		for(int i=0; i<dst.shape(0); i++) {
-			for(int j=0; j<dst.shape(1); j++) {
-				*dst_ptr++ = src_ptr[j*src.shape(1)];
-			}
-			src_ptr++;
-		}
+		detail::host_transpose(dst.ptr(), src.ptr(), src.shape(0), src.shape(1), dst.stride(0), src.stride(0), sizeof(V));
+	}
+
+#ifdef CUV_NO_CUDA
+	/// device memory is host memory, use the host implementation
+	template<class V, class L>
+	void transpose(tensor<V,dev_memory_space,L>& dst,
+			 const tensor<V,dev_memory_space,L>& src) {
+		tensor<V,host_memory_space,L> hdst = detail::host_alias(dst);
+		transpose(hdst, detail::host_alias(src));
+	}
+#endif
+
+	template<class V, class L>
+	void transpose(tensor<V,host_memory_space,L>& A) {
+                cuvAssert(A.ndim()==2);
+		cuvAssert(A.shape(0) == A.shape(1));
+		const unsigned int ld = IsSame<L,row_major>::Result::value ? A.stride(0) : A.stride(1);
+		detail::host_transpose_inplace(A.ptr(), A.shape(0), ld, sizeof(V));
+	}
+
+	template<class V, class L>
+	void transpose(tensor<V,dev_memory_space,L>& A) {
+                cuvAssert(A.ndim()==2);
+		cuvAssert(A.shape(0) == A.shape(1));
+		const tensor<V,dev_memory_space,L> tmp = A.copy();
+		transpose(A, tmp);
 	}
 } // namespace transpose_impl
 
@@ -795,6 +837,11 @@ void transpose(tensor<__value_type,__memory_space_type, __memory_layout_type>& d
 	transpose_impl::transpose(dst,src);
 }
 
+template<class __value_type, class __memory_space_type, class __memory_layout_type>
+void transpose(tensor<__value_type,__memory_space_type, __memory_layout_type>& A){
+	transpose_impl::transpose(A);
+}
+
 template<class V, class T, class M>
 cuv::tensor<V,T,typename other_memory_layout<M>::type> * transposed_view_p(cuv::tensor<V,T,M>&  src){
         std::vector<unsigned int> shape = src.shape();
@@ -834,7 +881,9 @@ const cuv::tensor<V,T,typename other_memory_layout<M>::type> * transposed_view_p
 
 #define INSTANTIATE_TRANSPOSE(V,M) \
   template void transpose(tensor<V, host_memory_space, M>&, const tensor<V, host_memory_space, M>&); \
-  template void transpose(tensor<V, dev_memory_space , M>&, const tensor<V, dev_memory_space , M>&);
+  template void transpose(tensor<V, dev_memory_space , M>&, const tensor<V, dev_memory_space , M>&); \
+  template void transpose(tensor<V, host_memory_space, M>&); \
+  template void transpose(tensor<V, dev_memory_space , M>&);
 
 #define INSTANTIATE_TRANSPOSED_VIEW(V) \
   template tensor<V,host_memory_space,other_memory_layout<column_major>::type >* transposed_view_p(tensor<V,host_memory_space,column_major>&);\
@@ -35,6 +35,8 @@
 #define __MATRIX_OPS_HPP__
 
 #include <cuv/basics/dia_matrix.hpp>
+#include <cuv/basics/csr_matrix.hpp>
+#include <cuv/basics/bsr_matrix.hpp>
 
 namespace cuv{
 
@@ -117,6 +119,12 @@ namespace cuv{
   /// @see prod
   template<class V, class M, class L>
 	  void prod(tensor<V,M,L>& C, const dia_matrix<V,M>& A, const tensor<V,M,L>& B, char transA='n', char transB='n', const float& factAB=1.f, const float& factC=0.f);
+  /// @see prod, only implemented for host matrices. Rows are distributed over the host threads by their number of non-zeros.
+  template<class V, class M, class L>
+	  void prod(tensor<V,M,L>& C, const csr_matrix<V,M>& A, const tensor<V,M,L>& B, char transA='n', char transB='n', const float& factAB=1.f, const float& factC=0.f);
+  /// @see prod, only implemented for host matrices. Block rows are distributed over the host threads by their number of blocks.
+  template<class V, class M, class L>
+	  void prod(tensor<V,M,L>& C, const bsr_matrix<V,M>& A, const tensor<V,M,L>& B, char transA='n', char transB='n', const float& factAB=1.f, const float& factC=0.f);
 
   /** 
    * @brief Transpose a matrix
@@ -128,6 +136,17 @@ namespace cuv{
 template<class V, class M, class L>
 void transpose(tensor<V,M, L>& dst, const tensor<V,M, L>& src);
 
+  /** 
+   * @brief Transpose a square matrix in place
+   * 
+   * On the host, this avoids the temporary copy needed by transpose(dst,src).
+   *
+   * @param A square matrix which is overwritten by its transpose
+   * 
+   */
+template<class V, class M, class L>
+void transpose(tensor<V,M, L>& A);
+
   /** 
    * @brief Transpose a matrix by creating a view with different storage
    * 
@@ -228,6 +247,27 @@ void transpose(tensor<V,M, L>& dst, const tensor<V,M, L>& src);
 	  void reduce_to_row(tensor<V, M>& dst, const tensor<__value_type2, M, L>& src, reduce_functor rf=RF_ADD, const __value_type2& factNew=1.f, const __value_type2& factOld=0.f);
 
 
+  /**
+   * @brief summation algorithm used by host reductions
+   *
+   * 	- HOST_REDUCE_FAST sums with several independent accumulators per output
+   * 	- HOST_REDUCE_KAHAN additionally uses compensated (Kahan) summation for RF_ADD, RF_MEAN and RF_ADD_SQUARED
+   */
+  enum host_reduce_accuracy{
+	  HOST_REDUCE_FAST,
+	  HOST_REDUCE_KAHAN
+  };
+
+  /**
+   * @brief set the summation algorithm used by reduce_to_row/reduce_to_col on the host
+   */
+  void set_host_reduce_accuracy(host_reduce_accuracy a);
+
+  /**
+   * @brief summation algorithm used by reduce_to_row/reduce_to_col on the host
+   */
+  host_reduce_accuracy get_host_reduce_accuracy();
+
   /** 
    * @brief Convenience function that creates a new vector and performs reduction by summing along given axis
    * 
@@ -276,6 +316,12 @@ void transpose(tensor<V,M, L>& dst, const tensor<V,M, L>& src);
    */
   template<class V, class M>
 	  void spmv(tensor<V, M>& dst, const dia_matrix<V, M>& A, const tensor<V, M>& v, char transA='n', const float& factAv=1.f, const float& factC=0.f);
+  /// @see spmv, only implemented for host matrices
+  template<class V, class M>
+	  void spmv(tensor<V, M>& dst, const csr_matrix<V, M>& A, const tensor<V, M>& v, char transA='n', const float& factAv=1.f, const float& factC=0.f);
+  /// @see spmv, only implemented for host matrices
+  template<class V, class M>
+	  void spmv(tensor<V, M>& dst, const bsr_matrix<V, M>& A, const tensor<V, M>& v, char transA='n', const float& factAv=1.f, const float& factC=0.f);
   
   /**
    * @brief Apply a binary functor on one axis of a tensor and a 1-dimensional tensor.
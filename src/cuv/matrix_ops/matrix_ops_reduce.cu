@@ -29,13 +29,16 @@
 
 #include <stdio.h>
 #include <stdexcept>
+#include <algorithm>
 
 #include <cuv/tools/cuv_general.hpp>
 #include <cuv/tools/meta_programming.hpp>
 #include <cuv/tensor_ops/functors.hpp>
 #include <cuv/tensor_ops/tensor_ops.hpp>
 #include <cuv/matrix_ops/matrix_ops.hpp>
+#include <cuv/tools/thread_pool.hpp>
 
+#ifndef CUV_NO_CUDA
 template<int BLOCK_DIM, class T, class V, class RF>
 __global__
 void reduce_to_col_kernel(const T* matrix, V* vector, const unsigned int nCols, const unsigned int nRows,
@@ -145,13 +148,25 @@ void reduce_to_row_kernel(const T* matrix, V* vector, const unsigned int nCols,
 		}
 	}
 }
+#endif
 
 namespace cuv {
 
+static host_reduce_accuracy g_host_reduce_accuracy = HOST_REDUCE_FAST;
+
+void set_host_reduce_accuracy(host_reduce_accuracy a){
+	g_host_reduce_accuracy = a;
+}
+
+host_reduce_accuracy get_host_reduce_accuracy(){
+	return g_host_reduce_accuracy;
+}
+
 namespace reduce_impl {
 	template<int dim, class __memory_space_type>
 	       struct reduce{};
 
+#ifndef CUV_NO_CUDA
 	template<>
 	struct reduce<1, dev_memory_space>{
                 template<class __value_type, class __value_type2, class __memory_layout_type, class RF, class S>
@@ -213,83 +228,280 @@ namespace reduce_impl {
                 reduce_to_row_kernel<BLOCK_DIM><<<grid,threads,mem>>>(m.ptr(),v.ptr(),main_dim,other_dim,__value_type2(factNew),__value_type2(factOld),rf,__value_type2(traits_type::init_value()));
 		cuvSafeCall(cudaThreadSynchronize());
 	}};
+#endif
+
+	/// number of outputs accumulated together when reducing over the strided axis, accumulators stay in L1
+	static const int REDUCE_HOST_BLOCK      = 512;
+	/// number of independent accumulators per output when reducing over contiguous elements
+	static const int REDUCE_HOST_LANES      = 8;
+	/// maximum number of partial results kept on the stack when the reduced axis is split among threads
+	static const int REDUCE_HOST_PARTIALS   = 4096;
+	/// minimum number of elements of the reduced axis processed by one thread
+	static const int REDUCE_HOST_MIN_PART   = 4096;
+
+	/// reductions which are sums of (a function of) the elements, and may use compensated summation
+	template<class RV>
+	struct kahan_term{
+		static const bool value = false;
+		template<class X> static inline X apply(const X& x){ return x; }
+	};
+	template<class R, class T, class U>
+	struct kahan_term<bf_plus<R,T,U> >{
+		static const bool value = true;
+		template<class X> static inline X apply(const X& x){ return x; }
+	};
+	template<class R, class T, class U>
+	struct kahan_term<bf_add_square<R,T,U> >{
+		static const bool value = true;
+		template<class X> static inline X apply(const X& x){ return x*x; }
+	};
+
+	/**
+	 * reduces the contiguous elements a[begin..end) into (r,idx).
+	 *
+	 * Uses REDUCE_HOST_LANES independent accumulators, so that the loop is
+	 * vectorized and not limited by the latency of the reduce functor. Arg
+	 * reductions use a single accumulator to return the first extremum.
+	 */
+	template<bool Kahan, class RF, class T, class A>
+	inline void reduce_contiguous(RF& rf, const A* a, int begin, int end, T& r, int& idx){
+		typedef cuv::reduce_functor_traits<typename RF::result_value_functor_type> functor_traits;
+		typedef kahan_term<typename RF::result_value_functor_type> term;
+		const int L = REDUCE_HOST_LANES;
+		int i = begin;
+		if(functor_traits::returns_index){
+			for(; i < end; i++)
+				rf.rv(r, idx, a[i], i);
+			return;
+		}
+		int dummy = 0;
+		if(Kahan && term::value){
+			T sum[L], comp[L];
+			for(int k = 0; k < L; k++){ sum[k] = 0; comp[k] = 0; }
+			for(; i + L <= end; i += L)
+				for(int k = 0; k < L; k++){
+					T y = term::apply((T)a[i+k]) - comp[k];
+					T t = sum[k] + y;
+					comp[k] = (t - sum[k]) - y;
+					sum[k] = t;
+				}
+			T c = 0;
+			for(int k = 0; k < L; k++){
+				T y = sum[k] - comp[k] - c;
+				T t = r + y;
+				c = (t - r) - y;
+				r = t;
+			}
+			for(; i < end; i++){
+				T y = term::apply((T)a[i]) - c;
+				T t = r + y;
+				c = (t - r) - y;
+				r = t;
+			}
+			return;
+		}
+		T acc[L];
+		for(int k = 0; k < L; k++)
+			acc[k] = functor_traits::init_value();
+		for(; i + L <= end; i += L)
+			for(int k = 0; k < L; k++)
+				rf.rv(acc[k], dummy, a[i+k], dummy);
+		for(; i < end; i++)
+			rf.rv(acc[0], dummy, a[i], dummy);
+		for(int k = 0; k < L; k++)
+			rf.rr(r, dummy, acc[k], dummy);
+	}
+
+	/**
+	 * reduces rows [c0,c1) of the n_rows x n_cols (row-contiguous) matrix a
+	 * into the outputs [j0,j1), i.e. r[j-j0] = rf(a[c*n_cols + j]) over c.
+	 */
+	template<bool Kahan, class RF, class T, class A>
+	inline void reduce_strided(RF& rf, const A* a, int n_cols, int j0, int j1, int c0, int c1, T* r, int* idx){
+		typedef cuv::reduce_functor_traits<typename RF::result_value_functor_type> functor_traits;
+		typedef kahan_term<typename RF::result_value_functor_type> term;
+		const int n = j1 - j0;
+		if(Kahan && term::value){
+			T comp[REDUCE_HOST_BLOCK];
+			for(int k = 0; k < n; k++)
+				comp[k] = 0;
+			for(int c = c0; c < c1; c++){
+				const A* row = a + (size_t)c * n_cols + j0;
+				for(int k = 0; k < n; k++){
+					T y = term::apply((T)row[k]) - comp[k];
+					T t = r[k] + y;
+					comp[k] = (t - r[k]) - y;
+					r[k] = t;
+				}
+			}
+			return;
+		}
+		if(functor_traits::returns_index){
+			for(int c = c0; c < c1; c++){
+				const A* row = a + (size_t)c * n_cols + j0;
+				for(int k = 0; k < n; k++)
+					rf.rv(r[k], idx[k], row[k], c);
+			}
+			return;
+		}
+		int dummy = 0;
+		for(int c = c0; c < c1; c++){
+			const A* row = a + (size_t)c * n_cols + j0;
+			for(int k = 0; k < n; k++)
+				rf.rv(r[k], dummy, row[k], dummy);
+		}
+	}
+
+	/**
+	 * host reduction of a column-major matrix, in parallel.
+	 *
+	 * The outputs are split into blocks; when there are too few blocks to
+	 * keep all threads busy, the reduced axis is split into parts as well and
+	 * the partial results (kept on the stack) are combined at the end.
+	 */
+	template<int dim, bool Kahan, class RF, class T, class A, class V2, class S>
+	struct host_reduce_task{
+		RF rf;
+		const A* a;
+		V2* v;
+		int n_out;      ///< number of outputs (main_dim)
+		int len;        ///< length of the reduced axis (other_dim)
+		int block;      ///< outputs per task
+		int n_blocks;
+		int parts;      ///< number of parts the reduced axis is split into
+		T*   partial;   ///< parts x n_out partial results, if parts > 1
+		int* partial_idx;
+		S factNew, factOld;
+
+		host_reduce_task(const RF& _rf, const A* _a, V2* _v, int _n_out, int _len, int _block, int _parts,
+				T* _partial, int* _partial_idx, const S& _factNew, const S& _factOld)
+			: rf(_rf), a(_a), v(_v), n_out(_n_out), len(_len), block(_block)
+			, n_blocks((_n_out + _block - 1) / _block), parts(_parts)
+			, partial(_partial), partial_idx(_partial_idx), factNew(_factNew), factOld(_factOld){}
+
+		inline void store(int j, const T& r, int idx){
+			typedef cuv::reduce_functor_traits<typename RF::result_value_functor_type> functor_traits;
+			if(functor_traits::returns_index)
+				v[j] = idx;
+			else if(factOld != 0)
+				v[j] = factOld * v[j] + factNew * r;
+			else
+				v[j] = factNew * r;
+		}
+
+		void operator()(size_t begin, size_t end){
+			typedef cuv::reduce_functor_traits<typename RF::result_value_functor_type> functor_traits;
+			for(size_t t = begin; t < end; t++){
+				const int b    = t / parts;
+				const int part = t % parts;
+				const int j0   = b * block;
+				const int j1   = std::min(n_out, j0 + block);
+				const int c0   = (int)((size_t)len *  part      / parts);
+				const int c1   = (int)((size_t)len * (part + 1) / parts);
+				if(dim == 0){
+					// outputs reduce contiguous segments of the matrix
+					for(int j = j0; j < j1; j++){
+						T r = functor_traits::init_value();
+						int idx = 0;
+						reduce_contiguous<Kahan>(rf, a + (size_t)j * len, c0, c1, r, idx);
+						if(parts == 1) store(j, r, idx);
+						else{ partial[part * n_out + j] = r; partial_idx[part * n_out + j] = idx; }
+					}
+				}else{
+					// outputs are contiguous, the reduced axis is strided
+					T r[REDUCE_HOST_BLOCK];
+					int idx[REDUCE_HOST_BLOCK];
+					for(int k = 0; k < j1 - j0; k++){
+						r[k] = functor_traits::init_value();
+						idx[k] = 0;
+					}
+					reduce_strided<Kahan>(rf, a, n_out, j0, j1, c0, c1, r, idx);
+					for(int j = j0; j < j1; j++){
+						if(parts == 1) store(j, r[j-j0], idx[j-j0]);
+						else{ partial[part * n_out + j] = r[j-j0]; partial_idx[part * n_out + j] = idx[j-j0]; }
+					}
+				}
+			}
+		}
+
+		/// combine the partial results of all parts, in order of the reduced axis
+		void finish(){
+			if(parts == 1)
+				return;
+			for(int j = 0; j < n_out; j++){
+				T r = partial[j];
+				int idx = partial_idx[j];
+				for(int p = 1; p < parts; p++)
+					rf.rr(r, idx, partial[p * n_out + j], partial_idx[p * n_out + j]);
+				store(j, r, idx);
+			}
+		}
+	};
+
+	template<int dim, bool Kahan, class RF, class T, class A, class V2, class S>
+	void host_reduce(const RF& rf, const A* a, V2* v, int n_out, int len, const S& factNew, const S& factOld){
+		T   partial[REDUCE_HOST_PARTIALS];
+		int partial_idx[REDUCE_HOST_PARTIALS];
+
+		const size_t size     = (size_t)n_out * len;
+		const int    nthreads = detail::host_thread_limit(0);
+		const bool   parallel = size >= get_host_parallel_threshold() && nthreads > 1;
+
+		int block, parts = 1;
+		if(dim == 0){
+			// a task reduces whole segments, about one chunk of data per task
+			block = parallel ? std::max(1, std::min(n_out / nthreads, (int)(host_chunk_size(sizeof(A)) / std::max(len, 1)))) : n_out;
+			block = std::max(block, 1);
+		}else{
+			// spread output blocks over threads, but keep them long enough to vectorize
+			block = parallel ? std::min(REDUCE_HOST_BLOCK, std::max(64, (n_out + nthreads - 1) / nthreads)) : REDUCE_HOST_BLOCK;
+		}
+		const int n_blocks = (n_out + block - 1) / block;
+		if(parallel && n_blocks < nthreads){
+			parts = std::min((nthreads + n_blocks - 1) / n_blocks, len / REDUCE_HOST_MIN_PART);
+			parts = std::min(parts, REDUCE_HOST_PARTIALS / std::max(n_out, 1));
+			parts = std::max(parts, 1);
+		}
+
+		host_reduce_task<dim, Kahan, RF, T, A, V2, S> task(rf, a, v, n_out, len, block, parts,
+				partial, partial_idx, factNew, factOld);
+		const size_t n_tasks = (size_t)n_blocks * parts;
+		if(parallel)
+			parallel_tasks(n_tasks, task);
+		else
+			task(0, n_tasks);
+		task.finish();
+	}
 
 	template<int dim>
 	struct reduce<dim, host_memory_space>{
                 template<class __value_type, class __value_type2, class __memory_layout_type, class RF, class S>
 	       	void operator()(tensor<__value_type,host_memory_space> &v,const tensor<__value_type2,host_memory_space,__memory_layout_type> &m,const S & factNew,const S & factOld, RF rf)const{
-		typedef __value_type2 V;
-		typedef __value_type V2;
-		typedef typename tensor<__value_type,host_memory_space,__memory_layout_type>::index_type I;
-		typedef typename unconst<V>::type unconstV;
-		typedef cuv::reduce_functor_traits<typename RF::result_value_functor_type> functor_traits;
+		typedef typename unconst<__value_type2>::type unconstV;
 
 		cuvAssert(m.ptr() != NULL);
-        const int main_dim = (dim==1) ? m.shape(0) : m.shape(m.ndim()-1);
-        const int other_dim = m.size()/main_dim;
+		cuvAssert(dim == 0 || dim == 1);
+		const int main_dim  = (dim==1) ? m.shape(0) : m.shape(m.ndim()-1);
+		const int other_dim = m.size()/main_dim;
 		// assert that vector has correct length
 		cuvAssert(v.size()==main_dim);
 
-		const __value_type2 * A_ptr                         = m.ptr();
-
-		// indices: only needed when arg-max/arg-min etc used
-		tensor<I,host_memory_space>* indices = NULL;
-		I* indices_ptr                         = NULL;
-		if(functor_traits::returns_index){
-			indices         =  new tensor<I,host_memory_space>(v.size());
-			indices_ptr     =  indices->ptr();
-			memset(indices_ptr,indices->memsize(), 0);
-		}
-		I*const indices_begin = indices_ptr;
-		I*const indices_end   = indices_ptr + v.size();
-
-		// values: the new values that are to be combined with v using fact
-		tensor<unconstV,host_memory_space> values(v.size());
-		unconstV* values_ptr                   = values.ptr();
-		V*const values_end                     = values_ptr + values.size();
-		while(values_ptr != values_end) 
-			*values_ptr++ =functor_traits::init_value(); 
-		values_ptr = values.ptr();      // reset pointers to begining of vector
-
-		if (dim==0){
-			// apply reduce functor along columns
-			for(;values_ptr!=values_end; values_ptr++, indices_ptr++) {
-				for(int j=0; j<other_dim; j++, A_ptr++)
-					rf.rv(*values_ptr,*indices_ptr,*A_ptr,j);
-			}
-		}
-		else if(dim==1){
-			// apply reduce functor along rows
-			for(I i=0;i<other_dim;i++) {
-				values_ptr  = values.ptr();
-				indices_ptr = indices_begin;
-				for(; values_ptr!=values_end;A_ptr++,values_ptr++,indices_ptr++) 
-					rf.rv(*values_ptr,*indices_ptr,*A_ptr,i);
-			}
-		}else{
-			cuvAssert(false);
-		}
+		if(get_host_reduce_accuracy() == HOST_REDUCE_KAHAN)
+			host_reduce<dim, true,  RF, unconstV>(rf, m.ptr(), v.ptr(), main_dim, other_dim, factNew, factOld);
+		else
+			host_reduce<dim, false, RF, unconstV>(rf, m.ptr(), v.ptr(), main_dim, other_dim, factNew, factOld);
+	}};
 
-		// reset pointers to begining of vectors
-		values_ptr  = values.ptr();
-		indices_ptr = indices_begin;
-
-		// put result into v via v_ptr.
-		V2* v_ptr   = v.ptr();
-		if (!functor_traits::returns_index){ 
-			if (factOld!=0){
-				while(values_ptr!=values_end) 
-					*v_ptr   = factOld * *v_ptr++  + factNew * *values_ptr++;
-			}else
-				while(values_ptr!=values_end) 
-					*v_ptr++ = factNew * *values_ptr++;
-		}
-		else{
-			while(indices_ptr!=indices_end) 
-				*v_ptr++ = *indices_ptr++;
-			delete indices;
-		}
+#ifdef CUV_NO_CUDA
+	/// without CUDA, device memory lives on the host: use the host reduction
+	template<int dim>
+	struct reduce<dim, dev_memory_space>{
+                template<class __value_type, class __value_type2, class __memory_layout_type, class RF, class S>
+	       	void operator()(tensor<__value_type,dev_memory_space> &v,const tensor<__value_type2,dev_memory_space,__memory_layout_type> &m,const S & factNew,const S & factOld, RF rf)const{
+		tensor<__value_type,host_memory_space> hv = detail::host_alias(v);
+		reduce<dim,host_memory_space>()(hv, detail::host_alias(m), factNew, factOld, rf);
 	}};
+#endif
 
         template<int dimension, class __value_type, class __value_type2, class __memory_space_type, class __memory_layout_type, class S>
 	void reduce_switch(tensor<__value_type,__memory_space_type>&v,
@@ -31,11 +31,15 @@
 
 
 
+#include <algorithm>
 #include <iostream>
 #include <boost/any.hpp>
 #include <cuv/basics/dia_matrix.hpp>
 #include <cuv/matrix_ops/matrix_ops.hpp>
+#include <cuv/tools/thread_pool.hpp>
+#ifndef CUV_NO_CUDA
 #include <cuv/tools/texture.h>
+#endif
 #include <boost/preprocessor/arithmetic/inc.hpp>
 #include <boost/preprocessor/cat.hpp>
 #include <boost/preprocessor/repetition/repeat.hpp>
@@ -54,10 +58,13 @@ using namespace std;
 #define MAX_NUM_IMGS_AT_ONCE 14
 #define SEQ_ROW_FACT         1
 #define SPMM_BLOCK_SIZE      256
+#define SPMM_HOST_COLS       4   // number of columns of B processed together on the host
+#define SPMM_HOST_MIN_TILE   64  // minimum number of rows of C processed together on the host
 
 
 namespace cuv{
 	namespace spmv_impl{
+#ifndef CUV_NO_CUDA
 		/*
 		 *  For a given number of blocks, return a 2D grid large enough to contain them
 		 *  FROM NVIDIA SDK
@@ -137,66 +144,195 @@ namespace cuv{
 				/*}*/
 				spmv_dia_device(A,v,dst,transA,factAv,factC);
 			}
+#endif /* CUV_NO_CUDA */
 
 
 		/****************************************************************
 		 *  Host Code
 		 ****************************************************************/
-		template<class value_type, class index_type>
-			void spmv(tensor<value_type,host_memory_space>& dst, const dia_matrix<value_type,host_memory_space,index_type>& A, const tensor<value_type,host_memory_space>& v, char transA, const float& factAv, const float& factC){
-				const tensor<int,host_memory_space>& offsets = A.get_offsets();
-				const int num_diags             = A.num_dia();
-				const int A_h                   = A.h();
-				const int A_w                   = A.w();
-				const int A_stride              = A.stride();
-				index_type max_dst = ((transA=='t') ? A_w : A_h);
-				if(factC==0.f)
-					for(int i=0;i<max_dst;i++) dst[i]=0;
-				else
-					for(int i=0;i<max_dst;i++) dst[i]=dst[i] * factC;
-				const int rf = A.row_fact();
-				if(transA == 't'){
-					cuvAssert(A_h == v.size());
-					cuvAssert(A_w == dst.size());
-					for(index_type i = 0; i < num_diags; i++){
-						const int k = offsets[i];  //diagonal offset
 
-						const index_type i_start =  1 * std::max((int)0, k);
-						const index_type j_start = rf * std::max((int)0,-k); // the matrix is now _wider_ than high --> stretch columns!
+		/**
+		 * adds factAv * A * B (or factAv * A^T * B) to the rows [r0,r1) of NB columns of C for all diagonals of A.
+		 *
+		 * The inner loops run along a diagonal, which is contiguous in A,
+		 * B and C if the row factor is one, so they can be vectorized. The
+		 * NB columns are updated one after the other while the part of the
+		 * diagonal for rows [r0,r1) is in cache. RF is the row factor
+		 * of A, or zero if it is only known at runtime.
+		 *
+		 * M is host_memory_space, or dev_memory_space if CUV is built without CUDA.
+		 */
+		template<int RF, int NB, class value_type, class M, class index_type>
+			void spmm_dia_host_tile(const dia_matrix<value_type,M,index_type>& A,
+					value_type* C, int ldc, const value_type* B, int ldb, char transA, const value_type factAv,
+					int r0, int r1){
+				const int* offsets  = A.get_offsets().ptr();
+				const int num_diags = A.num_dia();
+				const int A_h       = A.h();
+				const int A_w       = A.w();
+				const int A_stride  = A.stride();
+				const int rf        = RF ? RF : A.row_fact();
 
-						//number of elements to process
-						const index_type N = std::min((A_h - j_start)/rf, A_w - i_start);
+				value_type* y[NB];
+				const value_type* x[NB];
+				for(int i = 0; i < num_diags; i++){
+					const int k = offsets[i];  //diagonal offset
+					int i_start, j_start, N;
+					if(transA == 't'){
+						i_start = std::max(0, k);
+						j_start = rf*std::max(0,-k);
+						N = std::min((A_h - j_start)/rf, A_w - i_start);
+					}else{
+						i_start = rf*std::max(0,-k);
+						j_start = std::max(0, k);
+						N = std::min(A_h - i_start, rf*(A_w - j_start));
+					}
+					const int lo = std::max(r0, i_start);
+					const int hi = std::min(r1, i_start + N);
+					if(lo >= hi)
+						continue;
+					for(int c = 0; c < NB; c++){
+						y[c] = C + c*ldc;
+						x[c] = B + c*ldb + j_start;
+					}
+					if(transA == 't'){
+						// y[r] += sum of rf consecutive products, d and x start at j_start
+						const value_type* d = A.vec().ptr() + i*A_stride + j_start;
+						for(int c = 0; c < NB; c++){
+							value_type* yc = y[c];
+							const value_type* xc = x[c];
+							for(int r = lo; r < hi; r++){
+								const int n = (r - i_start) * rf;
+								value_type sum = 0;
+								for(int q = 0; q < rf; q++)
+									sum += d[n+q] * xc[n+q];
+								yc[r] += factAv * sum;
+							}
+						}
+					}else{
+						// d and y start at row 0, x at j_start
+						const value_type* d = A.vec().ptr() + i*A_stride;
+						for(int c = 0; c < NB; c++){
+							value_type* yc = y[c];
+							const value_type* xc = x[c];
+							for(int r = lo; r < hi; r++)
+								yc[r] += factAv * d[r] * xc[(r - i_start) / rf];
+						}
+					}
+				}
+			}
 
-						const value_type * d_ = A.vec().ptr() + i*A_stride + j_start;
-						const value_type * x_ = v.ptr() + j_start;
-						value_type * y_ = dst.ptr() + i_start;
+		/// selects the specialization of spmm_dia_host_tile for the row factor of A
+		template<int NB, class value_type, class M, class index_type>
+			void spmm_dia_host_tile(const dia_matrix<value_type,M,index_type>& A,
+					value_type* C, int ldc, const value_type* B, int ldb, char transA, const value_type factAv,
+					int r0, int r1){
+				switch(A.row_fact()){
+					case 1:  spmm_dia_host_tile<1,NB>(A,C,ldc,B,ldb,transA,factAv,r0,r1); break;
+					case 2:  spmm_dia_host_tile<2,NB>(A,C,ldc,B,ldb,transA,factAv,r0,r1); break;
+					case 4:  spmm_dia_host_tile<4,NB>(A,C,ldc,B,ldb,transA,factAv,r0,r1); break;
+					default: spmm_dia_host_tile<0,NB>(A,C,ldc,B,ldb,transA,factAv,r0,r1); break;
+				}
+			}
 
-						for(index_type n = 0; n < N; n++,y_++){
-							for(int k=0;k<rf;k++,x_++,d_++)
-								*y_ += factAv * *d_ * *x_;
+		/**
+		 * computes C = factC * C + factAv * A * B for tiles of rows of C, used by parallel_tasks.
+		 *
+		 * A tile of C stays in cache while all diagonals are applied to it,
+		 * and every part of a diagonal is loaded from memory once for SPMM_HOST_COLS columns of B.
+		 */
+		template<class value_type, class M, class index_type>
+			struct spmm_dia_host_tiles{
+				const dia_matrix<value_type,M,index_type>& A;
+				value_type* C;
+				const value_type* B;
+				int ldc, ldb, n_cols, n_rows, tile;
+				char transA;
+				value_type factAv, factC;
+				spmm_dia_host_tiles(const dia_matrix<value_type,M,index_type>& _A,
+						value_type* _C, int _ldc, const value_type* _B, int _ldb, int _n_cols, int _n_rows, int _tile,
+						char _transA, const value_type& _factAv, const value_type& _factC)
+					:A(_A),C(_C),B(_B),ldc(_ldc),ldb(_ldb),n_cols(_n_cols),n_rows(_n_rows),tile(_tile)
+					,transA(_transA),factAv(_factAv),factC(_factC){}
+				void operator()(size_t begin, size_t end){
+					for(size_t t = begin; t < end; t++){
+						const int r0 = t * tile;
+						const int r1 = std::min(n_rows, r0 + tile);
+						for(int c = 0; c < n_cols; c++){
+							value_type* y = C + c*ldc;
+							if(factC == 0.f)
+								std::fill(y + r0, y + r1, (value_type)0);
+							else
+								for(int r = r0; r < r1; r++)
+									y[r] *= factC;
 						}
+						int c = 0;
+						for(; c + SPMM_HOST_COLS <= n_cols; c += SPMM_HOST_COLS)
+							spmm_dia_host_tile<SPMM_HOST_COLS>(A, C + c*ldc, ldc, B + c*ldb, ldb, transA, factAv, r0, r1);
+						for(; c < n_cols; c++)
+							spmm_dia_host_tile<1>(A, C + c*ldc, ldc, B + c*ldb, ldb, transA, factAv, r0, r1);
 					}
-				}else{
-					cuvAssert(A_w == v.size());
-					cuvAssert(A_h == dst.size());
-					for(index_type i = 0; i < num_diags; i++){
-						const int k = offsets[i];  //diagonal offset
-
-						const index_type i_start = rf*std::max((int)0,-k);
-						const index_type j_start =  1*std::max((int)0, k);
+				}
+			};
 
-						//number of elements to process
-						const index_type N = std::min(A_h - i_start, rf*(A_w - j_start));
+		/**
+		 * C = factC * C + factAv * A * B for n_cols columns of B and C (stored with leading dimensions ldb and ldc).
+		 *
+		 * Rows of C are processed in parallel on the host thread pool.
+		 */
+		template<class value_type, class M, class index_type>
+			void spmm_dia_host(value_type* C, int ldc, const dia_matrix<value_type,M,index_type>& A,
+					const value_type* B, int ldb, int n_cols, char transA, const float& factAv, const float& factC){
+				const int n_rows = (transA=='t') ? A.w() : A.h();
+				if(n_rows == 0 || n_cols == 0)
+					return;
+				// a tile of C should fit into the cache
+				const int tile = std::max((size_t)SPMM_HOST_MIN_TILE, host_chunk_size(sizeof(value_type) * n_cols));
+				const size_t n_tiles = (n_rows + tile - 1) / tile;
+				spmm_dia_host_tiles<value_type,M,index_type> task(A, C, ldc, B, ldb, n_cols, n_rows, tile, transA, factAv, factC);
+				if((size_t)n_rows * n_cols * std::max(1, A.num_dia()) < get_host_parallel_threshold())
+					task(0, n_tiles);
+				else
+					parallel_tasks(n_tiles, task);
+			}
 
-						const value_type * d_ = A.vec().ptr() + i*A_stride + i_start;
-						const value_type * x_ = v.ptr() + j_start;
-						value_type * y_ = dst.ptr() + i_start;
+		/// the device overload above is more specialized, this one is used for M=dev_memory_space only without CUDA
+		template<class value_type, class M, class index_type>
+			void spmv(tensor<value_type,M>& dst, const dia_matrix<value_type,M,index_type>& A, const tensor<value_type,M>& v, char transA, const float& factAv, const float& factC){
+				if(transA == 't'){
+					cuvAssert(A.h() == v.size());
+					cuvAssert(A.w() == dst.size());
+				}else{
+					cuvAssert(A.w() == v.size());
+					cuvAssert(A.h() == dst.size());
+				}
+				spmm_dia_host(dst.ptr(), dst.size(), A, v.ptr(), v.size(), 1, transA, factAv, factC);
+			}
 
-						for(index_type n = 0; n < N; n++){
-							*y_++ += factAv * *d_++ * x_[n/rf];
-						}
-					}
+		/**
+		 * dense-matrix product with a diagonal matrix on the host, all columns
+		 * of B in one sweep over the diagonals.
+		 *
+		 * M is host_memory_space, or dev_memory_space if CUV is built without CUDA.
+		 */
+		template<class M>
+			void prod_host(tensor<float,M,column_major>& dst,
+					const dia_matrix<float,M>& A,
+					const tensor<float,M,column_major>& B,
+					char transA, char transB,
+					const float& factAB, const float& factC){
+				cuvAssert(dst.shape().size()==2);
+				cuvAssert(B.shape().size()==2);
+				cuvAssert(transB == 'n');
+				cuvAssert(dst.shape()[1] == B.shape()[1]);
+				if(transA=='t'){
+					cuvAssert(A.w() == dst.shape()[0]);
+					cuvAssert(A.h() == B.shape()[0]);
+				}else{
+					cuvAssert(A.h() == dst.shape()[0]);
+					cuvAssert(A.w() == B.shape()[0]);
 				}
+				spmm_dia_host(dst.ptr(), dst.shape()[0], A, B.ptr(), B.shape()[0], dst.shape()[1], transA, factAB, factC);
 			}
 	}
 
@@ -208,15 +344,7 @@ namespace cuv{
 				  char transB,
 				  const float& factAB,
 				  const float& factC){
-                        cuvAssert(dst.shape().size()==2);
-                        cuvAssert(B.shape().size()==2);
-			cuvAssert(transB == 'n');
-			cuvAssert(dst.shape()[1] == B.shape()[1]);
-			for(int i=0;i<dst.shape()[1];i++){
-				tensor<float,host_memory_space> dst_v(indices[index_range(0,dst.shape()[0])], dst.ptr()+i*dst.shape()[0]);
-				const tensor<float,host_memory_space> src_v(indices[index_range(0,B.shape()[0])],   const_cast<float*>(B.ptr()+i*B.shape()[0]));
-				spmv(dst_v,A,src_v,transA,factAB,factC);
-			}
+			spmv_impl::prod_host(dst,A,B,transA,transB,factAB,factC);
 		}
 	template<>
 		void prod(tensor<float,dev_memory_space,column_major>& dst,
@@ -226,6 +354,9 @@ namespace cuv{
 				  char transB,
 				  const float& factAB,
 				  const float& factC){
+#ifdef CUV_NO_CUDA
+			spmv_impl::prod_host(dst,A,B,transA,transB,factAB,factC);
+#else
                         cuvAssert(dst.shape().size()==2);
                         cuvAssert(B.shape().size()==2);
 			cuvAssert(transB == 'n');
@@ -244,6 +375,7 @@ namespace cuv{
 				const tensor<float,dev_memory_space> src_v(indices[index_range(0,B.shape()[0]* min(B.shape()[1]-i,  num_at_same_time))], const_cast<float*>(B.ptr()+i*B.shape()[0]));
 				spmv(dst_v,A,src_v,transA,factAB,factC);
 			}
+#endif /* CUV_NO_CUDA */
 		}
       template<class __value_type, class __memory_space_type>
               void spmv(tensor<__value_type, __memory_space_type>& dst, const dia_matrix<__value_type, __memory_space_type>& A, const tensor<__value_type, __memory_space_type>& v,const  char transA, const float& factAv, const float& factC){
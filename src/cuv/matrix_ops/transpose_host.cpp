@@ -0,0 +1,246 @@
+//*LB*
+// Copyright (c) 2010, University of Bonn, Institute for Computer Science VI
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+//  * Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//  * Neither the name of the University of Bonn 
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this software without specific prior written
+//    permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//*LE*
+
+
+
+
+/**
+ * @file transpose_host.cpp
+ * @brief tiled, multi-threaded host transposition
+ * @ingroup blas3
+ */
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <cuv/tools/cuv_general.hpp>
+#include <cuv/tools/thread_pool.hpp>
+#include <cuv/matrix_ops/transpose_host.hpp>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace cuv{ namespace detail{
+
+namespace{
+    /// edge length of a tile in elements. Source and destination tile of 4-byte elements fit into L1 cache.
+    const size_t TRANSPOSE_TILE = 64;
+
+    /// edge length of a block which is transposed in registers
+    const size_t TRANSPOSE_BLOCK = 8;
+
+    /**
+     * transpose one 8x8 block: dst[j*ldd+i] = src[i*lds+j].
+     *
+     * All rows are loaded before anything is stored, so the compiler keeps the
+     * block in registers.
+     */
+    template<class T>
+    inline void transpose_block(T* dst, size_t ldd, const T* src, size_t lds){
+        T b[TRANSPOSE_BLOCK][TRANSPOSE_BLOCK];
+        for(size_t i=0;i<TRANSPOSE_BLOCK;i++)
+            for(size_t j=0;j<TRANSPOSE_BLOCK;j++)
+                b[j][i] = src[i*lds+j];
+        for(size_t j=0;j<TRANSPOSE_BLOCK;j++)
+            for(size_t i=0;i<TRANSPOSE_BLOCK;i++)
+                dst[j*ldd+i] = b[j][i];
+    }
+
+#if defined(__SSE2__)
+    /// 8x8 block of 4-byte elements as four 4x4 SSE transposes (shuffles only, bit patterns are preserved)
+    template<>
+    inline void transpose_block<unsigned int>(unsigned int* dst_, size_t ldd, const unsigned int* src_, size_t lds){
+        const float* src = reinterpret_cast<const float*>(src_);
+        float*       dst = reinterpret_cast<float*>(dst_);
+        __m128 r0l = _mm_loadu_ps(src + 0*lds), r0h = _mm_loadu_ps(src + 0*lds + 4);
+        __m128 r1l = _mm_loadu_ps(src + 1*lds), r1h = _mm_loadu_ps(src + 1*lds + 4);
+        __m128 r2l = _mm_loadu_ps(src + 2*lds), r2h = _mm_loadu_ps(src + 2*lds + 4);
+        __m128 r3l = _mm_loadu_ps(src + 3*lds), r3h = _mm_loadu_ps(src + 3*lds + 4);
+        __m128 r4l = _mm_loadu_ps(src + 4*lds), r4h = _mm_loadu_ps(src + 4*lds + 4);
+        __m128 r5l = _mm_loadu_ps(src + 5*lds), r5h = _mm_loadu_ps(src + 5*lds + 4);
+        __m128 r6l = _mm_loadu_ps(src + 6*lds), r6h = _mm_loadu_ps(src + 6*lds + 4);
+        __m128 r7l = _mm_loadu_ps(src + 7*lds), r7h = _mm_loadu_ps(src + 7*lds + 4);
+        _MM_TRANSPOSE4_PS(r0l, r1l, r2l, r3l);
+        _MM_TRANSPOSE4_PS(r0h, r1h, r2h, r3h);
+        _MM_TRANSPOSE4_PS(r4l, r5l, r6l, r7l);
+        _MM_TRANSPOSE4_PS(r4h, r5h, r6h, r7h);
+        // row j of dst consists of column j of the upper and the lower half of src
+        _mm_storeu_ps(dst + 0*ldd, r0l); _mm_storeu_ps(dst + 0*ldd + 4, r4l);
+        _mm_storeu_ps(dst + 1*ldd, r1l); _mm_storeu_ps(dst + 1*ldd + 4, r5l);
+        _mm_storeu_ps(dst + 2*ldd, r2l); _mm_storeu_ps(dst + 2*ldd + 4, r6l);
+        _mm_storeu_ps(dst + 3*ldd, r3l); _mm_storeu_ps(dst + 3*ldd + 4, r7l);
+        _mm_storeu_ps(dst + 4*ldd, r0h); _mm_storeu_ps(dst + 4*ldd + 4, r4h);
+        _mm_storeu_ps(dst + 5*ldd, r1h); _mm_storeu_ps(dst + 5*ldd + 4, r5h);
+        _mm_storeu_ps(dst + 6*ldd, r2h); _mm_storeu_ps(dst + 6*ldd + 4, r6h);
+        _mm_storeu_ps(dst + 7*ldd, r3h); _mm_storeu_ps(dst + 7*ldd + 4, r7h);
+    }
+#endif
+
+    /// runs a functor on tiles [0,n_tiles) for a range of the elements of the matrix
+    template<class F>
+    struct tiles_of_elements{
+        F& f;
+        size_t n_tiles, elements;
+        tiles_of_elements(F& f_, size_t n, size_t e):f(f_), n_tiles(n), elements(e){}
+        void operator()(size_t begin, size_t end){
+            f(begin * n_tiles / elements, end * n_tiles / elements);
+        }
+    };
+
+    /**
+     * run f(begin,end) on tiles [0,n) with parallel_for over the elements of
+     * the matrix, so that its threshold and thread limits apply. A chunk
+     * covers about one tile.
+     */
+    template<class F>
+    void parallel_for_tiles(size_t n, size_t elements, F& f){
+        tiles_of_elements<F> t(f, n, elements);
+        parallel_for(elements, std::max(elements / n, (size_t)1), t);
+    }
+
+    /// transposes the tiles [begin,end) of a row-major tiling of the source
+    template<class T>
+    struct transpose_tiles{
+        T* dst; const T* src;
+        size_t rows, cols, ldd, lds, tiles_x;
+        void operator()(size_t begin, size_t end)const{
+            for(size_t t=begin; t<end; t++){
+                const size_t r0 = (t / tiles_x) * TRANSPOSE_TILE;
+                const size_t c0 = (t % tiles_x) * TRANSPOSE_TILE;
+                const size_t r1 = std::min(rows, r0 + TRANSPOSE_TILE);
+                const size_t c1 = std::min(cols, c0 + TRANSPOSE_TILE);
+                const size_t rb = r0 + (r1 - r0) / TRANSPOSE_BLOCK * TRANSPOSE_BLOCK;
+                const size_t cb = c0 + (c1 - c0) / TRANSPOSE_BLOCK * TRANSPOSE_BLOCK;
+                for(size_t r=r0; r<rb; r+=TRANSPOSE_BLOCK)
+                    for(size_t c=c0; c<cb; c+=TRANSPOSE_BLOCK)
+                        transpose_block(dst + c*ldd + r, ldd, src + r*lds + c, lds);
+                // margins which do not fill a whole block
+                for(size_t r=r0; r<rb; r++)
+                    for(size_t c=cb; c<c1; c++)
+                        dst[c*ldd + r] = src[r*lds + c];
+                for(size_t r=rb; r<r1; r++)
+                    for(size_t c=c0; c<c1; c++)
+                        dst[c*ldd + r] = src[r*lds + c];
+            }
+        }
+    };
+
+    /**
+     * transposes the tiles [begin,end) of the upper triangle of a square matrix in place.
+     *
+     * Tile (ti,tj) with ti<tj is swapped with the transposed tile (tj,ti),
+     * tiles below the diagonal are skipped.
+     */
+    template<class T>
+    struct transpose_tiles_inplace{
+        T* A;
+        size_t n, lda, tiles_x;
+        /// swap block (r,c) with block (c,r), transposing both. For r==c the block is transposed in place.
+        inline void swap_blocks(size_t r, size_t c)const{
+            T tmp[TRANSPOSE_BLOCK*TRANSPOSE_BLOCK];
+            transpose_block(tmp, TRANSPOSE_BLOCK, A + r*lda + c, lda);
+            if(r != c)
+                transpose_block(A + r*lda + c, lda, A + c*lda + r, lda);
+            for(size_t i=0;i<TRANSPOSE_BLOCK;i++)
+                std::memcpy(A + (c+i)*lda + r, tmp + i*TRANSPOSE_BLOCK, TRANSPOSE_BLOCK*sizeof(T));
+        }
+        void operator()(size_t begin, size_t end)const{
+            for(size_t t=begin; t<end; t++){
+                const size_t ti = t / tiles_x, tj = t % tiles_x;
+                if(tj < ti)
+                    continue;
+                const size_t r0 = ti * TRANSPOSE_TILE, c0 = tj * TRANSPOSE_TILE;
+                const size_t r1 = std::min(n, r0 + TRANSPOSE_TILE);
+                const size_t c1 = std::min(n, c0 + TRANSPOSE_TILE);
+                const size_t rb = r0 + (r1 - r0) / TRANSPOSE_BLOCK * TRANSPOSE_BLOCK;
+                const size_t cb = c0 + (c1 - c0) / TRANSPOSE_BLOCK * TRANSPOSE_BLOCK;
+                for(size_t r=r0; r<rb; r+=TRANSPOSE_BLOCK)
+                    for(size_t c=(ti==tj ? r : c0); c<cb; c+=TRANSPOSE_BLOCK)
+                        swap_blocks(r, c);
+                // margins which do not fill a whole block. On the diagonal
+                // tile only elements above the diagonal are swapped.
+                for(size_t r=r0; r<r1; r++){
+                    size_t c = (r < rb) ? cb : c0;
+                    if(ti == tj)
+                        c = std::max(c, r+1);
+                    for(; c<c1; c++)
+                        std::swap(A[r*lda + c], A[c*lda + r]);
+                }
+            }
+        }
+    };
+
+    template<class T>
+    void transpose_typed(T* dst, const T* src, size_t rows, size_t cols, size_t ldd, size_t lds){
+        transpose_tiles<T> f;
+        f.dst = dst; f.src = src;
+        f.rows = rows; f.cols = cols; f.ldd = ldd; f.lds = lds;
+        f.tiles_x = (cols + TRANSPOSE_TILE - 1) / TRANSPOSE_TILE;
+        const size_t tiles_y = (rows + TRANSPOSE_TILE - 1) / TRANSPOSE_TILE;
+        parallel_for_tiles(tiles_y * f.tiles_x, rows*cols, f);
+    }
+
+    template<class T>
+    void transpose_inplace_typed(T* A, size_t n, size_t lda){
+        transpose_tiles_inplace<T> f;
+        f.A = A; f.n = n; f.lda = lda;
+        f.tiles_x = (n + TRANSPOSE_TILE - 1) / TRANSPOSE_TILE;
+        parallel_for_tiles(f.tiles_x * f.tiles_x, n*n, f);
+    }
+}
+
+void host_transpose(void* dst, const void* src, size_t rows, size_t cols,
+        size_t ldd, size_t lds, size_t elem_size){
+    cuvAssert(ldd >= rows);
+    cuvAssert(lds >= cols);
+    if(rows == 0 || cols == 0)
+        return;
+    switch(elem_size){
+        case 1: transpose_typed((unsigned char*)dst,      (const unsigned char*)src,      rows, cols, ldd, lds); break;
+        case 2: transpose_typed((unsigned short*)dst,     (const unsigned short*)src,     rows, cols, ldd, lds); break;
+        case 4: transpose_typed((unsigned int*)dst,       (const unsigned int*)src,       rows, cols, ldd, lds); break;
+        case 8: transpose_typed((unsigned long long*)dst, (const unsigned long long*)src, rows, cols, ldd, lds); break;
+        default: throw std::runtime_error("host_transpose: unsupported element size");
+    }
+}
+
+void host_transpose_inplace(void* A, size_t n, size_t lda, size_t elem_size){
+    cuvAssert(lda >= n);
+    if(n < 2)
+        return;
+    switch(elem_size){
+        case 1: transpose_inplace_typed((unsigned char*)A,      n, lda); break;
+        case 2: transpose_inplace_typed((unsigned short*)A,     n, lda); break;
+        case 4: transpose_inplace_typed((unsigned int*)A,       n, lda); break;
+        case 8: transpose_inplace_typed((unsigned long long*)A, n, lda); break;
+        default: throw std::runtime_error("host_transpose_inplace: unsupported element size");
+    }
+}
+
+} }
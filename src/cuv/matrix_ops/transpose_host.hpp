@@ -0,0 +1,79 @@
+//*LB*
+// Copyright (c) 2010, University of Bonn, Institute for Computer Science VI
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+//  * Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//  * Neither the name of the University of Bonn 
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this software without specific prior written
+//    permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//*LE*
+
+
+
+
+/**
+ * @file transpose_host.hpp
+ * @brief host (CPU) implementation of matrix transposition
+ * @ingroup blas3
+ *
+ * The matrix is split into square tiles which fit into L1 cache. Tiles are
+ * processed on the host thread pool, within a tile 8x8 blocks are read into
+ * registers, transposed there and written back, so that both source and
+ * destination are accessed in contiguous rows.
+ */
+#ifndef __TRANSPOSE_HOST_HPP__
+#define __TRANSPOSE_HOST_HPP__
+
+#include <cstddef>
+
+namespace cuv{ namespace detail{
+
+/**
+ * transpose a row-major matrix of rows x cols elements of elem_size bytes.
+ *
+ * dst[c*ldd + r] = src[r*lds + c] for all 0<=r<rows, 0<=c<cols.
+ * The matrices must not overlap.
+ *
+ * @param dst       destination (cols x rows)
+ * @param src       source      (rows x cols)
+ * @param rows      number of rows of src
+ * @param cols      number of columns of src
+ * @param ldd       distance between rows of dst in elements (>= rows)
+ * @param lds       distance between rows of src in elements (>= cols)
+ * @param elem_size size of one element in bytes (1, 2, 4 or 8)
+ */
+void host_transpose(void* dst, const void* src, size_t rows, size_t cols,
+        size_t ldd, size_t lds, size_t elem_size);
+
+/**
+ * transpose a square n x n row-major matrix in place.
+ *
+ * @param A         the matrix
+ * @param n         number of rows and columns of A
+ * @param lda       distance between rows of A in elements (>= n)
+ * @param elem_size size of one element in bytes (1, 2, 4 or 8)
+ */
+void host_transpose_inplace(void* A, size_t n, size_t lda, size_t elem_size);
+
+} }
+
+#endif /* __TRANSPOSE_HOST_HPP__ */
@@ -0,0 +1,131 @@
+//*LB*
+// Copyright (c) 2010, University of Bonn, Institute for Computer Science VI
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+//  * Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//  * Neither the name of the University of Bonn 
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this software without specific prior written
+//    permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//*LE*
+
+
+
+
+/**
+ * @file philox.hpp
+ * @brief counter-based Philox4x32-10 random number generator for the host
+ *
+ * See Salmon et al., "Parallel random numbers: as easy as 1, 2, 3", SC 2011.
+ * The n-th block of four 32 bit numbers is a function of the key and n
+ * only, so any part of a stream can be generated independently.
+ */
+#ifndef __CUV_PHILOX_HPP__
+#define __CUV_PHILOX_HPP__
+
+#include <cmath>
+
+namespace cuv{
+namespace detail{
+
+/// number of Philox blocks generated together, the loops over a batch are vectorized by the compiler
+static const unsigned int PHILOX_BATCH = 16;
+
+static const unsigned int PHILOX_M0 = 0xD2511F53u;
+static const unsigned int PHILOX_M1 = 0xCD9E8D57u;
+static const unsigned int PHILOX_W0 = 0x9E3779B9u;
+static const unsigned int PHILOX_W1 = 0xBB67AE85u;
+
+/**
+ * Philox4x32-10 for a single counter.
+ *
+ * @param ctr  counter, replaced by the random block
+ * @param key  key, i.e. the seed
+ */
+inline void philox4x32(unsigned int ctr[4], const unsigned int key[2]){
+    unsigned int k0 = key[0], k1 = key[1];
+    for(int r = 0; r < 10; r++){
+        unsigned long long p0 = (unsigned long long) PHILOX_M0 * ctr[0];
+        unsigned long long p1 = (unsigned long long) PHILOX_M1 * ctr[2];
+        unsigned int c0 = (unsigned int)(p1 >> 32) ^ ctr[1] ^ k0;
+        unsigned int c2 = (unsigned int)(p0 >> 32) ^ ctr[3] ^ k1;
+        ctr[1] = (unsigned int) p1;
+        ctr[3] = (unsigned int) p0;
+        ctr[0] = c0;
+        ctr[2] = c2;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+}
+
+/**
+ * uniformly distributed floats in (0,1] for PHILOX_BATCH consecutive blocks.
+ *
+ * The counter of block b is (first_block + b, 0), the four numbers of a
+ * block are stored consecutively in dst, which holds 4*PHILOX_BATCH values.
+ */
+inline void philox4x32_uniform_batch(float* dst, unsigned long long first_block, const unsigned int key[2]){
+    unsigned int c0[PHILOX_BATCH], c1[PHILOX_BATCH], c2[PHILOX_BATCH], c3[PHILOX_BATCH];
+    for(unsigned int b = 0; b < PHILOX_BATCH; b++){
+        c0[b] = (unsigned int)(first_block + b);
+        c1[b] = (unsigned int)((first_block + b) >> 32);
+        c2[b] = 0;
+        c3[b] = 0;
+    }
+    unsigned int k0 = key[0], k1 = key[1];
+    for(int r = 0; r < 10; r++){
+        for(unsigned int b = 0; b < PHILOX_BATCH; b++){
+            unsigned long long p0 = (unsigned long long) PHILOX_M0 * c0[b];
+            unsigned long long p1 = (unsigned long long) PHILOX_M1 * c2[b];
+            c0[b] = (unsigned int)(p1 >> 32) ^ c1[b] ^ k0;
+            c2[b] = (unsigned int)(p0 >> 32) ^ c3[b] ^ k1;
+            c1[b] = (unsigned int) p1;
+            c3[b] = (unsigned int) p0;
+        }
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+    // 24 random bits, shifted to exclude zero
+    const float scale = 1.f / 16777216.f;
+    for(unsigned int b = 0; b < PHILOX_BATCH; b++){
+        dst[4*b + 0] = ((c0[b] >> 8) + 1) * scale;
+        dst[4*b + 1] = ((c1[b] >> 8) + 1) * scale;
+        dst[4*b + 2] = ((c2[b] >> 8) + 1) * scale;
+        dst[4*b + 3] = ((c3[b] >> 8) + 1) * scale;
+    }
+}
+
+/**
+ * transforms pairs of uniform numbers in (0,1] to pairs of standard normal numbers (Box-Muller)
+ */
+inline void box_muller(float* v, unsigned int n){
+    for(unsigned int i = 0; i + 1 < n; i += 2){
+        float r     = std::sqrt(-2.f * std::log(v[i]));
+        float theta = 6.2831853071795864f * v[i+1];
+        v[i]   = r * std::cos(theta);
+        v[i+1] = r * std::sin(theta);
+    }
+}
+
+}
+}
+
+#endif /* __CUV_PHILOX_HPP__ */
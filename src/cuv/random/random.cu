@@ -34,18 +34,24 @@
 #include <string>
 #include <cmath>
 #include <iostream>
+#include <algorithm>
 
 #include "random.hpp"
+#include "philox.hpp"
+#include <cuv/tools/thread_pool.hpp>
 
+#ifndef CUV_NO_CUDA
 #include <cuda.h>
 #include <curand.h>
 #include <curand_kernel.h>
+#endif
 
 #define NUM_RND_BLOCKS                      96
 #define NUM_RND_THREADS_PER_BLOCK           128
 #define NUM_RND_STREAMS                     (NUM_RND_BLOCKS * NUM_RND_THREADS_PER_BLOCK)
 
 namespace cuv{
+#ifndef CUV_NO_CUDA
     __global__ void setup_kernel(curandState* state, unsigned long long  seed){
     const uint tidx = NUM_RND_THREADS_PER_BLOCK * blockIdx.x + threadIdx.x;
     /* Each thread gets same seed, a different sequence number,
@@ -55,7 +61,20 @@ namespace cuv{
 	// Initialize seeds for the Mersenne Twister
 	static bool* g_mersenne_twister_initialized;
     static curandState** g_rnd_dev_state = NULL;
+#endif
+	static host_rng_state g_host_rng_state = {0, 0};
+
+	host_rng_state get_host_rng_state(){
+		return g_host_rng_state;
+	}
+	void set_host_rng_state(const host_rng_state& state){
+		g_host_rng_state = state;
+	}
+
 	void initialize_mersenne_twister_seeds(unsigned int seed) {
+        host_rng_state hs = {seed, 0};
+        set_host_rng_state(hs);
+#ifndef CUV_NO_CUDA
         if(g_rnd_dev_state==NULL){
             int cnt;
             cuvSafeCall(cudaGetDeviceCount(&cnt));
@@ -74,15 +93,19 @@ namespace cuv{
         setup_kernel<<<NUM_RND_BLOCKS, NUM_RND_THREADS_PER_BLOCK>>>(g_rnd_dev_state[dev], 1 + seed*2); // so there's no chance it'll be correlated with the other one
         cuvSafeCall(cudaThreadSynchronize());
 		g_mersenne_twister_initialized[dev] = true;
+#endif
 	}
 	void deinit_rng(unsigned int seed) {
+#ifndef CUV_NO_CUDA
         int dev;
         cuvSafeCall(cudaGetDevice(&dev));
         cuvSafeCall(cudaFree(g_rnd_dev_state[dev]));
         g_rnd_dev_state[dev] = NULL;
 		g_mersenne_twister_initialized[dev] = false;
+#endif
 	}
     
+#ifndef CUV_NO_CUDA
     struct uf_binarize{
         public:
             __device__ inline float operator()(float f, curandState* state){
@@ -113,7 +136,76 @@ namespace cuv{
                 return f + m_std*curand_normal(state);
             }
     };
+#endif
+
+    /**
+     * host counterpart of uf_uniform, uf_binarize and uf_add_gaussian.
+     * Element i of a call is computed from block first_block + i/4 of the
+     * Philox stream, independent of how the elements are split among threads.
+     */
+    template<class Op>
+    struct host_rng_kernel{
+        float* m_dst;
+        unsigned long long m_first_block;
+        unsigned int m_key[2];
+        Op m_op;
+        host_rng_kernel(float* dst, unsigned long long first_block, unsigned long long seed, const Op& op)
+            :m_dst(dst), m_first_block(first_block), m_op(op){
+            m_key[0] = (unsigned int) seed;
+            m_key[1] = (unsigned int)(seed >> 32);
+        }
+        void operator()(size_t begin, size_t end){
+            const size_t batch = 4 * detail::PHILOX_BATCH;
+            float rnd[4 * detail::PHILOX_BATCH];
+            for(size_t b = begin / batch * batch; b < end; b += batch){
+                detail::philox4x32_uniform_batch(rnd, m_first_block + b / 4, m_key);
+                m_op.transform(rnd, batch);
+                size_t i0 = std::max(b, begin);
+                size_t i1 = std::min(b + batch, end);
+                for(size_t i = i0; i < i1; i++)
+                    m_dst[i] = m_op(m_dst[i], rnd[i - b]);
+            }
+        }
+    };
+    struct hf_uniform{
+        inline void transform(float*, unsigned int)const{}
+        inline float operator()(float, float r)const{ return r; }
+    };
+    struct hf_binarize{
+        inline void transform(float*, unsigned int)const{}
+        inline float operator()(float f, float r)const{ return f > r; }
+    };
+    struct hf_add_gaussian{
+        float m_std;
+        hf_add_gaussian(float std):m_std(std){}
+        inline void transform(float* r, unsigned int n)const{ detail::box_muller(r, n); }
+        inline float operator()(float f, float r)const{ return f + m_std * r; }
+    };
+
+    template<class Op>
+        void
+    call_host_rng_kernel(tensor<float,host_memory_space>& dst, const Op& op){
+        size_t size = dst.size();
+        // reserve a range of the stream, rounded to whole blocks
+        unsigned long long first_block = __sync_fetch_and_add(&g_host_rng_state.counter, (unsigned long long)(size + 3) / 4);
+        host_rng_kernel<Op> kernel(dst.ptr(), first_block, g_host_rng_state.seed, op);
+        parallel_for(size, host_chunk_size(sizeof(float)), kernel);
+    }
 
+#ifdef CUV_NO_CUDA
+    // without CUDA, device memory lives on the host: draw from the host stream
+    typedef hf_binarize uf_binarize;
+    typedef hf_uniform uf_uniform;
+    typedef hf_add_gaussian uf_add_gaussian;
+
+    template<class Op>
+        void
+    call_unary_rng_kernel(tensor<float,dev_memory_space>& dst, tensor<float,dev_memory_space>& src, const Op& op){
+        cuvAssert(dst.ptr() == src.ptr());
+        tensor<float,host_memory_space> h = detail::host_alias(dst);
+        call_host_rng_kernel(h, op);
+    }
+#else
     template<class Op>
     __global__ void unary_rng_kernel(float* dst, const float* src, curandState* state, unsigned int size, Op op){
         const unsigned int tidx = NUM_RND_THREADS_PER_BLOCK * blockIdx.x + threadIdx.x;
@@ -134,6 +226,7 @@ namespace cuv{
         unary_rng_kernel<<<NUM_RND_BLOCKS,NUM_RND_THREADS_PER_BLOCK>>>(dst.ptr(), src.ptr(),g_rnd_dev_state[dev], dst.size(), op);
 		cuvSafeCall(cudaThreadSynchronize());
     }
+#endif
 
 	template<>
 	void rnd_binarize(tensor<float,dev_memory_space>& v){
@@ -143,9 +236,7 @@ namespace cuv{
 	template<>
 	void rnd_binarize(tensor<float,host_memory_space>& v){
 	   cuvAssert(v.ptr());
-	   tensor<float,host_memory_space>::value_type* ptr = v.ptr();
-	   for(int i=0;i<v.size();i++)
-		   *ptr++ = ((float)rand()/RAND_MAX) < *ptr;
+	   call_host_rng_kernel(v, hf_binarize());
 	}
         template<>
 	void rnd_binarize(tensor<float,host_memory_space,column_major>& v){
@@ -158,10 +249,7 @@ namespace cuv{
 	template<>
 	void fill_rnd_uniform(tensor<float,host_memory_space>& v){
 	   cuvAssert(v.ptr());
-	   tensor<float,host_memory_space>::value_type* ptr = v.ptr();
-       unsigned int size = v.size();
-	   for(unsigned int i=0;i<size;i++)
-		   *ptr++ = ((float)rand()/RAND_MAX);
+	   call_host_rng_kernel(v, hf_uniform());
 	}
 	template<>
 	void fill_rnd_uniform(tensor<float,dev_memory_space>& v){
@@ -176,38 +264,10 @@ namespace cuv{
 	void fill_rnd_uniform(tensor<float,dev_memory_space,column_major>& v){
             fill_rnd_uniform(*reinterpret_cast<tensor<float,dev_memory_space>* >(&v));
         }
-        double norminv(double q) {
-            if(q == .5)
-                return 0;
-
-            q = 1.0 - q;
-
-            double p = (q > 0.0 && q < 0.5) ? q : (1.0 - q);
-            double t = sqrt(log(1.0 / pow(p, 2.0)));
-
-            double c0 = 2.515517;
-            double c1 = 0.802853;
-            double c2 = 0.010328;
-
-            double d1 = 1.432788;
-            double d2 = 0.189269;
-            double d3 = 0.001308;
-
-            double x = t - (c0 + c1 * t + c2 * pow(t, 2.0)) /
-                (1.0 + d1 * t + d2 * pow(t, 2.0) + d3 * pow(t, 3.0));
-
-            if(q > .5)
-                x *= -1.0;
-
-            return x;
-        }
 	template<>
 	void add_rnd_normal(tensor<float,host_memory_space>& v, const float& std){
 	   cuvAssert(v.ptr());
-	   tensor<float,host_memory_space>::value_type* ptr = v.ptr();
-       unsigned int size = v.size();
-	   for(unsigned int i=0;i<size;i++)
-		   *ptr++ += std*norminv(drand48());
+	   call_host_rng_kernel(v, hf_add_gaussian(std));
 	}
 	template<>
 	void add_rnd_normal(tensor<float,dev_memory_space>& v, const float& std){
@@ -68,9 +68,32 @@ namespace cuv{
 	 * @param seed Seed for initialization
 	 *
 	 * This function has to be called exactly _once_ before making use of any random functions.
+	 * It also resets the host generator to the start of the stream for seed.
 	 */
 	void initialize_mersenne_twister_seeds(unsigned int seed = 0); 
 
+	/**
+	 * @brief state of the host random number generator
+	 *
+	 * Host random numbers are generated by the counter-based Philox4x32-10
+	 * generator. Every call consumes a consecutive range of the stream given
+	 * by seed, so results do not depend on the number of host threads.
+	 */
+	struct host_rng_state{
+		unsigned long long seed;     ///< key of the generator
+		unsigned long long counter;  ///< position of the next block of four numbers in the stream
+	};
+
+	/**
+	 * @brief current state of the host random number generator, e.g. to reproduce a sequence later
+	 */
+	host_rng_state get_host_rng_state();
+
+	/**
+	 * @brief continue host random number generation at the given state
+	 */
+	void set_host_rng_state(const host_rng_state& state);
+
 	/** 
 	 * @brief destruction counterpart to @see initialize_mersenne_twister_seeds
 	 * 
@@ -0,0 +1,453 @@
+//*LB*
+// Copyright (c) 2010, University of Bonn, Institute for Computer Science VI
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+//  * Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//  * Neither the name of the University of Bonn 
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this software without specific prior written
+//    permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//*LE*
+
+
+
+
+/**
+ * @file expression.hpp
+ * @brief lazily evaluated arithmetic on tensors (expression templates)
+ * @ingroup tensor_ops
+ *
+ * The arithmetic operators on tensors declared in tensor_ops.hpp evaluate
+ * eagerly: every operator allocates a temporary and sweeps over memory once.
+ * Wrapping one operand in lazy() builds an expression tree instead, which
+ * is evaluated in a single pass when it is assigned to a tensor or
+ * tensor_view:
+ *
+ * @code
+ * tensor<float,host_memory_space> a(n), b(n), c(n), d(n), e(n), r;
+ * r = lazy(a)*b + lazy(c)*d - e;        // one pass, no temporaries
+ * r[indices[index_range(0,10)]] = lazy(a) * 2.f;  // assign to a view
+ * tensor<unsigned char,host_memory_space> m = lazy(a) < 0.5f;
+ * @endcode
+ *
+ * As with the eager operators, all operands must have the same value type,
+ * shape, memory space and memory layout, and tensor operands must be
+ * c-contiguous. Comparisons result in unsigned char.
+ *
+ * Host expressions are evaluated by a fused loop on the host thread pool.
+ * Device expressions are evaluated by a single fused thrust::transform if the
+ * assignment is compiled by nvcc, and node by node using the eager functors
+ * otherwise (see detail::expression_evaluator).
+ */
+#ifndef __CUV_EXPRESSION_HPP__
+#define __CUV_EXPRESSION_HPP__
+
+#include <vector>
+#include <stdexcept>
+#include <boost/static_assert.hpp>
+#include <boost/type_traits/is_same.hpp>
+#include <cuv/basics/tensor.hpp>
+#include <cuv/tensor_ops/tensor_ops.hpp>
+#include <cuv/tools/thread_pool.hpp>
+
+#ifdef __CUDACC__
+#include <thrust/device_ptr.h>
+#include <thrust/transform.h>
+#include <thrust/iterator/counting_iterator.h>
+#endif
+
+namespace cuv{
+
+/**
+ * @addtogroup tensor_ops
+ * @{
+ */
+
+/**
+ * base class of all nodes in an expression tree (CRTP)
+ */
+template<class E>
+struct expression{
+	/// @return the derived node
+	const E& self()const{ return static_cast<const E&>(*this); }
+};
+
+namespace detail{
+	/*
+	 * operations used in expression nodes. bf, sf and rsf are the functors
+	 * which perform the same operation in the eager fallback on (tensor,tensor),
+	 * (tensor,scalar) and (scalar,tensor).
+	 */
+	struct expr_plus{
+		template<class R, class A, class B>
+		static __host__ __device__ R apply(const A& a, const B& b){ return a + b; }
+		static const BinaryFunctor bf = BF_ADD;
+		static const ScalarFunctor sf = SF_ADD, rsf = SF_ADD;
+	};
+	struct expr_minus{
+		template<class R, class A, class B>
+		static __host__ __device__ R apply(const A& a, const B& b){ return a - b; }
+		static const BinaryFunctor bf = BF_SUBTRACT;
+		static const ScalarFunctor sf = SF_SUBTRACT, rsf = SF_RSUB;
+	};
+	struct expr_multiplies{
+		template<class R, class A, class B>
+		static __host__ __device__ R apply(const A& a, const B& b){ return a * b; }
+		static const BinaryFunctor bf = BF_MULT;
+		static const ScalarFunctor sf = SF_MULT, rsf = SF_MULT;
+	};
+	struct expr_divides{
+		template<class R, class A, class B>
+		static __host__ __device__ R apply(const A& a, const B& b){ return a / b; }
+		static const BinaryFunctor bf = BF_DIV;
+		static const ScalarFunctor sf = SF_DIV, rsf = SF_RDIV;
+	};
+	struct expr_equal{
+		template<class R, class A, class B>
+		static __host__ __device__ R apply(const A& a, const B& b){ return a == b; }
+		static const BinaryFunctor bf = BF_EQ;
+		static const ScalarFunctor sf = SF_EQ, rsf = SF_EQ;
+	};
+	struct expr_less{
+		template<class R, class A, class B>
+		static __host__ __device__ R apply(const A& a, const B& b){ return a < b; }
+		static const ScalarFunctor sf = SF_LT, rsf = SF_GT;
+	};
+	struct expr_greater{
+		template<class R, class A, class B>
+		static __host__ __device__ R apply(const A& a, const B& b){ return a > b; }
+		static const ScalarFunctor sf = SF_GT, rsf = SF_LT;
+	};
+	struct expr_less_equal{
+		template<class R, class A, class B>
+		static __host__ __device__ R apply(const A& a, const B& b){ return a <= b; }
+		static const ScalarFunctor sf = SF_LEQ, rsf = SF_GEQ;
+	};
+	struct expr_greater_equal{
+		template<class R, class A, class B>
+		static __host__ __device__ R apply(const A& a, const B& b){ return a >= b; }
+		static const ScalarFunctor sf = SF_GEQ, rsf = SF_LEQ;
+	};
+
+	/// result type of an operation on operands of type V
+	template<class Op, class V> struct expression_result                 { typedef V type; };
+	template<class V> struct expression_result<expr_equal,V>             { typedef unsigned char type; };
+	template<class V> struct expression_result<expr_less,V>              { typedef unsigned char type; };
+	template<class V> struct expression_result<expr_greater,V>           { typedef unsigned char type; };
+	template<class V> struct expression_result<expr_less_equal,V>        { typedef unsigned char type; };
+	template<class V> struct expression_result<expr_greater_equal,V>     { typedef unsigned char type; };
+}
+
+/**
+ * leaf of an expression tree, refers to a tensor
+ */
+template<class V, class M, class L>
+struct tensor_expression : public expression<tensor_expression<V,M,L> >{
+	typedef V value_type;
+	typedef M memory_space_type;
+	typedef L memory_layout_type;
+	typedef typename tensor<V,M,L>::size_type size_type;
+	/// number of bytes read per element when evaluating the expression
+	static const size_t bytes_per_element = sizeof(V);
+
+	const tensor<V,M,L>* m_tensor;
+	const V* m_ptr;
+
+	tensor_expression(const tensor<V,M,L>& t)
+		:m_tensor(&t), m_ptr(t.ptr()){
+		cuvAssert(t.ptr());
+		cuvAssert(t.is_c_contiguous());
+	}
+	__host__ __device__ V operator[](size_t i)const{ return m_ptr[i]; }
+	std::vector<size_type> shape()const{ return m_tensor->shape(); }
+	/// evaluate eagerly (used by the fallback of the device backend)
+	tensor<V,M,L> materialize()const{ return *m_tensor; }
+	/// evaluate eagerly into dst
+	template<class R>
+	void materialize_into(tensor<R,M,L>& dst)const{ apply_scalar_functor(dst, *m_tensor, SF_COPY); }
+};
+
+/**
+ * applies a binary operation to the results of two expressions
+ */
+template<class Op, class E1, class E2>
+struct binary_expression : public expression<binary_expression<Op,E1,E2> >{
+	typedef typename detail::expression_result<Op, typename E1::value_type>::type value_type;
+	typedef typename E1::memory_space_type memory_space_type;
+	typedef typename E1::memory_layout_type memory_layout_type;
+	typedef typename E1::size_type size_type;
+	static const size_t bytes_per_element = E1::bytes_per_element + E2::bytes_per_element;
+	BOOST_STATIC_ASSERT((boost::is_same<typename E1::value_type, typename E2::value_type>::value));
+	BOOST_STATIC_ASSERT((boost::is_same<memory_space_type, typename E2::memory_space_type>::value));
+	BOOST_STATIC_ASSERT((boost::is_same<memory_layout_type, typename E2::memory_layout_type>::value));
+
+	E1 m_e1;
+	E2 m_e2;
+
+	binary_expression(const E1& e1, const E2& e2)
+		:m_e1(e1), m_e2(e2){
+		if(e1.shape() != e2.shape())
+			throw std::runtime_error("expression: shapes of operands do not match");
+	}
+	__host__ __device__ value_type operator[](size_t i)const{
+		return Op::template apply<value_type>(m_e1[i], m_e2[i]);
+	}
+	std::vector<size_type> shape()const{ return m_e1.shape(); }
+	tensor<value_type,memory_space_type,memory_layout_type> materialize()const{
+		tensor<value_type,memory_space_type,memory_layout_type> res(shape());
+		materialize_into(res);
+		return res;
+	}
+	template<class R>
+	void materialize_into(tensor<R,memory_space_type,memory_layout_type>& dst)const{
+		const BinaryFunctor bf = Op::bf;
+		apply_binary_functor(dst, m_e1.materialize(), m_e2.materialize(), bf);
+	}
+};
+
+/**
+ * applies a binary operation to the result of an expression and a scalar
+ *
+ * @tparam ScalarFirst if true, the scalar is the first operand
+ */
+template<class Op, class E, bool ScalarFirst>
+struct scalar_expression : public expression<scalar_expression<Op,E,ScalarFirst> >{
+	typedef typename E::value_type scalar_type;
+	typedef typename detail::expression_result<Op, scalar_type>::type value_type;
+	typedef typename E::memory_space_type memory_space_type;
+	typedef typename E::memory_layout_type memory_layout_type;
+	typedef typename E::size_type size_type;
+	static const size_t bytes_per_element = E::bytes_per_element;
+
+	E m_e;
+	scalar_type m_s;
+
+	scalar_expression(const E& e, const scalar_type& s)
+		:m_e(e), m_s(s){}
+	__host__ __device__ value_type operator[](size_t i)const{
+		return ScalarFirst
+			? Op::template apply<value_type>(m_s, m_e[i])
+			: Op::template apply<value_type>(m_e[i], m_s);
+	}
+	std::vector<size_type> shape()const{ return m_e.shape(); }
+	tensor<value_type,memory_space_type,memory_layout_type> materialize()const{
+		tensor<value_type,memory_space_type,memory_layout_type> res(shape());
+		materialize_into(res);
+		return res;
+	}
+	template<class R>
+	void materialize_into(tensor<R,memory_space_type,memory_layout_type>& dst)const{
+		const ScalarFunctor sf = ScalarFirst ? Op::rsf : Op::sf;
+		apply_scalar_functor(dst, m_e.materialize(), sf, m_s);
+	}
+};
+
+/**
+ * negates the result of an expression
+ */
+template<class E>
+struct negate_expression : public expression<negate_expression<E> >{
+	typedef typename E::value_type value_type;
+	typedef typename E::memory_space_type memory_space_type;
+	typedef typename E::memory_layout_type memory_layout_type;
+	typedef typename E::size_type size_type;
+	static const size_t bytes_per_element = E::bytes_per_element;
+
+	E m_e;
+
+	negate_expression(const E& e):m_e(e){}
+	__host__ __device__ value_type operator[](size_t i)const{ return -m_e[i]; }
+	std::vector<size_type> shape()const{ return m_e.shape(); }
+	tensor<value_type,memory_space_type,memory_layout_type> materialize()const{
+		tensor<value_type,memory_space_type,memory_layout_type> res(shape());
+		materialize_into(res);
+		return res;
+	}
+	template<class R>
+	void materialize_into(tensor<R,memory_space_type,memory_layout_type>& dst)const{
+		apply_scalar_functor(dst, m_e.materialize(), SF_NEGATE);
+	}
+};
+
+/**
+ * start a lazily evaluated expression
+ *
+ * @param t a c-contiguous tensor which must stay alive until the expression is assigned
+ */
+template<class V, class M, class L>
+tensor_expression<V,M,L> lazy(const tensor<V,M,L>& t){
+	return tensor_expression<V,M,L>(t);
+}
+
+namespace detail{
+	/// fused evaluation of an expression on a chunk of the host memory
+	template<class V, class E>
+	struct host_expression_range{
+		V* m_dst;
+		const E& m_e;
+		host_expression_range(V* dst, const E& e):m_dst(dst),m_e(e){}
+		void operator()(size_t begin, size_t end){
+			V* dst = m_dst;
+			const E& e = m_e;
+			for(size_t i=begin; i<end; i++)
+				dst[i] = (V) e[i];
+		}
+	};
+
+#ifdef __CUDACC__
+	/// fused evaluation of an expression on the device
+	template<class V, class E>
+	struct device_expression_functor{
+		E m_e;
+		device_expression_functor(const E& e):m_e(e){}
+		__host__ __device__ V operator()(size_t i)const{ return (V) m_e[i]; }
+	};
+#endif
+
+	/**
+	 * evaluates an expression into dst, which has the shape of the expression.
+	 *
+	 * This is the dispatch hook for the memory spaces.
+	 */
+	template<class M>
+	struct expression_evaluator{};
+
+	template<>
+	struct expression_evaluator<host_memory_space>{
+		template<class V, class L, class E>
+		static void run(tensor<V,host_memory_space,L>& dst, const E& e){
+			host_expression_range<V,E> r(dst.ptr(), e);
+			parallel_for(dst.size(), host_chunk_size(sizeof(V) + E::bytes_per_element), r);
+		}
+	};
+
+	template<>
+	struct expression_evaluator<dev_memory_space>{
+		template<class V, class L, class E>
+		static void run(tensor<V,dev_memory_space,L>& dst, const E& e){
+#ifdef __CUDACC__
+			thrust::device_ptr<V> dst_ptr(dst.ptr());
+			thrust::transform(thrust::counting_iterator<size_t>(0), thrust::counting_iterator<size_t>(dst.size()),
+					dst_ptr, device_expression_functor<V,E>(e));
+			cuvSafeCall(cudaThreadSynchronize());
+#else
+			// kernels can only be generated by nvcc, fall back to the eager functors
+			e.materialize_into(dst);
+#endif
+		}
+	};
+}
+
+/**
+ * evaluate an expression into a tensor
+ *
+ * used by the constructor and operator= of tensor and tensor_view.
+ *
+ * @param dst    the destination, which may also occur in the expression
+ * @param e      the expression
+ * @param rebind if true (assignment to a tensor), dst is overwritten in place
+ *               only if it exclusively owns c-contiguous memory of the
+ *               right shape, otherwise it refers to newly allocated memory
+ *               afterwards, like with the eager operators.  If false
+ *               (assignment to a tensor_view), dst is always overwritten
+ *               in place and shapes must match.
+ */
+template<class V, class M, class L, class E>
+void evaluate(tensor<V,M,L>& dst, const expression<E>& e, bool rebind){
+	BOOST_STATIC_ASSERT((boost::is_same<M, typename E::memory_space_type>::value));
+	BOOST_STATIC_ASSERT((boost::is_same<L, typename E::memory_layout_type>::value));
+	const E& ex = e.self();
+	std::vector<typename E::size_type> shape = ex.shape();
+	if(!rebind){
+		if(dst.shape() != shape)
+			throw std::runtime_error("expression: shape of destination does not match");
+		cuvAssert(dst.is_c_contiguous());
+		detail::expression_evaluator<M>::run(dst, ex);
+		return;
+	}
+	if(dst.mem() && dst.mem().unique() && dst.shape() == shape && dst.is_c_contiguous()){
+		detail::expression_evaluator<M>::run(dst, ex);
+		return;
+	}
+	tensor<V,M,L> tmp(shape, dst.m_allocator);
+	detail::expression_evaluator<M>::run(tmp, ex);
+	dst = tmp;
+}
+
+/*
+ * operators creating expressions
+ */
+#define CUV_EXPRESSION_BINARY_OPERATOR(OP, NAME) \
+	template<class E1, class E2> \
+	binary_expression<detail::NAME, E1, E2> \
+	operator OP(const expression<E1>& e1, const expression<E2>& e2){ \
+		return binary_expression<detail::NAME, E1, E2>(e1.self(), e2.self()); \
+	} \
+	template<class E, class V, class M, class L> \
+	binary_expression<detail::NAME, E, tensor_expression<V,M,L> > \
+	operator OP(const expression<E>& e, const tensor<V,M,L>& t){ \
+		return binary_expression<detail::NAME, E, tensor_expression<V,M,L> >(e.self(), lazy(t)); \
+	} \
+	template<class E, class V, class M, class L> \
+	binary_expression<detail::NAME, tensor_expression<V,M,L>, E> \
+	operator OP(const tensor<V,M,L>& t, const expression<E>& e){ \
+		return binary_expression<detail::NAME, tensor_expression<V,M,L>, E>(lazy(t), e.self()); \
+	}
+#define CUV_EXPRESSION_SCALAR_OPERATOR(OP, NAME) \
+	template<class E> \
+	scalar_expression<detail::NAME, E, false> \
+	operator OP(const expression<E>& e, const typename E::value_type& s){ \
+		return scalar_expression<detail::NAME, E, false>(e.self(), s); \
+	} \
+	template<class E> \
+	scalar_expression<detail::NAME, E, true> \
+	operator OP(const typename E::value_type& s, const expression<E>& e){ \
+		return scalar_expression<detail::NAME, E, true>(e.self(), s); \
+	}
+
+CUV_EXPRESSION_BINARY_OPERATOR(+, expr_plus)
+CUV_EXPRESSION_BINARY_OPERATOR(-, expr_minus)
+CUV_EXPRESSION_BINARY_OPERATOR(*, expr_multiplies)
+CUV_EXPRESSION_BINARY_OPERATOR(/, expr_divides)
+CUV_EXPRESSION_BINARY_OPERATOR(==, expr_equal)
+CUV_EXPRESSION_SCALAR_OPERATOR(+, expr_plus)
+CUV_EXPRESSION_SCALAR_OPERATOR(-, expr_minus)
+CUV_EXPRESSION_SCALAR_OPERATOR(*, expr_multiplies)
+CUV_EXPRESSION_SCALAR_OPERATOR(/, expr_divides)
+CUV_EXPRESSION_SCALAR_OPERATOR(==, expr_equal)
+CUV_EXPRESSION_SCALAR_OPERATOR(<, expr_less)
+CUV_EXPRESSION_SCALAR_OPERATOR(>, expr_greater)
+CUV_EXPRESSION_SCALAR_OPERATOR(<=, expr_less_equal)
+CUV_EXPRESSION_SCALAR_OPERATOR(>=, expr_greater_equal)
+
+#undef CUV_EXPRESSION_BINARY_OPERATOR
+#undef CUV_EXPRESSION_SCALAR_OPERATOR
+
+/// negate an expression
+template<class E>
+negate_expression<E> operator-(const expression<E>& e){
+	return negate_expression<E>(e.self());
+}
+
+/** @} */ // end group tensor_ops
+}
+
+#endif /* __CUV_EXPRESSION_HPP__ */
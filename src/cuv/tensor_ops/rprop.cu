@@ -42,6 +42,8 @@
 #define __global__
 #endif
 
+#ifndef CUV_NO_CUDA
+
 template<class T, class S>
 __global__ void rprop_kernel(T*W, T* dW, S* dW_old, T* rate, int n, T decay, T sparsedecay, T eta_p, T eta_m) {
 	const unsigned int idx = blockIdx.x * blockDim.x + threadIdx.x;
@@ -168,6 +170,7 @@ __global__ void learn_step_weight_decay_momentum_kernel(T* A, T* M, const T* dA,
 		/*A[i] = f - sgn(f)*min(sparsedecay,fabs(f));*/
 	}
 }
+#endif
 
 
 
@@ -176,12 +179,18 @@ namespace cuv{
 	template<class V, class S>
 	void
 	rprop_impl(tensor<V,dev_memory_space>& W, tensor<V,dev_memory_space>& dW, tensor<S,dev_memory_space>& dW_old, tensor<V,dev_memory_space>& rate, V decay, V sparsedecay, V eta_p, V eta_m){
+#ifdef CUV_NO_CUDA
+		tensor<V,host_memory_space> hW = detail::host_alias(W), hdW = detail::host_alias(dW), hrate = detail::host_alias(rate);
+		tensor<S,host_memory_space> hdW_old = detail::host_alias(dW_old);
+		rprop_impl(hW, hdW, hdW_old, hrate, decay, sparsedecay, eta_p, eta_m);
+#else
 		cuvAssert(decay >= 0);
 		cuvAssert(sparsedecay >= 0);
 		int num_threads = 512;
 		int num_blocks  = min(512,(int)ceil((float)dW.size() / num_threads));
 		rprop_kernel<<< num_blocks, num_threads>>>(W.ptr(), dW.ptr(), dW_old.ptr(), rate.ptr(), dW.size(), decay, sparsedecay, eta_p, eta_m);
 		cuvSafeCall(cudaThreadSynchronize());
+#endif
 	}
 
 	template<class T, class S>
@@ -247,6 +256,11 @@ namespace cuv{
 	template<class V, class S>
 	void
 	rrmsprop_impl(tensor<V,dev_memory_space>& W, tensor<V,dev_memory_space>& dW, tensor<S,dev_memory_space>& dW_old, tensor<V,dev_memory_space>& rate, tensor<V,dev_memory_space>& sW, V avg_grad, V delta, V decay, V sparsedecay, V eta_p, V eta_m, V delta_max, V delta_min){
+#ifdef CUV_NO_CUDA
+		tensor<V,host_memory_space> hW = detail::host_alias(W), hdW = detail::host_alias(dW), hrate = detail::host_alias(rate), hsW = detail::host_alias(sW);
+		tensor<S,host_memory_space> hdW_old = detail::host_alias(dW_old);
+		rrmsprop_impl(hW, hdW, hdW_old, hrate, hsW, avg_grad, delta, decay, sparsedecay, eta_p, eta_m, delta_max, delta_min);
+#else
 		cuvAssert(decay >= 0);
 		cuvAssert(sparsedecay >= 0);
 		int num_threads = 512;
@@ -254,6 +268,7 @@ namespace cuv{
 		rrmsprop_kernel<<< num_blocks, num_threads>>>(W.ptr(), dW.ptr(), dW_old.ptr(), rate.ptr(), sW.ptr(), dW.size(), avg_grad, delta, decay, sparsedecay, eta_p, eta_m, delta_max, delta_min);
 // 		rprop_kernel<<< num_blocks, num_threads>>>(W.ptr(), dW.ptr(), dW_old.ptr(), rate.ptr(), dW.size(), decay, sparsedecay, eta_p, eta_m);
 		cuvSafeCall(cudaThreadSynchronize());
+#endif
 	}
 
 	template<class T, class S>
@@ -322,10 +337,15 @@ namespace cuv{
 	
 	template<class V>
 	void learn_step_weight_decay_impl(tensor<V,dev_memory_space>& W, const tensor<V,dev_memory_space>& dW, const float& alpha, const float& beta, const float& sparsedecay){
+#ifdef CUV_NO_CUDA
+		tensor<V,host_memory_space> hW = detail::host_alias(W);
+		learn_step_weight_decay_impl(hW, detail::host_alias(dW), alpha, beta, sparsedecay);
+#else
 		int num_threads = 512;
 		int num_blocks  = min(512,(int)ceil((float)dW.size() / num_threads));
 		learn_step_weight_decay_kernel<<< num_blocks, num_threads>>>(W.ptr(), dW.ptr(), alpha, beta, sparsedecay, W.size());
 		cuvSafeCall(cudaThreadSynchronize());
+#endif
 	}
 	template<class V>
 	void learn_step_weight_decay_impl(tensor<V,host_memory_space>& W, const tensor<V,host_memory_space>& dW, const float& alpha, const float& beta, const float& sparsedecay){
@@ -347,10 +367,15 @@ namespace cuv{
 
 	template<class V>
 	void learn_step_weight_decay_momentum_impl(tensor<V,dev_memory_space>& W, tensor<V,dev_memory_space>& momentum, const tensor<V,dev_memory_space>& dW, const float& lr, const float& momentum_weight, const float& l2decay, const float& sparsedecay){
+#ifdef CUV_NO_CUDA
+		tensor<V,host_memory_space> hW = detail::host_alias(W), hmomentum = detail::host_alias(momentum);
+		learn_step_weight_decay_momentum_impl(hW, hmomentum, detail::host_alias(dW), lr, momentum_weight, l2decay, sparsedecay);
+#else
 		int num_threads = 512;
 		int num_blocks  = min(512,(int)ceil((float)dW.size() / num_threads));
 		learn_step_weight_decay_momentum_kernel<<< num_blocks, num_threads >>>(W.ptr(), momentum.ptr(), dW.ptr(), lr, momentum_weight, l2decay, sparsedecay, W.size());
 		cuvSafeCall(cudaThreadSynchronize());
+#endif
 	}
 	template<class V>
 	void learn_step_weight_decay_momentum_impl(tensor<V,host_memory_space>& W, tensor<V,host_memory_space>& momentum,const tensor<V,host_memory_space>& dW, const float& lr, const float& momentum_weight, const float& l2decay, const float& sparsedecay){
@@ -360,7 +385,7 @@ namespace cuv{
         const unsigned int size = W.size();
 		for (unsigned int i = 0; i < size; i++){
             float m = mptr[i];
-			m  = momentum_weight * m - lr*(dwptr[i] - l2decay*wptr[i]);
+			m  = momentum_weight * m - lr*(dwptr[i] + l2decay*wptr[i]);
             wptr[i] += m;
             mptr[i] = m;
 			/*wptr[i] -= sgn(wptr[i])* min(sparsedecay,fabs(wptr[i]));*/
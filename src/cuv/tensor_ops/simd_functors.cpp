@@ -0,0 +1,123 @@
+//*LB*
+// Copyright (c) 2010, University of Bonn, Institute for Computer Science VI
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+//  * Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//  * Neither the name of the University of Bonn 
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this software without specific prior written
+//    permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//*LE*
+
+
+
+
+/**
+ * @file simd_functors.cpp
+ * @brief selection of the instruction set for vectorized host functors
+ */
+#include <cstdlib>
+#include <cstring>
+#include <boost/thread/once.hpp>
+#include <cuv/tensor_ops/simd_functors.hpp>
+
+namespace{
+	/// the best level supported by both the CPU and the library
+	cuv::host_simd_level detect_simd_support(){
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+		__builtin_cpu_init();
+		if(cuv::detail::simd_compiled_avx512() && __builtin_cpu_supports("avx512f"))
+			return cuv::HOST_SIMD_AVX512;
+		if(cuv::detail::simd_compiled_avx2() && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+			return cuv::HOST_SIMD_AVX2;
+		if(cuv::detail::simd_compiled_sse2() && __builtin_cpu_supports("sse2"))
+			return cuv::HOST_SIMD_SSE2;
+#endif
+		return cuv::HOST_SIMD_NONE;
+	}
+
+	/// the level requested by the environment variable CUV_HOST_SIMD, or the best supported one
+	cuv::host_simd_level default_simd_level(cuv::host_simd_level support){
+		const char* env = getenv("CUV_HOST_SIMD");
+		if(!env)
+			return support;
+		cuv::host_simd_level l = support;
+		if     (!strcmp(env, "none"))   l = cuv::HOST_SIMD_NONE;
+		else if(!strcmp(env, "sse2"))   l = cuv::HOST_SIMD_SSE2;
+		else if(!strcmp(env, "avx2"))   l = cuv::HOST_SIMD_AVX2;
+		else if(!strcmp(env, "avx512")) l = cuv::HOST_SIMD_AVX512;
+		return l < support ? l : support;
+	}
+
+	boost::once_flag g_simd_once = BOOST_ONCE_INIT;
+	cuv::host_simd_level g_simd_support = cuv::HOST_SIMD_NONE;
+	volatile cuv::host_simd_level g_simd_level = cuv::HOST_SIMD_NONE;
+
+	void detect_simd(){
+		g_simd_support = detect_simd_support();
+		g_simd_level   = default_simd_level(g_simd_support);
+	}
+
+	/// detects the instruction set on the first call, later calls do not lock
+	void init_simd(){
+		boost::call_once(detect_simd, g_simd_once);
+	}
+}
+
+namespace cuv{
+
+host_simd_level get_host_simd_support(){
+	init_simd();
+	return g_simd_support;
+}
+
+host_simd_level get_host_simd_level(){
+	init_simd();
+	return g_simd_level;
+}
+
+void set_host_simd_level(host_simd_level l){
+	init_simd();
+	g_simd_level = l < g_simd_support ? l : g_simd_support;
+}
+
+namespace detail{
+
+simd_unary_kernel get_simd_kernel(ScalarFunctor sf, int numparams){
+	switch(get_host_simd_level()){
+		case HOST_SIMD_AVX512: return get_simd_kernel_avx512(sf, numparams);
+		case HOST_SIMD_AVX2:   return get_simd_kernel_avx2(sf, numparams);
+		case HOST_SIMD_SSE2:   return get_simd_kernel_sse2(sf, numparams);
+		default:               return NULL;
+	}
+}
+
+simd_binary_kernel get_simd_kernel(BinaryFunctor bf, int numparams){
+	switch(get_host_simd_level()){
+		case HOST_SIMD_AVX512: return get_simd_kernel_avx512(bf, numparams);
+		case HOST_SIMD_AVX2:   return get_simd_kernel_avx2(bf, numparams);
+		case HOST_SIMD_SSE2:   return get_simd_kernel_sse2(bf, numparams);
+		default:               return NULL;
+	}
+}
+
+}
+}
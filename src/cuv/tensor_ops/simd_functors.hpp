@@ -0,0 +1,133 @@
+//*LB*
+// Copyright (c) 2010, University of Bonn, Institute for Computer Science VI
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+//  * Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//  * Neither the name of the University of Bonn 
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this software without specific prior written
+//    permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//*LE*
+
+
+
+
+/**
+ * @file simd_functors.hpp
+ * @brief vectorized host implementations of scalar and binary functors on float tensors
+ * @ingroup functors
+ */
+#ifndef __CUV_SIMD_FUNCTORS_HPP__
+#define __CUV_SIMD_FUNCTORS_HPP__
+
+#include <cstddef>
+#include <cuv/tensor_ops/tensor_ops.hpp>
+
+namespace cuv{
+
+/**
+ * @addtogroup functors
+ * @{
+ */
+
+/**
+ * instruction sets used for vectorized host functors.
+ *
+ * Kernels for all levels are compiled into the library; at runtime, the
+ * best level supported by the CPU is chosen. The choice can be overridden by
+ * set_host_simd_level() or the environment variable CUV_HOST_SIMD
+ * (one of "none", "sse2", "avx2", "avx512").
+ *
+ * The transcendental functions are computed by polynomial approximations and
+ * differ slightly from the results of the scalar (HOST_SIMD_NONE) path.
+ * Maximum errors w.r.t. the exact result, for finite inputs whose results
+ * are normal floats (measured on dense grids over the whole input range):
+ *
+ *  - SF_EXP:                          < 2 ulp, results below FLT_MIN are flushed to zero
+ *  - SF_LOG:                          < 1 ulp
+ *  - SF_TANH (with/without params):   < 2 ulp
+ *  - SF_SIGM (with/without params):   < 4 ulp
+ *  - SF_LOGADDEXP, BF_LOGADDEXP:      < 3 ulp
+ *  - SF_BERNOULLI_KL, BF_BERNOULLI_KL: < 5e-7 * (1 + |result|)
+ *
+ * All other vectorized functors (arithmetic, min/max, sqrt) give results
+ * identical to the scalar path.
+ * Results do not depend on the number of host threads.
+ */
+enum host_simd_level{
+	HOST_SIMD_NONE,   ///< use the scalar functors
+	HOST_SIMD_SSE2,   ///< 4 floats per instruction
+	HOST_SIMD_AVX2,   ///< 8 floats per instruction, uses FMA
+	HOST_SIMD_AVX512  ///< 16 floats per instruction (AVX-512F)
+};
+
+/**
+ * @return the best instruction set supported by this CPU (and compiled into the library)
+ */
+host_simd_level get_host_simd_support();
+
+/**
+ * @return the instruction set currently used for host functors
+ */
+host_simd_level get_host_simd_level();
+
+/**
+ * select the instruction set used for host functors.
+ *
+ * Levels not supported by the CPU are reduced to the best supported one.
+ *
+ * @param l the requested level, use HOST_SIMD_NONE to disable vectorized functors
+ */
+void set_host_simd_level(host_simd_level l);
+
+namespace detail{
+	/// processes dst[i] = sf(src[i]) for 0 <= i < n
+	typedef void (*simd_unary_kernel)(float* dst, const float* src, size_t n, float p, float p2);
+	/// processes dst[i] = bf(src1[i], src2[i]) for 0 <= i < n
+	typedef void (*simd_binary_kernel)(float* dst, const float* src1, const float* src2, size_t n, float p, float p2);
+
+	/**
+	 * @return a vectorized kernel for the scalar functor using the current simd level, or NULL if there is none.
+	 */
+	simd_unary_kernel get_simd_kernel(ScalarFunctor sf, int numparams);
+
+	/**
+	 * @return a vectorized kernel for the binary functor using the current simd level, or NULL if there is none.
+	 */
+	simd_binary_kernel get_simd_kernel(BinaryFunctor bf, int numparams);
+
+	/// @internal kernel tables for the individual instruction sets (NULL if not compiled in)
+	simd_unary_kernel  get_simd_kernel_sse2(ScalarFunctor sf, int numparams);
+	simd_binary_kernel get_simd_kernel_sse2(BinaryFunctor bf, int numparams);
+	simd_unary_kernel  get_simd_kernel_avx2(ScalarFunctor sf, int numparams);
+	simd_binary_kernel get_simd_kernel_avx2(BinaryFunctor bf, int numparams);
+	simd_unary_kernel  get_simd_kernel_avx512(ScalarFunctor sf, int numparams);
+	simd_binary_kernel get_simd_kernel_avx512(BinaryFunctor bf, int numparams);
+	/// @return whether kernels for the instruction set were compiled into the library
+	bool simd_compiled_sse2();
+	bool simd_compiled_avx2();
+	bool simd_compiled_avx512();
+}
+
+/** @} */ // end group functors
+}
+
+#endif /* __CUV_SIMD_FUNCTORS_HPP__ */
@@ -0,0 +1,108 @@
+//*LB*
+// Copyright (c) 2010, University of Bonn, Institute for Computer Science VI
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+//  * Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//  * Neither the name of the University of Bonn 
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this software without specific prior written
+//    permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//*LE*
+
+
+
+
+/**
+ * @file simd_functors_avx512.cpp
+ * @brief vectorized host functors using AVX-512F
+ *
+ * must be compiled with -mavx512f, otherwise no kernels are provided.
+ */
+#include <cuv/tensor_ops/simd_functors.hpp>
+
+#if defined(__AVX512F__)
+#include <immintrin.h>
+#include <cuv/tensor_ops/simd_functors_impl.hpp>
+
+namespace{
+	/// register operations for AVX-512F, used by the kernels in simd_functors_impl.hpp
+	struct avx512_traits{
+		typedef __m512    reg;
+		typedef __m512i   ireg;
+		typedef __mmask16 mask;
+		static const size_t width = 16;
+
+		static inline reg  loadu(const float* p){ return _mm512_loadu_ps(p); }
+		static inline void storeu(float* p, reg a){ _mm512_storeu_ps(p, a); }
+		static inline reg  set1(float f){ return _mm512_set1_ps(f); }
+		static inline reg  zero(){ return _mm512_setzero_ps(); }
+
+		static inline reg add(reg a, reg b){ return _mm512_add_ps(a, b); }
+		static inline reg sub(reg a, reg b){ return _mm512_sub_ps(a, b); }
+		static inline reg mul(reg a, reg b){ return _mm512_mul_ps(a, b); }
+		static inline reg div(reg a, reg b){ return _mm512_div_ps(a, b); }
+		static inline reg min(reg a, reg b){ return _mm512_min_ps(a, b); }
+		static inline reg max(reg a, reg b){ return _mm512_max_ps(a, b); }
+		static inline reg sqrt(reg a){ return _mm512_sqrt_ps(a); }
+		static inline reg fmadd(reg a, reg b, reg c){ return _mm512_fmadd_ps(a, b, c); }
+
+		static inline ireg signbit(){ return _mm512_set1_epi32(0x80000000); }
+		static inline reg abs(reg a){ return as_float(_mm512_andnot_si512(signbit(), as_int(a))); }
+		static inline reg neg(reg a){ return as_float(_mm512_xor_si512(signbit(), as_int(a))); }
+		static inline reg copysign(reg a, reg s){ return as_float(_mm512_or_si512(as_int(abs(a)), _mm512_and_si512(signbit(), as_int(s)))); }
+
+		static inline mask cmplt(reg a, reg b){ return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+		static inline mask cmpgt(reg a, reg b){ return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ); }
+		static inline mask cmpeq(reg a, reg b){ return _mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ); }
+		static inline mask cmpnge(reg a, reg b){ return _mm512_cmp_ps_mask(a, b, _CMP_NGE_UQ); }
+		static inline mask isnan(reg a){ return _mm512_cmp_ps_mask(a, a, _CMP_UNORD_Q); }
+		static inline reg  select(mask m, reg a, reg b){ return _mm512_mask_blend_ps(m, b, a); }
+
+		static inline ireg round_i(reg a){ return _mm512_cvtps_epi32(a); }
+		static inline reg  to_float(ireg a){ return _mm512_cvtepi32_ps(a); }
+		static inline reg  as_float(ireg a){ return _mm512_castsi512_ps(a); }
+		static inline ireg as_int(reg a){ return _mm512_castps_si512(a); }
+		static inline ireg set1_i(int i){ return _mm512_set1_epi32(i); }
+		static inline ireg add_i(ireg a, ireg b){ return _mm512_add_epi32(a, b); }
+		static inline ireg sub_i(ireg a, ireg b){ return _mm512_sub_epi32(a, b); }
+		static inline ireg and_i(ireg a, ireg b){ return _mm512_and_si512(a, b); }
+		static inline ireg or_i(ireg a, ireg b){ return _mm512_or_si512(a, b); }
+		static inline ireg slli23(ireg a){ return _mm512_slli_epi32(a, 23); }
+		static inline ireg srli23(ireg a){ return _mm512_srli_epi32(a, 23); }
+		static inline ireg srai1(ireg a){ return _mm512_srai_epi32(a, 1); }
+	};
+}
+
+namespace cuv{ namespace detail{
+	simd_unary_kernel  get_simd_kernel_avx512(ScalarFunctor sf, int numparams){ return simd::unary_kernel_for<avx512_traits>(sf, numparams); }
+	simd_binary_kernel get_simd_kernel_avx512(BinaryFunctor bf, int numparams){ return simd::binary_kernel_for<avx512_traits>(bf, numparams); }
+	bool simd_compiled_avx512(){ return true; }
+} }
+
+#else
+
+namespace cuv{ namespace detail{
+	simd_unary_kernel  get_simd_kernel_avx512(ScalarFunctor sf, int numparams){ return NULL; }
+	simd_binary_kernel get_simd_kernel_avx512(BinaryFunctor bf, int numparams){ return NULL; }
+	bool simd_compiled_avx512(){ return false; }
+} }
+
+#endif
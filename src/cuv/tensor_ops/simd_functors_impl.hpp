@@ -0,0 +1,383 @@
+//*LB*
+// Copyright (c) 2010, University of Bonn, Institute for Computer Science VI
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+//  * Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//  * Neither the name of the University of Bonn 
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this software without specific prior written
+//    permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//*LE*
+
+
+
+
+/**
+ * @file simd_functors_impl.hpp
+ * @brief instruction set independent part of the vectorized host functors
+ *
+ * This file is included by simd_functors_{sse2,avx2,avx512}.cpp, each of
+ * which defines a register traits class (see sse2_traits in
+ * simd_functors_sse2.cpp) and is compiled with the matching compiler flags.
+ *
+ * The polynomial approximations of exp and log are those of the Cephes
+ * library (expf.c, logf.c), tanh uses the Cephes polynomial for small
+ * arguments and 1-2/(exp(2x)+1) otherwise.
+ */
+#ifndef __CUV_SIMD_FUNCTORS_IMPL_HPP__
+#define __CUV_SIMD_FUNCTORS_IMPL_HPP__
+
+#include <cmath>
+#include <cuv/tensor_ops/simd_functors.hpp>
+
+namespace cuv{ namespace detail{ namespace simd{
+
+	/// 2^n for integer n in [-126,127]
+	template<class V>
+	inline typename V::reg pow2(typename V::ireg n){
+		return V::as_float(V::slli23(V::add_i(n, V::set1_i(127))));
+	}
+
+	/**
+	 * e^x
+	 *
+	 * x = n log(2) + r with |r| <= log(2)/2, e^r by a polynomial of degree 7.
+	 * 2^n is applied in two steps, such that n=-126 and n=128 do not leave the
+	 * range of the exponent.
+	 */
+	template<class V>
+	inline typename V::reg exp(typename V::reg x){
+		typedef typename V::reg reg;
+		typedef typename V::ireg ireg;
+		const reg hi = V::set1( 88.72283905206835f);
+		const reg lo = V::set1(-87.33654475055310f);
+		reg xc = V::max(V::min(x, hi), lo);
+
+		ireg n  = V::round_i(V::mul(xc, V::set1(1.44269504088896341f)));
+		reg  nf = V::to_float(n);
+		reg  r  = V::fmadd(nf, V::set1(-0.693359375f), xc);
+		r       = V::fmadd(nf, V::set1(2.12194440e-4f), r);
+
+		reg p = V::set1(1.9875691500E-4f);
+		p = V::fmadd(p, r, V::set1(1.3981999507E-3f));
+		p = V::fmadd(p, r, V::set1(8.3334519073E-3f));
+		p = V::fmadd(p, r, V::set1(4.1665795894E-2f));
+		p = V::fmadd(p, r, V::set1(1.6666665459E-1f));
+		p = V::fmadd(p, r, V::set1(5.0000001201E-1f));
+		p = V::fmadd(p, V::mul(r, r), V::add(r, V::set1(1.f)));
+
+		ireg n1 = V::srai1(n);
+		p = V::mul(V::mul(p, pow2<V>(n1)), pow2<V>(V::sub_i(n, n1)));
+
+		p = V::select(V::cmpgt(x, hi), V::set1(HUGE_VALF), p);
+		p = V::select(V::cmplt(x, lo), V::zero(), p);
+		return V::select(V::isnan(x), x, p);
+	}
+
+	/**
+	 * natural logarithm
+	 *
+	 * x = 2^e m with sqrt(1/2) <= m < sqrt(2), log(m) by a polynomial of degree 9 in m-1.
+	 */
+	template<class V>
+	inline typename V::reg log(typename V::reg x){
+		typedef typename V::reg reg;
+		typedef typename V::ireg ireg;
+		const reg one = V::set1(1.f);
+
+		// scale denormals into the normal range
+		typename V::mask denorm = V::cmplt(x, V::set1(1.17549435e-38f));
+		reg xs = V::select(denorm, V::mul(x, V::set1(8388608.f)), x);
+		reg e_adj = V::select(denorm, V::set1(23.f), V::zero());
+
+		ireg bits = V::as_int(xs);
+		reg  e = V::sub(V::to_float(V::sub_i(V::srli23(bits), V::set1_i(126))), e_adj);
+		reg  m = V::as_float(V::or_i(V::and_i(bits, V::set1_i(0x807fffff)), V::set1_i(0x3f000000)));
+
+		// m in [0.5,1) -> [sqrt(1/2), sqrt(2))
+		typename V::mask small = V::cmplt(m, V::set1(0.707106781186547524f));
+		m = V::sub(V::add(m, V::select(small, m, V::zero())), one);
+		e = V::sub(e, V::select(small, one, V::zero()));
+
+		reg z = V::mul(m, m);
+		reg y = V::set1(7.0376836292E-2f);
+		y = V::fmadd(y, m, V::set1(-1.1514610310E-1f));
+		y = V::fmadd(y, m, V::set1( 1.1676998740E-1f));
+		y = V::fmadd(y, m, V::set1(-1.2420140846E-1f));
+		y = V::fmadd(y, m, V::set1( 1.4249322787E-1f));
+		y = V::fmadd(y, m, V::set1(-1.6668057665E-1f));
+		y = V::fmadd(y, m, V::set1( 2.0000714765E-1f));
+		y = V::fmadd(y, m, V::set1(-2.4999993993E-1f));
+		y = V::fmadd(y, m, V::set1( 3.3333331174E-1f));
+		y = V::mul(V::mul(y, m), z);
+		y = V::fmadd(e, V::set1(-2.12194440e-4f), y);
+		y = V::fmadd(z, V::set1(-0.5f), y);
+		reg res = V::fmadd(e, V::set1(0.693359375f), V::add(m, y));
+
+		res = V::select(V::cmpeq(x, V::set1(HUGE_VALF)), x, res);
+		res = V::select(V::cmpeq(x, V::zero()), V::set1(-HUGE_VALF), res);
+		// negative numbers and NaN
+		return V::select(V::cmpnge(x, V::zero()), V::set1(NAN), res);
+	}
+
+	/// log(1+a) for a >= 0, exact for small a
+	template<class V>
+	inline typename V::reg log1p_pos(typename V::reg a){
+		typedef typename V::reg reg;
+		reg u = V::add(a, V::set1(1.f));
+		reg d = V::sub(u, V::set1(1.f));
+		// log(u) * a/(u-1) corrects for the rounding error in 1+a
+		reg r = V::mul(log<V>(u), V::div(a, V::select(V::cmpeq(d, V::zero()), V::set1(1.f), d)));
+		return V::select(V::cmpeq(d, V::zero()), a, r);
+	}
+
+	/// hyperbolic tangent
+	template<class V>
+	inline typename V::reg tanh(typename V::reg x){
+		typedef typename V::reg reg;
+		reg ax = V::abs(x);
+
+		// |x| < 0.625
+		reg z = V::mul(x, x);
+		reg p = V::set1(-5.70498872745E-3f);
+		p = V::fmadd(p, z, V::set1( 2.06390887954E-2f));
+		p = V::fmadd(p, z, V::set1(-5.37397155531E-2f));
+		p = V::fmadd(p, z, V::set1( 1.33314422036E-1f));
+		p = V::fmadd(p, z, V::set1(-3.33332819422E-1f));
+		reg small = V::fmadd(V::mul(p, z), x, x);
+
+		// |x| >= 0.625
+		reg e = exp<V>(V::add(ax, ax));
+		reg large = V::sub(V::set1(1.f), V::div(V::set1(2.f), V::add(e, V::set1(1.f))));
+		large = V::copysign(large, x);
+
+		return V::select(V::cmplt(ax, V::set1(0.625f)), small, large);
+	}
+
+	/// logistic function 1/(1+exp(-x))
+	template<class V>
+	inline typename V::reg sigm(typename V::reg x){
+		const typename V::reg one = V::set1(1.f);
+		return V::div(one, V::add(one, exp<V>(V::neg(x))));
+	}
+
+	/// log(exp(a)+exp(b)), same special value handling as bf_logaddexp
+	template<class V>
+	inline typename V::reg logaddexp(typename V::reg a, typename V::reg b){
+		typedef typename V::reg reg;
+		reg diff = V::sub(a, b);
+		reg m    = V::select(V::cmpgt(diff, V::zero()), a, b);
+		reg res  = V::add(m, log1p_pos<V>(exp<V>(V::neg(V::abs(diff)))));
+		return V::select(V::isnan(diff), V::add(a, b), res);
+	}
+
+	/// Kullback-Leibler divergence of two bernoulli variables, see bf_bernoulli_kl
+	template<class V>
+	inline typename V::reg bernoulli_kl(typename V::reg x, typename V::reg y){
+		typedef typename V::reg reg;
+		const reg one = V::set1(1.f);
+		const reg eps = V::set1(0.0001f);
+		x = V::max(x, eps);
+		y = V::max(y, eps);
+		reg a = V::mul(x, log<V>(V::div(x, y)));
+		reg b = V::mul(V::sub(one, x), log<V>(V::div(V::sub(one, x), V::sub(one, y))));
+		return V::add(a, b);
+	}
+
+	/*
+	 * element-wise operations. Each has a constructor taking the two
+	 * parameters of the functor and an operator() on registers.
+	 */
+#define CUV_SIMD_UNARY_OP(NAME, EXPR) \
+	template<class V> struct NAME{ \
+		typename V::reg p, p2; \
+		NAME(float _p, float _p2):p(V::set1(_p)),p2(V::set1(_p2)){} \
+		inline typename V::reg operator()(typename V::reg x)const{ return EXPR; } \
+	};
+#define CUV_SIMD_BINARY_OP(NAME, EXPR) \
+	template<class V> struct NAME{ \
+		typename V::reg p, p2; \
+		NAME(float _p, float _p2):p(V::set1(_p)),p2(V::set1(_p2)){} \
+		inline typename V::reg operator()(typename V::reg x, typename V::reg y)const{ return EXPR; } \
+	};
+
+	CUV_SIMD_UNARY_OP(op_exp,       exp<V>(x))
+	CUV_SIMD_UNARY_OP(op_log,       log<V>(x))
+	CUV_SIMD_UNARY_OP(op_sigm,      sigm<V>(x))
+	CUV_SIMD_UNARY_OP(op_dsigm,     V::mul(x, V::sub(V::set1(1.f), x)))
+	CUV_SIMD_UNARY_OP(op_tanh,      tanh<V>(x))
+	CUV_SIMD_UNARY_OP(op_dtanh,     V::sub(V::set1(1.f), V::mul(x, x)))
+	CUV_SIMD_UNARY_OP(op_square,    V::mul(x, x))
+	CUV_SIMD_UNARY_OP(op_inv,       V::div(V::set1(1.f), V::add(x, V::set1(0.00000001f))))
+	CUV_SIMD_UNARY_OP(op_sqrt,      V::sqrt(x))
+	CUV_SIMD_UNARY_OP(op_negate,    V::neg(x))
+	CUV_SIMD_UNARY_OP(op_abs,       V::abs(x))
+	CUV_SIMD_UNARY_OP(op_copy,      x)
+	CUV_SIMD_UNARY_OP(op_add,       V::add(x, p))
+	CUV_SIMD_UNARY_OP(op_subtract,  V::sub(x, p))
+	CUV_SIMD_UNARY_OP(op_rsub,      V::sub(p, x))
+	CUV_SIMD_UNARY_OP(op_mult,      V::mul(x, p))
+	CUV_SIMD_UNARY_OP(op_div,       V::div(x, p))
+	CUV_SIMD_UNARY_OP(op_rdiv,      V::div(p, x))
+	CUV_SIMD_UNARY_OP(op_min,       V::min(x, p))
+	CUV_SIMD_UNARY_OP(op_max,       V::max(x, p))
+	CUV_SIMD_UNARY_OP(op_sigm_temp, sigm<V>(V::div(x, p)))
+	CUV_SIMD_UNARY_OP(op_logaddexp, logaddexp<V>(p, x))
+	CUV_SIMD_UNARY_OP(op_bernoulli_kl, bernoulli_kl<V>(p, x))
+	CUV_SIMD_UNARY_OP(op_axpb,      V::add(V::mul(p, x), p2))
+	CUV_SIMD_UNARY_OP(op_tanh2,     V::mul(p, tanh<V>(V::mul(p2, x))))
+	CUV_SIMD_UNARY_OP(op_dtanh2,    V::mul(V::mul(V::div(p2, p), V::add(p, x)), V::sub(p, x)))
+
+	CUV_SIMD_BINARY_OP(op_b_add,       V::add(x, y))
+	CUV_SIMD_BINARY_OP(op_b_subtract,  V::sub(x, y))
+	CUV_SIMD_BINARY_OP(op_b_mult,      V::mul(x, y))
+	CUV_SIMD_BINARY_OP(op_b_div,       V::div(x, y))
+	CUV_SIMD_BINARY_OP(op_b_min,       V::min(x, y))
+	CUV_SIMD_BINARY_OP(op_b_max,       V::max(x, y))
+	CUV_SIMD_BINARY_OP(op_b_logaddexp, logaddexp<V>(x, y))
+	CUV_SIMD_BINARY_OP(op_b_bernoulli_kl, bernoulli_kl<V>(x, y))
+	CUV_SIMD_BINARY_OP(op_b_axpy,      V::add(V::mul(p, x), y))
+	CUV_SIMD_BINARY_OP(op_b_xpby,      V::add(x, V::mul(p, y)))
+	CUV_SIMD_BINARY_OP(op_b_axpby,     V::add(V::mul(p, x), V::mul(p2, y)))
+
+#undef CUV_SIMD_UNARY_OP
+#undef CUV_SIMD_BINARY_OP
+
+	/**
+	 * apply a unary operation to n floats.
+	 *
+	 * The remainder which does not fill a register is processed through a
+	 * padded buffer, so that every element is computed by the same
+	 * instructions no matter where a range starts or ends.
+	 */
+	template<class V, template<class> class Op>
+	void unary_kernel(float* dst, const float* src, size_t n, float p, float p2){
+		const Op<V> op(p, p2);
+		size_t i = 0;
+		for(; i + V::width <= n; i += V::width)
+			V::storeu(dst + i, op(V::loadu(src + i)));
+		if(i < n){
+			float buf[V::width];
+			for(size_t j = 0; j < V::width; j++)
+				buf[j] = i + j < n ? src[i + j] : 0.f;
+			V::storeu(buf, op(V::loadu(buf)));
+			for(size_t j = 0; i + j < n; j++)
+				dst[i + j] = buf[j];
+		}
+	}
+
+	/// @see unary_kernel
+	template<class V, template<class> class Op>
+	void binary_kernel(float* dst, const float* src1, const float* src2, size_t n, float p, float p2){
+		const Op<V> op(p, p2);
+		size_t i = 0;
+		for(; i + V::width <= n; i += V::width)
+			V::storeu(dst + i, op(V::loadu(src1 + i), V::loadu(src2 + i)));
+		if(i < n){
+			float buf1[V::width], buf2[V::width];
+			for(size_t j = 0; j < V::width; j++){
+				buf1[j] = i + j < n ? src1[i + j] : 0.f;
+				buf2[j] = i + j < n ? src2[i + j] : 0.f;
+			}
+			V::storeu(buf1, op(V::loadu(buf1), V::loadu(buf2)));
+			for(size_t j = 0; i + j < n; j++)
+				dst[i + j] = buf1[j];
+		}
+	}
+
+	/// @return the kernel for sf using instruction set V, or NULL
+	template<class V>
+	simd_unary_kernel unary_kernel_for(ScalarFunctor sf, int numparams){
+		if(numparams == 0){
+			switch(sf){
+				case SF_EXP:    return &unary_kernel<V, op_exp>;
+				case SF_LOG:    return &unary_kernel<V, op_log>;
+				case SF_SIGM:   return &unary_kernel<V, op_sigm>;
+				case SF_DSIGM:  return &unary_kernel<V, op_dsigm>;
+				case SF_TANH:   return &unary_kernel<V, op_tanh>;
+				case SF_DTANH:  return &unary_kernel<V, op_dtanh>;
+				case SF_SQUARE: return &unary_kernel<V, op_square>;
+				case SF_INV:    return &unary_kernel<V, op_inv>;
+				case SF_SQRT:   return &unary_kernel<V, op_sqrt>;
+				case SF_NEGATE: return &unary_kernel<V, op_negate>;
+				case SF_ABS:    return &unary_kernel<V, op_abs>;
+				case SF_COPY:   return &unary_kernel<V, op_copy>;
+				default:        return NULL;
+			}
+		}else if(numparams == 1){
+			switch(sf){
+				case SF_ADD:          return &unary_kernel<V, op_add>;
+				case SF_SUBTRACT:     return &unary_kernel<V, op_subtract>;
+				case SF_RSUB:         return &unary_kernel<V, op_rsub>;
+				case SF_MULT:         return &unary_kernel<V, op_mult>;
+				case SF_DIV:          return &unary_kernel<V, op_div>;
+				case SF_RDIV:         return &unary_kernel<V, op_rdiv>;
+				case SF_MIN:          return &unary_kernel<V, op_min>;
+				case SF_MAX:          return &unary_kernel<V, op_max>;
+				case SF_SIGM:         return &unary_kernel<V, op_sigm_temp>;
+				case SF_LOGADDEXP:    return &unary_kernel<V, op_logaddexp>;
+				case SF_BERNOULLI_KL: return &unary_kernel<V, op_bernoulli_kl>;
+				default:              return NULL;
+			}
+		}else if(numparams == 2){
+			switch(sf){
+				case SF_AXPB:  return &unary_kernel<V, op_axpb>;
+				case SF_TANH:  return &unary_kernel<V, op_tanh2>;
+				case SF_DTANH: return &unary_kernel<V, op_dtanh2>;
+				default:       return NULL;
+			}
+		}
+		return NULL;
+	}
+
+	/// @return the kernel for bf using instruction set V, or NULL
+	template<class V>
+	simd_binary_kernel binary_kernel_for(BinaryFunctor bf, int numparams){
+		if(numparams == 0){
+			switch(bf){
+				case BF_ADD:          return &binary_kernel<V, op_b_add>;
+				case BF_SUBTRACT:     return &binary_kernel<V, op_b_subtract>;
+				case BF_MULT:         return &binary_kernel<V, op_b_mult>;
+				case BF_DIV:          return &binary_kernel<V, op_b_div>;
+				case BF_MIN:          return &binary_kernel<V, op_b_min>;
+				case BF_MAX:          return &binary_kernel<V, op_b_max>;
+				case BF_LOGADDEXP:    return &binary_kernel<V, op_b_logaddexp>;
+				case BF_BERNOULLI_KL: return &binary_kernel<V, op_b_bernoulli_kl>;
+				default:              return NULL;
+			}
+		}else if(numparams == 1){
+			switch(bf){
+				case BF_AXPY: return &binary_kernel<V, op_b_axpy>;
+				case BF_XPBY: return &binary_kernel<V, op_b_xpby>;
+				default:      return NULL;
+			}
+		}else if(numparams == 2){
+			switch(bf){
+				case BF_AXPBY: return &binary_kernel<V, op_b_axpby>;
+				default:       return NULL;
+			}
+		}
+		return NULL;
+	}
+
+} } }
+
+#endif /* __CUV_SIMD_FUNCTORS_IMPL_HPP__ */
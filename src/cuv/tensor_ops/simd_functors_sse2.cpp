@@ -0,0 +1,106 @@
+//*LB*
+// Copyright (c) 2010, University of Bonn, Institute for Computer Science VI
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+//  * Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//  * Neither the name of the University of Bonn 
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this software without specific prior written
+//    permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//*LE*
+
+
+
+
+/**
+ * @file simd_functors_sse2.cpp
+ * @brief vectorized host functors using SSE2
+ */
+#include <cuv/tensor_ops/simd_functors.hpp>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#include <cuv/tensor_ops/simd_functors_impl.hpp>
+
+namespace{
+	/// register operations for SSE2, used by the kernels in simd_functors_impl.hpp
+	struct sse2_traits{
+		typedef __m128  reg;
+		typedef __m128i ireg;
+		typedef __m128  mask;
+		static const size_t width = 4;
+
+		static inline reg  loadu(const float* p){ return _mm_loadu_ps(p); }
+		static inline void storeu(float* p, reg a){ _mm_storeu_ps(p, a); }
+		static inline reg  set1(float f){ return _mm_set1_ps(f); }
+		static inline reg  zero(){ return _mm_setzero_ps(); }
+
+		static inline reg add(reg a, reg b){ return _mm_add_ps(a, b); }
+		static inline reg sub(reg a, reg b){ return _mm_sub_ps(a, b); }
+		static inline reg mul(reg a, reg b){ return _mm_mul_ps(a, b); }
+		static inline reg div(reg a, reg b){ return _mm_div_ps(a, b); }
+		static inline reg min(reg a, reg b){ return _mm_min_ps(a, b); }
+		static inline reg max(reg a, reg b){ return _mm_max_ps(a, b); }
+		static inline reg sqrt(reg a){ return _mm_sqrt_ps(a); }
+		static inline reg fmadd(reg a, reg b, reg c){ return _mm_add_ps(_mm_mul_ps(a, b), c); }
+
+		static inline reg signbit(){ return _mm_castsi128_ps(_mm_set1_epi32(0x80000000)); }
+		static inline reg abs(reg a){ return _mm_andnot_ps(signbit(), a); }
+		static inline reg neg(reg a){ return _mm_xor_ps(signbit(), a); }
+		static inline reg copysign(reg a, reg s){ return _mm_or_ps(abs(a), _mm_and_ps(signbit(), s)); }
+
+		static inline mask cmplt(reg a, reg b){ return _mm_cmplt_ps(a, b); }
+		static inline mask cmpgt(reg a, reg b){ return _mm_cmpgt_ps(a, b); }
+		static inline mask cmpeq(reg a, reg b){ return _mm_cmpeq_ps(a, b); }
+		static inline mask cmpnge(reg a, reg b){ return _mm_cmpnge_ps(a, b); }
+		static inline mask isnan(reg a){ return _mm_cmpunord_ps(a, a); }
+		static inline reg  select(mask m, reg a, reg b){ return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+
+		static inline ireg round_i(reg a){ return _mm_cvtps_epi32(a); }
+		static inline reg  to_float(ireg a){ return _mm_cvtepi32_ps(a); }
+		static inline reg  as_float(ireg a){ return _mm_castsi128_ps(a); }
+		static inline ireg as_int(reg a){ return _mm_castps_si128(a); }
+		static inline ireg set1_i(int i){ return _mm_set1_epi32(i); }
+		static inline ireg add_i(ireg a, ireg b){ return _mm_add_epi32(a, b); }
+		static inline ireg sub_i(ireg a, ireg b){ return _mm_sub_epi32(a, b); }
+		static inline ireg and_i(ireg a, ireg b){ return _mm_and_si128(a, b); }
+		static inline ireg or_i(ireg a, ireg b){ return _mm_or_si128(a, b); }
+		static inline ireg slli23(ireg a){ return _mm_slli_epi32(a, 23); }
+		static inline ireg srli23(ireg a){ return _mm_srli_epi32(a, 23); }
+		static inline ireg srai1(ireg a){ return _mm_srai_epi32(a, 1); }
+	};
+}
+
+namespace cuv{ namespace detail{
+	simd_unary_kernel  get_simd_kernel_sse2(ScalarFunctor sf, int numparams){ return simd::unary_kernel_for<sse2_traits>(sf, numparams); }
+	simd_binary_kernel get_simd_kernel_sse2(BinaryFunctor bf, int numparams){ return simd::binary_kernel_for<sse2_traits>(bf, numparams); }
+	bool simd_compiled_sse2(){ return true; }
+} }
+
+#else
+
+namespace cuv{ namespace detail{
+	simd_unary_kernel  get_simd_kernel_sse2(ScalarFunctor sf, int numparams){ return NULL; }
+	simd_binary_kernel get_simd_kernel_sse2(BinaryFunctor bf, int numparams){ return NULL; }
+	bool simd_compiled_sse2(){ return false; }
+} }
+
+#endif
@@ -28,9 +28,12 @@
 //*LE*
 
 
+#include <algorithm>
 #include <cmath>
 #include <iostream>
+#ifndef CUV_NO_CUDA
 #include <cublas.h>
+#endif
 
 #include <thrust/device_ptr.h>
 #include <thrust/device_malloc.h>
@@ -43,9 +46,11 @@
 #include <thrust/count.h>
 
 #include <cuv/tools/cuv_general.hpp>
+#include <cuv/tools/thread_pool.hpp>
 
 #include <cuv/basics/tensor.hpp>
 #include <cuv/tensor_ops/functors.hpp>
+#include <cuv/tensor_ops/simd_functors.hpp>
 
 #include <cuv/tensor_ops/tensor_ops.hpp>
 
@@ -154,10 +159,58 @@ void launch_unary_kernel(
 	 cuvSafeCall(cudaThreadSynchronize());
 }
 
+/**
+ * processes a chunk of a unary host kernel, used by parallel_for
+ */
+template<class unary_functor, class V1, class V2>
+struct host_unary_range{
+	V1* dst;
+	const V2* src;
+	const unsigned char* mask;
+	unary_functor uf;
+	host_unary_range(V1* d, const V2* s, const unsigned char* m, const unary_functor& f)
+		:dst(d),src(s),mask(m),uf(f){}
+	void operator()(size_t begin, size_t end){
+		unary_functor f = uf;
+		V1* dst_ptr = dst + begin;
+		const V2* src_ptr = src + begin;
+		if(!mask)
+			for(size_t i=begin;i<end;i++)
+				*dst_ptr++ = f( *src_ptr++ );
+		else{
+			const unsigned char* mask_ptr = mask + begin;
+			for(size_t i=begin;i<end;i++,src_ptr++)
+				*dst_ptr++ = *mask_ptr++ ? f( *src_ptr ) : *src_ptr;
+		}
+	}
+	/// processes one run of a strided_loop over (dst, src, mask)
+	void operator()(const ptrdiff_t* off, const ptrdiff_t* stride, size_t n){
+		unary_functor f = uf;
+		V1* dst_ptr = dst + off[0];
+		const V2* src_ptr = src + off[1];
+		const ptrdiff_t ds = stride[0], ss = stride[1];
+		if(!mask && ds == 1 && ss == 1)
+			for(size_t i=0;i<n;i++)
+				*dst_ptr++ = f( *src_ptr++ );
+		else if(!mask)
+			for(size_t i=0;i<n;i++,dst_ptr+=ds,src_ptr+=ss)
+				*dst_ptr = f( *src_ptr );
+		else{
+			const unsigned char* mask_ptr = mask + off[2];
+			const ptrdiff_t ms = stride[2];
+			for(size_t i=0;i<n;i++,dst_ptr+=ds,src_ptr+=ss,mask_ptr+=ms)
+				*dst_ptr = *mask_ptr ? f( *src_ptr ) : *src_ptr;
+		}
+	}
+};
+
 /**
  * @overload
  *
- * Launch unary kernel on device
+ * Launch unary kernel on host
+ *
+ * Large tensors are split into cache-sized chunks which are distributed over the host thread pool.
+ * Views which are not contiguous are processed in place using a strided loop.
  */
 template<class unary_functor, class V1, class V2>
 void launch_unary_kernel(
@@ -167,18 +220,20 @@ void launch_unary_kernel(
 	 cuvAssert(src.ptr());
 	 cuvAssert(dst.ptr());
 	 cuvAssert(dst.size() == src.size());
-	 V1* dst_ptr = dst.ptr();
-	 const V2* src_ptr = src.ptr();
-     size_t size = dst.size();
-	 if(!mask)
-		 for(size_t i=0;i<size;i++)
-			 *dst_ptr++ = uf( *src_ptr++ );
-	 else{
+	 if(mask)
 		 cuvAssert(mask->ptr());
-		 const unsigned char* mask_ptr = mask->ptr();
-		 for(size_t i=0;i<size;i++,src_ptr++)
-			 *dst_ptr++ = *mask_ptr++ ? uf( *src_ptr ) : *src_ptr;
+	 host_unary_range<unary_functor,V1,V2> r(dst.ptr(), src.ptr(), mask ? mask->ptr() : NULL, uf);
+	 const size_t grain = host_chunk_size(sizeof(V1)+sizeof(V2)+(mask?1:0));
+	 if(dst.is_c_contiguous() && src.is_c_contiguous() && (!mask || mask->is_c_contiguous())){
+		 parallel_for(dst.size(), grain, r);
+		 return;
 	 }
+	 cuvAssert(dst.info().host_shape == src.info().host_shape);
+	 if(mask)
+		 cuvAssert(dst.info().host_shape == mask->info().host_shape);
+	 cuv::detail::strided_loop<3> loop(dst.info().host_shape, dst.info().host_stride, src.info().host_stride,
+			 mask ? mask->info().host_stride : src.info().host_stride);
+	 cuv::detail::strided_parallel_for(loop, grain, r);
 }
 
 /**
@@ -210,6 +265,41 @@ void launch_binary_kernel(
 	 cuvSafeCall(cudaThreadSynchronize());
 }
 
+/**
+ * processes a chunk of a binary host kernel, used by parallel_for
+ */
+template<class binary_functor, class V1, class V2, class V3>
+struct host_binary_range{
+	V1* dst;
+	const V2* src1;
+	const V3* src2;
+	binary_functor bf;
+	host_binary_range(V1* d, const V2* s1, const V3* s2, const binary_functor& f)
+		:dst(d),src1(s1),src2(s2),bf(f){}
+	void operator()(size_t begin, size_t end){
+		binary_functor f = bf;
+		V1* dst_ptr = dst + begin;
+		const V2* src1_ptr = src1 + begin;
+		const V3* src2_ptr = src2 + begin;
+		for(size_t i=begin;i<end;i++)
+			*dst_ptr++ = f(*src1_ptr++, *src2_ptr++);
+	}
+	/// processes one run of a strided_loop over (dst, src1, src2)
+	void operator()(const ptrdiff_t* off, const ptrdiff_t* stride, size_t n){
+		binary_functor f = bf;
+		V1* dst_ptr = dst + off[0];
+		const V2* src1_ptr = src1 + off[1];
+		const V3* src2_ptr = src2 + off[2];
+		const ptrdiff_t ds = stride[0], s1 = stride[1], s2 = stride[2];
+		if(ds == 1 && s1 == 1 && s2 == 1)
+			for(size_t i=0;i<n;i++)
+				*dst_ptr++ = f(*src1_ptr++, *src2_ptr++);
+		else
+			for(size_t i=0;i<n;i++,dst_ptr+=ds,src1_ptr+=s1,src2_ptr+=s2)
+				*dst_ptr = f(*src1_ptr, *src2_ptr);
+	}
+};
+
 /**
  * @overload
  *
@@ -223,11 +313,479 @@ void launch_binary_kernel(
 	 cuvAssert(src.ptr());
 	 cuvAssert(dst.ptr());
 	 cuvAssert(dst.size() == src.size());
-	 V1* dst_ptr = dst.ptr();
-	 const V2* src_ptr = src.ptr();
-     const size_t size = dst.size();
-	 for(size_t i=0;i<size;i++)
-	   *dst_ptr++ = uf(*dst_ptr,*src_ptr++);
+	 host_binary_range<binary_functor,V1,V1,V2> r(dst.ptr(), dst.ptr(), src.ptr(), uf);
+	 const size_t grain = host_chunk_size(2*sizeof(V1)+sizeof(V2));
+	 if(dst.is_c_contiguous() && src.is_c_contiguous()){
+		 parallel_for(dst.size(), grain, r);
+		 return;
+	 }
+	 cuvAssert(dst.info().host_shape == src.info().host_shape);
+	 cuv::detail::strided_loop<3> loop(dst.info().host_shape, dst.info().host_stride, dst.info().host_stride, src.info().host_stride);
+	 cuv::detail::strided_parallel_for(loop, grain, r);
+}
+
+/**
+ * Launch binary kernel on device
+ * 
+ * @param dst destination
+ * @param src1 first parameter of bf
+ * @param src2 second parameter of bf
+ * @param bf the binary functor to be applied
+ */
+template<class binary_functor, class V1, class V2, class V3>
+void launch_binary_kernel(
+   cuv::tensor<V1,dev_memory_space>& dst,
+   const cuv::tensor<V2,dev_memory_space>& src1, 
+   const cuv::tensor<V3,dev_memory_space>& src2, 
+	 binary_functor bf){
+	 cuvAssert(dst.ptr());
+	 cuvAssert(src1.ptr());
+	 cuvAssert(src2.ptr());
+	 cuvAssert(dst.size() == src1.size());
+	 cuvAssert(dst.size() == src2.size());
+	 thrust::device_ptr<V1> d_ptr(dst.ptr());
+	 thrust::device_ptr<V2> s1_ptr(const_cast<V2*>(src1.ptr()));
+	 thrust::device_ptr<V3> s2_ptr(const_cast<V3*>(src2.ptr()));
+	 thrust::transform(s1_ptr, s1_ptr+dst.size(), s2_ptr, d_ptr, bf);
+	 cuvSafeCall(cudaThreadSynchronize());
+}
+
+/**
+ * @overload
+ *
+ * launch a binary kernel on host, splitting large tensors over the host thread pool.
+ * Views which are not contiguous are processed in place using a strided loop.
+ */
+template<class binary_functor, class V1, class V2, class V3>
+void launch_binary_kernel(
+   cuv::tensor<V1,host_memory_space>& dst,
+   const cuv::tensor<V2,host_memory_space>& src1, 
+   const cuv::tensor<V3,host_memory_space>& src2, 
+	 binary_functor bf){
+	 cuvAssert(dst.ptr());
+	 cuvAssert(src1.ptr());
+	 cuvAssert(src2.ptr());
+	 cuvAssert(dst.size() == src1.size());
+	 cuvAssert(dst.size() == src2.size());
+	 host_binary_range<binary_functor,V1,V2,V3> r(dst.ptr(), src1.ptr(), src2.ptr(), bf);
+	 const size_t grain = host_chunk_size(sizeof(V1)+sizeof(V2)+sizeof(V3));
+	 if(dst.is_c_contiguous() && src1.is_c_contiguous() && src2.is_c_contiguous()){
+		 parallel_for(dst.size(), grain, r);
+		 return;
+	 }
+	 cuvAssert(dst.info().host_shape == src1.info().host_shape);
+	 cuvAssert(dst.info().host_shape == src2.info().host_shape);
+	 cuv::detail::strided_loop<3> loop(dst.info().host_shape, dst.info().host_stride, src1.info().host_stride, src2.info().host_stride);
+	 cuv::detail::strided_parallel_for(loop, grain, r);
+}
+
+/**
+ * processes a chunk of a vectorized unary host kernel, used by parallel_for
+ */
+struct simd_unary_range{
+	cuv::detail::simd_unary_kernel k;
+	float* dst;
+	const float* src;
+	float p, p2;
+	simd_unary_range(cuv::detail::simd_unary_kernel _k, float* d, const float* s, float _p, float _p2)
+		:k(_k),dst(d),src(s),p(_p),p2(_p2){}
+	void operator()(size_t begin, size_t end){
+		k(dst+begin, src+begin, end-begin, p, p2);
+	}
+	/// processes one (contiguous) run of a strided_loop over (dst, src)
+	void operator()(const ptrdiff_t* off, const ptrdiff_t*, size_t n){
+		k(dst+off[0], src+off[1], n, p, p2);
+	}
+};
+
+/**
+ * processes a chunk of a vectorized binary host kernel, used by parallel_for
+ */
+struct simd_binary_range{
+	cuv::detail::simd_binary_kernel k;
+	float* dst;
+	const float* src1;
+	const float* src2;
+	float p, p2;
+	simd_binary_range(cuv::detail::simd_binary_kernel _k, float* d, const float* s1, const float* s2, float _p, float _p2)
+		:k(_k),dst(d),src1(s1),src2(s2),p(_p),p2(_p2){}
+	void operator()(size_t begin, size_t end){
+		k(dst+begin, src1+begin, src2+begin, end-begin, p, p2);
+	}
+	/// processes one (contiguous) run of a strided_loop over (dst, src1, src2)
+	void operator()(const ptrdiff_t* off, const ptrdiff_t*, size_t n){
+		k(dst+off[0], src1+off[1], src2+off[2], n, p, p2);
+	}
+};
+
+/**
+ * Uses a vectorized host kernel (see simd_functors.hpp) for a scalar functor if there is one.
+ *
+ * Only float tensors in host memory without mask are vectorized. Views
+ * are vectorized if their innermost dimension is contiguous.
+ *
+ * @return true if the functor was applied
+ */
+template<class V1, class V2, class M>
+struct simd_scalar_functor{
+	static bool apply(cuv::tensor<V1,M>&, const cuv::tensor<V2,M>&, const cuv::ScalarFunctor&, int, const cuv::tensor<unsigned char,M>*, float, float){
+		return false;
+	}
+};
+template<>
+struct simd_scalar_functor<float,float,host_memory_space>{
+	static bool apply(cuv::tensor<float,host_memory_space>& dst, const cuv::tensor<float,host_memory_space>& src, const cuv::ScalarFunctor& sf, int numparams, const cuv::tensor<unsigned char,host_memory_space>* mask, float p, float p2){
+		if(mask)
+			return false;
+		cuv::detail::simd_unary_kernel k = cuv::detail::get_simd_kernel(sf, numparams);
+		if(!k)
+			return false;
+		cuvAssert(dst.ptr());
+		cuvAssert(src.ptr());
+		cuvAssert(dst.size() == src.size());
+		simd_unary_range r(k, dst.ptr(), src.ptr(), p, p2);
+		if(dst.is_c_contiguous() && src.is_c_contiguous()){
+			parallel_for(dst.size(), host_chunk_size(2*sizeof(float)), r);
+			return true;
+		}
+		cuvAssert(dst.info().host_shape == src.info().host_shape);
+		cuv::detail::strided_loop<2> loop(dst.info().host_shape, dst.info().host_stride, src.info().host_stride);
+		if(!loop.inner_contiguous())
+			return false;
+		cuv::detail::strided_parallel_for(loop, host_chunk_size(2*sizeof(float)), r);
+		return true;
+	}
+};
+
+/**
+ * Uses a vectorized host kernel (see simd_functors.hpp) for a binary functor if there is one.
+ *
+ * @return true if the functor was applied
+ */
+template<class V1, class V2, class V3, class M>
+struct simd_binary_functor{
+	static bool apply(cuv::tensor<V1,M>&, const cuv::tensor<V2,M>&, const cuv::tensor<V3,M>&, const cuv::BinaryFunctor&, int, float, float){
+		return false;
+	}
+};
+template<>
+struct simd_binary_functor<float,float,float,host_memory_space>{
+	static bool apply(cuv::tensor<float,host_memory_space>& dst, const cuv::tensor<float,host_memory_space>& src1, const cuv::tensor<float,host_memory_space>& src2, const cuv::BinaryFunctor& bf, int numparams, float p, float p2){
+		cuv::detail::simd_binary_kernel k = cuv::detail::get_simd_kernel(bf, numparams);
+		if(!k)
+			return false;
+		cuvAssert(dst.ptr());
+		cuvAssert(src1.ptr());
+		cuvAssert(src2.ptr());
+		cuvAssert(dst.size() == src1.size());
+		cuvAssert(dst.size() == src2.size());
+		simd_binary_range r(k, dst.ptr(), src1.ptr(), src2.ptr(), p, p2);
+		if(dst.is_c_contiguous() && src1.is_c_contiguous() && src2.is_c_contiguous()){
+			parallel_for(dst.size(), host_chunk_size(3*sizeof(float)), r);
+			return true;
+		}
+		cuvAssert(dst.info().host_shape == src1.info().host_shape);
+		cuvAssert(dst.info().host_shape == src2.info().host_shape);
+		cuv::detail::strided_loop<3> loop(dst.info().host_shape, dst.info().host_stride, src1.info().host_stride, src2.info().host_stride);
+		if(!loop.inner_contiguous())
+			return false;
+		cuv::detail::strided_parallel_for(loop, host_chunk_size(3*sizeof(float)), r);
+		return true;
+	}
+};
+
+/**
+ * fills one run of a strided_loop with a constant
+ */
+template<class V>
+struct host_fill_run{
+	V* dst;
+	V val;
+	host_fill_run(V* d, const V& v):dst(d),val(v){}
+	void operator()(const ptrdiff_t* off, const ptrdiff_t* stride, size_t n){
+		V* dst_ptr = dst + off[0];
+		const ptrdiff_t ds = stride[0];
+		if(ds == 1)
+			std::fill(dst_ptr, dst_ptr+n, val);
+		else
+			for(size_t i=0;i<n;i++,dst_ptr+=ds)
+				*dst_ptr = val;
+	}
+};
+
+/**
+ * writes consecutive numbers to the runs of a strided_loop (must be run serially)
+ */
+template<class V>
+struct host_sequence_run{
+	V* dst;
+	size_t pos;
+	host_sequence_run(V* d):dst(d),pos(0){}
+	void operator()(const ptrdiff_t* off, const ptrdiff_t* stride, size_t n){
+		V* dst_ptr = dst + off[0];
+		for(size_t i=0;i<n;i++,dst_ptr+=stride[0])
+			*dst_ptr = (V)(pos++);
+	}
+};
+
+/**
+ * applies a nullary functor to a host tensor which is not contiguous
+ *
+ * @return true (host tensors can always be processed in place)
+ */
+template<class V>
+bool apply_0ary_strided(tensor<V,host_memory_space>& v, const NullaryFunctor& nf, const V& param){
+	cuv::detail::strided_loop<1> loop(v.info().host_shape, v.info().host_stride);
+	switch(nf){
+		case NF_SEQ:
+			{
+				host_sequence_run<V> r(v.ptr());
+				loop.run(0, loop.size(), r);
+			}
+			break;
+		case NF_FILL:
+			{
+				host_fill_run<V> r(v.ptr(), param);
+				cuv::detail::strided_parallel_for(loop, host_chunk_size(sizeof(V)), r);
+			}
+			break;
+		default:
+			cuvAssert(false);
+	}
+	return true;
+}
+/**
+ * @overload
+ *
+ * @return false, device tensors are processed as flat arrays
+ */
+template<class V>
+bool apply_0ary_strided(tensor<V,dev_memory_space>&, const NullaryFunctor&, const V&){
+	return false;
+}
+
+/**
+ * accumulates r = bf(r, uf(x)) over the runs of a strided_loop
+ */
+template<class V, class UF, class R, class BF>
+struct host_reduce_run{
+	const V* src;
+	UF uf;
+	R r;
+	BF bf;
+	host_reduce_run(const V* s, const UF& u, const R& init, const BF& b):src(s),uf(u),r(init),bf(b){}
+	void operator()(const ptrdiff_t* off, const ptrdiff_t* stride, size_t n){
+		const V* src_ptr = src + off[0];
+		const ptrdiff_t ss = stride[0];
+		for(size_t i=0;i<n;i++,src_ptr+=ss)
+			r = bf(r, uf(*src_ptr));
+	}
+};
+
+/**
+ * reduces the elements [begin,end) of a strided_loop, used by parallel_reduce
+ */
+template<class V, class UF, class R, class BF>
+struct host_reduce_range{
+	const cuv::detail::strided_loop<1>& loop;
+	const V* src;
+	UF uf;
+	R init;
+	BF bf;
+	host_reduce_range(const cuv::detail::strided_loop<1>& l, const V* s, const UF& u, const R& i, const BF& b)
+		:loop(l),src(s),uf(u),init(i),bf(b){}
+	R operator()(size_t begin, size_t end){
+		host_reduce_run<V,UF,R,BF> r(src, uf, init, bf);
+		loop.run(begin, end, r);
+		return r.r;
+	}
+};
+
+/**
+ * @return true if a reduction over v is done by strided_transform_reduce:
+ *         always for host tensors (in parallel), for device tensors only if they are not contiguous
+ */
+template<class V>
+bool reduce_strided(const tensor<V,host_memory_space>& v){
+	return true;
+}
+/// @overload
+template<class V>
+bool reduce_strided(const tensor<V,dev_memory_space>& v){
+	return !v.is_c_contiguous();
+}
+
+/**
+ * transform_reduce over a host tensor of any layout, on the host thread pool
+ *
+ * init must be the neutral element of bf and join. Partial results of chunks
+ * are combined with join, which takes two results (unlike bf, which takes a
+ * result and an element).
+ */
+template<class V, class UF, class R, class BF, class JF>
+R strided_transform_reduce(const tensor<V,host_memory_space>& v, const UF& uf, const R& init, const BF& bf, const JF& join){
+	cuv::detail::strided_loop<1> loop(v.info().host_shape, v.info().host_stride);
+	host_reduce_range<V,UF,R,BF> r(loop, v.ptr(), uf, init, bf);
+	return parallel_reduce(loop.size(), host_chunk_size(sizeof(V)), init, r, join);
+}
+/**
+ * @overload
+ *
+ * device kernels work on flat arrays, so a contiguous copy of v is reduced
+ */
+template<class V, class UF, class R, class BF, class JF>
+R strided_transform_reduce(const tensor<V,dev_memory_space>& v, const UF& uf, const R& init, const BF& bf, const JF&){
+	tensor<V,dev_memory_space> c = v.copy();
+	thrust::device_ptr<V> c_ptr(c.ptr());
+	return thrust::transform_reduce(c_ptr, c_ptr+c.size(), uf, init, bf);
+}
+
+/**
+ * the first maximal (or minimal) element of a range and its position
+ */
+template<class V>
+struct host_extremum{
+	V best;
+	size_t arg;
+	bool found;
+	host_extremum():best(),arg(0),found(false){}
+};
+
+/**
+ * finds the position of the first maximal (or minimal) element in the runs of a strided_loop
+ */
+template<class V, bool Max>
+struct host_arg_extremum_run{
+	const V* src;
+	size_t pos;
+	host_extremum<V> r;
+	host_arg_extremum_run(const V* s, size_t begin):src(s),pos(begin){}
+	void operator()(const ptrdiff_t* off, const ptrdiff_t* stride, size_t n){
+		const V* src_ptr = src + off[0];
+		if(!r.found && n > 0){
+			r.best  = *src_ptr;
+			r.arg   = pos;
+			r.found = true;
+		}
+		for(size_t i=0;i<n;i++,pos++,src_ptr+=stride[0])
+			if(Max ? r.best < *src_ptr : *src_ptr < r.best){
+				r.best = *src_ptr;
+				r.arg  = pos;
+			}
+	}
+};
+
+/**
+ * finds the extremum of the elements [begin,end) of a strided_loop, used by parallel_reduce
+ */
+template<class V, bool Max>
+struct host_arg_extremum_range{
+	const cuv::detail::strided_loop<1>& loop;
+	const V* src;
+	host_arg_extremum_range(const cuv::detail::strided_loop<1>& l, const V* s):loop(l),src(s){}
+	host_extremum<V> operator()(size_t begin, size_t end){
+		host_arg_extremum_run<V,Max> r(src, begin);
+		loop.run(begin, end, r);
+		return r.r;
+	}
+};
+
+/**
+ * combines the extrema of two consecutive ranges, the first one wins ties
+ */
+template<class V, bool Max>
+struct host_arg_extremum_join{
+	host_extremum<V> operator()(const host_extremum<V>& a, const host_extremum<V>& b)const{
+		if(!a.found)
+			return b;
+		if(b.found && (Max ? a.best < b.best : b.best < a.best))
+			return b;
+		return a;
+	}
+};
+
+/**
+ * arg_max/arg_min of a host tensor of any layout, on the host thread pool
+ *
+ * @return the index of the extremum in row-major order
+ */
+template<bool Max, class V>
+typename tensor<V,host_memory_space>::index_type
+strided_arg_extremum(const tensor<V,host_memory_space>& v){
+	cuv::detail::strided_loop<1> loop(v.info().host_shape, v.info().host_stride);
+	host_arg_extremum_range<V,Max> r(loop, v.ptr());
+	return parallel_reduce(loop.size(), host_chunk_size(sizeof(V)), host_extremum<V>(), r,
+			host_arg_extremum_join<V,Max>()).arg;
+}
+/**
+ * @overload
+ *
+ * device kernels work on flat arrays, so a contiguous copy of v is searched
+ */
+template<bool Max, class V>
+typename tensor<V,dev_memory_space>::index_type
+strided_arg_extremum(const tensor<V,dev_memory_space>& v){
+	tensor<V,dev_memory_space> c = v.copy();
+	thrust::device_ptr<V> begin(c.ptr());
+	thrust::device_ptr<V> elem = Max ? thrust::max_element(begin, begin+c.size())
+	                                 : thrust::min_element(begin, begin+c.size());
+	return thrust::distance(begin,elem);
+}
+
+/**
+ * accumulates the squared differences of the runs of a strided_loop over two tensors
+ */
+template<class V>
+struct host_squared_diff_run{
+	const V* v;
+	const V* w;
+	float r;
+	host_squared_diff_run(const V* _v, const V* _w):v(_v),w(_w),r(0.f){}
+	void operator()(const ptrdiff_t* off, const ptrdiff_t* stride, size_t n){
+		const V* v_ptr = v + off[0];
+		const V* w_ptr = w + off[1];
+		for(size_t i=0;i<n;i++,v_ptr+=stride[0],w_ptr+=stride[1]){
+			float d = (float)(*v_ptr - *w_ptr);
+			r += d*d;
+		}
+	}
+};
+
+/**
+ * sums the squared differences of the elements [begin,end) of a strided_loop, used by parallel_reduce
+ */
+template<class V>
+struct host_squared_diff_range{
+	const cuv::detail::strided_loop<2>& loop;
+	const V* v;
+	const V* w;
+	host_squared_diff_range(const cuv::detail::strided_loop<2>& l, const V* _v, const V* _w):loop(l),v(_v),w(_w){}
+	float operator()(size_t begin, size_t end){
+		host_squared_diff_run<V> r(v, w);
+		loop.run(begin, end, r);
+		return r.r;
+	}
+};
+
+/**
+ * sum of squared differences of two host tensors of any layout, on the host thread pool
+ */
+template<class V>
+float strided_squared_diff(const tensor<V,host_memory_space>& v, const tensor<V,host_memory_space>& w){
+	cuvAssert(v.info().host_shape == w.info().host_shape);
+	cuv::detail::strided_loop<2> loop(v.info().host_shape, v.info().host_stride, w.info().host_stride);
+	host_squared_diff_range<V> r(loop, v.ptr(), w.ptr());
+	return parallel_reduce(loop.size(), host_chunk_size(2*sizeof(V)), 0.f, r, bf_plus<float,float,float>());
+}
+/**
+ * @overload
+ *
+ * device kernels work on flat arrays, so contiguous copies are compared
+ */
+template<class V>
+float strided_squared_diff(const tensor<V,dev_memory_space>& v, const tensor<V,dev_memory_space>& w){
+	float n = cuv::diff_norm2(v.copy(), w.copy());
+	return n*n;
 }
 
 namespace cuv{
@@ -245,6 +803,8 @@ template<class __value_type, class __memory_space_type>
 void
 apply_0ary_functor(tensor<__value_type, __memory_space_type>& v, const NullaryFunctor& nf){
 	 cuvAssert(v.ptr());
+	 if(!v.is_c_contiguous() && apply_0ary_strided(v, nf, __value_type()))
+		 return;
 	 typedef typename memspace_cuv2thrustptr<__value_type,__memory_space_type>::ptr_type ptr_type;
 	 ptr_type dst_ptr(v.ptr());
 	 switch(nf){
@@ -270,6 +830,8 @@ template<class V1, class M>
 void
 apply_0ary_functor(tensor<V1, M>& v, const NullaryFunctor& nf, const V1& param){
 	 cuvAssert(v.ptr());
+	 if(!v.is_c_contiguous() && apply_0ary_strided(v, nf, param))
+		 return;
 
 	 typedef typename memspace_cuv2thrustptr<V1,M >::ptr_type ptr_type;
 	 ptr_type dst_ptr(v.ptr());
@@ -291,6 +853,9 @@ namespace detail{
 	void apply_scalar_functor(tensor<V1, M>& dst, const tensor<V2, M>& src, const ScalarFunctor& sf, const int& numparams, const tensor<unsigned char,M>* mask, const S1& p, const S2& p2){
 		cuvAssert(equal_shape(dst,src));
 
+		if(simd_scalar_functor<V1,V2,M>::apply(dst,src,sf,numparams,mask,(float)p,(float)p2))
+			return;
+
 		typedef typename memspace_cuv2thrustptr<V1, M>::ptr_type ptr_type1;
 		typedef typename memspace_cuv2thrustptr<V2, M>::ptr_type ptr_type2;
 		ptr_type1 d_ptr(dst.ptr());
@@ -376,17 +941,14 @@ namespace detail{
         bool src2_agrees = equal_shape(dst,src2);
         cuvAssert(src1_agrees || src2_agrees);
 
+        if(src1_agrees && src2_agrees && simd_binary_functor<V1,V2,V3,M>::apply(dst,src1,src2,bf,numparams,(float)p,(float)p2))
+            return;
+
         
 
        
         
 
-		typedef typename memspace_cuv2thrustptr<V1, M>::ptr_type ptr_type1;
-		typedef typename memspace_cuv2thrustptr<V2,M>::ptr_type ptr_type2;
-		typedef typename memspace_cuv2thrustptr<V3,M>::ptr_type ptr_type3;
-		ptr_type1 d_ptr(dst.ptr());
-		ptr_type2 s1_ptr(const_cast<V2*>(src1.ptr()));
-		ptr_type2 s2_ptr(const_cast<V3*>(src2.ptr()));
         if(numparams==0){
             if(!src1_agrees && src1.size() == 1){
                 switch(bf){
@@ -426,24 +988,24 @@ namespace detail{
             }
 #if USE_THRUST_LAUNCHER 
             switch(bf){
-                case BF_1ST:      thrust::transform(s1_ptr, s1_ptr+dst.size(), s2_ptr, d_ptr, bf_1st<V1,V2,V3>()); break;
-                case BF_2ND:      thrust::transform(s1_ptr, s1_ptr+dst.size(), s2_ptr, d_ptr, bf_2nd<V1,V2,V3>()); break;
-                case BF_EQ:       thrust::transform(s1_ptr, s1_ptr+dst.size(), s2_ptr, d_ptr, bf_equals<V1,V2,V3>()); break;
-                case BF_AND:      thrust::transform(s1_ptr, s1_ptr+dst.size(), s2_ptr, d_ptr, bf_and<V1,V2,V3>()); break;
-                case BF_OR :      thrust::transform(s1_ptr, s1_ptr+dst.size(), s2_ptr, d_ptr, bf_or<V1,V2,V3>()); break;
-                case BF_ADD:      thrust::transform(s1_ptr, s1_ptr+dst.size(), s2_ptr, d_ptr, bf_plus<V1,V2,V3>()); break;
-                case BF_SUBTRACT: thrust::transform(s1_ptr, s1_ptr+dst.size(), s2_ptr, d_ptr, bf_minus<V1,V2,V3>()); break;
-                case BF_MULT:     thrust::transform(s1_ptr, s1_ptr+dst.size(), s2_ptr, d_ptr, bf_multiplies<V1,V2,V3>()); break;
-                case BF_DIV:      thrust::transform(s1_ptr, s1_ptr+dst.size(), s2_ptr, d_ptr, bf_divides<V1,V2,V3>()); break;
-                case BF_MIN:      thrust::transform(s1_ptr, s1_ptr+dst.size(), s2_ptr, d_ptr, bf_min<V1,V2,V3>()); break;
-                case BF_MAX:      thrust::transform(s1_ptr, s1_ptr+dst.size(), s2_ptr, d_ptr, bf_max<V1,V2,V3>()); break;
-                case BF_ATAN2:    thrust::transform(s1_ptr, s1_ptr+dst.size(), s2_ptr, d_ptr, bf_atan2<V1,V2,V3>()); break;
-                case BF_NORM:     thrust::transform(s1_ptr, s1_ptr+dst.size(), s2_ptr, d_ptr, bf_norm<V1,V2,V3>()); break;
-                case BF_LOGADDEXP:     thrust::transform(s1_ptr, s1_ptr+dst.size(), s2_ptr, d_ptr, bf_logaddexp<V1>()); break;
-                case BF_LOGADDEXP_GRAD:     thrust::transform(s1_ptr, s1_ptr+dst.size(), s2_ptr, d_ptr, bf_logaddexp_grad<V1>()); break;                
-                case BF_LOGCE_OF_LOGISTIC:     thrust::transform(s1_ptr, s1_ptr+dst.size(), s2_ptr, d_ptr, bf_logce_of_logistic<V1,V2,V3>()); break;
-                case BF_BERNOULLI_KL:      thrust::transform(s1_ptr, s1_ptr+dst.size(), s2_ptr, d_ptr, bf_bernoulli_kl<V1,V2,V3>()); break;
-                case BF_DBERNOULLI_KL:     thrust::transform(s1_ptr, s1_ptr+dst.size(), s2_ptr, d_ptr, bf_dbernoulli_kl<V1,V2,V3>()); break;
+                case BF_1ST:      launch_binary_kernel(dst, src1, src2, bf_1st<V1,V2,V3>()); break;
+                case BF_2ND:      launch_binary_kernel(dst, src1, src2, bf_2nd<V1,V2,V3>()); break;
+                case BF_EQ:       launch_binary_kernel(dst, src1, src2, bf_equals<V1,V2,V3>()); break;
+                case BF_AND:      launch_binary_kernel(dst, src1, src2, bf_and<V1,V2,V3>()); break;
+                case BF_OR :      launch_binary_kernel(dst, src1, src2, bf_or<V1,V2,V3>()); break;
+                case BF_ADD:      launch_binary_kernel(dst, src1, src2, bf_plus<V1,V2,V3>()); break;
+                case BF_SUBTRACT: launch_binary_kernel(dst, src1, src2, bf_minus<V1,V2,V3>()); break;
+                case BF_MULT:     launch_binary_kernel(dst, src1, src2, bf_multiplies<V1,V2,V3>()); break;
+                case BF_DIV:      launch_binary_kernel(dst, src1, src2, bf_divides<V1,V2,V3>()); break;
+                case BF_MIN:      launch_binary_kernel(dst, src1, src2, bf_min<V1,V2,V3>()); break;
+                case BF_MAX:      launch_binary_kernel(dst, src1, src2, bf_max<V1,V2,V3>()); break;
+                case BF_ATAN2:    launch_binary_kernel(dst, src1, src2, bf_atan2<V1,V2,V3>()); break;
+                case BF_NORM:     launch_binary_kernel(dst, src1, src2, bf_norm<V1,V2,V3>()); break;
+                case BF_LOGADDEXP:     launch_binary_kernel(dst, src1, src2, bf_logaddexp<V1>()); break;
+                case BF_LOGADDEXP_GRAD:     launch_binary_kernel(dst, src1, src2, bf_logaddexp_grad<V1>()); break;                
+                case BF_LOGCE_OF_LOGISTIC:     launch_binary_kernel(dst, src1, src2, bf_logce_of_logistic<V1,V2,V3>()); break;
+                case BF_BERNOULLI_KL:      launch_binary_kernel(dst, src1, src2, bf_bernoulli_kl<V1,V2,V3>()); break;
+                case BF_DBERNOULLI_KL:     launch_binary_kernel(dst, src1, src2, bf_dbernoulli_kl<V1,V2,V3>()); break;
                 default: cuvAssert(false);
             }
 #else
@@ -489,14 +1051,14 @@ namespace detail{
             }
 #if USE_THRUST_LAUNCHER
 			switch(bf){
-				case BF_AXPY:     thrust::transform(s1_ptr, s1_ptr+src1.size(), s2_ptr,  d_ptr, bf_axpy<V1,V2,V3>(p)); break;
-				case BF_XPBY:     thrust::transform(s1_ptr, s1_ptr+src1.size(), s2_ptr,  d_ptr, bf_xpby<V1,V2,V3>(p)); break;
-				case BF_EPSILON_INSENSITIVE_LOSS: thrust::transform(s1_ptr, s1_ptr+src1.size(), s2_ptr,  d_ptr, make_bind3rd(tf_epsilon_insensitive_loss<V1>(),p)); break;
-				case BF_DEPSILON_INSENSITIVE_LOSS: thrust::transform(s1_ptr, s1_ptr+src1.size(), s2_ptr,  d_ptr, make_bind3rd(tf_depsilon_insensitive_loss<V1>(),p)); break;
-				case BF_HINGE_LOSS: thrust::transform(s1_ptr, s1_ptr+src1.size(), s2_ptr,  d_ptr, make_bind3rd(tf_hinge_loss<V1>(),p)); break;
-				case BF_DHINGE_LOSS: thrust::transform(s1_ptr, s1_ptr+src1.size(), s2_ptr,  d_ptr, make_bind3rd(tf_dhinge_loss<V1>(),p)); break;
-				case BF_SQHINGE_LOSS: thrust::transform(s1_ptr, s1_ptr+src1.size(), s2_ptr,  d_ptr, make_bind3rd(tf_sqhinge_loss<V1>(),p)); break;
-				case BF_DSQHINGE_LOSS: thrust::transform(s1_ptr, s1_ptr+src1.size(), s2_ptr,  d_ptr, make_bind3rd(tf_dsqhinge_loss<V1>(),p)); break;
+				case BF_AXPY:     launch_binary_kernel(dst, src1, src2, bf_axpy<V1,V2,V3>(p)); break;
+				case BF_XPBY:     launch_binary_kernel(dst, src1, src2, bf_xpby<V1,V2,V3>(p)); break;
+				case BF_EPSILON_INSENSITIVE_LOSS: launch_binary_kernel(dst, src1, src2, make_bind3rd(tf_epsilon_insensitive_loss<V1>(),p)); break;
+				case BF_DEPSILON_INSENSITIVE_LOSS: launch_binary_kernel(dst, src1, src2, make_bind3rd(tf_depsilon_insensitive_loss<V1>(),p)); break;
+				case BF_HINGE_LOSS: launch_binary_kernel(dst, src1, src2, make_bind3rd(tf_hinge_loss<V1>(),p)); break;
+				case BF_DHINGE_LOSS: launch_binary_kernel(dst, src1, src2, make_bind3rd(tf_dhinge_loss<V1>(),p)); break;
+				case BF_SQHINGE_LOSS: launch_binary_kernel(dst, src1, src2, make_bind3rd(tf_sqhinge_loss<V1>(),p)); break;
+				case BF_DSQHINGE_LOSS: launch_binary_kernel(dst, src1, src2, make_bind3rd(tf_dsqhinge_loss<V1>(),p)); break;
 						  /*case BF_XPBY:     cublasSaxpy(v.size(), param, (float*)w.ptr(), 1, (float*)v.ptr(), 1) ; break;*/
 				default: cuvAssert(false);
 			}
@@ -528,7 +1090,7 @@ namespace detail{
             }
 #if USE_THRUST_LAUNCHER
 			switch(bf){
-				case BF_AXPBY:     thrust::transform(s1_ptr, s1_ptr+src1.size(), s2_ptr,  d_ptr, bf_axpby<V1,V2,V3>(p,p2)); break;
+				case BF_AXPBY:     launch_binary_kernel(dst, src1, src2, bf_axpby<V1,V2,V3>(p,p2)); break;
 				default: cuvAssert(false);
 			}
 #else
@@ -552,6 +1114,8 @@ namespace detail{
 template<class __value_type, class __memory_space_type>
 bool
 has_inf(const tensor<__value_type, __memory_space_type>& v){
+	if(reduce_strided(v))
+		return strided_transform_reduce(v, uf_is_inf<__value_type>(), false, bf_or<bool,bool,bool>(), bf_or<bool,bool,bool>());
 	typedef typename memspace_cuv2thrustptr<__value_type,__memory_space_type>::ptr_type ptr_type;
 	ptr_type v_ptr(const_cast<__value_type*>(v.ptr()));
 	uf_is_inf<__value_type> uo;
@@ -560,6 +1124,8 @@ has_inf(const tensor<__value_type, __memory_space_type>& v){
 template<class __value_type, class __memory_space_type>
 bool
 has_nan(const tensor<__value_type, __memory_space_type>& v){
+	if(reduce_strided(v))
+		return strided_transform_reduce(v, uf_is_nan<__value_type>(), false, bf_or<bool,bool,bool>(), bf_or<bool,bool,bool>());
 	typedef typename memspace_cuv2thrustptr<__value_type,__memory_space_type>::ptr_type ptr_type;
 	ptr_type v_ptr(const_cast<__value_type*>(v.ptr()));
 	uf_is_nan<__value_type> uo;
@@ -568,6 +1134,8 @@ has_nan(const tensor<__value_type, __memory_space_type>& v){
 template<class __value_type, class __memory_space_type>
 float
 norm2(const tensor<__value_type, __memory_space_type>& v){
+	if(reduce_strided(v))
+		return std::sqrt(strided_transform_reduce(v, uf_square<float,__value_type>(), 0.f, bf_plus<float,float,__value_type>(), bf_plus<float,float,float>()));
 	typedef typename memspace_cuv2thrustptr<__value_type,__memory_space_type>::ptr_type ptr_type;
 	ptr_type v_ptr(const_cast<__value_type*>(v.ptr()));
 	float init=0;
@@ -583,6 +1151,8 @@ struct squared_diff{
 template<class __value_type, class __memory_space_type>
 float
 diff_norm2(const tensor<__value_type, __memory_space_type>& v, const tensor<__value_type, __memory_space_type>& w){
+	if(reduce_strided(v) || !w.is_c_contiguous())
+		return std::sqrt(strided_squared_diff(v, w));
 	typedef typename memspace_cuv2thrustptr<__value_type,__memory_space_type>::ptr_type ptr_type;
 	ptr_type v_ptr(const_cast<__value_type*>(v.ptr()));
 	ptr_type w_ptr(const_cast<__value_type*>(w.ptr()));
@@ -600,6 +1170,8 @@ diff_norm2(const tensor<__value_type, __memory_space_type>& v, const tensor<__va
 template<class __value_type, class __memory_space_type>
 float
 norm1(const tensor<__value_type, __memory_space_type>& v){
+	if(reduce_strided(v))
+		return strided_transform_reduce(v, uf_abs<float,__value_type>(), 0.f, bf_plus<float,float,__value_type>(), bf_plus<float,float,float>());
 	typedef typename memspace_cuv2thrustptr<__value_type,__memory_space_type>::ptr_type ptr_type;
 	ptr_type v_ptr(const_cast<__value_type*>(v.ptr()));
 	float init=0;
@@ -610,6 +1182,8 @@ norm1(const tensor<__value_type, __memory_space_type>& v){
 template<class __value_type, class __memory_space_type>
 float
 sum(const tensor<__value_type, __memory_space_type>& v){
+	if(reduce_strided(v))
+		return strided_transform_reduce(v, uf_identity<__value_type,__value_type>(), 0.f, bf_plus<float,float,__value_type>(), bf_plus<float,float,float>());
 	typedef typename memspace_cuv2thrustptr<__value_type,__memory_space_type>::ptr_type ptr_type;
 	ptr_type v_ptr(const_cast<__value_type*>(v.ptr()));
 	float init=0.0;
@@ -618,6 +1192,9 @@ sum(const tensor<__value_type, __memory_space_type>& v){
 template<class __value_type, class __memory_space_type>
 unsigned int
 count(const tensor<__value_type, __memory_space_type>& v, const __value_type& s){
+	if(reduce_strided(v))
+		return strided_transform_reduce(v, make_bind2nd(bf_equals<unsigned int,__value_type,__value_type>(),s), 0u,
+				bf_plus<unsigned int,unsigned int,unsigned int>(), bf_plus<unsigned int,unsigned int,unsigned int>());
 	typedef typename memspace_cuv2thrustptr<__value_type,__memory_space_type>::ptr_type ptr_type;
 	ptr_type v_ptr(const_cast<__value_type*>(v.ptr()));
 	return   thrust::count(v_ptr, v_ptr+v.size(), s);
@@ -625,6 +1202,8 @@ count(const tensor<__value_type, __memory_space_type>& v, const __value_type& s)
 template<class __value_type, class __memory_space_type>
 float
 maximum(const tensor<__value_type, __memory_space_type>& v){
+	if(reduce_strided(v))
+		return strided_transform_reduce(v, uf_identity<__value_type,__value_type>(), (float)-INT_MAX, bf_max<float,float,__value_type>(), bf_max<float,float,float>());
 	typedef typename memspace_cuv2thrustptr<__value_type,__memory_space_type>::ptr_type ptr_type;
 	ptr_type v_ptr(const_cast<__value_type*>(v.ptr()));
 	float init=-INT_MAX;
@@ -633,6 +1212,8 @@ maximum(const tensor<__value_type, __memory_space_type>& v){
 template<class __value_type, class __memory_space_type>
 float
 minimum(const tensor<__value_type, __memory_space_type>& v){
+	if(reduce_strided(v))
+		return strided_transform_reduce(v, uf_identity<__value_type,__value_type>(), (float)INT_MAX, bf_min<float,float,__value_type>(), bf_min<float,float,float>());
 	typedef typename memspace_cuv2thrustptr<__value_type,__memory_space_type>::ptr_type ptr_type;
 	ptr_type v_ptr(const_cast<__value_type*>(v.ptr()));
 	float init=INT_MAX;
@@ -650,6 +1231,9 @@ var(const tensor<__value_type, __memory_space_type>& v){
 	ptr_type v_ptr(const_cast<__value_type*>(v.ptr()));
 	float init=0;
 	float m = mean(v);
+	if(reduce_strided(v))
+		return strided_transform_reduce(v, make_bind2nd(bf_squared_diff<float,__value_type,float>(),m),
+				init, bf_plus<float,float,float>(), bf_plus<float,float,float>()) / (float)v.size();
 	return   thrust::transform_reduce(v_ptr, v_ptr+v.size(), 
 			make_bind2nd(bf_squared_diff<float,__value_type,float>(),m),  // result, tensor-type, mean-type
 			init, bf_plus<float,float,float>()) / (float)v.size();
@@ -657,6 +1241,8 @@ var(const tensor<__value_type, __memory_space_type>& v){
 template<class __value_type, class __memory_space_type>
 typename tensor<__value_type, __memory_space_type>::index_type
 arg_max(const tensor<__value_type, __memory_space_type>& v){
+	if(reduce_strided(v))
+		return strided_arg_extremum<true>(v);
 	typedef typename memspace_cuv2thrustptr<__value_type,__memory_space_type>::ptr_type ptr_type;
 	ptr_type begin(const_cast<__value_type*>(v.ptr()));
 	ptr_type elem = thrust::max_element(begin, begin	+v.size());
@@ -665,6 +1251,8 @@ arg_max(const tensor<__value_type, __memory_space_type>& v){
 template<class __value_type, class __memory_space_type>
 typename tensor<__value_type, __memory_space_type>::index_type
 arg_min(const tensor<__value_type, __memory_space_type>& v){
+	if(reduce_strided(v))
+		return strided_arg_extremum<false>(v);
 	typedef typename memspace_cuv2thrustptr<__value_type,__memory_space_type>::ptr_type ptr_type;
 	ptr_type begin(const_cast<__value_type*>(v.ptr()));
 	ptr_type elem = thrust::min_element(begin, begin	+v.size());
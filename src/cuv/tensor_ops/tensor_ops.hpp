@@ -1104,4 +1104,6 @@ namespace cuv{
   }
 
 
+#include <cuv/tensor_ops/expression.hpp>
+
 #endif
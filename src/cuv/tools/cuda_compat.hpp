@@ -0,0 +1,266 @@
+//*LB*
+// Copyright (c) 2010, University of Bonn, Institute for Computer Science VI
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+//  * Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//  * Neither the name of the University of Bonn 
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this software without specific prior written
+//    permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//*LE*
+
+
+
+
+#ifndef __CUV_CUDA_COMPAT_HPP__
+#define __CUV_CUDA_COMPAT_HPP__
+
+/**
+ * @file cuda_compat.hpp
+ * @brief the part of the CUDA runtime API used by CUV.
+ *
+ * Normally, this just includes the CUDA runtime headers.
+ *
+ * If CUV is built with CUV_CPU_ONLY (which defines CUV_NO_CUDA), there is no
+ * CUDA toolkit. Instead, this file defines the CUDA qualifiers as nothing and
+ * emulates the subset of the runtime API used by CUV in host memory: "device"
+ * memory is allocated with malloc, copies are memcpy and synchronization does
+ * nothing. dev_memory_space thus still works, device code paths of CUV forward
+ * to the host implementations, and thrust is configured to use its C++
+ * backend.
+ *
+ * Code using a host-only libcuv must be compiled with CUV_NO_CUDA defined.
+ */
+
+#ifndef CUV_NO_CUDA
+
+#include <cuda_runtime_api.h>
+
+#else
+
+#include <cstdlib>
+#include <cstring>
+
+#ifndef THRUST_DEVICE_SYSTEM
+#  define THRUST_DEVICE_SYSTEM THRUST_DEVICE_SYSTEM_CPP
+#endif
+
+#ifndef __host__
+#  define __host__
+#endif
+#ifndef __device__
+#  define __device__
+#endif
+#ifndef __global__
+#  define __global__
+#endif
+#ifndef __shared__
+#  define __shared__
+#endif
+#ifndef __forceinline__
+#  define __forceinline__ inline
+#endif
+
+/// CUDA error codes (the ones which can occur without a GPU)
+enum cudaError {
+    cudaSuccess = 0,
+    cudaErrorMemoryAllocation = 2,
+    cudaErrorInvalidValue = 11,
+    cudaErrorInvalidDevice = 10,
+    cudaErrorNoDevice = 38
+};
+typedef enum cudaError cudaError_t;
+
+/// direction of a copy (ignored, all memory is host memory)
+enum cudaMemcpyKind {
+    cudaMemcpyHostToHost = 0,
+    cudaMemcpyHostToDevice = 1,
+    cudaMemcpyDeviceToHost = 2,
+    cudaMemcpyDeviceToDevice = 3,
+    cudaMemcpyDefault = 4
+};
+
+/// streams are never created, all operations are synchronous
+typedef struct CUstream_st* cudaStream_t;
+
+/// properties of the emulated device
+struct cudaDeviceProp {
+    char name[256];
+    size_t totalGlobalMem;
+    int major;
+    int minor;
+    int multiProcessorCount;
+};
+
+namespace cuv {
+namespace detail {
+/// the error returned by the next call to cudaGetLastError()
+inline cudaError_t& host_cuda_last_error() {
+    static cudaError_t err = cudaSuccess;
+    return err;
+}
+/// remember err for cudaGetLastError() and return it
+inline cudaError_t host_cuda_status(cudaError_t err) {
+    if (err != cudaSuccess)
+        host_cuda_last_error() = err;
+    return err;
+}
+}
+}
+
+inline cudaError_t cudaGetLastError() {
+    cudaError_t err = cuv::detail::host_cuda_last_error();
+    cuv::detail::host_cuda_last_error() = cudaSuccess;
+    return err;
+}
+
+inline const char* cudaGetErrorString(cudaError_t err) {
+    switch (err) {
+        case cudaSuccess:
+            return "no error";
+        case cudaErrorMemoryAllocation:
+            return "out of memory";
+        case cudaErrorInvalidValue:
+            return "invalid argument";
+        case cudaErrorInvalidDevice:
+            return "invalid device ordinal (CUV was built without CUDA)";
+        default:
+            return "unknown error (CUV was built without CUDA)";
+    }
+}
+
+inline cudaError_t cudaGetDeviceCount(int* count) {
+    *count = 1;
+    return cudaSuccess;
+}
+
+inline cudaError_t cudaGetDevice(int* dev) {
+    *dev = 0;
+    return cudaSuccess;
+}
+
+inline cudaError_t cudaSetDevice(int dev) {
+    return cuv::detail::host_cuda_status(dev == 0 ? cudaSuccess : cudaErrorInvalidDevice);
+}
+
+inline cudaError_t cudaGetDeviceProperties(cudaDeviceProp* prop, int dev) {
+    if (dev != 0)
+        return cuv::detail::host_cuda_status(cudaErrorInvalidDevice);
+    std::memset(prop, 0, sizeof(cudaDeviceProp));
+    std::strcpy(prop->name, "host (CUV_NO_CUDA)");
+    return cudaSuccess;
+}
+
+inline cudaError_t cudaThreadSynchronize() {
+    return cudaSuccess;
+}
+
+inline cudaError_t cudaDeviceSynchronize() {
+    return cudaSuccess;
+}
+
+inline cudaError_t cudaThreadExit() {
+    return cudaSuccess;
+}
+
+inline cudaError_t cudaStreamSynchronize(cudaStream_t) {
+    return cudaSuccess;
+}
+
+inline cudaError_t cudaMalloc(void** ptr, size_t size) {
+    *ptr = std::malloc(size ? size : 1);
+    return cuv::detail::host_cuda_status(*ptr ? cudaSuccess : cudaErrorMemoryAllocation);
+}
+
+inline cudaError_t cudaMallocHost(void** ptr, size_t size) {
+    return cudaMalloc(ptr, size);
+}
+
+/// rows are not padded, the pitch is the width
+inline cudaError_t cudaMallocPitch(void** ptr, size_t* pitch, size_t width, size_t height) {
+    *pitch = width;
+    return cudaMalloc(ptr, width * height);
+}
+
+inline cudaError_t cudaFree(void* ptr) {
+    std::free(ptr);
+    return cudaSuccess;
+}
+
+inline cudaError_t cudaFreeHost(void* ptr) {
+    return cudaFree(ptr);
+}
+
+inline cudaError_t cudaMemset(void* ptr, int value, size_t count) {
+    std::memset(ptr, value, count);
+    return cudaSuccess;
+}
+
+inline cudaError_t cudaMemcpy(void* dst, const void* src, size_t count, cudaMemcpyKind) {
+    if (count)
+        std::memmove(dst, src, count);
+    return cudaSuccess;
+}
+
+inline cudaError_t cudaMemcpyAsync(void* dst, const void* src, size_t count, cudaMemcpyKind kind,
+        cudaStream_t = 0) {
+    return cudaMemcpy(dst, src, count, kind);
+}
+
+inline cudaError_t cudaMemcpy2D(void* dst, size_t dpitch, const void* src, size_t spitch, size_t width,
+        size_t height, cudaMemcpyKind) {
+    if (width > dpitch || width > spitch)
+        return cuv::detail::host_cuda_status(cudaErrorInvalidValue);
+    for (size_t i = 0; i < height; i++)
+        std::memmove(static_cast<char*>(dst) + i * dpitch, static_cast<const char*>(src) + i * spitch, width);
+    return cudaSuccess;
+}
+
+inline cudaError_t cudaMemcpy2DAsync(void* dst, size_t dpitch, const void* src, size_t spitch, size_t width,
+        size_t height, cudaMemcpyKind kind, cudaStream_t = 0) {
+    return cudaMemcpy2D(dst, dpitch, src, spitch, width, height, kind);
+}
+
+/// @name vector types used by CUV (layout as in vector_types.h)
+/// @{
+struct float1 { float x; };
+struct float2 { float x, y; };
+struct float3 { float x, y, z; };
+struct float4 { float x, y, z, w; };
+struct int2 { int x, y; };
+struct uchar4 { unsigned char x, y, z, w; };
+/// @}
+
+/// @name min and max which nvcc provides for host and device code
+/// @{
+inline int min(int a, int b) { return a < b ? a : b; }
+inline unsigned int min(unsigned int a, unsigned int b) { return a < b ? a : b; }
+inline float min(float a, float b) { return a < b ? a : b; }
+inline double min(double a, double b) { return a < b ? a : b; }
+inline int max(int a, int b) { return a > b ? a : b; }
+inline unsigned int max(unsigned int a, unsigned int b) { return a > b ? a : b; }
+inline float max(float a, float b) { return a > b ? a : b; }
+inline double max(double a, double b) { return a > b ? a : b; }
+/// @}
+
+#endif /* CUV_NO_CUDA */
+
+#endif
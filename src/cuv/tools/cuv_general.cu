@@ -34,7 +34,9 @@
 #include <string>
 #include <stdexcept>
 #include <iostream>
+#ifndef CUV_NO_CUDA
 #include <cuda.h>
+#endif
 /*#include <cutil_inline.h>*/
 
 #include "cuv_general.hpp"
@@ -1,7 +1,7 @@
 #ifndef __CUV_GENERAL_HPP__
 #define __CUV_GENERAL_HPP__
 
-#include <cuda_runtime_api.h>
+#include <cuv/tools/cuda_compat.hpp>
 #include <stdexcept>
 
 #ifndef CUDA_TEST_DEVICE
@@ -12,8 +12,10 @@
 #include <stdexcept>
 #include <iostream>
 #include <cstring>
+#ifndef CUV_NO_CUDA
 #include <cuda.h>
 #include <cuda_runtime.h>
+#endif
 #include <vector>
 #include "cuv_general.hpp"
 
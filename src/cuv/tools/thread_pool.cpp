@@ -0,0 +1,567 @@
+//*LB*
+// Copyright (c) 2010, University of Bonn, Institute for Computer Science VI
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+//  * Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//  * Neither the name of the University of Bonn 
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this software without specific prior written
+//    permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//*LE*
+
+
+
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/once.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "thread_pool.hpp"
+
+namespace cuv{
+
+namespace{
+
+/// index of the current thread in the pool, -1 for threads which do not belong to the pool
+__thread int t_worker = -1;
+
+/// limit set by scoped_host_thread_limit for the current thread, 0 if none
+__thread unsigned int t_thread_limit = 0;
+
+/// @return the value of a variable which is modified atomically by other threads
+template<class T>
+inline T atomic_load(T& x){
+    return __sync_fetch_and_add(&x, (T) 0);
+}
+
+/// @return the CPUs the process may run on, ordered by NUMA node, and the node of every CPU
+void host_cpu_topology(std::vector<int>& cpus, std::vector<int>& nodes){
+    cpus.clear();
+    nodes.clear();
+#ifdef __linux__
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if(sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+        return;
+    std::vector<bool> seen(CPU_SETSIZE, false);
+    for(int node = 0; ; node++){
+        char path[64];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+        FILE* f = fopen(path, "r");
+        if(!f)
+            break;
+        // format: "0-3,8-11"
+        int a, b;
+        char sep;
+        while(fscanf(f, "%d", &a) == 1){
+            b = a;
+            if(fscanf(f, "%c", &sep) == 1 && sep == '-'){
+                if(fscanf(f, "%d", &b) != 1)
+                    break;
+                if(fscanf(f, "%c", &sep) != 1)
+                    sep = '\n';
+            }
+            for(int c = a; c <= b && c < CPU_SETSIZE; c++)
+                if(CPU_ISSET(c, &allowed) && !seen[c]){
+                    seen[c] = true;
+                    cpus.push_back(c);
+                    nodes.push_back(node);
+                }
+            if(sep != ',')
+                break;
+        }
+        fclose(f);
+    }
+    // no NUMA information: a single node
+    for(int c = 0; c < CPU_SETSIZE; c++)
+        if(CPU_ISSET(c, &allowed) && !seen[c]){
+            cpus.push_back(c);
+            nodes.push_back(0);
+        }
+#endif
+}
+
+unsigned int default_num_threads(){
+    const char* env = getenv("CUV_NUM_THREADS");
+    if(env){
+        int n = atoi(env);
+        if(n > 0)
+            return n;
+    }
+    std::vector<int> cpus, nodes;
+    host_cpu_topology(cpus, nodes);
+    if(!cpus.empty())
+        return cpus.size();
+    unsigned int n = boost::thread::hardware_concurrency();
+    return n ? n : 1;
+}
+
+bool default_pin_threads(){
+    const char* env = getenv("CUV_PIN_THREADS");
+    return env && atoi(env) > 0;
+}
+
+/**
+ * a spin lock for the short critical sections of chunk queues.
+ *
+ * Yields after a while, in case the holder was preempted (e.g. if there are
+ * more threads than CPUs).
+ */
+class spin_lock{
+    private:
+        volatile int m_locked;
+    public:
+        spin_lock():m_locked(0){}
+        void lock(){
+            for(unsigned int spins = 0; __sync_lock_test_and_set(&m_locked, 1); spins++)
+                if(spins >= 64)
+                    boost::this_thread::yield();
+        }
+        void unlock(){
+            __sync_lock_release(&m_locked);
+        }
+};
+
+/**
+ * the chunks owned by one thread taking part in a job.
+ *
+ * The owner takes chunks from the front, thieves take the back half.
+ * Padded to a cache line to avoid false sharing.
+ */
+struct chunk_queue{
+    spin_lock lock;
+    size_t begin;
+    size_t end;
+    int node;   ///< NUMA node of the owner, -1 if unknown
+    char pad[64 - sizeof(spin_lock) - 2 * sizeof(size_t) - sizeof(int)];
+    chunk_queue():begin(0), end(0), node(-1){}
+};
+
+/**
+ * one call of run_parallel.
+ *
+ * Lives on the stack of the submitting thread, which holds the first queue.
+ * Workers joining the job get one of the remaining queues.
+ */
+struct job{
+    detail::range_task* task;
+    size_t n;
+    size_t grain;
+    size_t n_chunks;
+    std::vector<chunk_queue> queues;
+    unsigned int joined;    ///< number of queues in use (atomic, modified with the pool mutex held)
+    unsigned int active;    ///< workers currently inside the job (protected by the pool mutex)
+    size_t claimed;         ///< chunks which were taken for execution (atomic)
+    size_t finished;        ///< chunks which were executed (atomic)
+    int failed;             ///< an exception occurred (atomic)
+    std::string error;
+    boost::mutex error_mutex;
+
+    job(detail::range_task& t, size_t _n, size_t _grain, unsigned int max_threads)
+        : task(&t), n(_n), grain(_grain), n_chunks((_n + _grain - 1) / _grain)
+        , queues(max_threads), joined(1), active(0), claimed(0), finished(0), failed(0)
+    {
+        queues[0].begin = 0;
+        queues[0].end   = n_chunks;
+    }
+
+    bool open(){
+        return atomic_load(joined) < queues.size() && atomic_load(claimed) < n_chunks;
+    }
+    bool done(){
+        return atomic_load(finished) == n_chunks && active == 0;
+    }
+
+    /// take a chunk from our own queue
+    bool pop(unsigned int q, size_t& c){
+        chunk_queue& my = queues[q];
+        my.lock.lock();
+        bool ok = my.begin < my.end;
+        if(ok)
+            c = my.begin++;
+        my.lock.unlock();
+        return ok;
+    }
+
+    /// take half of the chunks of another queue, the first one is returned in c
+    bool steal(unsigned int q, size_t& c){
+        const unsigned int nq = std::min(atomic_load(joined), (unsigned int) queues.size());
+        const int node = queues[q].node;
+        // two passes: victims on our own NUMA node first
+        for(int pass = 0; pass < 2; pass++){
+            for(unsigned int i = 1; i < nq; i++){
+                chunk_queue& victim = queues[(q + i) % nq];
+                if((pass == 0) != (node >= 0 && victim.node == node))
+                    continue;
+                victim.lock.lock();
+                size_t rest = victim.end - std::min(victim.begin, victim.end);
+                if(rest == 0){
+                    victim.lock.unlock();
+                    continue;
+                }
+                size_t take = (rest + 1) / 2;
+                size_t end = victim.end;
+                victim.end -= take;
+                victim.lock.unlock();
+
+                chunk_queue& my = queues[q];
+                my.lock.lock();
+                my.begin = end - take + 1;
+                my.end = end;
+                my.lock.unlock();
+                c = end - take;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void run_chunk(size_t c){
+        __sync_fetch_and_add(&claimed, (size_t)1);
+        if(!atomic_load(failed)){
+            size_t begin = c * grain;
+            size_t end = begin + grain < n ? begin + grain : n;
+            try{
+                (*task)(begin, end);
+            }catch(std::exception& e){
+                fail(e.what());
+            }catch(...){
+                fail("unknown exception in host thread pool");
+            }
+        }
+    }
+
+    void fail(const std::string& msg){
+        boost::mutex::scoped_lock lock(error_mutex);
+        if(!failed){
+            error = msg;
+            __sync_fetch_and_add(&failed, 1);
+        }
+    }
+
+    /// execute chunks until there are none left to steal, @return true if the job is finished
+    bool work(unsigned int q){
+        size_t c;
+        bool last = false;
+        while(pop(q, c) || steal(q, c)){
+            run_chunk(c);
+            last = __sync_add_and_fetch(&finished, (size_t)1) == n_chunks;
+        }
+        return last;
+    }
+};
+
+/// @return NUMA node of the CPU the calling thread runs on, -1 if unknown
+int current_node(const std::vector<int>& node_of_cpu){
+#ifdef __linux__
+    int cpu = sched_getcpu();
+    if(cpu >= 0 && cpu < (int) node_of_cpu.size())
+        return node_of_cpu[cpu];
+#endif
+    return -1;
+}
+
+/**
+ * persistent pool of worker threads with work stealing.
+ *
+ * Any number of jobs may run at the same time. The submitting thread works
+ * on its own job, idle workers join the most recent job which has chunks
+ * left and steal from the threads already working on it.
+ */
+class host_thread_pool{
+    private:
+        boost::mutex m_mutex;          ///< protects the job list and the pool state
+        boost::condition_variable m_work_cond;
+        boost::condition_variable m_done_cond;
+        std::vector<boost::thread*> m_workers;
+        std::vector<job*> m_jobs;      ///< running jobs, most recent last
+        unsigned int m_running;        ///< number of running jobs
+        bool m_stop;
+        bool m_resizing;
+
+        unsigned int m_num_threads;
+        size_t m_threshold;
+        bool m_pin;
+
+        std::vector<int> m_cpus;       ///< CPUs ordered by NUMA node
+        std::vector<int> m_cpu_node;   ///< NUMA node of m_cpus[i]
+        std::vector<int> m_node_of_cpu;///< NUMA node of a CPU number
+        std::vector<int> m_worker_node;///< NUMA node of worker i if pinned, -1 otherwise
+
+        /// @return a job the calling worker can join, NULL if there is none (m_mutex must be held)
+        job* find_job(){
+            for(int i = (int) m_jobs.size() - 1; i >= 0; i--)
+                if(m_jobs[i]->open())
+                    return m_jobs[i];
+            return NULL;
+        }
+
+        void worker_loop(unsigned int w){
+            t_worker = w;
+            pin_self(w);
+            boost::mutex::scoped_lock lock(m_mutex);
+            for(;;){
+                job* j = NULL;
+                while(!m_stop && (j = find_job()) == NULL)
+                    m_work_cond.wait(lock);
+                if(m_stop)
+                    return;
+                // the queue becomes visible to thieves with the increment of joined
+                unsigned int q = atomic_load(j->joined);
+                j->queues[q].node = m_worker_node[w];
+                __sync_fetch_and_add(&j->joined, 1u);
+                j->active++;
+                lock.unlock();
+                j->work(q);
+                lock.lock();
+                if(--j->active == 0 && atomic_load(j->finished) == j->n_chunks)
+                    m_done_cond.notify_all();
+            }
+        }
+
+        /// pin worker w to a CPU if requested and remember its NUMA node
+        void pin_self(unsigned int w){
+#ifdef __linux__
+            if(!m_pin || m_cpus.empty())
+                return;
+            // worker w runs next to the submitting thread, which usually is on the first CPU
+            unsigned int i = w % m_cpus.size();
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(m_cpus[i], &set);
+            if(pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0)
+                m_worker_node[w] = m_cpu_node[i];
+#endif
+        }
+
+        void start_workers(){
+            const unsigned int n = num_threads();
+            m_worker_node.assign(n, -1);
+            for(unsigned int i=1; i<n; i++)
+                m_workers.push_back(new boost::thread(&host_thread_pool::worker_loop, this, i));
+        }
+
+        void stop_workers(){
+            {
+                boost::mutex::scoped_lock lock(m_mutex);
+                m_stop = true;
+                m_work_cond.notify_all();
+            }
+            for(unsigned int i=0; i<m_workers.size(); i++){
+                m_workers[i]->join();
+                delete m_workers[i];
+            }
+            m_workers.clear();
+            m_stop = false;
+        }
+
+        /// wait until no job runs and keep new jobs from using the workers
+        void begin_resize(boost::mutex::scoped_lock& lock){
+            while(m_resizing)
+                m_done_cond.wait(lock);
+            m_resizing = true;
+            while(m_running > 0)
+                m_done_cond.wait(lock);
+        }
+
+        void end_resize(){
+            boost::mutex::scoped_lock lock(m_mutex);
+            m_resizing = false;
+            m_done_cond.notify_all();
+        }
+
+    public:
+        host_thread_pool()
+            : m_running(0), m_stop(false), m_resizing(false)
+            , m_num_threads(default_num_threads()), m_threshold(32768)
+            , m_pin(default_pin_threads())
+        {
+            host_cpu_topology(m_cpus, m_cpu_node);
+            for(unsigned int i = 0; i < m_cpus.size(); i++){
+                if(m_cpus[i] >= (int) m_node_of_cpu.size())
+                    m_node_of_cpu.resize(m_cpus[i] + 1, -1);
+                m_node_of_cpu[m_cpus[i]] = m_cpu_node[i];
+            }
+            start_workers();
+        }
+
+        ~host_thread_pool(){
+            stop_workers();
+        }
+
+        unsigned int num_threads(){ return atomic_load(m_num_threads); }
+        size_t threshold()const{ return m_threshold; }
+        void set_threshold(size_t n){ m_threshold = n; }
+        bool pin_threads()const{ return m_pin; }
+
+        void set_num_threads(unsigned int n){
+            if(n == 0)
+                n = default_num_threads();
+            {
+                boost::mutex::scoped_lock lock(m_mutex);
+                if(n == num_threads())
+                    return;
+                begin_resize(lock);
+            }
+            stop_workers();
+            __sync_lock_test_and_set(&m_num_threads, n);
+            start_workers();
+            end_resize();
+        }
+
+        void set_pin_threads(bool pin){
+            {
+                boost::mutex::scoped_lock lock(m_mutex);
+                if(pin == m_pin)
+                    return;
+                begin_resize(lock);
+            }
+            stop_workers();
+            m_pin = pin;
+            start_workers();
+            end_resize();
+        }
+
+        void run(size_t n, size_t grain, detail::range_task& task, unsigned int max_threads){
+            if(grain == 0)
+                grain = 1;
+            if(n <= grain){
+                task(0, n);
+                return;
+            }
+            const size_t n_chunks = (n + grain - 1) / grain;
+            max_threads = std::min((size_t) max_threads, n_chunks);
+            job j(task, n, grain, max_threads);
+            j.queues[0].node = t_worker >= 0 ? m_worker_node[t_worker] : current_node(m_node_of_cpu);
+            {
+                boost::mutex::scoped_lock lock(m_mutex);
+                if(m_resizing || m_workers.empty()){
+                    // the pool is being resized, do not wait for it.
+                    lock.unlock();
+                    task(0, n);
+                    return;
+                }
+                m_running++;
+                j.active++;
+                m_jobs.push_back(&j);
+                m_work_cond.notify_all();
+            }
+            j.work(0);
+            {
+                boost::mutex::scoped_lock lock(m_mutex);
+                j.active--;
+                // no worker may join once all chunks are claimed, remove the job
+                m_jobs.erase(std::find(m_jobs.begin(), m_jobs.end(), &j));
+                while(!j.done())
+                    m_done_cond.wait(lock);
+                if(--m_running == 0 && m_resizing)
+                    m_done_cond.notify_all();
+            }
+            if(j.failed)
+                throw std::runtime_error(j.error);
+        }
+};
+
+boost::once_flag g_pool_once = BOOST_ONCE_INIT;
+host_thread_pool* g_pool = NULL;
+
+/// destroys the pool (and joins its threads) at program exit
+struct pool_destroyer{
+    ~pool_destroyer(){
+        delete g_pool;
+        g_pool = NULL;
+    }
+} g_pool_destroyer;
+
+void create_pool(){
+    g_pool = new host_thread_pool();
+}
+
+/// the pool is created by the first call, later calls do not lock
+host_thread_pool& pool(){
+    boost::call_once(create_pool, g_pool_once);
+    return *g_pool;
+}
+
+}
+
+void set_host_num_threads(unsigned int n){
+    pool().set_num_threads(n);
+}
+
+unsigned int get_host_num_threads(){
+    return pool().num_threads();
+}
+
+void set_host_parallel_threshold(size_t n){
+    pool().set_threshold(n);
+}
+
+size_t get_host_parallel_threshold(){
+    return pool().threshold();
+}
+
+void set_host_pin_threads(bool pin){
+    pool().set_pin_threads(pin);
+}
+
+bool get_host_pin_threads(){
+    return pool().pin_threads();
+}
+
+scoped_host_thread_limit::scoped_host_thread_limit(unsigned int n)
+    : m_old(t_thread_limit)
+{
+    t_thread_limit = n;
+}
+
+scoped_host_thread_limit::~scoped_host_thread_limit(){
+    t_thread_limit = m_old;
+}
+
+namespace detail{
+    unsigned int host_thread_limit(unsigned int max_threads){
+        unsigned int n = pool().num_threads();
+        if(t_thread_limit > 0)
+            n = std::min(n, t_thread_limit);
+        if(max_threads > 0)
+            n = std::min(n, max_threads);
+        return n;
+    }
+
+    void run_parallel(size_t n, size_t grain, range_task& task, unsigned int max_threads){
+        pool().run(n, grain, task, host_thread_limit(max_threads));
+    }
+}
+
+}
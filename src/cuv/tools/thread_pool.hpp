@@ -0,0 +1,306 @@
+//*LB*
+// Copyright (c) 2010, University of Bonn, Institute for Computer Science VI
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+//  * Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//  * Neither the name of the University of Bonn 
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this software without specific prior written
+//    permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//*LE*
+
+
+
+
+#ifndef __CUV_THREAD_POOL_HPP__
+#define __CUV_THREAD_POOL_HPP__
+
+#include <cstddef>
+#include <vector>
+#include <boost/scoped_array.hpp>
+
+namespace cuv{
+
+/**
+ * @addtogroup tools
+ * @{
+ *
+ * @section host_runtime host execution runtime
+ *
+ * All host kernels of CUV run on one persistent pool of worker threads.
+ * Work is submitted with parallel_for(), parallel_tasks() and
+ * parallel_reduce(). The range of a call is split into chunks which are
+ * distributed over the threads taking part in the call, idle threads steal
+ * chunks from busy ones (preferring threads on the same NUMA node).
+ *
+ * Several host threads (e.g. Python threads) may submit work at the same
+ * time, the workers are shared among their calls. Calls from within a
+ * running chunk are executed in parallel as well.
+ */
+
+/**
+ * @brief set the number of threads used by host (CPU) kernels.
+ *
+ * This is the global concurrency limit. The calling thread always takes part
+ * in the work, so n=1 means that host kernels run serially. n=0 resets to the
+ * default, which is the value of the environment variable CUV_NUM_THREADS or,
+ * if that is not set, the number of CPUs the process may run on.
+ *
+ * @param n number of threads
+ */
+void set_host_num_threads(unsigned int n);
+
+/**
+ * @return the number of threads used by host kernels
+ */
+unsigned int get_host_num_threads();
+
+/**
+ * @brief set the minimum number of elements a host kernel must process before it is split across threads.
+ *
+ * Small operations are dominated by the cost of waking up the workers, they
+ * stay serial.
+ *
+ * @param n number of elements
+ */
+void set_host_parallel_threshold(size_t n);
+
+/**
+ * @return the minimum number of elements for which host kernels run in parallel
+ */
+size_t get_host_parallel_threshold();
+
+/**
+ * @brief pin the worker threads to CPUs.
+ *
+ * Workers are then placed on the CPUs the process may run on, node by node,
+ * so that neighbouring workers share a NUMA node. Pinning is off by default
+ * since it does not play well with other multithreaded libraries in the same
+ * process. The default can be changed by setting CUV_PIN_THREADS=1.
+ *
+ * Only has an effect on Linux.
+ *
+ * @param pin whether to pin the workers
+ */
+void set_host_pin_threads(bool pin);
+
+/**
+ * @return whether the worker threads are pinned to CPUs
+ */
+bool get_host_pin_threads();
+
+/**
+ * @brief limits the number of threads of host kernels called by the current thread.
+ *
+ * The limit holds for the lifetime of the object and applies in addition to
+ * the global limit and to the limit passed to a single call. Limits can be
+ * nested, the innermost one wins.
+ *
+ * @code
+ * {
+ *     scoped_host_thread_limit limit(2);
+ *     apply_binary_functor(a, b, BF_ADD); // uses at most two threads
+ * }
+ * @endcode
+ */
+class scoped_host_thread_limit{
+    private:
+        unsigned int m_old; ///< limit which was active before
+        scoped_host_thread_limit(const scoped_host_thread_limit&);
+        scoped_host_thread_limit& operator=(const scoped_host_thread_limit&);
+    public:
+        /// @param n maximum number of threads, 0 means no limit
+        explicit scoped_host_thread_limit(unsigned int n);
+        ~scoped_host_thread_limit();
+};
+
+/**
+ * size in bytes of the memory touched by one chunk of work in an
+ * element-wise host kernel.  Chosen such that the chunk fits into L2 cache.
+ */
+static const size_t HOST_CHUNK_BYTES = 128 * 1024;
+
+/**
+ * @return the number of elements per chunk such that one chunk touches about HOST_CHUNK_BYTES
+ * @param bytes_per_element number of bytes read and written per element
+ */
+inline size_t host_chunk_size(size_t bytes_per_element){
+    size_t n = HOST_CHUNK_BYTES / (bytes_per_element ? bytes_per_element : 1);
+    return n ? n : 1;
+}
+
+namespace detail{
+    /**
+     * a piece of work which can be executed on any sub-range [begin,end) of [0,n).
+     */
+    struct range_task{
+        virtual ~range_task(){}
+        virtual void operator()(size_t begin, size_t end)=0;
+    };
+
+    /**
+     * adapts a functor with operator()(size_t begin, size_t end) to range_task
+     */
+    template<class F>
+    struct range_task_adaptor : public range_task{
+        F& m_f;
+        range_task_adaptor(F& f):m_f(f){}
+        void operator()(size_t begin, size_t end){ m_f(begin,end); }
+    };
+
+    /**
+     * split [0,n) in chunks [k*grain, (k+1)*grain) and process them on the
+     * persistent host thread pool.  Returns when all chunks are done.
+     *
+     * Exceptions thrown by the task are re-thrown in the calling thread as
+     * std::runtime_error, chunks which did not start yet are skipped.
+     *
+     * @param max_threads maximum number of threads working on the call, 0 means no limit
+     */
+    void run_parallel(size_t n, size_t grain, range_task& task, unsigned int max_threads = 0);
+
+    /**
+     * @return the number of threads a call with the given limit may use,
+     *         taking the global and scoped limits into account
+     */
+    unsigned int host_thread_limit(unsigned int max_threads);
+
+    /// maximum number of partial results of a parallel_reduce kept on the stack
+    static const size_t REDUCE_STACK_PARTIALS = 256;
+
+    /**
+     * computes the partial results of the chunks of a parallel_reduce
+     */
+    template<class T, class F>
+    struct reduce_chunks{
+        F& m_f;
+        T* m_partial;
+        size_t m_n;
+        size_t m_grain;
+        reduce_chunks(F& f, T* partial, size_t n, size_t grain)
+            :m_f(f), m_partial(partial), m_n(n), m_grain(grain){}
+        void operator()(size_t begin, size_t end){
+            for(size_t c = begin; c < end; c++){
+                size_t b = c * m_grain;
+                m_partial[c] = m_f(b, b + m_grain < m_n ? b + m_grain : m_n);
+            }
+        }
+    };
+}
+
+/**
+ * @brief call f(begin,end) for consecutive chunks of [0,n), possibly in parallel.
+ *
+ * If n is below the threshold set by set_host_parallel_threshold(), f is
+ * called exactly once with f(0,n) in the calling thread. Otherwise, chunks
+ * start at multiples of grain and have grain elements (except for the last
+ * one).
+ *
+ * f must be safe to call concurrently on disjoint ranges.
+ *
+ * @param n     number of elements
+ * @param grain number of elements in one chunk
+ * @param f     functor with operator()(size_t begin, size_t end)
+ * @param max_threads maximum number of threads for this call, 0 means no limit
+ */
+template<class F>
+void parallel_for(size_t n, size_t grain, F& f, unsigned int max_threads = 0){
+    if(n == 0)
+        return;
+    if(n < get_host_parallel_threshold() || n <= grain || detail::host_thread_limit(max_threads) < 2){
+        f((size_t)0, n);
+        return;
+    }
+    detail::range_task_adaptor<F> task(f);
+    detail::run_parallel(n, grain, task, max_threads);
+}
+
+/**
+ * @brief call f(begin,end) for ranges of the tasks [0,n), possibly in parallel.
+ *
+ * For kernels which divide their work into few, large tasks (e.g. tiles of a
+ * matrix). Unlike parallel_for, the element threshold does not apply and every
+ * task may be executed by a different thread.
+ *
+ * @param n number of tasks
+ * @param f functor with operator()(size_t begin, size_t end)
+ * @param max_threads maximum number of threads for this call, 0 means no limit
+ */
+template<class F>
+void parallel_tasks(size_t n, F& f, unsigned int max_threads = 0){
+    if(n == 0)
+        return;
+    if(n < 2 || detail::host_thread_limit(max_threads) < 2){
+        f((size_t)0, n);
+        return;
+    }
+    detail::range_task_adaptor<F> task(f);
+    detail::run_parallel(n, 1, task, max_threads);
+}
+
+/**
+ * @brief reduce [0,n), possibly in parallel.
+ *
+ * [0,n) is split into chunks of grain elements and f(begin,end) computes
+ * the result of one chunk. The results of the chunks are combined in order,
+ * @code
+ * join(...join(join(init, f(0,grain)), f(grain,2*grain))..., f(.., n))
+ * @endcode
+ * The chunks do not depend on the number of threads, neither does the
+ * result. join must be associative.
+ *
+ * @param n     number of elements
+ * @param grain number of elements in one chunk
+ * @param init  the first operand of join
+ * @param f     functor with T operator()(size_t begin, size_t end), must be safe to call concurrently
+ * @param join  functor with T operator()(const T&, const T&)
+ * @param max_threads maximum number of threads for this call, 0 means no limit
+ * @return the combined result
+ */
+template<class T, class F, class J>
+T parallel_reduce(size_t n, size_t grain, const T& init, F& f, J join, unsigned int max_threads = 0){
+    if(n == 0)
+        return init;
+    if(grain == 0)
+        grain = 1;
+    const size_t n_chunks = (n + grain - 1) / grain;
+    // not a std::vector, vector<bool> has no T* to its elements.
+    // the heap is only used for very long ranges.
+    T stack_partial[detail::REDUCE_STACK_PARTIALS];
+    boost::scoped_array<T> heap_partial(n_chunks > detail::REDUCE_STACK_PARTIALS ? new T[n_chunks] : NULL);
+    T* partial = heap_partial ? heap_partial.get() : stack_partial;
+    detail::reduce_chunks<T,F> chunks(f, partial, n, grain);
+    if(n < get_host_parallel_threshold() || n_chunks < 2 || detail::host_thread_limit(max_threads) < 2)
+        chunks((size_t)0, n_chunks);
+    else{
+        detail::range_task_adaptor<detail::reduce_chunks<T,F> > task(chunks);
+        detail::run_parallel(n_chunks, 1, task, max_threads);
+    }
+    T r = init;
+    for(size_t c = 0; c < n_chunks; c++)
+        r = join(r, partial[c]);
+    return r;
+}
+
+/** @} */ // end group tools
+}
+
+#endif /* __CUV_THREAD_POOL_HPP__ */
@@ -157,12 +157,14 @@ void export_convolve(){
                 arg("fact_new")=1.f,
                 arg("fact_old")=0.f));
 
-    def("local_avg_pool_grad",(void (*)(T&,const T&, int, int, int)) local_avg_pool_grad<V,M,L>, (
+    def("local_avg_pool_grad",(void (*)(T&,const T&, int, int, int, float, float)) local_avg_pool_grad<V,M,L>, (
                 arg("target"),
                 arg("avgGrads"),
                 arg("subsx"),
                 arg("startx"),
-                arg("stridex")));
+                arg("stridex"),
+                arg("fact_new")=1.f,
+                arg("fact_old")=0.f));
 
     def("response_normalization",(void (*)(T&, T&, const T&, int, float, float)) response_normalization<V,M,L>, (
                 arg("target"),
@@ -0,0 +1,170 @@
+//*LB*
+// Copyright (c) 2010, University of Bonn, Institute for Computer Science VI
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+//  * Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//  * Neither the name of the University of Bonn 
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this software without specific prior written
+//    permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//*LE*
+
+
+
+
+
+#include <string>
+#include <fstream>
+#include <boost/python.hpp>
+
+#include <cuv/basics/dia_matrix.hpp>
+#include <cuv/basics/sparse_matrix_io.hpp>
+#include <cuv/matrix_ops/matrix_ops.hpp>
+#include <cuv/convert/convert.hpp>
+
+using namespace boost::python;
+using namespace cuv;
+
+template<class V, class I>
+struct csr_io{
+	template<class T>
+	static void save_host(T& m, std::string fn){
+			std::ofstream ofs(fn.c_str());
+			boost::archive::binary_oarchive oa(ofs);
+			oa << m;
+	}
+	template<class T>
+	static void load_host(T& m, std::string fn){
+			std::ifstream ifs(fn.c_str());
+			boost::archive::binary_iarchive ia(ifs);
+			ia >> m;
+	}
+	static void save_mat(csr_matrix<V,host_memory_space,I>& m, std::string fn){ save_host(m,fn); }
+	static void load_mat(csr_matrix<V,host_memory_space,I>& m, std::string fn){ load_host(m,fn); }
+	static void save_mat(bsr_matrix<V,host_memory_space,I>& m, std::string fn){ save_host(m,fn); }
+	static void load_mat(bsr_matrix<V,host_memory_space,I>& m, std::string fn){ load_host(m,fn); }
+	static void save_mat(csr_matrix<V,dev_memory_space,I>& m, std::string fn){
+		csr_matrix<V,host_memory_space,I> m2;
+		convert(m2,m);
+		save_host(m2,fn);
+	}
+	static void load_mat(csr_matrix<V,dev_memory_space,I>& m, std::string fn){
+		csr_matrix<V,host_memory_space,I> m2;
+		load_host(m2,fn);
+		convert(m,m2);
+	}
+	static void save_mat(bsr_matrix<V,dev_memory_space,I>& m, std::string fn){
+		bsr_matrix<V,host_memory_space,I> m2;
+		convert(m2,m);
+		save_host(m2,fn);
+	}
+	static void load_mat(bsr_matrix<V,dev_memory_space,I>& m, std::string fn){
+		bsr_matrix<V,host_memory_space,I> m2;
+		load_host(m2,fn);
+		convert(m,m2);
+	}
+};
+
+/// the common part of CSR and BSR matrices
+template<class T>
+class_<T,boost::shared_ptr<T> >
+export_csrmat_common(const char* name){
+	typedef T mat;
+	typedef typename mat::value_type value_type;
+	typedef typename mat::index_type index_type;
+	typedef typename mat::vec_type vec_type;
+	typedef typename mat::idxvec_type idxvec_type;
+
+	class_<mat,boost::shared_ptr<mat> > matobj(name);
+	matobj
+		.add_property("h", &mat::h)
+		.add_property("w", &mat::w)
+		.add_property("nnz", &mat::nnz, "number of stored entries")
+		.add_property("vals",    make_function((vec_type& (mat::*)())(&mat::vals),       return_internal_reference<>()))
+		.add_property("row_ptr", make_function((idxvec_type& (mat::*)())(&mat::row_ptr), return_internal_reference<>()))
+		.add_property("col_idx", make_function((idxvec_type& (mat::*)())(&mat::col_idx), return_internal_reference<>()))
+		.def("__len__",&mat::n, "number of elements")
+		.def("dealloc",&mat::dealloc, "deallocate memory")
+		.def("save", (void (*)(mat&,std::string)) csr_io<value_type, index_type>::save_mat, "save to file")
+		.def("load", (void (*)(mat&,std::string)) csr_io<value_type, index_type>::load_mat, "load from file")
+		.def("set", &mat::set, "set a value")
+		.def("has", &mat::has, "whether the matrix stores this value")
+		.def("__call__",  (value_type (mat::*)(const index_type&, const index_type&)const)(&mat::operator()))
+		.def(init<>())
+		;
+	return matobj;
+}
+
+template<class V, class M>
+void
+export_csrmat(const char* csr_name, const char* bsr_name){
+	typedef csr_matrix<V,M> csr;
+	typedef bsr_matrix<V,M> bsr;
+	typedef typename csr::index_type index_type;
+	export_csrmat_common<csr>(csr_name)
+		.def(init<index_type,index_type,index_type>((arg("h"),arg("w"),arg("nnz"))))
+		;
+	export_csrmat_common<bsr>(bsr_name)
+		.def(init<index_type,index_type,index_type,index_type,index_type>((arg("h"),arg("w"),arg("block_h"),arg("block_w"),arg("nnzb"))))
+		.add_property("block_h", &bsr::block_h)
+		.add_property("block_w", &bsr::block_w)
+		.add_property("nnzb", &bsr::nnzb, "number of stored blocks")
+		;
+}
+
+template <class T>
+void
+export_csrmat_conversion(){
+	typedef csr_matrix<T,host_memory_space> hcsr;
+	typedef bsr_matrix<T,host_memory_space> hbsr;
+	typedef tensor<T,host_memory_space,column_major> hdense;
+	def("convert", (void(*)(csr_matrix<T,dev_memory_space>&,const hcsr&)) cuv::convert);
+	def("convert", (void(*)(hcsr&,const csr_matrix<T,dev_memory_space>&)) cuv::convert);
+	def("convert", (void(*)(bsr_matrix<T,dev_memory_space>&,const hbsr&)) cuv::convert);
+	def("convert", (void(*)(hbsr&,const bsr_matrix<T,dev_memory_space>&)) cuv::convert);
+	def("convert", (void(*)(hdense&, const hcsr&)) cuv::convert);
+	def("convert", (void(*)(hcsr&, const hdense&)) cuv::convert);
+	def("convert", (void(*)(hdense&, const hbsr&)) cuv::convert);
+	def("convert", (void(*)(hbsr&, const hdense&)) cuv::convert);
+	def("convert", (void(*)(hcsr&, const dia_matrix<T,host_memory_space>&)) cuv::convert);
+	def("convert", (void(*)(dia_matrix<T,host_memory_space>&, const hcsr&)) cuv::convert);
+	def("convert", (void(*)(hcsr&, const hbsr&)) cuv::convert);
+	def("convert", (void(*)(hbsr&, const hcsr&)) cuv::convert);
+}
+
+void export_csr_matrix(){
+	export_csrmat<float,dev_memory_space>("dev_csr_matrix_f", "dev_bsr_matrix_f");
+	export_csrmat<float,host_memory_space>("host_csr_matrix_f", "host_bsr_matrix_f");
+	export_csrmat_conversion<float>();
+
+	def("prod", (void (*)(tensor<float,host_memory_space,column_major>&,const csr_matrix<float,host_memory_space>&,const tensor<float,host_memory_space,column_major>&,char, char, const float&, const float& ))cuv::prod<float,host_memory_space,column_major>, 
+			(arg("C"),arg("A"),arg("B"),arg("transA"),arg("transB"),arg("factAB")=1.f,arg("factC")=0.f));
+	def("prod", (void (*)(tensor<float,host_memory_space,row_major>&,const csr_matrix<float,host_memory_space>&,const tensor<float,host_memory_space,row_major>&,char, char, const float&, const float& ))cuv::prod<float,host_memory_space,row_major>, 
+			(arg("C"),arg("A"),arg("B"),arg("transA"),arg("transB"),arg("factAB")=1.f,arg("factC")=0.f));
+	def("prod", (void (*)(tensor<float,host_memory_space,column_major>&,const bsr_matrix<float,host_memory_space>&,const tensor<float,host_memory_space,column_major>&,char, char, const float&, const float& ))cuv::prod<float,host_memory_space,column_major>, 
+			(arg("C"),arg("A"),arg("B"),arg("transA"),arg("transB"),arg("factAB")=1.f,arg("factC")=0.f));
+	def("prod", (void (*)(tensor<float,host_memory_space,row_major>&,const bsr_matrix<float,host_memory_space>&,const tensor<float,host_memory_space,row_major>&,char, char, const float&, const float& ))cuv::prod<float,host_memory_space,row_major>, 
+			(arg("C"),arg("A"),arg("B"),arg("transA"),arg("transB"),arg("factAB")=1.f,arg("factC")=0.f));
+	def("spmv", (void (*)(tensor<float,host_memory_space>&,const csr_matrix<float,host_memory_space>&,const tensor<float,host_memory_space>&,char, const float&, const float& ))cuv::spmv<float,host_memory_space>, 
+			(arg("dst"),arg("A"),arg("v"),arg("transA")='n',arg("factAv")=1.f,arg("factC")=0.f));
+	def("spmv", (void (*)(tensor<float,host_memory_space>&,const bsr_matrix<float,host_memory_space>&,const tensor<float,host_memory_space>&,char, const float&, const float& ))cuv::spmv<float,host_memory_space>, 
+			(arg("dst"),arg("A"),arg("v"),arg("transA")='n',arg("factAv")=1.f,arg("factC")=0.f));
+}
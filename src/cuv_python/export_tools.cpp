@@ -37,6 +37,8 @@
 #include <cuv/convert/convert.hpp>
 #include <cuv/convolution_ops/convolution_ops.hpp>
 #include <cuv/tools/device_tools.hpp>
+#include <cuv/tools/thread_pool.hpp>
+#include <cuv/tensor_ops/simd_functors.hpp>
 
 
 //using namespace std;
@@ -49,4 +51,20 @@ void export_tools(){
 	def("get_max_mem",(int (*)())getMaxDeviceMemory);
 	def("count_devices",countDevices);
 	def("get_current_device",getCurrentDevice);
+	def("set_host_num_threads",set_host_num_threads, (arg("n")=0));
+	def("get_host_num_threads",get_host_num_threads);
+	def("set_host_parallel_threshold",set_host_parallel_threshold, (arg("n")));
+	def("get_host_parallel_threshold",get_host_parallel_threshold);
+	def("set_host_pin_threads",set_host_pin_threads, (arg("pin")));
+	def("get_host_pin_threads",get_host_pin_threads);
+
+	enum_<host_simd_level>("host_simd_level")
+		.value("NONE",   HOST_SIMD_NONE)
+		.value("SSE2",   HOST_SIMD_SSE2)
+		.value("AVX2",   HOST_SIMD_AVX2)
+		.value("AVX512", HOST_SIMD_AVX512)
+		;
+	def("get_host_simd_support",get_host_simd_support);
+	def("get_host_simd_level",get_host_simd_level);
+	def("set_host_simd_level",set_host_simd_level, (arg("level")));
 }
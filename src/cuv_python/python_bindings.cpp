@@ -45,18 +45,23 @@ using namespace cuv;
 void export_tensor();
 void export_tensor_ops();
 //void export_dense_matrix();
-void export_cuda_array();
 void export_matrix_ops();
 void export_random();
+void export_tools();
+void export_csr_matrix();
+#ifndef CUV_NO_CUDA
+void export_cuda_array();
 //void export_dia_matrix();
 void export_convolution_ops();
 void export_image_ops();
-void export_tools();
 void export_libs_rbm();
 void export_libs_kmeans();
 void export_libs_kernels();
 void export_libs_cimg();
 //void export_libs_hog();
+#else
+void export_dia_matrix();
+#endif
 
 BOOST_PYTHON_MODULE(_cuv_python){
         def("initCUDA", initCUDA);
@@ -66,18 +71,24 @@ BOOST_PYTHON_MODULE(_cuv_python){
         export_tensor();
         export_tensor_ops();
         //export_dense_matrix();
-        export_cuda_array();
         export_matrix_ops();
         export_random();
+        export_tools();
+        export_csr_matrix();
+#ifndef CUV_NO_CUDA
+        export_cuda_array();
         //export_dia_matrix();
         export_convolution_ops();
         export_image_ops();
-        export_tools();
         export_libs_rbm();
         export_libs_kmeans();
         export_libs_kernels();
         export_libs_cimg();
         //export_libs_hog();
+#else
+        // the DIA products (spmv.cu, densedense_to_sparse.cu) are only built without CUDA
+        export_dia_matrix();
+#endif
 }
 
 
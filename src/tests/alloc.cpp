@@ -6,6 +6,8 @@
 #include <boost/asio.hpp>
 #include <boost/bind.hpp>
 #include <boost/thread.hpp>
+#include <algorithm>
+#include <cstring>
 
 #include <cuv/basics/allocators.hpp>
 #include <cuv/basics/reference.hpp>
@@ -253,6 +255,143 @@ static void test_pooled_allocator_garbage_collection() {
     BOOST_CHECK_EQUAL(allocator.pool_free_count(m), 0);
 }
 
+static void test_thread_caching_allocator() {
+    host_memory_space m;
+    thread_caching_allocator allocator("thread_caching");
+    void* ptr1 = 0;
+    void* ptr2 = 0;
+
+    allocator.alloc(&ptr1, 1000, sizeof(float), m);
+    BOOST_REQUIRE(ptr1);
+    BOOST_CHECK_EQUAL(reinterpret_cast<size_t>(ptr1) % thread_caching_allocator::ALIGNMENT, 0u);
+    BOOST_CHECK_EQUAL(allocator.stats().bytes_in_use, 4096u); // rounded up to the size class
+    BOOST_CHECK_EQUAL(allocator.stats().misses, 1u);
+
+    // same size class: served from this thread's cache
+    void* old = ptr1;
+    allocator.dealloc(&ptr1, m);
+    BOOST_CHECK(ptr1 == 0);
+    BOOST_CHECK_EQUAL(allocator.stats().bytes_in_use, 0u);
+    allocator.alloc(&ptr1, 3000, 1, m);
+    BOOST_CHECK_EQUAL(ptr1, old);
+    BOOST_CHECK_EQUAL(allocator.stats().thread_cache_hits, 1u);
+    BOOST_CHECK_CLOSE(allocator.stats().hit_rate(), 0.5, 0.001);
+
+    // too large to be cached
+    allocator.alloc(&ptr2, thread_caching_allocator::MAX_BLOCK_SIZE + 1, 1, m);
+    BOOST_CHECK_EQUAL(reinterpret_cast<size_t>(ptr2) % thread_caching_allocator::ALIGNMENT, 0u);
+    BOOST_CHECK_GT(allocator.stats().bytes_in_use_peak, thread_caching_allocator::MAX_BLOCK_SIZE);
+    allocator.dealloc(&ptr2, m);
+    allocator.dealloc(&ptr1, m);
+    BOOST_CHECK_EQUAL(allocator.stats().bytes_in_use, 0u);
+    BOOST_CHECK_EQUAL(allocator.stats().bytes_reserved, 4096u);
+
+    allocator.garbage_collection();
+    BOOST_CHECK_EQUAL(allocator.stats().bytes_reserved, 0u);
+}
+
+struct caching_alloc_tester {
+    thread_caching_allocator* allocator;
+    std::vector<void*>* pointers;
+    size_t offset;
+    caching_alloc_tester(thread_caching_allocator& alloc, std::vector<void*>& ptrs, size_t off)
+        :allocator(&alloc), pointers(&ptrs), offset(off){}
+    void operator()() {
+        host_memory_space m;
+        // temporaries of varying size, as created by tensor expressions
+        for (size_t i = 0; i < 10000; i++) {
+            void* ptr = 0;
+            size_t size = 1 + (i * 7919) % 100000;
+            allocator->alloc(&ptr, size, 1, m);
+            memset(ptr, 0, size);
+            allocator->dealloc(&ptr, m);
+        }
+        // blocks that outlive this thread and are released by another one
+        for (size_t i = 0; i < 100; i++)
+            allocator->alloc(&(*pointers)[offset + i], 1000 * i + 1, sizeof(float), m);
+    }
+};
+
+static void test_thread_caching_allocator_multi_threaded() {
+    host_memory_space m;
+    thread_caching_allocator allocator("thread_caching_multi_threaded");
+    const size_t NUM_THREADS = 8;
+    std::vector<void*> pointers(NUM_THREADS * 100, (void*) 0);
+
+    boost::thread_group threads;
+    for (size_t t = 0; t < NUM_THREADS; t++)
+        threads.create_thread(caching_alloc_tester(allocator, pointers, t * 100));
+    threads.join_all();
+
+    std::sort(pointers.begin(), pointers.end());
+    BOOST_CHECK(std::unique(pointers.begin(), pointers.end()) == pointers.end());
+    for (size_t i = 0; i < pointers.size(); i++) {
+        BOOST_REQUIRE(pointers[i]);
+        BOOST_CHECK_EQUAL(reinterpret_cast<size_t>(pointers[i]) % thread_caching_allocator::ALIGNMENT, 0u);
+        allocator.dealloc(&pointers[i], m);
+    }
+
+    caching_allocator_stats s = allocator.stats();
+    BOOST_CHECK_EQUAL(s.bytes_in_use, 0u);
+    BOOST_CHECK_GT(s.hit_rate(), 0.9);
+
+    // caches of the finished threads have been returned to the shared lists
+    allocator.garbage_collection();
+    BOOST_CHECK_EQUAL(allocator.stats().bytes_reserved, 0u);
+}
+
+static void test_arena_allocator() {
+    host_memory_space m;
+    arena_allocator arena(4096);
+    void* ptr1 = 0;
+    void* ptr2 = 0;
+    void* ptr3 = 0;
+
+    arena.alloc(&ptr1, 10, sizeof(float), m);
+    arena.alloc(&ptr2, 10, sizeof(float), m);
+    BOOST_CHECK_EQUAL(reinterpret_cast<size_t>(ptr1) % arena_allocator::ALIGNMENT, 0u);
+    BOOST_CHECK_EQUAL(static_cast<char*>(ptr2) - static_cast<char*>(ptr1), (long) arena_allocator::ALIGNMENT);
+    BOOST_CHECK_EQUAL(arena.bytes_used(), 2 * arena_allocator::ALIGNMENT);
+
+    {
+        arena_scope scope(arena);
+        arena.alloc(&ptr3, 1000, 1, m);
+        void* first = ptr3;
+        arena.dealloc(&ptr3, m);
+        BOOST_CHECK(ptr3 == 0);
+        {
+            arena_scope inner(arena);
+            // larger than a chunk
+            arena.alloc(&ptr3, 10000, 1, m);
+            BOOST_CHECK_EQUAL(reinterpret_cast<size_t>(ptr3) % arena_allocator::ALIGNMENT, 0u);
+            memset(ptr3, 0, 10000);
+            arena.dealloc(&ptr3, m);
+        }
+        BOOST_CHECK_EQUAL(arena.bytes_used(), 2 * arena_allocator::ALIGNMENT + 1024);
+        arena.alloc(&ptr3, 1000, 1, m);
+        BOOST_CHECK_EQUAL(ptr3, static_cast<char*>(first) + 1024);
+        arena.dealloc(&ptr3, m);
+    }
+    BOOST_CHECK_EQUAL(arena.bytes_used(), 2 * arena_allocator::ALIGNMENT);
+    size_t reserved = arena.bytes_reserved();
+    BOOST_CHECK_GE(reserved, 4096u + 10000u);
+
+    // memory is reused after rewinding
+    for (int i = 0; i < 10; i++) {
+        arena_scope scope(arena);
+        arena.alloc(&ptr3, 10000, 1, m);
+        arena.dealloc(&ptr3, m);
+    }
+    BOOST_CHECK_EQUAL(arena.bytes_reserved(), reserved);
+
+    arena.dealloc(&ptr1, m);
+    arena.dealloc(&ptr2, m);
+    arena.reset();
+    BOOST_CHECK_EQUAL(arena.bytes_used(), 0u);
+    arena.garbage_collection();
+    BOOST_CHECK_EQUAL(arena.bytes_reserved(), 0u);
+}
+
 BOOST_AUTO_TEST_CASE( pooled_cuda_allocator_test_simple ) {
     test_pooled_allocator<dev_memory_space>();
     test_pooled_allocator<host_memory_space>();
@@ -267,4 +406,16 @@ BOOST_AUTO_TEST_CASE( pooled_cuda_allocator_test_garbage_collection ) {
     test_pooled_allocator_garbage_collection<dev_memory_space>();
     test_pooled_allocator_garbage_collection<host_memory_space>();
 }
+
+BOOST_AUTO_TEST_CASE( thread_caching_allocator_test_simple ) {
+    test_thread_caching_allocator();
+}
+
+BOOST_AUTO_TEST_CASE( thread_caching_allocator_test_multithreaded ) {
+    test_thread_caching_allocator_multi_threaded();
+}
+
+BOOST_AUTO_TEST_CASE( arena_allocator_test ) {
+    test_arena_allocator();
+}
 BOOST_AUTO_TEST_SUITE_END()
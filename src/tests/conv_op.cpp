@@ -33,6 +33,7 @@
 
 #define BOOST_TEST_MODULE example
 #include <cstdio>
+#include <algorithm>
 #include <boost/test/included/unit_test.hpp>
 #include <float.h>
 #include <cmath>
@@ -200,6 +201,137 @@ BOOST_AUTO_TEST_CASE( test_conv2d_hostdev )
 }
 
 
+BOOST_AUTO_TEST_CASE( test_local_pool_hostdev )
+{
+    using namespace cuv::alex_conv;
+    unsigned int nFilt   = 16;
+    unsigned int nImgPix = 16;
+    unsigned int nImg    = 96;
+
+    // non-overlapping and overlapping pooling regions
+    int subs[]   = {2, 3};
+    int stride[] = {2, 2};
+    for(int c = 0; c < 2; c++){
+        unsigned int nOutPix = (nImgPix - subs[c]) / stride[c] + 1;
+
+        tensor<float,host_memory_space> h_img(extents[nFilt][nImgPix][nImgPix][nImg]);
+        tensor<float,host_memory_space> h_out(extents[nFilt][nOutPix][nOutPix][nImg]);
+        for(unsigned int i=0;i<h_img.size();i++) h_img[i] = drand48();
+        tensor<float,dev_memory_space> d_img = h_img;
+        tensor<float,dev_memory_space> d_out(h_out.shape());
+
+        for(int p = 0; p < 2; p++){
+            pool_type pt = p == 0 ? PT_MAX : PT_AVG;
+            if(pt == PT_AVG && subs[c] != stride[c])
+                continue; // the average is taken w.r.t. nImgPix/nOutPix, which only makes sense without overlap
+            local_pool(h_out, h_img, subs[c], 0, stride[c], nOutPix, pt);
+            local_pool(d_out, d_img, subs[c], 0, stride[c], nOutPix, pt);
+            tensor<float,host_memory_space> d_out_h = d_out;
+            for(unsigned int i=0;i<h_out.size();i++)
+                BOOST_CHECK_CLOSE((float)h_out[i], (float)d_out_h[i], 0.001f);
+        }
+
+        // derivatives, also accumulating into the target
+        local_pool(h_out, h_img, subs[c], 0, stride[c], nOutPix, PT_MAX);
+        tensor<float,dev_memory_space> d_acts = h_out;
+        tensor<float,host_memory_space> h_grads(h_out.shape());
+        for(unsigned int i=0;i<h_grads.size();i++) h_grads[i] = drand48();
+        tensor<float,dev_memory_space> d_grads = h_grads;
+
+        tensor<float,host_memory_space> h_target(h_img.shape());
+        for(int acc = 0; acc < 2; acc++){
+            float factNew = acc ? 0.5f : 1.f;
+            float factOld = acc ? 2.f  : 0.f;
+            for(unsigned int i=0;i<h_target.size();i++) h_target[i] = drand48();
+            tensor<float,dev_memory_space> d_target = h_target;
+            local_max_pool_grad(h_target, h_img, h_grads, h_out, subs[c], 0, stride[c], factNew, factOld);
+            local_max_pool_grad(d_target, d_img, d_grads, d_acts, subs[c], 0, stride[c], factNew, factOld);
+            tensor<float,host_memory_space> d_target_h = d_target;
+            for(unsigned int i=0;i<h_target.size();i++)
+                BOOST_CHECK_CLOSE((float)h_target[i], (float)d_target_h[i], 0.001f);
+
+            for(unsigned int i=0;i<h_target.size();i++) h_target[i] = drand48();
+            d_target = h_target;
+            local_avg_pool_grad(h_target, h_grads, subs[c], 0, stride[c], factNew, factOld);
+            local_avg_pool_grad(d_target, d_grads, subs[c], 0, stride[c], factNew, factOld);
+            d_target_h = d_target;
+            for(unsigned int i=0;i<h_target.size();i++)
+                BOOST_CHECK_CLOSE((float)h_target[i], (float)d_target_h[i], 0.001f);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_conv2d_hostdev_grads )
+{
+    // host implementation of all passes, dense and sparse, w.r.t. the device
+    using namespace cuv::alex_conv;
+    unsigned int nImgChan  = 32;
+    unsigned int nImgPix   = 16;
+    unsigned int nImg      = 32;
+    unsigned int nGroups   = 2;
+    unsigned int nFiltChan = nImgChan/nGroups;
+    unsigned int nFiltPix  = 3;
+    unsigned int nFilt     = 32;
+    int          padding   = -1;
+    unsigned int nResPix   = nImgPix + 2*(-padding) - nFiltPix + 1;
+
+    tensor<int,host_memory_space> hidx(extents[nGroups][nImgChan]);
+    for(unsigned int g=0; g<nGroups; g++){
+        std::vector<int> v(nImgChan);
+        for(unsigned int k=0; k<nImgChan; k++) v[k] = k;
+        std::random_shuffle(v.begin(), v.end());
+        for(unsigned int k=0; k<nImgChan; k++) hidx(g,k) = v[k];
+    }
+    tensor<int,dev_memory_space> didx = hidx;
+
+    tensor<float,host_memory_space> himg(extents[nImgChan][nImgPix][nImgPix][nImg]);
+    tensor<float,host_memory_space> hdst(extents[nFilt][nResPix][nResPix][nImg]);
+    tensor<float,host_memory_space> hflt(extents[nFiltChan][nFiltPix*nFiltPix][nFilt]);
+    for(unsigned int i=0;i<himg.size();i++) himg[i] = drand48() - 0.5f;
+    for(unsigned int i=0;i<hflt.size();i++) hflt[i] = drand48() - 0.5f;
+    tensor<float,dev_memory_space> dimg = himg, dflt = hflt, ddst(hdst.shape());
+
+    for(int sparse = 0; sparse < 2; sparse++){
+        // forward pass, accumulating into the target
+        hdst = 1.f; ddst = 1.f;
+        if(sparse){
+            convolve2d(hdst, himg, hflt, hidx, padding, 1, nGroups, 0.5f, 2.f);
+            convolve2d(ddst, dimg, dflt, didx, padding, 1, nGroups, 0.5f, 2.f);
+        }else{
+            convolve2d(hdst, himg, hflt, padding, 1, nGroups, 0.5f, 2.f);
+            convolve2d(ddst, dimg, dflt, padding, 1, nGroups, 0.5f, 2.f);
+        }
+        tensor<float,host_memory_space> ddst_h = ddst;
+        BOOST_CHECK_LT(norm2(hdst-ddst_h)/norm2(ddst_h), 0.0001f);
+
+        // derivative w.r.t. images
+        tensor<float,host_memory_space> hgimg(himg.shape());
+        tensor<float,dev_memory_space>  dgimg(himg.shape());
+        if(sparse){
+            d_conv2d_dimg(hgimg, hdst, hflt, hidx, padding, 1, nGroups);
+            d_conv2d_dimg(dgimg, ddst, dflt, didx, padding, 1, nGroups);
+        }else{
+            d_conv2d_dimg(hgimg, hdst, hflt, padding, 1, nGroups);
+            d_conv2d_dimg(dgimg, ddst, dflt, padding, 1, nGroups);
+        }
+        tensor<float,host_memory_space> dgimg_h = dgimg;
+        BOOST_CHECK_LT(norm2(hgimg-dgimg_h)/norm2(dgimg_h), 0.0001f);
+
+        // derivative w.r.t. filters
+        tensor<float,host_memory_space> hgflt(hflt.shape());
+        tensor<float,dev_memory_space>  dgflt(hflt.shape());
+        if(sparse){
+            d_conv2d_dfilt(hgflt, hdst, himg, hidx, padding, 1, nGroups, 4);
+            d_conv2d_dfilt(dgflt, ddst, dimg, didx, padding, 1, nGroups, 4);
+        }else{
+            d_conv2d_dfilt(hgflt, hdst, himg, padding, 1, nGroups, 4);
+            d_conv2d_dfilt(dgflt, ddst, dimg, padding, 1, nGroups, 4);
+        }
+        tensor<float,host_memory_space> dgflt_h = dgflt;
+        BOOST_CHECK_LT(norm2(hgflt-dgflt_h)/norm2(dgflt_h), 0.0001f);
+    }
+}
+
 BOOST_AUTO_TEST_CASE( test_conv2d )
 {
     using namespace cuv::alex_conv;
@@ -85,5 +85,67 @@ struct Fix{
 
 BOOST_FIXTURE_TEST_SUITE( s, Fix )
 
+BOOST_AUTO_TEST_CASE( conv2d_host_speed )
+{
+    using namespace cuv::alex_conv;
+    unsigned int nImgChan  = 32;
+    unsigned int nImgPix   = 32;
+    unsigned int nImg      = 64;
+    unsigned int nFiltPix  = 5;
+    unsigned int nFilt     = 64;
+    unsigned int nResPix   = nImgPix - nFiltPix + 1;
+
+    tensor<float,host_memory_space> h_img(extents[nImgChan][nImgPix][nImgPix][nImg]);
+    tensor<float,host_memory_space> h_dst(extents[nFilt][nResPix][nResPix][nImg]);
+    tensor<float,host_memory_space> h_flt(extents[nImgChan][nFiltPix*nFiltPix][nFilt]);
+    for(unsigned int i=0;i<h_img.size();i++) h_img[i] = drand48();
+    for(unsigned int i=0;i<h_flt.size();i++) h_flt[i] = drand48();
+    tensor<float,dev_memory_space> d_img = h_img, d_dst(h_dst.shape()), d_flt = h_flt;
+
+    MEASURE_TIME(fwd_dev,   convolve2d(d_dst, d_img, d_flt, 0, 1, 1), 5);
+    MEASURE_TIME(fwd_host,  convolve2d(h_dst, h_img, h_flt, 0, 1, 1), 5);
+    MEASURE_TIME(dimg_dev,  d_conv2d_dimg(d_img, d_dst, d_flt, 0, 1, 1), 5);
+    MEASURE_TIME(dimg_host, d_conv2d_dimg(h_img, h_dst, h_flt, 0, 1, 1), 5);
+    MEASURE_TIME(dflt_dev,  d_conv2d_dfilt(d_flt, d_dst, d_img, 0, 1, 1, 4), 5);
+    MEASURE_TIME(dflt_host, d_conv2d_dfilt(h_flt, h_dst, h_img, 0, 1, 1, 4), 5);
+
+    float gflop = 2.f * nFilt * nResPix * nResPix * nImg * nImgChan * nFiltPix * nFiltPix / 1e9f;
+    printf("host GFLOP/s: fwd %3.2f, dimg %3.2f, dfilt %3.2f\n",
+            gflop / fwd_host * 1e6f, gflop / dimg_host * 1e6f, gflop / dflt_host * 1e6f);
+}
+
+BOOST_AUTO_TEST_CASE( local_pool_speed )
+{
+    using namespace cuv::alex_conv;
+    unsigned int nFilt   = 64;
+    unsigned int nImgPix = 32;
+    unsigned int nImg    = 128;
+    unsigned int nOutPix = 16;
+
+    tensor<float,host_memory_space> h_img(extents[nFilt][nImgPix][nImgPix][nImg]);
+    tensor<float,host_memory_space> h_out(extents[nFilt][nOutPix][nOutPix][nImg]);
+    tensor<float,host_memory_space> h_grads(h_out.shape()), h_target(h_img.shape());
+    for(unsigned int i=0;i<h_img.size();i++)   h_img[i]   = drand48();
+    for(unsigned int i=0;i<h_grads.size();i++) h_grads[i] = drand48();
+    tensor<float,dev_memory_space> d_img = h_img, d_out(h_out.shape()), d_grads = h_grads, d_target(h_img.shape());
+
+    MEASURE_TIME(max_dev,  local_pool(d_out, d_img, 2, 0, 2, nOutPix, PT_MAX), 10);
+    MEASURE_TIME(max_host, local_pool(h_out, h_img, 2, 0, 2, nOutPix, PT_MAX), 10);
+    MEASURE_TIME(avg_dev,  local_pool(d_out, d_img, 2, 0, 2, nOutPix, PT_AVG), 10);
+    MEASURE_TIME(avg_host, local_pool(h_out, h_img, 2, 0, 2, nOutPix, PT_AVG), 10);
+    local_pool(h_out, h_img, 2, 0, 2, nOutPix, PT_MAX);
+    local_pool(d_out, d_img, 2, 0, 2, nOutPix, PT_MAX);
+    MEASURE_TIME(max_grad_dev,  local_max_pool_grad(d_target, d_img, d_grads, d_out, 2, 0, 2), 10);
+    MEASURE_TIME(max_grad_host, local_max_pool_grad(h_target, h_img, h_grads, h_out, 2, 0, 2), 10);
+    MEASURE_TIME(avg_grad_dev,  local_avg_pool_grad(d_target, d_grads, 2, 0, 2), 10);
+    MEASURE_TIME(avg_grad_host, local_avg_pool_grad(h_target, h_grads, 2, 0, 2), 10);
+
+    float mb = h_img.size() * sizeof(float) / 1024.f / 1024.f;
+    printf("host throughput (MB of images/s): max %3.1f, avg %3.1f, max_grad %3.1f, avg_grad %3.1f\n",
+            mb / max_host * 1e6f, mb / avg_host * 1e6f, mb / max_grad_host * 1e6f, mb / avg_grad_host * 1e6f);
+    printf("dev/host ratio: max %3.4f, avg %3.4f, max_grad %3.4f, avg_grad %3.4f\n",
+            max_host / max_dev, avg_host / avg_dev, max_grad_host / max_grad_dev, avg_grad_host / avg_grad_dev);
+}
+
 
 BOOST_AUTO_TEST_SUITE_END()
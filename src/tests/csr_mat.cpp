@@ -0,0 +1,255 @@
+//*LB*
+// Copyright (c) 2010, University of Bonn, Institute for Computer Science VI
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+//  * Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//  * Neither the name of the University of Bonn 
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this software without specific prior written
+//    permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//*LE*
+
+
+
+
+#define BOOST_TEST_MODULE example
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+
+#include <cuv/tools/cuv_test.hpp>
+#include <cuv/tools/cuv_general.hpp>
+#include <cuv/tools/thread_pool.hpp>
+#include <cuv/basics/csr_matrix.hpp>
+#include <cuv/basics/bsr_matrix.hpp>
+#include <cuv/basics/dia_matrix.hpp>
+#include <cuv/matrix_ops/matrix_ops.hpp>
+#include <cuv/convert/convert.hpp>
+#include <cuv/basics/sparse_matrix_io.hpp>
+
+using namespace std;
+using namespace cuv;
+
+static const int n=96;   // height
+static const int m=64;   // width
+static const int k=7;    // number of columns of the dense factor
+
+struct MyConfig {
+	static const int dev = CUDA_TEST_DEVICE;
+	MyConfig()   { 
+		printf("Testing on device=%d\n",dev);
+		initCUDA(dev); 
+	}
+	~MyConfig()  { exitCUDA();  }
+};
+
+BOOST_GLOBAL_FIXTURE( MyConfig );
+
+
+struct Fix{
+	tensor<float,host_memory_space,column_major> d;
+	csr_matrix<float,host_memory_space> w;
+	bsr_matrix<float,host_memory_space> b;
+	Fix()
+	:  d(extents[n][m]) 
+	,  b(n,m,4,2,0)
+	{
+		// about 10% non-zeros, some dense and some empty rows to test the load balancing
+		srand(42);
+		fill(d,0);
+		for(int i=0;i<n;i++)
+			for(int j=0;j<m;j++)
+				if(i%17==3 || (i%13!=5 && rand()%10==0))
+					d(i,j) = (float)(rand()%100)/10.f - 5.f;
+		convert(w,d);
+		convert(b,d);
+	}
+	~Fix(){
+	}
+};
+
+/// C = factC * C + factAB * transA(A) * B, using the dense version of A
+template<class L>
+void dense_prod(tensor<float,host_memory_space,L>& C, const tensor<float,host_memory_space,column_major>& A,
+		const tensor<float,host_memory_space,L>& B, char transA, float factAB, float factC){
+	const int h = C.shape()[0];
+	for(int i=0;i<h;i++)
+		for(int j=0;j<(int)C.shape()[1];j++){
+			float s = 0.f;
+			for(int l=0;l<(int)B.shape()[0];l++)
+				s += (transA=='t' ? A(l,i) : A(i,l)) * B(l,j);
+			C(i,j) = factC * C(i,j) + factAB * s;
+		}
+}
+
+template<class L, class Mat>
+void check_prod(const Mat& A, const tensor<float,host_memory_space,column_major>& Ad, char transA){
+	const int h = transA=='t' ? A.w() : A.h();
+	const int w = transA=='t' ? A.h() : A.w();
+	tensor<float,host_memory_space,L> B(extents[w][k]), C(extents[h][k]), C2(extents[h][k]);
+	for(int i=0;i<w;i++)
+		for(int j=0;j<k;j++)
+			B(i,j) = (float)(i*k+j)/(w*k) - 0.5f;
+	for(int i=0;i<h;i++)
+		for(int j=0;j<k;j++){
+			C(i,j)  = (float)(i+j)/(h+k);
+			C2(i,j) = (float)(i+j)/(h+k);
+		}
+	dense_prod(C2,Ad,B,transA,1.5f,0.5f);
+	prod(C,A,B,transA,'n',1.5f,0.5f);
+	for(int i=0;i<h;i++)
+		for(int j=0;j<k;j++)
+			BOOST_CHECK_SMALL(C(i,j)-C2(i,j), 0.001f);
+}
+
+template<class Mat>
+void check_spmv(const Mat& A, const tensor<float,host_memory_space,column_major>& Ad, char transA){
+	const int h = transA=='t' ? A.w() : A.h();
+	const int w = transA=='t' ? A.h() : A.w();
+	tensor<float,host_memory_space> v(w), dst(h);
+	tensor<float,host_memory_space,column_major> B(extents[w][1]), C(extents[h][1]);
+	for(int i=0;i<w;i++){
+		v[i]   = (float)i/w - 0.5f;
+		B(i,0) = (float)i/w - 0.5f;
+	}
+	fill(dst,1.f);
+	fill(C,1.f);
+	dense_prod(C,Ad,B,transA,2.f,1.f);
+	spmv(dst,A,v,transA,2.f,1.f);
+	for(int i=0;i<h;i++)
+		BOOST_CHECK_SMALL(dst[i]-C(i,0), 0.001f);
+}
+
+
+BOOST_FIXTURE_TEST_SUITE( s, Fix )
+
+BOOST_AUTO_TEST_CASE( csr_saveload )
+{
+	if(1){
+		// save...
+		std::ofstream ofs("test_csr_mat.save");
+		boost::archive::binary_oarchive oa(ofs);
+		oa << w;
+		oa << b;
+	}
+	csr_matrix<float,host_memory_space> w2;
+	bsr_matrix<float,host_memory_space> b2;
+	if(1){
+		// load...
+		std::ifstream ifs("test_csr_mat.save");
+		boost::archive::binary_iarchive ia(ifs);
+		ia >> w2;
+		ia >> b2;
+	}
+	BOOST_CHECK_EQUAL(w.nnz(), w2.nnz());
+	BOOST_CHECK_EQUAL(b.nnzb(), b2.nnzb());
+	BOOST_CHECK_EQUAL(b2.block_h(), 4);
+	MAT_CMP(w,w2,0.01);
+	MAT_CMP(b,b2,0.01);
+}
+
+BOOST_AUTO_TEST_CASE( csr_dense )
+{
+	// stored entries are exactly the non-zeros
+	unsigned int nnz = 0;
+	for(int i=0;i<n;i++)
+		for(int j=0;j<m;j++){
+			BOOST_CHECK_EQUAL(w.has(i,j), d(i,j)!=0.f);
+			nnz += d(i,j)!=0.f;
+		}
+	BOOST_CHECK_EQUAL(w.nnz(), nnz);
+	MAT_CMP(w,d,0.01);
+	MAT_CMP(b,d,0.01);
+
+	tensor<float,host_memory_space,row_major> d2(extents[n][m]);
+	fill(d2,-1);
+	convert(d2,w);
+	MAT_CMP(d,d2,0.01);
+	fill(d2,-1);
+	convert(d2,b);
+	MAT_CMP(d,d2,0.01);
+}
+
+BOOST_AUTO_TEST_CASE( csr_sparse_conv )
+{
+	// csr <-> bsr
+	csr_matrix<float,host_memory_space> w2;
+	convert(w2,b);
+	BOOST_CHECK_EQUAL(w.nnz(), w2.nnz());
+	MAT_CMP(w,w2,0.01);
+	bsr_matrix<float,host_memory_space> b2(n,m,2,8,0);
+	convert(b2,w);
+	MAT_CMP(b2,d,0.01);
+
+	// csr <-> dia
+	dia_matrix<float,host_memory_space> dia;
+	convert(dia,w);
+	MAT_CMP(dia,d,0.01);
+	csr_matrix<float,host_memory_space> w3;
+	convert(w3,dia);
+	MAT_CMP(w3,d,0.01);
+
+	// host <-> dev
+	csr_matrix<float,dev_memory_space> wdev;
+	csr_matrix<float,host_memory_space> w4;
+	convert(wdev,w);
+	convert(w4,wdev);
+	MAT_CMP(w4,d,0.01);
+	bsr_matrix<float,dev_memory_space> bdev;
+	bsr_matrix<float,host_memory_space> b4;
+	convert(bdev,b);
+	convert(b4,bdev);
+	MAT_CMP(b4,d,0.01);
+}
+
+BOOST_AUTO_TEST_CASE( csr_prod )
+{
+	size_t threshold = get_host_parallel_threshold();
+	set_host_parallel_threshold(0);
+	for(unsigned int threads=1;threads<=4;threads+=3){
+		scoped_host_thread_limit limit(threads);
+		check_prod<column_major>(w,d,'n');
+		check_prod<column_major>(w,d,'t');
+		check_prod<row_major>(w,d,'n');
+		check_prod<row_major>(w,d,'t');
+		check_prod<column_major>(b,d,'n');
+		check_prod<column_major>(b,d,'t');
+		check_prod<row_major>(b,d,'n');
+		check_prod<row_major>(b,d,'t');
+	}
+	set_host_parallel_threshold(threshold);
+}
+
+BOOST_AUTO_TEST_CASE( csr_spmv )
+{
+	size_t threshold = get_host_parallel_threshold();
+	set_host_parallel_threshold(0);
+	for(unsigned int threads=1;threads<=4;threads+=3){
+		scoped_host_thread_limit limit(threads);
+		check_spmv(w,d,'n');
+		check_spmv(w,d,'t');
+		check_spmv(b,d,'n');
+		check_spmv(b,d,'t');
+	}
+	set_host_parallel_threshold(threshold);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
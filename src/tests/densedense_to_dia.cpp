@@ -163,6 +163,31 @@ BOOST_AUTO_TEST_CASE( dd2s_correctness_host )
 	}
 }
 
+BOOST_AUTO_TEST_CASE( dd2s_factors_host )
+{
+	dia_matrix<float,host_memory_space>   Chdia(C.shape()[0],C.shape()[1],C.num_dia(),C.stride(),rf);
+	tensor<float,host_memory_space,column_major> Chdense(C.shape()[0],C.shape()[1]);
+	tensor<float,host_memory_space,column_major> Ah(A.shape());
+	tensor<float,host_memory_space,column_major> Bh(B.shape());
+	convert(Chdia,C);
+	convert(Ah,A);
+	convert(Bh,B);
+	sequence(Chdia.vec());
+	convert(Chdense,Chdia);
+
+	// C = 0.5 C + 2 A B'
+	host_block_descriptor<float> bdh(Chdia);
+	densedense_to_dia(Chdia,bdh,Ah,Bh,2.f,0.5f);
+	prod(Chdense,Ah,Bh,'n','t',2.f,0.5f);
+	for(int i=0;i<C.shape()[0];i++){
+		for(int j=0;j<C.shape()[1];j++){
+			if(Chdia.has(i,j)){
+				BOOST_CHECK_CLOSE( (float)Chdia(i,j), (float)Chdense(i,j), 0.01 );
+			}
+		}
+	}
+}
+
 BOOST_AUTO_TEST_CASE( dd2s_cmp_dev_host )
 {
 	fill(C.vec(),0);
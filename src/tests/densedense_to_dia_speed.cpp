@@ -44,6 +44,7 @@
 #include <cuv/matrix_ops/matrix_ops.hpp>
 #include <cuv/matrix_ops/densedense_to_sparse.hpp>
 #include <cuv/tools/timing.hpp>
+#include <cuv/tools/thread_pool.hpp>
 
 #define MEASURE_TIME(MSG, OPERATION, ITERS)     \
 	float MSG;                                  \
@@ -128,6 +129,24 @@ BOOST_AUTO_TEST_CASE( dd2s_speed_host_host )
 	printf("Speedup: %3.4f\n", host_dense/host_dia);
 }
 
+BOOST_AUTO_TEST_CASE( dd2s_speed_host_threads )
+{
+	// the host version is tiled over rows and diagonals, the tiles run on the host thread pool
+	dia_matrix<float,host_memory_space>   C2(C_dev.shape()[0],C_dev.shape()[1],C_dev.num_dia(),C_dev.stride());
+	tensor<float,host_memory_space,column_major> A2(A_dev.shape()[0],A_dev.shape()[1]);
+	tensor<float,host_memory_space,column_major> B2(B_dev.shape()[0],B_dev.shape()[1]);
+	convert(C2,C_dev);
+	convert(A2,A_dev);
+	convert(B2,B_dev);
+
+	host_block_descriptor<float> bdh(C2);
+	unsigned int num_threads = get_host_num_threads();
+	set_host_num_threads(1);
+	MEASURE_TIME(host_dia_1, densedense_to_dia(C2,bdh,A2,B2), 5);
+	set_host_num_threads(num_threads);
+	MEASURE_TIME(host_dia,   densedense_to_dia(C2,bdh,A2,B2), 5);
+	printf("Speedup (%d threads): %3.4f\n", num_threads, host_dia_1/host_dia);
+}
 
 BOOST_AUTO_TEST_CASE( dd2s_speed_dev_host )
 {
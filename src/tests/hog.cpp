@@ -0,0 +1,240 @@
+//*LB*
+// Copyright (c) 2010, University of Bonn, Institute for Computer Science VI
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+//  * Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//  * Neither the name of the University of Bonn 
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this software without specific prior written
+//    permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//*LE*
+
+
+
+
+#define BOOST_TEST_MODULE example
+#include <cmath>
+#include <boost/test/included/unit_test.hpp>
+
+#include <cuv/tools/cuv_general.hpp>
+#include <cuv/tools/thread_pool.hpp>
+#include <cuv/basics/tensor.hpp>
+#include <cuv/libs/hog/hog.hpp>
+
+using namespace cuv;
+
+struct MyConfig {
+	static const int dev = CUDA_TEST_DEVICE;
+	MyConfig()   { 
+		printf("Testing on device=%d\n",dev);
+		initCUDA(dev); 
+	}
+	~MyConfig()  { exitCUDA();  }
+};
+
+BOOST_GLOBAL_FIXTURE( MyConfig );
+
+struct Fix{
+	Fix()
+	{
+		srand(42);
+	}
+	~Fix(){
+	}
+};
+
+typedef tensor<float,host_memory_space> host_t;
+
+/// src(c,y,x), zero outside of the image
+float pixel(const host_t& src, int c, int y, int x){
+	if(y < 0 || y >= (int)src.shape(1) || x < 0 || x >= (int)src.shape(2))
+		return 0.f;
+	return src(c,y,x);
+}
+
+/**
+ * a paraboloid of a different center and steepness in each channel of the c x h x w tensor m:
+ * the gradients point in all directions and the strongest channel changes across the image
+ */
+void paraboloids(host_t& m){
+	const int h = m.shape(1), w = m.shape(2);
+	for(unsigned int c = 0; c < m.shape(0); c++){
+		const float cy = h * (c+1) / 4.f, cx = w * (3-c) / 4.f;
+		for(int y = 0; y < h; y++)
+			for(int x = 0; x < w; x++)
+				m(c,y,x) = (c+1) * ((y-cy)*(y-cy) + (x-cx)*(x-cx)) / 64.f;
+	}
+}
+
+/// normalize the descriptor of every pixel of the steps x h x w tensor b
+void normalize(host_t& b){
+	for(unsigned int y = 0; y < b.shape(1); y++)
+		for(unsigned int x = 0; x < b.shape(2); x++){
+			float n = 0.0001f;
+			for(unsigned int s = 0; s < b.shape(0); s++)
+				n += b(s,y,x) * b(s,y,x);
+			n = sqrtf(n);
+			for(unsigned int s = 0; s < b.shape(0); s++)
+				b(s,y,x) = b(s,y,x) / n;
+		}
+}
+
+/// hog descriptor with one pass over the whole image per step
+void naive_hog(host_t& dst, const host_t& src, unsigned int steps, int r){
+	const int chann = src.shape(0), h = src.shape(1), w = src.shape(2);
+	host_t bins(extents[steps][h][w]);
+	bins = 0.f;
+
+	// gradient of the strongest channel and orientation binning
+	for(int y = 0; y < h; y++)
+		for(int x = 0; x < w; x++){
+			float best = -1.f, gx = 0.f, gy = 0.f;
+			for(int c = 0; c < chann; c++){
+				float dx = 0.5f * (pixel(src,c,y,x+1) - pixel(src,c,y,x-1));
+				float dy = 0.5f * (pixel(src,c,y+1,x) - pixel(src,c,y-1,x));
+				if(dx*dx + dy*dy > best){
+					best = dx*dx + dy*dy;
+					gx = dx;
+					gy = dy;
+				}
+			}
+			float a = atan2f(gy,gx);
+			if(a < 0) a += (float)M_PI;
+			const float mag = sqrtf(best);
+			const float pos = a / (float)M_PI * steps;
+			const unsigned int s = (unsigned int)pos % steps;
+			const float frac = pos - floorf(pos);
+			bins(s,y,x) = bins(s,y,x) + mag * (1.f - frac);
+			bins((s+1)%steps,y,x) = bins((s+1)%steps,y,x) + mag * frac;
+		}
+
+	// spatial pooling with a gaussian
+	std::vector<float> k(2*r+1, 1.f);
+	if(r > 0){
+		float sum = 0.f, sigma = r / 2.f;
+		for(int i = 0; i < 2*r+1; i++){
+			k[i] = expf(-(i-r)*(i-r) / (2*sigma*sigma));
+			sum += k[i];
+		}
+		for(int i = 0; i < 2*r+1; i++)
+			k[i] /= sum;
+	}
+	host_t tmp(extents[steps][h][w]);
+	dst = host_t(extents[steps][h][w]);
+	for(unsigned int s = 0; s < steps; s++)
+		for(int y = 0; y < h; y++)
+			for(int x = 0; x < w; x++){
+				float v = 0.f;
+				for(int j = -r; j <= r; j++)
+					v += pixel(bins,s,y,x+j) * k[r-j];
+				tmp(s,y,x) = v;
+			}
+	for(unsigned int s = 0; s < steps; s++)
+		for(int y = 0; y < h; y++)
+			for(int x = 0; x < w; x++){
+				float v = 0.f;
+				for(int j = -r; j <= r; j++)
+					v += pixel(tmp,s,y+j,x) * k[r-j];
+				dst(s,y,x) = v;
+			}
+
+	// normalize, clip and renormalize
+	normalize(dst);
+	for(unsigned int i = 0; i < dst.size(); i++)
+		dst[i] = std::min((float)dst[i], 0.2f);
+	normalize(dst);
+}
+
+BOOST_FIXTURE_TEST_SUITE( s, Fix )
+
+/** 
+ * @test
+ * @brief host hog equals the step by step computation, for images crossing tile borders
+ */
+BOOST_AUTO_TEST_CASE( hog_host )
+{
+	const int sizes[][2] = { {5,7}, {45,300}, {70,140} };
+	const int pools[] = { 0, 1, 3, 6 };
+	for(int t = 0; t < 3; t++){
+		host_t src(extents[3][sizes[t][0]][sizes[t][1]]), ref;
+		host_t dst(extents[9][sizes[t][0]][sizes[t][1]]);
+		paraboloids(src);
+		for(int p = 0; p < 4; p++){
+			naive_hog(ref, src, 9, pools[p]);
+			for(int threads = 1; threads <= 4; threads += 3){
+				scoped_host_thread_limit limit(threads);
+				libs::hog::hog(dst, src, pools[p]);
+				for(unsigned int i = 0; i < dst.size(); i++)
+					BOOST_CHECK_SMALL(dst[i] - ref[i], 0.0001f);
+			}
+		}
+	}
+}
+
+/** 
+ * @test
+ * @brief a ramp puts all weight into the bins of its orientation, away from the border
+ */
+BOOST_AUTO_TEST_CASE( hog_host_ramp )
+{
+	const int h = 30, w = 40, r = 3;
+	host_t src(extents[3][h][w]), dst(extents[9][h][w]);
+	for(int dir = 0; dir < 2; dir++){
+		// the second channel rises along x (orientation 0, bin 0) or along y (orientation pi/2,
+		// halfway between bins 4 and 5), the other channels are constant
+		for(int y = 0; y < h; y++)
+			for(int x = 0; x < w; x++){
+				src(0,y,x) = 1.f;
+				src(1,y,x) = dir == 0 ? x : y;
+				src(2,y,x) = 2.f;
+			}
+		libs::hog::hog(dst, src, r);
+		// the border has a gradient towards the zero padding, which is pooled up to r pixels inwards
+		for(int y = r+1; y < h-r-1; y++)
+			for(int x = r+1; x < w-r-1; x++)
+				for(int s = 0; s < 9; s++){
+					// the n nonzero bins are clipped to 0.2 and renormalized, with the 0.0001 of normalize
+					const int n = dir == 0 ? 1 : 2;
+					const bool hit = dir == 0 ? s == 0 : s == 4 || s == 5;
+					const float ref = hit ? 0.2f / sqrtf(n * 0.04f + 0.0001f) : 0.f;
+					BOOST_CHECK_SMALL(dst(s,y,x) - ref, 0.0001f);
+				}
+	}
+}
+
+/** 
+ * @test
+ * @brief device and host give the same results, on a non-square image
+ */
+BOOST_AUTO_TEST_CASE( hog_dev_host )
+{
+	const int h = 48, w = 80;
+	host_t src(extents[3][h][w]), dst(extents[9][h][w]), dst2;
+	paraboloids(src);
+	tensor<float,dev_memory_space> d_src(src), d_dst(extents[9][h][w]);
+	libs::hog::hog(dst, src, 3);
+	libs::hog::hog(d_dst, d_src, 3);
+	dst2 = d_dst;
+	for(unsigned int i = 0; i < dst.size(); i++)
+		BOOST_CHECK_SMALL(dst[i] - dst2[i], 0.001f);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
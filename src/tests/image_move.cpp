@@ -0,0 +1,210 @@
+//*LB*
+// Copyright (c) 2010, University of Bonn, Institute for Computer Science VI
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+//  * Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//  * Neither the name of the University of Bonn 
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this software without specific prior written
+//    permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//*LE*
+
+
+
+
+#define BOOST_TEST_MODULE example
+#include <cmath>
+#include <cstdlib>
+#include <boost/test/included/unit_test.hpp>
+
+#include <cuv/tools/cuv_general.hpp>
+#include <cuv/tools/thread_pool.hpp>
+#include <cuv/basics/tensor.hpp>
+#include <cuv/image_ops/move.hpp>
+
+using namespace cuv;
+
+struct MyConfig {
+	static const int dev = CUDA_TEST_DEVICE;
+	MyConfig()   { 
+		printf("Testing on device=%d\n",dev);
+		initCUDA(dev); 
+	}
+	~MyConfig()  { exitCUDA();  }
+};
+
+BOOST_GLOBAL_FIXTURE( MyConfig );
+
+struct Fix{
+	Fix()
+	{
+		srand(42);
+	}
+	~Fix(){
+	}
+};
+
+typedef tensor<unsigned char,host_memory_space,column_major> src_t;
+typedef tensor<float,host_memory_space,column_major> dst_t;
+
+void random_images(src_t& m){
+	for(unsigned int i = 0; i < m.size(); i++)
+		m[i] = rand() % 256;
+}
+
+/**
+ * color channel ch of dst pixel (x,y) of image img, determined pixel by
+ * pixel as in the device kernel of image_move.
+ */
+float naive_move(const src_t& src, int img, int ss, int ds, int maps, int xs, int ys, int x, int y, int ch){
+	const unsigned char* im = src.ptr() + img * src.shape(0);
+	const bool enlarge = ss != ds;
+	int px, py;
+	float fx = 0.f, fy = 0.f;
+	bool in;
+	if(enlarge){
+		const float pxf = ((float)(x - xs) / ds) * ss, pyf = ((float)(y - ys) / ds) * ss;
+		px = (int)pxf; py = (int)pyf;
+		fx = pxf - px; fy = pyf - py;
+		in = x >= xs && y >= ys && x < ds + xs && y < ds + ys;
+	}else{
+		px = x - xs; py = y - ys;
+		in = px >= 0 && px < ss && py >= 0 && py < ss;
+	}
+	float p[4];
+	if(in){
+		const int px1 = std::min(px + 1, ss - 1), py1 = std::min(py + 1, ss - 1);
+		p[0] = im[(py  * ss + px ) * maps + ch];
+		p[1] = im[(py  * ss + px1) * maps + ch];
+		p[2] = im[(py1 * ss + px ) * maps + ch];
+		p[3] = im[(py1 * ss + px1) * maps + ch];
+	}else{
+		const int xn = std::max(1, std::min(px, ss - 2)), yn = std::max(1, std::min(py, ss - 2));
+		const float d = std::min(1.f, std::max(0.f, 0.13f * (float)(std::abs(px - xn) + std::abs(py - yn))));
+		p[0] = p[1] = p[2] = p[3] = (unsigned char)(d * im[ch] + (1.f - d) * im[(yn * ss + xn) * maps + ch]);
+	}
+	if(!enlarge)
+		return p[0];
+	return (unsigned char)((1.f - fy) * ((1.f - fx) * p[0] + fx * p[1]) + fy * ((1.f - fx) * p[2] + fx * p[3]));
+}
+
+/// check dst against naive_move for all images, shifted by xs[i], ys[i]
+void check_moved(const dst_t& dst, const src_t& src, int ss, int ds, int maps, const int* xs, const int* ys){
+	for(unsigned int i = 0; i < src.shape(1); i++)
+		for(int y = 0; y < ds; y++)
+			for(int x = 0; x < ds; x++){
+				const unsigned int idx = i * dst.shape(0) + y * ds + x;
+				if(maps == 1){
+					BOOST_CHECK_CLOSE((float)dst[idx] + 1.f, naive_move(src, i, ss, ds, maps, xs[i], ys[i], x, y, 0) + 1.f, 0.01f);
+					continue;
+				}
+				const float r = naive_move(src, i, ss, ds, maps, xs[i], ys[i], x, y, 0);
+				const float g = naive_move(src, i, ss, ds, maps, xs[i], ys[i], x, y, 1);
+				const float b = naive_move(src, i, ss, ds, maps, xs[i], ys[i], x, y, 2);
+				BOOST_CHECK_SMALL((float)dst[idx]         - ((-0.5525f*r - 0.5719f*g - 0.6063f*b + 441.3285f) * 0.004531772f - 1.0f), 0.0001f);
+				BOOST_CHECK_SMALL((float)dst[idx+ds*ds]   - (( 0.7152f*r + 0.0483f*g - 0.6973f*b + 177.8115f) * 0.005369070f - 1.0f), 0.0001f);
+				BOOST_CHECK_SMALL((float)dst[idx+2*ds*ds] - ((-0.4281f*r + 0.8189f*g - 0.3823f*b + 206.6520f) * 0.004813808f - 1.0f), 0.0001f);
+			}
+}
+
+BOOST_FIXTURE_TEST_SUITE( s, Fix )
+
+/** 
+ * @test
+ * @brief moving and enlarging grayscale and RGBA images
+ */
+BOOST_AUTO_TEST_CASE( image_move_host )
+{
+	const int n = 5;
+	const int sizes[][2] = { {16,16}, {20,16}, {13,32} };
+	const int shifts[][2] = { {0,0}, {3,-2}, {-7,5}, {40,-40} };
+	for(int maps = 1; maps <= 4; maps += 3){
+		for(int t = 0; t < 3; t++){
+			const int ss = sizes[t][0], ds = sizes[t][1];
+			src_t src(extents[ss*ss*maps][n]);
+			dst_t dst(extents[ds*ds*(maps == 4 ? 3 : 1)][n]);
+			random_images(src);
+			for(int s = 0; s < 4; s++){
+				for(int threads = 1; threads <= 4; threads += 3){
+					scoped_host_thread_limit limit(threads);
+					image_move(dst, src, ss, ds, maps, shifts[s][0], shifts[s][1]);
+					const int xs[n] = { shifts[s][0], shifts[s][0], shifts[s][0], shifts[s][0], shifts[s][0] };
+					const int ys[n] = { shifts[s][1], shifts[s][1], shifts[s][1], shifts[s][1], shifts[s][1] };
+					check_moved(dst, src, ss, ds, maps, xs, ys);
+				}
+			}
+		}
+	}
+}
+
+/** 
+ * @test
+ * @brief every image is moved by its own shift
+ */
+BOOST_AUTO_TEST_CASE( image_move_host_batched )
+{
+	const int n = 7, ss = 24;
+	for(int maps = 1; maps <= 4; maps += 3){
+		for(int ds = 24; ds <= 32; ds += 8){
+			src_t src(extents[ss*ss*maps][n]);
+			dst_t dst(extents[ds*ds*(maps == 4 ? 3 : 1)][n]);
+			tensor<int,host_memory_space> xs(n), ys(n);
+			random_images(src);
+			for(int i = 0; i < n; i++){
+				xs[i] = rand() % 21 - 10;
+				ys[i] = rand() % 21 - 10;
+			}
+			image_move(dst, src, ss, ds, maps, xs, ys);
+			check_moved(dst, src, ss, ds, maps, xs.ptr(), ys.ptr());
+
+			// unsigned char output of grayscale images
+			if(maps == 1){
+				tensor<unsigned char,host_memory_space,column_major> udst(dst.shape());
+				image_move(udst, src, ss, ds, maps, xs, ys);
+				for(unsigned int i = 0; i < dst.size(); i++)
+					BOOST_CHECK_EQUAL((int)udst[i], (int)dst[i]);
+			}
+		}
+	}
+}
+
+/** 
+ * @test
+ * @brief moving images in device memory gives the same result
+ */
+BOOST_AUTO_TEST_CASE( image_move_dev_host )
+{
+	const int n = 3, ss = 32;
+	for(int maps = 1; maps <= 4; maps += 3){
+		src_t src(extents[ss*ss*maps][n]);
+		dst_t dst(extents[ss*ss*(maps == 4 ? 3 : 1)][n]);
+		random_images(src);
+		tensor<unsigned char,dev_memory_space,column_major> dsrc(src);
+		tensor<float,dev_memory_space,column_major> ddst(dst.shape());
+		image_move(dst, src, ss, ss, maps, 5, -3);
+		image_move(ddst, dsrc, ss, ss, maps, 5, -3);
+		dst_t res(ddst);
+		for(unsigned int i = 0; i < dst.size(); i++)
+			BOOST_CHECK_SMALL((float)dst[i] - (float)res[i], maps == 1 ? 1.001f : 0.01f);
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,296 @@
+//*LB*
+// Copyright (c) 2010, University of Bonn, Institute for Computer Science VI
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+//  * Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//  * Neither the name of the University of Bonn 
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this software without specific prior written
+//    permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//*LE*
+
+
+
+
+#define BOOST_TEST_MODULE example
+#include <boost/test/included/unit_test.hpp>
+
+#include <cuv/tools/cuv_general.hpp>
+#include <cuv/tools/thread_pool.hpp>
+#include <cuv/basics/tensor.hpp>
+#include <cuv/image_ops/image_pyramid.hpp>
+
+using namespace cuv;
+
+struct MyConfig {
+	static const int dev = CUDA_TEST_DEVICE;
+	MyConfig()   { 
+		printf("Testing on device=%d\n",dev);
+		initCUDA(dev); 
+	}
+	~MyConfig()  { exitCUDA();  }
+};
+
+BOOST_GLOBAL_FIXTURE( MyConfig );
+
+struct Fix{
+	Fix()
+	{
+		srand(42);
+	}
+	~Fix(){
+	}
+};
+
+typedef tensor<float,host_memory_space> host_t;
+
+int clamp(int i, int n){ return std::max(0, std::min(n - 1, i)); }
+
+/// src(y,c*x+ch) blurred with the binomial filter, pixels outside are clamped to the border
+float binomial(const host_t& src, int y, int x, int c=1, int ch=0){
+	static const float k[5] = { 1.f, 4.f, 6.f, 4.f, 1.f };
+	const int h = src.shape(0), w = src.shape(1) / c;
+	float s = 0.f;
+	for(int i = 0; i < 5; i++)
+		for(int j = 0; j < 5; j++)
+			s += k[i] * k[j] * src(clamp(y - 2 + i, h), c * clamp(x - 2 + j, w) + ch);
+	return s / 256.f;
+}
+
+/**
+ * m(y,c*x+ch) = ((ch+1) x^2 + 2 y^2) / 16. The binomial filter has variance one,
+ * it raises this by (ch+3)/16 away from the border.
+ */
+void quadratic(host_t& m, int c=1){
+	for(unsigned int y = 0; y < m.shape(0); y++)
+		for(unsigned int x = 0; x < m.shape(1); x++)
+			m(y,x) = ((x%c+1) * (x/c) * (x/c) + 2.f * y * y) / 16.f;
+}
+
+BOOST_FIXTURE_TEST_SUITE( s, Fix )
+
+/** 
+ * @test
+ * @brief down sampling and blurring of grayscale images
+ */
+BOOST_AUTO_TEST_CASE( pyramid_host_downsample )
+{
+	const int sizes[][2] = { {7,9}, {64,100}, {129,257} };
+	for(int t = 0; t < 3; t++){
+		const int h = sizes[t][0], w = sizes[t][1];
+		host_t src(extents[h][w]), dst(extents[(h+1)/2][(w+1)/2]), blur(extents[h][w]);
+		quadratic(src);
+		for(int threads = 1; threads <= 4; threads += 3){
+			scoped_host_thread_limit limit(threads);
+			gaussian_pyramid_downsample(dst, src, 1);
+			for(int y = 0; y < (h+1)/2; y++)
+				for(int x = 0; x < (w+1)/2; x++){
+					BOOST_CHECK_CLOSE((float)dst(y,x), binomial(src, 2*y, 2*x), 0.001f);
+					if(2*y >= 2 && 2*y < h-2 && 2*x >= 2 && 2*x < w-2)
+						BOOST_CHECK_CLOSE((float)dst(y,x), (float)src(2*y,2*x) + 3/16.f, 0.001f);
+				}
+
+			gaussian(blur, src);
+			for(int y = 0; y < h; y++)
+				for(int x = 0; x < w; x++){
+					BOOST_CHECK_CLOSE((float)blur(y,x), binomial(src, y, x), 0.001f);
+					if(y >= 2 && y < h-2 && x >= 2 && x < w-2)
+						BOOST_CHECK_CLOSE((float)blur(y,x), (float)src(y,x) + 3/16.f, 0.001f);
+				}
+		}
+	}
+}
+
+/** 
+ * @test
+ * @brief down sampling an RGBA image to three channels
+ */
+BOOST_AUTO_TEST_CASE( pyramid_host_downsample_rgba )
+{
+	const int h = 50, w = 70;
+	host_t src(extents[h][4*w]), dst(extents[3*(h/2)][w/2]);
+	quadratic(src, 4);
+	gaussian_pyramid_downsample(dst, src, 4);
+	for(int c = 0; c < 3; c++)
+		for(int y = 0; y < h/2; y++)
+			for(int x = 0; x < w/2; x++)
+				BOOST_CHECK_CLOSE((float)dst(c*(h/2)+y,x), binomial(src, 2*y, 2*x, 4, c), 0.001f);
+
+	// unsigned char images are filtered without rounding errors
+	tensor<unsigned char,host_memory_space> usrc(extents[h][4*w]), udst(extents[3*(h/2)][w/2]);
+	for(unsigned int i = 0; i < usrc.size(); i++)
+		usrc[i] = 100;
+	gaussian_pyramid_downsample(udst, usrc, 4);
+	for(unsigned int i = 0; i < udst.size(); i++)
+		BOOST_CHECK_EQUAL((int)udst[i], 100);
+}
+
+/** 
+ * @test
+ * @brief up sampling interpolates between neighbouring pixels
+ */
+BOOST_AUTO_TEST_CASE( pyramid_host_upsample )
+{
+	const int h = 13, w = 20;
+	host_t src(extents[h][w]), dst(extents[2*h][2*w]);
+	// curved along x and linear along y, mixing up the axes or the neighbours changes the result
+	for(int y = 0; y < h; y++)
+		for(int x = 0; x < w; x++)
+			src(y,x) = x * x + 3.f * y;
+	gaussian_pyramid_upsample(dst, src);
+	for(int y = 0; y < 2*h; y++)
+		for(int x = 0; x < 2*w; x++){
+			// odd coordinates hit a pixel, even ones are between two pixels
+			const int x0 = clamp((x-1)/2, w), x1 = clamp(x/2, w);
+			const int y0 = clamp((y-1)/2, h), y1 = clamp(y/2, h);
+			const float ref = 0.25f * (src(y0,x0) + src(y0,x1) + src(y1,x0) + src(y1,x1));
+			BOOST_CHECK_CLOSE((float)dst(y,x), ref, 0.001f);
+		}
+}
+
+/** 
+ * @test
+ * @brief building a pyramid of a three channel image on the host
+ */
+BOOST_AUTO_TEST_CASE( pyramid_host_build )
+{
+	const int h = 60, w = 90, depth = 4;
+	host_t src(extents[3*2*h][2*w]);
+	quadratic(src);
+
+	image_pyramid<host_t> pyr(h, w, depth, 3);
+	pyr.build(src, 1);
+	BOOST_REQUIRE_EQUAL(pyr.depth(), depth);
+
+	for(int c = 0; c < 3; c++){
+		host_t prev(extents[2*h][2*w]);
+		for(unsigned int i = 0; i < prev.size(); i++)
+			prev[i] = src[c*prev.size() + i];
+		for(int l = 0; l < depth; l++){
+			host_t* level = pyr.get(l, c);
+			const int lh = level->shape(0), lw = level->shape(1);
+			BOOST_CHECK_EQUAL(lh, (int)ceil(h / pow(2.f, l)));
+			for(int y = 0; y < lh; y++)
+				for(int x = 0; x < lw; x++)
+					BOOST_CHECK_CLOSE((float)(*level)(y,x), binomial(prev, 2*y, 2*x), 0.001f);
+			prev = level->copy();
+			delete level;
+		}
+	}
+
+	// all levels live in one allocation
+	for(int l = 1; l < depth; l++)
+		BOOST_CHECK_EQUAL(pyr.get_all_channels(l)->ptr(),
+				pyr.get_all_channels(l-1)->ptr() + pyr.get_all_channels(l-1)->size());
+
+	// an image of the size of the base is copied
+	host_t base(extents[3*h][w]);
+	sequence(base);
+	pyr.build(base, 1);
+	for(unsigned int i = 0; i < base.size(); i++)
+		BOOST_CHECK_EQUAL((float)(*pyr.get_all_channels(0))[i], (float)base[i]);
+}
+
+/// linear texture lookup at (u,v), pixel centers at .5 and coordinates clamped to the border
+float texture(const host_t& src, float u, float v){
+	const int h = src.shape(0), w = src.shape(1);
+	const int x = (int)floor(u - 0.5f), y = (int)floor(v - 0.5f);
+	const float a = u - 0.5f - x, b = v - 0.5f - y;
+	return (1.f-a) * (1.f-b) * src(clamp(y,   h), clamp(x,   w))
+		+      a  * (1.f-b) * src(clamp(y,   h), clamp(x+1, w))
+		+ (1.f-a) *      b  * src(clamp(y+1, h), clamp(x,   w))
+		+      a  *      b  * src(clamp(y+1, h), clamp(x+1, w));
+}
+
+/// classify all pixels of dst like get_pixel_classes, one pixel at a time
+void naive_pixel_classes(tensor<unsigned char,host_memory_space>& dst, const host_t& src, float scale_fact){
+	const float du[4] = { 1.f,  1.f, -1.f, -1.f };
+	const float dv[4] = { 1.f, -1.f,  1.f, -1.f };
+	for(unsigned int y = 0; y < dst.shape(0); y++)
+		for(unsigned int x = 0; x < dst.shape(1) / 4; x++){
+			const float u0 = x / scale_fact, v0 = y / scale_fact;
+			float dist[4], sum = 0.f;
+			int best = 0;
+			for(int i = 0; i < 4; i++){
+				// the three channels are compared at the same position (no offset)
+				const float f = texture(src, u0, v0) - texture(src, u0 + du[i], v0 + dv[i]);
+				dist[i] = 3 * f * f;
+				sum += dist[i];
+				if(dist[i] < dist[best])
+					best = i;
+			}
+			dst(y, 4*x + 0) = best % 2 ? 255 : 0;
+			dst(y, 4*x + 1) = best > 1 ? 255 : 0;
+			dst(y, 4*x + 2) = 0;
+			dst(y, 4*x + 3) = (unsigned char)std::max(0.f, std::min(255.f, sum - 4 * dist[best]));
+		}
+}
+
+/** 
+ * @test
+ * @brief a constant image has no preferred direction
+ */
+BOOST_AUTO_TEST_CASE( pyramid_host_pixel_classes )
+{
+	host_t src(extents[3*16][16]);
+	tensor<unsigned char,host_memory_space> dst(extents[32][4*32]);
+	fill(src, 3.f);
+	get_pixel_classes(dst, src, 2.f);
+	for(unsigned int i = 0; i < dst.size(); i++)
+		BOOST_CHECK_EQUAL((int)dst[i], 0);
+}
+
+/** 
+ * @test
+ * @brief a diagonal ramp changes least along the other diagonal
+ */
+BOOST_AUTO_TEST_CASE( pyramid_host_pixel_classes_gradient )
+{
+	const int h = 12, w = 20;
+	host_t src(extents[3*h][w]);
+	tensor<unsigned char,host_memory_space> dst(extents[2*h][4*2*w]), ref(extents[2*h][4*2*w]);
+	for(int dir = 0; dir < 2; dir++){
+		// dir 0 rises along (1,1), the directions (1,-1) and (-1,1) are flat, the first of them wins.
+		// dir 1 rises along (1,-1), the directions (1,1) and (-1,-1) are flat.
+		for(int y = 0; y < 3*h; y++)
+			for(int x = 0; x < w; x++)
+				src(y,x) = dir == 0 ? x + y : x - y + 3*h;
+		const int cls = dir == 0 ? 1 : 0;
+		for(int threads = 1; threads <= 4; threads += 3){
+			scoped_host_thread_limit limit(threads);
+			get_pixel_classes(dst, src, 2.f);
+			naive_pixel_classes(ref, src, 2.f);
+			for(unsigned int i = 0; i < dst.size(); i++)
+				BOOST_CHECK_EQUAL((int)dst[i], (int)ref[i]);
+
+			// away from the border the ramp is interpolated exactly:
+			// two directions differ by 2 in all three channels, two by 0
+			for(int y = 4; y < 2*h - 2; y++)
+				for(int x = 4; x < 2*w - 4; x++){
+					BOOST_CHECK_EQUAL((int)dst(y, 4*x + 0), cls % 2 ? 255 : 0);
+					BOOST_CHECK_EQUAL((int)dst(y, 4*x + 1), cls > 1 ? 255 : 0);
+					BOOST_CHECK_EQUAL((int)dst(y, 4*x + 3), 2 * 3 * 2 * 2);
+				}
+		}
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -42,6 +42,7 @@ using namespace boost::assign;
 #include <cuv/basics/tensor.hpp>
 #include <cuv/convert/convert.hpp>
 #include <cuv/matrix_ops/matrix_ops.hpp>
+#include <cuv/tools/thread_pool.hpp>
 #include <cuv/tensor_ops/rprop.hpp>
 #include <cuv/tools/cuv_test.hpp>
 #include <cuv/random/random.hpp>
@@ -813,6 +814,19 @@ void test_matrix_transpose(unsigned int n, unsigned int m){
         }
 }
 
+template<class T, class M, class R>
+void test_matrix_transpose_inplace(unsigned int n){
+    tensor<T,M,R> A(extents[n][n]);
+    sequence(A);
+    tensor<T,M,R> B = A.copy();
+    transpose(A);
+    for(unsigned int i = 0;i<n;i++)
+        for (unsigned int j = 0; j < n; ++j)
+        {
+            BOOST_CHECK_EQUAL(A(i,j),B(j,i));
+        }
+}
+
 
 BOOST_AUTO_TEST_CASE( mat_op_transpose )
 {
@@ -838,6 +852,25 @@ for(unsigned int iter=0;iter<1;iter++){
 }
 }
 
+BOOST_AUTO_TEST_CASE( mat_op_transpose_tiled )
+{
+    // sizes around the tile (64) and register block (8) edges, run in parallel
+    size_t old_threshold = get_host_parallel_threshold();
+    set_host_parallel_threshold(1);
+    int nm[] = {1,7,8,9,63,64,65,130};
+    for(unsigned int ni = 0; ni<8;ni++){
+        for(unsigned int mi = 0; mi<8;mi++){
+            test_matrix_transpose<float,host_memory_space,column_major>(nm[ni],nm[mi]);
+            test_matrix_transpose<float,host_memory_space,row_major>(nm[ni],nm[mi]);
+        }
+        test_matrix_transpose_inplace<float,host_memory_space,column_major>(nm[ni]);
+        test_matrix_transpose_inplace<float,host_memory_space,row_major>(nm[ni]);
+        test_matrix_transpose_inplace<unsigned char,host_memory_space,row_major>(nm[ni]);
+        test_matrix_transpose_inplace<float,dev_memory_space,row_major>(nm[ni]);
+    }
+    set_host_parallel_threshold(old_threshold);
+}
+
 
 BOOST_AUTO_TEST_CASE( logaddexp_reduce ){
 	const int n = 25;
@@ -922,4 +955,92 @@ BOOST_AUTO_TEST_CASE( all_reduce )
 	}
 	}
 }
+BOOST_AUTO_TEST_CASE( host_reduce_threads )
+{
+	// the host reduction splits work among threads differently depending on the shape
+	unsigned int old_num_threads = get_host_num_threads();
+	size_t old_threshold = get_host_parallel_threshold();
+	const int shapes[][2] = {{64, 100000}, {100000, 64}, {3, 400000}, {1, 1000000}};
+	reduce_functor rfs[] = {RF_ADD, RF_MAX, RF_ARGMAX, RF_ARGMIN};
+	for(int s = 0; s < 4; s++){
+		tensor<float,host_memory_space,column_major> A(extents[shapes[s][0]][shapes[s][1]]);
+		for(unsigned int i = 0; i < A.size(); i++)
+			A[i] = drand48();
+		for(int dim = 0; dim < 2; dim++){
+			unsigned int len = dim == 0 ? A.shape(1) : A.shape(0);
+			for(int f = 0; f < 4; f++){
+				tensor<float,host_memory_space> v1(len), v2(len);
+				set_host_num_threads(1);
+				if(dim == 0) reduce_to_row(v1, A, rfs[f]);
+				else         reduce_to_col(v1, A, rfs[f]);
+				set_host_num_threads(4);
+				set_host_parallel_threshold(1);
+				if(dim == 0) reduce_to_row(v2, A, rfs[f]);
+				else         reduce_to_col(v2, A, rfs[f]);
+				set_host_parallel_threshold(old_threshold);
+				for(unsigned int i = 0; i < len; i++){
+					if(rfs[f] == RF_ADD) BOOST_REQUIRE_CLOSE((float)v1[i], (float)v2[i], 0.001f);
+					else                 BOOST_REQUIRE_EQUAL((float)v1[i], (float)v2[i]);
+				}
+			}
+		}
+	}
+	set_host_num_threads(old_num_threads);
+}
+
+BOOST_AUTO_TEST_CASE( host_reduce_kahan )
+{
+	const int n = 1 << 22;
+	tensor<float,host_memory_space,column_major> A(extents[n][1]);
+	double sum = 0;
+	for(int i = 0; i < n; i++){
+		A[i] = 0.1f + (i % 7) * 0.01f;
+		sum += A[i];
+	}
+	tensor<float,host_memory_space> v(1);
+	set_host_reduce_accuracy(HOST_REDUCE_KAHAN);
+	reduce_to_row(v, A, RF_ADD);
+	set_host_reduce_accuracy(HOST_REDUCE_FAST);
+	BOOST_CHECK_CLOSE((double)v[0], sum, 0.0001);
+}
+
+template<class L>
+void check_host_mat_op_vec(int axis, float factNew, float factOld){
+	tensor<float,host_memory_space,L> src(extents[5][11][37]), dst(src.shape()), ref(src.shape());
+	for(unsigned int i = 0; i < src.size(); i++){
+		src[i] = drand48();
+		dst[i] = drand48(); // must be ignored if factOld==0
+		ref[i] = (float)dst[i];
+	}
+	tensor<float,host_memory_space> v(src.shape(axis));
+	for(unsigned int i = 0; i < v.size(); i++)
+		v[i] = drand48();
+	for(unsigned int a = 0; a < 5; a++)
+		for(unsigned int b = 0; b < 11; b++)
+			for(unsigned int c = 0; c < 37; c++){
+				unsigned int idx[] = {a, b, c};
+				float old = factOld == 0.f ? 0.f : factOld * ref(a,b,c);
+				ref(a,b,c) = old + factNew * (src(a,b,c) * v[idx[axis]]);
+			}
+	matrix_op_vec(dst, src, v, axis, BF_MULT, factNew, factOld);
+	for(unsigned int i = 0; i < src.size(); i++)
+		BOOST_REQUIRE_CLOSE((float)dst[i], (float)ref[i], 0.001f);
+}
+
+BOOST_AUTO_TEST_CASE( host_mat_op_vec_threads )
+{
+	unsigned int old_num_threads = get_host_num_threads();
+	size_t old_threshold = get_host_parallel_threshold();
+	set_host_num_threads(4);
+	set_host_parallel_threshold(1);
+	const float facts[][2] = {{1.f, 0.f}, {1.5f, 0.f}, {1.f, 2.f}, {1.5f, 2.f}};
+	for(int axis = 0; axis < 3; axis++)
+		for(int f = 0; f < 4; f++){
+			check_host_mat_op_vec<row_major>(axis, facts[f][0], facts[f][1]);
+			check_host_mat_op_vec<column_major>(axis, facts[f][0], facts[f][1]);
+		}
+	set_host_num_threads(old_num_threads);
+	set_host_parallel_threshold(old_threshold);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
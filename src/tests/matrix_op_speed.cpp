@@ -39,6 +39,7 @@
 #include <cuv/basics/tensor.hpp>
 #include <cuv/matrix_ops/matrix_ops.hpp>
 #include <cuv/tools/timing.hpp>
+#include <cuv/tools/thread_pool.hpp>
 #include <cuv/random/random.hpp>
 
 using namespace cuv;
@@ -161,6 +162,27 @@ BOOST_AUTO_TEST_CASE( mat_transpose )
 	printf("Speedup: %3.4f\n", host/dev);
 }
 
+BOOST_AUTO_TEST_CASE( mat_transpose_host_bandwidth )
+{
+	// every element is read and written once, compare to a plain copy
+	const int n = 4096;
+	const float gb = 2.f * n * n * sizeof(float) / 1e9f;
+
+	tensor<float,host_memory_space,row_major> X(n,n), Y(n,n); sequence(X);
+	unsigned int old_num_threads = get_host_num_threads();
+	set_host_num_threads(1);
+	MEASURE_TIME(copy_1,    copy(Y,X), 10);
+	MEASURE_TIME(host_1,    transpose(Y,X), 10);
+	MEASURE_TIME(inplace_1, transpose(X), 10);
+	set_host_num_threads(0);
+	MEASURE_TIME(host_n,    transpose(Y,X), 10);
+	MEASURE_TIME(inplace_n, transpose(X), 10);
+	printf("copy, 1 thread:       %3.2f GB/s\n", gb / copy_1 * 1e6f);
+	printf("transpose, 1 thread:  %3.2f GB/s, in place %3.2f GB/s\n", gb / host_1 * 1e6f, gb / inplace_1 * 1e6f);
+	printf("transpose, %d threads: %3.2f GB/s, in place %3.2f GB/s\n", get_host_num_threads(), gb / host_n * 1e6f, gb / inplace_n * 1e6f);
+	set_host_num_threads(old_num_threads);
+}
+
 BOOST_AUTO_TEST_CASE( mat_op_reduce_big_rm_to_row )
 {
 	tensor<float,dev_memory_space,row_major> A_dev(32, 384*384*32);
@@ -180,7 +202,8 @@ BOOST_AUTO_TEST_CASE( mat_op_reduce_big_rm_to_row )
 	fill(V_host, 0);
 
 	MEASURE_TIME(dev, reduce_to_row(V_dev,A_dev,RF_ADD, 1.0f, 1.0f), 10);
-	//MEASURE_TIME(host, reduce_to_row(V_host,A_host,RF_ADD, 1.0f, 1.0f), 10);
+	MEASURE_TIME(host, reduce_to_row(V_host,A_host,RF_ADD, 1.0f, 1.0f), 10);
+	printf("Speedup: %3.4f\n", host/dev);
 
 }
 
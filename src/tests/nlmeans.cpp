@@ -0,0 +1,266 @@
+//*LB*
+// Copyright (c) 2010, University of Bonn, Institute for Computer Science VI
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+//  * Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//  * Neither the name of the University of Bonn 
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this software without specific prior written
+//    permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//*LE*
+
+
+
+
+#define BOOST_TEST_MODULE example
+#include <cmath>
+#include <boost/test/included/unit_test.hpp>
+
+#include <cuv/tools/cuv_general.hpp>
+#include <cuv/tools/thread_pool.hpp>
+#include <cuv/basics/tensor.hpp>
+#include <cuv/libs/nlmeans/nlmeans.hpp>
+#include <cuv/libs/nlmeans/conv3d.hpp>
+
+using namespace cuv;
+using namespace cuv::libs::nlmeans;
+
+struct MyConfig {
+	static const int dev = CUDA_TEST_DEVICE;
+	MyConfig()   { 
+		printf("Testing on device=%d\n",dev);
+		initCUDA(dev); 
+	}
+	~MyConfig()  { exitCUDA();  }
+};
+
+BOOST_GLOBAL_FIXTURE( MyConfig );
+
+struct Fix{
+	Fix()
+	{
+		srand(42);
+	}
+	~Fix(){
+	}
+};
+
+typedef tensor<float,host_memory_space> host_t;
+
+/**
+ * blocks of 4 x 3 pixels in three gray levels, shifted by one block in every slice,
+ * with a faint ramp along x: many patches are similar, few are equal
+ */
+void blocks(host_t& m){
+	const int w = m.shape(m.ndim()-1), h = m.shape(m.ndim()-2);
+	for(unsigned int i = 0; i < m.size(); i++){
+		const int x = i % w, y = i / w % h, z = i / (w*h);
+		m[i] = ((x/3 + y/4 + z) % 3) * 4.f + x / 16.f;
+	}
+}
+
+/**
+ * non-local means of a c x d x h x w volume, comparing all pixels of the patches.
+ *
+ * The search offsets are those of filter_nlmean: in 2D, d is 1 and the
+ * channels share their weights.
+ */
+void naive_nlmean(host_t& dst, const host_t& src, int c, int d, int h, int w,
+		int sr, int fr, float sigma, float dist_sigma, float step, bool three_dim){
+	const int frz = three_dim ? fr : 0;
+	const float patch = (2*fr+1) * (2*fr+1) * (2*frz+1) * c;
+	std::vector<float> steps;
+	for(float v = -sr; v <= sr; v += step)
+		steps.push_back(v);
+	const int nz = three_dim ? steps.size() : 1;
+	for(int z = 0; z < d; z++)
+	for(int y = 0; y < h; y++)
+	for(int x = 0; x < w; x++){
+		std::vector<double> acc(c, 0.0);
+		double wsum = 0.0;
+		for(int i = 0; i < nz; i++)
+		for(int j = 0; j < (int)steps.size(); j++)
+		for(int k = 0; k < (int)steps.size(); k++){
+			const float vz = three_dim ? steps[i] : 0.f, vy = steps[j], vx = steps[k];
+			const int oz = (int)floorf(vz), oy = (int)floorf(vy), ox = (int)floorf(vx);
+			double dist = 0.0;
+			bool valid = true;
+			for(int pz = z - frz; pz <= z + frz; pz++)
+			for(int py = y - fr; py <= y + fr; py++)
+			for(int px = x - fr; px <= x + fr; px++){
+				if(pz < 0 || pz >= d || py < 0 || py >= h || px < 0 || px >= w)
+					continue;
+				if(pz+oz < 0 || pz+oz >= d || py+oy < 0 || py+oy >= h || px+ox < 0 || px+ox >= w){
+					valid = false;
+					continue;
+				}
+				for(int ch = 0; ch < c; ch++){
+					const float v = src[((ch*d + pz)*h + py)*w + px] - src[((ch*d + pz+oz)*h + py+oy)*w + px+ox];
+					dist += v * v;
+				}
+			}
+			if(!valid)
+				continue;
+			double lw = -dist / (patch * sigma * sigma);
+			if(dist_sigma > 0.f)
+				lw -= (vz*vz + vy*vy + vx*vx) / (dist_sigma * dist_sigma);
+			const double wgt = exp(lw);
+			wsum += wgt;
+			for(int ch = 0; ch < c; ch++)
+				acc[ch] += wgt * src[((ch*d + z+oz)*h + y+oy)*w + x+ox];
+		}
+		for(int ch = 0; ch < c; ch++)
+			dst[((ch*d + z)*h + y)*w + x] = acc[ch] / wsum;
+	}
+}
+
+/// src filtered along axis (0, 1 or 2) of a d x h x w volume with kernel, pixels outside are zero
+void naive_conv(host_t& dst, const host_t& src, const host_t& kernel, int axis){
+	const int d = src.shape(0), h = src.shape(1), w = src.shape(2);
+	const int r = (kernel.size() - 1) / 2;
+	for(int z = 0; z < d; z++)
+	for(int y = 0; y < h; y++)
+	for(int x = 0; x < w; x++){
+		float s = 0.f;
+		for(int j = -r; j <= r; j++){
+			const int pz = z + (axis == 0 ? j : 0), py = y + (axis == 1 ? j : 0), px = x + (axis == 2 ? j : 0);
+			if(pz < 0 || pz >= d || py < 0 || py >= h || px < 0 || px >= w)
+				continue;
+			s += src(pz, py, px) * kernel[r - j];
+		}
+		dst(z, y, x) = s;
+	}
+}
+
+void check_close(const host_t& a, const host_t& b, float tol){
+	BOOST_REQUIRE(equal_shape(a, b));
+	for(unsigned int i = 0; i < a.size(); i++)
+		BOOST_CHECK_SMALL((float)a[i] - (float)b[i], tol);
+}
+
+BOOST_FIXTURE_TEST_SUITE( s, Fix )
+
+/** 
+ * @test
+ * @brief non-local means of grayscale images
+ */
+BOOST_AUTO_TEST_CASE( nlmeans_host_2d )
+{
+	const int sizes[][2] = { {5,7}, {37,45}, {70,33} };
+	for(int t = 0; t < 3; t++){
+		const int h = sizes[t][0], w = sizes[t][1];
+		host_t src(extents[h][w]), dst, ref(extents[h][w]);
+		blocks(src);
+		for(int fr = 0; fr <= 2; fr++){
+			naive_nlmean(ref, src, 1, 1, h, w, 3, fr, 4.f, 0.f, 1.f, false);
+			for(int threads = 1; threads <= 4; threads += 3){
+				scoped_host_thread_limit limit(threads);
+				filter_nlmean(dst, src, 3, fr, 4.f);
+				check_close(dst, ref, 0.001f);
+			}
+		}
+
+		// all patches of a constant image are equal, the weighted mean is the constant
+		fill(src, 2.5f);
+		filter_nlmean(dst, src, 3, 1, 4.f);
+		for(unsigned int i = 0; i < dst.size(); i++)
+			BOOST_CHECK_CLOSE((float)dst[i], 2.5f, 0.001f);
+	}
+}
+
+/** 
+ * @test
+ * @brief the images of a stack share their weights, unless filtered in 3D
+ */
+BOOST_AUTO_TEST_CASE( nlmeans_host_channels_and_3d )
+{
+	const int d = 11, h = 40, w = 23;
+	host_t src(extents[d][h][w]), dst, ref(extents[d][h][w]);
+	blocks(src);
+	for(int threads = 1; threads <= 4; threads += 3){
+		scoped_host_thread_limit limit(threads);
+
+		host_t src3(extents[3][h][w]), dst3, ref3(extents[3][h][w]);
+		for(unsigned int i = 0; i < src3.size(); i++)
+			src3[i] = src[i];
+		naive_nlmean(ref3, src3, 3, 1, h, w, 2, 1, 5.f, 0.f, 1.f, false);
+		filter_nlmean(dst3, src3, 2, 1, 5.f);
+		check_close(dst3, ref3, 0.001f);
+
+		naive_nlmean(ref, src, 1, d, h, w, 2, 1, 5.f, 0.f, 1.f, true);
+		filter_nlmean(dst, src, 2, 1, 5.f, 0.f, 1.f, true);
+		check_close(dst, ref, 0.001f);
+	}
+}
+
+/** 
+ * @test
+ * @brief the distance prior and fractional search steps
+ */
+BOOST_AUTO_TEST_CASE( nlmeans_host_prior_and_steps )
+{
+	const int d = 6, h = 19, w = 25;
+	host_t src(extents[d][h][w]), dst, ref(extents[d][h][w]);
+	blocks(src);
+
+	naive_nlmean(ref, src, d, 1, h, w, 3, 2, 3.f, 2.f, 1.f, false);
+	filter_nlmean(dst, src, 3, 2, 3.f, 2.f);
+	check_close(dst, ref, 0.001f);
+
+	naive_nlmean(ref, src, 1, d, h, w, 1, 1, 3.f, 1.5f, 0.5f, true);
+	filter_nlmean(dst, src, 1, 1, 3.f, 1.5f, 0.5f, true);
+	check_close(dst, ref, 0.001f);
+
+	// no offset is zero and the prior is tiny: all weights vanish and the source is copied
+	filter_nlmean(dst, src, 1, 1, 3.f, 0.001f, 0.75f);
+	for(unsigned int i = 0; i < src.size(); i++)
+		BOOST_CHECK_EQUAL((float)dst[i], (float)src[i]);
+}
+
+/** 
+ * @test
+ * @brief 3D convolutions along rows, columns and slices
+ */
+BOOST_AUTO_TEST_CASE( conv3d_host )
+{
+	const int d = 9, h = 33, w = 70;
+	host_t src(extents[d][h][w]), dst(extents[d][h][w]), ref(extents[d][h][w]);
+	blocks(src);
+	for(int r = 0; r <= 4; r += 2){
+		host_t kernel(2*r+1);
+		for(int i = 0; i < 2*r+1; i++)
+			kernel[i] = 1.f + i;
+
+		convolutionRows(dst, src, kernel);
+		naive_conv(ref, src, kernel, 2);
+		check_close(dst, ref, 0.001f);
+
+		convolutionColumns(dst, src, kernel);
+		naive_conv(ref, src, kernel, 1);
+		check_close(dst, ref, 0.001f);
+
+		convolutionDepth(dst, src, kernel);
+		naive_conv(ref, src, kernel, 0);
+		check_close(dst, ref, 0.001f);
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
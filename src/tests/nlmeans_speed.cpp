@@ -0,0 +1,145 @@
+//*LB*
+// Copyright (c) 2010, University of Bonn, Institute for Computer Science VI
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+//  * Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//  * Neither the name of the University of Bonn 
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this software without specific prior written
+//    permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//*LE*
+
+
+
+
+#define BOOST_TEST_MODULE example
+#include <cstdio>
+#include <cmath>
+#include <vector>
+#include <boost/test/included/unit_test.hpp>
+
+#include <cuv/tools/cuv_general.hpp>
+#include <cuv/tools/thread_pool.hpp>
+#include <cuv/basics/tensor.hpp>
+#include <cuv/tools/timing.hpp>
+#include <cuv/libs/nlmeans/nlmeans.hpp>
+
+using namespace cuv;
+
+#define MEASURE_TIME(MSG, OPERATION, ITERS)     \
+	float MSG;                                  \
+	if(1){                                      \
+		Timing tim;                             \
+		for(int i=0;i<ITERS;i++){               \
+			OPERATION ;                         \
+			safeThreadSync();                   \
+		}                                       \
+		tim.update(ITERS);                      \
+		printf("%s [%s] took %4.4f us/pass\n", #MSG, #OPERATION, 1000000.0f*tim.perf()); \
+		MSG = 1000000.0f*tim.perf();            \
+	}
+
+struct MyConfig {
+	static const int dev = CUDA_TEST_DEVICE;
+	MyConfig()   { 
+		printf("Testing on device=%d\n",dev);
+		initCUDA(dev); 
+	}
+	~MyConfig()  { exitCUDA();  }
+};
+
+BOOST_GLOBAL_FIXTURE( MyConfig );
+
+struct Fix{
+	Fix()
+	{
+	}
+	~Fix(){
+	}
+};
+
+typedef tensor<float,host_memory_space> host_t;
+
+/**
+ * non-local means of a d x h x w volume (2D if d is 1), comparing all
+ * pixels of the patches for every search offset.
+ */
+void brute_force_nlmean(host_t& dst, const host_t& src, int d, int h, int w, int sr, int fr, float sigma){
+	const int frz = d > 1 ? fr : 0, srz = d > 1 ? sr : 0;
+	const float scale = -1.f / ((2*fr+1) * (2*fr+1) * (2*frz+1) * sigma * sigma);
+	for(int z = 0; z < d; z++)
+	for(int y = 0; y < h; y++)
+	for(int x = 0; x < w; x++){
+		float acc = 0.f, wsum = 0.f;
+		for(int oz = -srz; oz <= srz; oz++)
+		for(int oy = -sr; oy <= sr; oy++)
+		for(int ox = -sr; ox <= sr; ox++){
+			float dist = 0.f;
+			bool valid = true;
+			for(int pz = std::max(0, z - frz); pz <= std::min(d - 1, z + frz) && valid; pz++)
+			for(int py = std::max(0, y - fr); py <= std::min(h - 1, y + fr) && valid; py++)
+			for(int px = std::max(0, x - fr); px <= std::min(w - 1, x + fr); px++){
+				if(pz+oz < 0 || pz+oz >= d || py+oy < 0 || py+oy >= h || px+ox < 0 || px+ox >= w){
+					valid = false;
+					break;
+				}
+				const float v = src[(pz*h + py)*w + px] - src[((pz+oz)*h + py+oy)*w + px+ox];
+				dist += v * v;
+			}
+			if(!valid)
+				continue;
+			const float wgt = expf(dist * scale);
+			wsum += wgt;
+			acc  += wgt * src[((z+oz)*h + y+oy)*w + x+ox];
+		}
+		dst[(z*h + y)*w + x] = acc / wsum;
+	}
+}
+
+BOOST_FIXTURE_TEST_SUITE( s, Fix )
+
+BOOST_AUTO_TEST_CASE( nlmeans_host_2d_speed )
+{
+	using namespace cuv::libs::nlmeans;
+	const int h = 256, w = 256, sr = 5, fr = 3;
+	host_t src(extents[h][w]), dst(extents[h][w]), ref(extents[h][w]);
+	for(unsigned int i=0;i<src.size();i++) src[i] = drand48();
+
+	MEASURE_TIME(brute_force, brute_force_nlmean(ref, src, 1, h, w, sr, fr, 0.5f), 1);
+	MEASURE_TIME(host_1,      { scoped_host_thread_limit limit(1); filter_nlmean(dst, src, sr, fr, 0.5f); }, 5);
+	MEASURE_TIME(host,        filter_nlmean(dst, src, sr, fr, 0.5f), 5);
+	printf("speedup over brute force: %3.2f (1 thread), %3.2f\n", brute_force / host_1, brute_force / host);
+}
+
+BOOST_AUTO_TEST_CASE( nlmeans_host_3d_speed )
+{
+	using namespace cuv::libs::nlmeans;
+	const int d = 32, h = 32, w = 32, sr = 2, fr = 2;
+	host_t src(extents[d][h][w]), dst(extents[d][h][w]), ref(extents[d][h][w]);
+	for(unsigned int i=0;i<src.size();i++) src[i] = drand48();
+
+	MEASURE_TIME(brute_force, brute_force_nlmean(ref, src, d, h, w, sr, fr, 0.5f), 1);
+	MEASURE_TIME(host_1,      { scoped_host_thread_limit limit(1); filter_nlmean(dst, src, sr, fr, 0.5f, 0.f, 1.f, true); }, 5);
+	MEASURE_TIME(host,        filter_nlmean(dst, src, sr, fr, 0.5f, 0.f, 1.f, true), 5);
+	printf("speedup over brute force: %3.2f (1 thread), %3.2f\n", brute_force / host_1, brute_force / host);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,79 @@
+# vim:ts=4:sw=4:et
+import numpy as np
+import cuv_python as cp
+from nose.tools import *
+from nose.plugins.skip import SkipTest
+
+def setUpModule():
+    cp.initCUDA(-1)
+def tearDownModule():
+    cp.exitCUDA()
+
+def dense_example():
+    """ a small matrix with empty rows, columns and 2x2 blocks """
+    return np.array([[1, 0, 2, 0],
+                     [0, 0, 3, 0],
+                     [4, 5, 0, 0],
+                     [0, 0, 0, 6]], dtype="float32")
+
+class testSparseMatrices:
+    def setUp(self):
+        self.n = dense_example()
+        self.d = cp.host_tensor_float_cm(self.n.copy("F"))
+        self.B = np.arange(8).reshape(4, 2).astype("float32")
+
+    def tearDown(self):
+        pass
+
+    def testCsrFromDense(self):
+        """ convert a dense matrix to csr and back """
+        A = cp.host_csr_matrix_f()
+        cp.convert(A, self.d)
+        eq_(A.h, 4)
+        eq_(A.w, 4)
+        eq_(A.nnz, 6)
+        eq_(A(2, 1), 5)
+        ok_(not A.has(1, 0))
+        d2 = cp.host_tensor_float_cm([4, 4])
+        cp.convert(d2, A)
+        ok_(np.all(d2.np == self.n))
+
+    def testCsrProd(self):
+        """ C <- A*B with A in csr format """
+        A = cp.host_csr_matrix_f()
+        cp.convert(A, self.d)
+        B = cp.host_tensor_float_cm(self.B.copy("F"))
+        C = cp.host_tensor_float_cm([4, 2])
+        cp.prod(C, A, B, 'n', 'n')
+        ok_(np.allclose(C.np, np.dot(self.n, self.B)))
+        C = cp.host_tensor_float_cm([4, 2])
+        cp.prod(C, A, B, 't', 'n')
+        ok_(np.allclose(C.np, np.dot(self.n.T, self.B)))
+
+    def testBsrSpmv(self):
+        """ dst <- A*v with A in bsr format """
+        A = cp.host_bsr_matrix_f(4, 4, 2, 2, 0)
+        cp.convert(A, self.d)
+        eq_(A.block_h, 2)
+        eq_(A.nnzb, 4)
+        v = cp.host_tensor_float(np.arange(4).astype("float32"))
+        dst = cp.host_tensor_float([4])
+        cp.spmv(dst, A, v)
+        ok_(np.allclose(dst.np, np.dot(self.n, np.arange(4))))
+
+    def testDiaProd(self):
+        """ C <- A*B with A in dia format """
+        if not hasattr(cp, "host_dia_matrix_f"):
+            raise SkipTest("dia matrices are only exported without CUDA")
+        A = cp.host_dia_matrix_f(4, 4, [-1, 0, 1], 4, 1)
+        n = np.zeros((4, 4), dtype="float32")
+        for i in range(4):
+            for j in range(max(0, i - 1), min(4, i + 2)):
+                n[i, j] = 1 + i + 4 * j
+                A.set(i, j, n[i, j])
+        eq_(A.num_dia, 3)
+        eq_(A(2, 1), n[2, 1])
+        B = cp.host_tensor_float_cm(self.B.copy("F"))
+        C = cp.host_tensor_float_cm([4, 2])
+        cp.prod(C, A, B, 'n', 'n')
+        ok_(np.allclose(C.np, np.dot(n, self.B)))
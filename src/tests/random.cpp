@@ -40,6 +40,7 @@
 #include <cuv/tools/cuv_general.hpp>
 #include <cuv/tensor_ops/tensor_ops.hpp>
 #include <cuv/random/random.hpp>
+#include <cuv/tools/thread_pool.hpp>
 
 using namespace cuv;
 
@@ -131,6 +132,37 @@ BOOST_AUTO_TEST_CASE( binarize )
 	}
 }
 
+BOOST_AUTO_TEST_CASE( host_reproducible )
+{
+	// the host stream must not depend on the number of threads
+	unsigned int old_num_threads = get_host_num_threads();
+	size_t old_threshold = get_host_parallel_threshold();
+	tensor<float,host_memory_space> y(n);
+
+	host_rng_state state = get_host_rng_state();
+	set_host_num_threads(1);
+	fill(x,0); add_rnd_normal(x); fill_rnd_uniform(y);
+	BOOST_CHECK_EQUAL(get_host_rng_state().counter, state.counter + 2*((n+3)/4));
+
+	set_host_rng_state(state);
+	set_host_num_threads(4);
+	set_host_parallel_threshold(1);
+	tensor<float,host_memory_space> x2(n), y2(n);
+	fill(x2,0); add_rnd_normal(x2); fill_rnd_uniform(y2);
+	for(int i = 0; i < n; ++ i) {
+		BOOST_REQUIRE_EQUAL( x[i], x2[i] );
+		BOOST_REQUIRE_EQUAL( y[i], y2[i] );
+	}
+
+	// different seeds give different streams
+	initialize_mersenne_twister_seeds(42);
+	fill_rnd_uniform(y2);
+	BOOST_CHECK_NE( y[0], y2[0] );
+
+	set_host_num_threads(old_num_threads);
+	set_host_parallel_threshold(old_threshold);
+}
+
 
 
 
@@ -0,0 +1,307 @@
+//*LB*
+// Copyright (c) 2010, University of Bonn, Institute for Computer Science VI
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+//  * Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//  * Neither the name of the University of Bonn 
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this software without specific prior written
+//    permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//*LE*
+
+#define BOOST_TEST_MODULE example
+#include <cmath>
+#include <boost/test/included/unit_test.hpp>
+
+#include <cuv/tools/cuv_general.hpp>
+#include <cuv/tools/thread_pool.hpp>
+#include <cuv/basics/tensor.hpp>
+#include <cuv/basics/image.hpp>
+#include <cuv/tensor_ops/tensor_ops.hpp>
+#include <cuv/libs/separable_conv/separable_convolution.hpp>
+
+using namespace cuv;
+
+struct MyConfig {
+	static const int dev = CUDA_TEST_DEVICE;
+	MyConfig()   { 
+		printf("Testing on device=%d\n",dev);
+		initCUDA(dev); 
+	}
+	~MyConfig()  { exitCUDA();  }
+};
+
+BOOST_GLOBAL_FIXTURE( MyConfig );
+
+struct Fix{
+	Fix()
+	{
+		srand(42);
+	}
+	~Fix(){
+	}
+};
+
+typedef tensor<float,host_memory_space> host_t;
+
+/// 2r+1 coefficients of a gaussian filter, normalized to sum one
+std::vector<float> gauss_kernel(int r, float sigma){
+	std::vector<float> k(2*r+1);
+	float sum = 0.f;
+	for(int i = 0; i < 2*r+1; i++){
+		float dist = (float)(i - r);
+		k[i] = expf(- dist * dist / (2*sigma*sigma));
+		sum += k[i];
+	}
+	for(int i = 0; i < 2*r+1; i++)
+		k[i] /= sum;
+	return k;
+}
+
+/// src(y,x), zero outside of the image
+float pixel(const host_t& src, int y, int x){
+	if(y < 0 || y >= (int)src.shape(0) || x < 0 || x >= (int)src.shape(1))
+		return 0.f;
+	return src(y,x);
+}
+
+/**
+ * dst(y,x) = sum_j src(y,x+j) * k[r-j] (axis 0) or sum_j src(y+j,x) * k[r-j] (axis 1),
+ * zero outside of the image
+ */
+void naive_pass(host_t& dst, const host_t& src, const std::vector<float>& k, int axis){
+	const int h = src.shape(0), w = src.shape(1);
+	const int r = k.size() / 2;
+	dst = host_t(extents[h][w]);
+	for(int y = 0; y < h; y++)
+		for(int x = 0; x < w; x++){
+			float s = 0.f;
+			for(int j = -r; j <= r; j++){
+				const int yy = axis == 1 ? y + j : y;
+				const int xx = axis == 0 ? x + j : x;
+				s += pixel(src,yy,xx) * k[r-j];
+			}
+			dst(y,x) = s;
+		}
+}
+
+/// unit impulses every step pixels, starting at the top left, zero elsewhere
+void impulses(host_t& m, int step){
+	fill(m, 0.f);
+	for(unsigned int y = 0; y < m.shape(0); y += step)
+		for(unsigned int x = 0; x < m.shape(1); x += step)
+			m(y,x) = 1.f;
+}
+
+/**
+ * coefficient of k at the distance of pixel i to the nearest impulse in a row of n pixels
+ * with impulses every step=2r+1 pixels, which is within reach of at most one impulse
+ */
+float tap(const std::vector<float>& k, int i, int n){
+	const int r = k.size() / 2, step = 2*r+1;
+	const int before = i % step, after = step - before;
+	if(before <= r)
+		return k[r - before];
+	return i + after < n ? k[r - after] : 0.f;
+}
+
+void check_equal(const host_t& a, const host_t& b, float tol=0.0001f){
+	BOOST_REQUIRE(equal_shape(a,b));
+	for(unsigned int i = 0; i < a.size(); i++)
+		BOOST_CHECK_SMALL(a[i] - b[i], tol);
+}
+
+BOOST_FIXTURE_TEST_SUITE( s, Fix )
+
+/** 
+ * @test
+ * @brief gaussian filter on the host, for all radii and images crossing tile borders
+ */
+BOOST_AUTO_TEST_CASE( sep_conv_host_gauss )
+{
+	const int sizes[][2] = { {5,7}, {70,300}, {130,513} };
+	for(int t = 0; t < 3; t++){
+		const int h = sizes[t][0], w = sizes[t][1];
+		host_t src(extents[h][w]), dst;
+		for(int r = 0; r <= 8; r++){
+			// the responses to the impulses do not overlap, each is the outer product of the kernel
+			impulses(src, 2*r+1);
+			std::vector<float> k = gauss_kernel(r, 2.f);
+			for(int threads = 1; threads <= 4; threads += 3){
+				scoped_host_thread_limit limit(threads);
+				sep_conv::convolve(dst, src, r, sep_conv::SP_GAUSS, 2, 2.f);
+				for(int y = 0; y < h; y++)
+					for(int x = 0; x < w; x++)
+						BOOST_CHECK_SMALL(dst(y,x) - tap(k,y,h) * tap(k,x,w), 0.0001f);
+			}
+		}
+	}
+}
+
+/** 
+ * @test
+ * @brief radii above the device limit of 8 use the runtime radius on the host
+ */
+BOOST_AUTO_TEST_CASE( sep_conv_host_large_radius )
+{
+	const int sizes[][2] = { {10,15}, {70,300} };
+	const int radii[] = { 9, 12, 20 };
+	for(int t = 0; t < 2; t++){
+		const int h = sizes[t][0], w = sizes[t][1];
+		host_t src(extents[h][w]), dst;
+		for(int i = 0; i < 3; i++){
+			const int r = radii[i];
+			impulses(src, 2*r+1);
+			std::vector<float> k = gauss_kernel(r, 4.f);
+			sep_conv::convolve(dst, src, r, sep_conv::SP_GAUSS, 2, 4.f);
+			for(int y = 0; y < h; y++)
+				for(int x = 0; x < w; x++)
+					BOOST_CHECK_SMALL(dst(y,x) - tap(k,y,h) * tap(k,x,w), 0.0001f);
+
+			std::vector<float> box(2*r+1, 1.f/(2*r+1));
+			sep_conv::convolve(dst, src, r, sep_conv::SP_BOX);
+			for(int y = 0; y < h; y++)
+				for(int x = 0; x < w; x++)
+					BOOST_CHECK_SMALL(dst(y,x) - tap(box,y,h) * tap(box,x,w), 0.0001f);
+		}
+	}
+}
+
+/** 
+ * @test
+ * @brief box filter and derivatives of a stack of images
+ */
+BOOST_AUTO_TEST_CASE( sep_conv_host_stack )
+{
+	const int n = 3, h = 67, w = 260;
+	host_t src(extents[n][h][w]), dst, slice(extents[h][w]), tmp, ref;
+	// a different ramp in every image, the box filter keeps it and the derivatives are constant
+	for(int i = 0; i < n; i++)
+		for(int y = 0; y < h; y++)
+			for(int x = 0; x < w; x++)
+				src(i,y,x) = (i+1) * x / 16.f - y / 8.f;
+
+	std::vector<float> box(7, 1.f/7);
+	std::vector<float> diff(3);
+	diff[0] = -0.5f; diff[1] = 0.f; diff[2] = 0.5f;
+
+	sep_conv::convolve(dst, src, 3, sep_conv::SP_BOX);
+	for(int i = 0; i < n; i++){
+		for(int j = 0; j < h*w; j++)
+			slice[j] = src[i*h*w + j];
+		naive_pass(tmp, slice, box, 0);
+		naive_pass(ref, tmp, box, 1);
+		for(int j = 0; j < h*w; j++)
+			BOOST_CHECK_SMALL(dst[i*h*w + j] - ref[j], 0.0001f);
+		for(int y = 3; y < h-3; y++)
+			for(int x = 3; x < w-3; x++)
+				BOOST_CHECK_SMALL(dst(i,y,x) - src(i,y,x), 0.0001f);
+	}
+
+	for(int axis = 0; axis < 2; axis++){
+		sep_conv::convolve(dst, src, 1, sep_conv::SP_CENTERED_DERIVATIVE, axis);
+		for(int i = 0; i < n; i++){
+			for(int j = 0; j < h*w; j++)
+				slice[j] = src[i*h*w + j];
+			naive_pass(ref, slice, diff, axis);
+			for(int j = 0; j < h*w; j++)
+				BOOST_CHECK_SMALL(dst[i*h*w + j] - ref[j], 0.0001f);
+			// the kernel is flipped by the convolution
+			const float slope = axis == 0 ? -(i+1) / 16.f : 1 / 8.f;
+			for(int y = 1; y < h-1; y++)
+				for(int x = 1; x < w-1; x++)
+					BOOST_CHECK_SMALL(dst(i,y,x) - slope, 0.0001f);
+		}
+	}
+}
+
+/** 
+ * @test
+ * @brief gaussian filter of an interleaved RGBA image
+ */
+BOOST_AUTO_TEST_CASE( sep_conv_host_interleaved )
+{
+	const int h = 80, w = 90;
+	interleaved_image<4,float,host_memory_space> src(h,w), dst(1,1);
+	host_t plain(extents[h][w]);
+	// channel c holds impulses of height c+1, mixing up channels changes the heights
+	impulses(plain, 11);
+	for(int y = 0; y < h; y++)
+		for(int x = 0; x < w; x++)
+			for(int c = 0; c < 4; c++)
+				src(y,x,c) = (c+1) * plain(y,x);
+
+	std::vector<float> k = gauss_kernel(5, 1.5f);
+	sep_conv::convolve(dst, src, 5, sep_conv::SP_GAUSS, 2, 1.5f);
+	BOOST_REQUIRE_EQUAL(dst.height(), h);
+	BOOST_REQUIRE_EQUAL(dst.width(), w);
+	for(int y = 0; y < h; y++)
+		for(int x = 0; x < w; x++)
+			for(int c = 0; c < 4; c++)
+				BOOST_CHECK_SMALL(dst(y,x,c) - (c+1) * tap(k,y,h) * tap(k,x,w), 0.0001f);
+}
+
+/** 
+ * @test
+ * @brief gradient orientation and magnitude
+ */
+BOOST_AUTO_TEST_CASE( sep_conv_host_orientation )
+{
+	const int h = 20, w = 30;
+	host_t src(extents[h][w]), dst;
+	// inside the image, the centered differences are exactly gx = y/8+2 and gy = x/8-3,
+	// gy changes its sign, which the orientation folds into [0,pi)
+	for(int y = 0; y < h; y++)
+		for(int x = 0; x < w; x++)
+			src(y,x) = x * y / 8.f + 2 * x - 3 * y;
+	sep_conv::convolve(dst, src, 1, sep_conv::SP_ORIENTATION_AND_MAGNITUDE);
+	BOOST_REQUIRE_EQUAL(dst.ndim(), 3);
+	BOOST_REQUIRE_EQUAL(dst.shape(0), 2);
+	for(int y = 0; y < h; y++)
+		for(int x = 0; x < w; x++){
+			float gx = 0.5f * (pixel(src,y,x+1) - pixel(src,y,x-1));
+			float gy = 0.5f * (pixel(src,y+1,x) - pixel(src,y-1,x));
+			float a = atan2f(gy,gx);
+			if(a < 0) a += (float)M_PI;
+			BOOST_CHECK_SMALL(dst(0,y,x) - a, 0.0001f);
+			BOOST_CHECK_SMALL(dst(1,y,x) - sqrtf(gx*gx + gy*gy), 0.0001f);
+		}
+}
+
+/** 
+ * @test
+ * @brief device and host give the same results
+ */
+BOOST_AUTO_TEST_CASE( sep_conv_dev_host )
+{
+	host_t src(extents[128][256]), dst, dst2;
+	// a sawtooth with edges along both axes
+	for(int y = 0; y < 128; y++)
+		for(int x = 0; x < 256; x++)
+			src(y,x) = (float)((3*x + 5*y) % 11);
+	tensor<float,dev_memory_space> d_src(src), d_dst;
+	sep_conv::convolve(dst, src, 4, sep_conv::SP_GAUSS, 2, 2.f);
+	sep_conv::convolve(d_dst, d_src, 4, sep_conv::SP_GAUSS, 2, 2.f);
+	dst2 = d_dst;
+	check_equal(dst, dst2, 0.001f);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
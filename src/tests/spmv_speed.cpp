@@ -43,11 +43,12 @@
 #include <cuv/convert/convert.hpp>
 #include <cuv/matrix_ops/matrix_ops.hpp>
 #include <cuv/tools/timing.hpp>
+#include <cuv/tools/thread_pool.hpp>
 
 using namespace std;
 using namespace cuv;
 
-static const unsigned int px = 256;  // image width and height
+static const unsigned int px = 64;   // image width and height, the dense A_ has 16*px^4 entries
 static const unsigned int  n = px*px;// size of input layer
 static const unsigned int  m = 16*n;  // size output layer (same as input times number of output maps)
 static const unsigned int  k = 14;    // number images
@@ -78,6 +79,16 @@ struct MyConfig {
 
 BOOST_GLOBAL_FIXTURE( MyConfig );
 
+/// C = factC * C + factAv * A * B with one spmv per column
+void spmv_columns(tensor<float,host_memory_space,column_major>& C, const dia_matrix<float,host_memory_space>& A,
+		const tensor<float,host_memory_space,column_major>& B, float factAv, float factC){
+	for(unsigned int c=0;c<C.shape(1);c++){
+		tensor<float,host_memory_space> dst_v(indices[index_range(0,C.shape(0))], C.ptr()+c*C.shape(0));
+		const tensor<float,host_memory_space> src_v(indices[index_range(0,B.shape(0))], const_cast<float*>(B.ptr()+c*B.shape(0)));
+		spmv(dst_v,A,src_v,'n',factAv,factC);
+	}
+}
+
 struct Fix{
 	dia_matrix<float,host_memory_space>   A_host;
 	tensor<float,host_memory_space,column_major> A_;
@@ -119,6 +130,8 @@ struct Fix{
 BOOST_FIXTURE_TEST_SUITE( s, Fix )
 
 
+// without CUDA, the device code paths use the host implementation
+#ifndef CUV_NO_CUDA
 BOOST_AUTO_TEST_CASE( spmv_dev_speed_vs_dense )
 {
 	if(px>64)
@@ -172,6 +185,7 @@ BOOST_AUTO_TEST_CASE( spmv_dev_speed_vs_dia )
 	BOOST_CHECK_LT(dev_dia,  host_dia);
 	BOOST_CHECK_LT(dev_dia_t,host_dia_t);
 }
+#endif
 BOOST_AUTO_TEST_CASE( spmv_host_speed )
 {
 	if(px>64)
@@ -188,5 +202,22 @@ BOOST_AUTO_TEST_CASE( spmv_host_speed )
    BOOST_CHECK_LT(sparse_host,  dense_host);
    BOOST_CHECK_LT(sparse_host_t,dense_host_t);
 }
+BOOST_AUTO_TEST_CASE( spmm_host_speed_vs_spmv )
+{
+	// the host prod processes blocks of columns of B per sweep over the diagonals,
+	// spmv uses the same tiles with a single column.
+	float factAv = 2.f, factC = 1.3f;
+	unsigned int num_threads = get_host_num_threads();
+	MEASURE_TIME(host_spmv, spmv_columns(CLarge_host,A_host,BLarge_host,factAv,factC), 2);
+	set_host_num_threads(1);
+	MEASURE_TIME(host_spmm_1, prod(CLarge_host,A_host,BLarge_host,'n','n',factAv,factC), 2);
+	set_host_num_threads(num_threads);
+	MEASURE_TIME(host_spmm, prod(CLarge_host,A_host,BLarge_host,'n','n',factAv,factC), 2);
+	printf("Speedup (1 thread): %3.4f, (%d threads): %3.4f\n", host_spmv/host_spmm_1, num_threads, host_spmv/host_spmm);
+
+	MEASURE_TIME(host_spmm_t, prod(BLarge_host,A_host,CLarge_host,'t','n',factAv,factC), 2);
+	printf("transposed: %4.4f us/pass\n", host_spmm_t);
+	printf("Ratio prod/spmv (1 thread): %3.4f\n", host_spmm_1/host_spmv);
+}
 
 BOOST_AUTO_TEST_SUITE_END()
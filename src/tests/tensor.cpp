@@ -277,6 +277,103 @@ BOOST_AUTO_TEST_CASE( tensor_memcpy2d )
                 }
 }
 
+BOOST_AUTO_TEST_CASE( tensor_copy_strided )
+{
+    // views which are neither contiguous nor 2d-copyable are copied element by element
+    tensor<float,host_memory_space> x(extents[4][5][6]);
+    for (int i = 0; i < 4; ++i)
+        for (int j = 0; j < 5; ++j)
+            for (int k = 0; k < 6; ++k)
+                x(i,j,k) = i*100+j*10+k;
+
+    tensor_view<float,host_memory_space> v(indices[index_range()][index_range(1,4)][index_range(0,6,4)], x);
+    BOOST_CHECK(!v.is_c_contiguous());
+    BOOST_CHECK(!v.is_2dcopyable());
+    BOOST_CHECK_EQUAL(v.shape(2), 2);
+    tensor<float,host_memory_space> y = v.copy();
+    BOOST_CHECK(y.is_c_contiguous());
+    for (int i = 0; i < 4; ++i)
+        for (int j = 0; j < 3; ++j)
+            for (int k = 0; k < 2; ++k)
+                BOOST_CHECK_EQUAL(y(i,j,k), i*100+(j+1)*10+4*k);
+
+    // write into a view
+    for(int k=0;k<y.size();k++)
+        y[k] = -k;
+    v = y;
+    for (int i = 0; i < 4; ++i)
+        for (int j = 0; j < 5; ++j)
+            for (int k = 0; k < 6; ++k){
+                if(j>=1 && j<4 && k%4==0){
+                    BOOST_CHECK_EQUAL(x(i,j,k), -((i*3+j-1)*2+k/4));
+                }else{
+                    BOOST_CHECK_EQUAL(x(i,j,k), i*100+j*10+k);
+                }
+            }
+
+    // view to view, in other memory spaces
+    tensor<float,dev_memory_space> z(extents[4][5][6]);
+    tensor_view<float,dev_memory_space> w(indices[index_range()][index_range(0,3)][index_range(1,6,4)], z);
+    w = v;
+    tensor<float,host_memory_space> zh(w.copy());
+    for(int k=0;k<y.size();k++)
+        BOOST_CHECK_EQUAL(zh[k], y[k]);
+
+    // slices of column major tensors
+    tensor<float,host_memory_space,column_major> c(extents[6][5]);
+    for (int i = 0; i < 6; ++i)
+        for (int j = 0; j < 5; ++j)
+            c(i,j) = i*10+j;
+    tensor_view<float,host_memory_space,column_major> cv(indices[index_range(0,6,2)][index_range(1,4)], c);
+    BOOST_CHECK(!cv.is_2dcopyable());
+    tensor<float,host_memory_space,column_major> cc = cv.copy();
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+            BOOST_CHECK_EQUAL(cc(i,j), 2*i*10+j+1);
+}
+
+BOOST_AUTO_TEST_CASE( tensor_element_access )
+{
+    tensor<float,host_memory_space> x(extents[4][5]);
+    for(int k=0;k<x.size();k++)
+        x[k] = k;
+
+    // iterators over contiguous host tensors
+    BOOST_CHECK_EQUAL(x.end()-x.begin(), 20);
+    BOOST_CHECK_EQUAL(std::accumulate(x.begin(), x.end(), 0.f), 190.f);
+    std::vector<float> v(x.size());
+    std::copy(x.begin(), x.end(), v.begin());
+    for(int k=0;k<x.size();k++)
+        BOOST_CHECK_EQUAL(v[k], k);
+    const tensor<float,host_memory_space>& cx = x;
+    BOOST_CHECK_EQUAL(*(cx.end()-1), 19.f);
+
+    // linear index into a view
+    tensor_view<float,host_memory_space> w(indices[index_range(1,3)][index_range(1,4)], x);
+    for (int i = 0; i < 2; ++i)
+        for (int j = 0; j < 3; ++j)
+            BOOST_CHECK_EQUAL(w[i*3+j], x(i+1,j+1));
+
+    // strided one-dimensional view, negative indices count from the end
+    tensor_view<float,host_memory_space> col(indices[index_range()][4], x);
+    BOOST_CHECK_EQUAL(col.ndim(), 1);
+    for (int i = 0; i < 4; ++i){
+        BOOST_CHECK_EQUAL(col(i), x(i,4));
+        BOOST_CHECK_EQUAL(col[i], x(i,4));
+    }
+    BOOST_CHECK_EQUAL(col(-1), x(3,4));
+    col(-2) = -1.f;
+    BOOST_CHECK_EQUAL(x(2,4), -1.f);
+
+    // column major
+    tensor<float,host_memory_space,column_major> c(extents[3][4]);
+    for(int k=0;k<c.size();k++)
+        c[k] = k;
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 4; ++j)
+            BOOST_CHECK_EQUAL(c(i,j), i+3*j);
+}
+
 template<class V,class M1,class M2>
 void test_pushpull_2d()
 {
@@ -604,4 +701,40 @@ BOOST_AUTO_TEST_CASE( tensor_resize ) {
     test_resize<float, dev_memory_space>();
 }
 
+BOOST_AUTO_TEST_CASE( tensor_shape_array ) {
+    // shapes are stored inline up to SHAPE_ARRAY_INLINE_SIZE dimensions, and on the heap beyond
+    tensor<float,host_memory_space> a(extents[2][3][4]);
+    std::vector<unsigned int> v = a.shape();
+    BOOST_CHECK_EQUAL(v.size(), 3);
+    BOOST_CHECK(a.shape() == v);
+    BOOST_CHECK(v == a.shape());
+    v[2] = 5;
+    BOOST_CHECK(a.shape() != v);
+
+    tensor<float,host_memory_space> b(a.shape());
+    BOOST_CHECK(b.shape() == a.shape());
+
+    std::vector<unsigned int> big(SHAPE_ARRAY_INLINE_SIZE + 2, 1);
+    big[0] = 2; big[SHAPE_ARRAY_INLINE_SIZE + 1] = 3;
+    tensor<float,host_memory_space> c(big);
+    BOOST_CHECK_EQUAL(c.ndim(), SHAPE_ARRAY_INLINE_SIZE + 2);
+    BOOST_CHECK(c.shape() == big);
+    BOOST_CHECK_EQUAL(c.stride(0), 3);
+    BOOST_CHECK_EQUAL(c.effective_shape().size(), 2);
+    BOOST_CHECK_EQUAL(c.effective_shape()[1], 3);
+    BOOST_CHECK(equal_shape(c, tensor<float,host_memory_space>(extents[2][3])));
+
+    // copies and views of high-dimensional tensors keep their own shape
+    tensor<float,host_memory_space> d = c;
+    c.reshape(extents[6]);
+    BOOST_CHECK(d.shape() == big);
+    tensor<float,host_memory_space,column_major> e(d);
+    BOOST_CHECK_EQUAL(e.shape(0), 3);
+    BOOST_CHECK_EQUAL(e.shape(SHAPE_ARRAY_INLINE_SIZE + 1), 2);
+    tensor_view<float,host_memory_space> f = d[indices[1]];
+    BOOST_CHECK_EQUAL(f.ndim(), SHAPE_ARRAY_INLINE_SIZE + 1);
+    BOOST_CHECK_EQUAL(f.shape(SHAPE_ARRAY_INLINE_SIZE), 3);
+    BOOST_CHECK_EQUAL(f.ptr(), d.ptr() + 3);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -35,10 +35,13 @@
 #include <boost/test/included/unit_test.hpp>
 #include <boost/test/floating_point_comparison.hpp>
 #include <limits>
+#include <boost/thread.hpp>
 
 #include <cuv/tools/cuv_general.hpp>
+#include <cuv/tools/thread_pool.hpp>
 #include <cuv/tensor_ops/tensor_ops.hpp>
 #include <cuv/tensor_ops/rprop.hpp>
+#include <cuv/tensor_ops/simd_functors.hpp>
 
 using namespace cuv;
 
@@ -53,6 +56,52 @@ struct MyConfig {
 
 BOOST_GLOBAL_FIXTURE( MyConfig );
 
+/// sums i*i over a range, for parallel_reduce
+struct sum_squares_range{
+	double operator()(size_t begin, size_t end){
+		double r = 0;
+		for(size_t i=begin;i<end;i++)
+			r += (double)i*i;
+		return r;
+	}
+};
+/// joins partial results of sum_squares_range
+struct join_plus{
+	double operator()(double a, double b)const{ return a+b; }
+};
+/// counts elements in a nested parallel_for
+struct nested_count{
+	unsigned int* cnt;
+	nested_count(unsigned int* c):cnt(c){}
+	void operator()(size_t begin, size_t end){
+		for(size_t i=begin;i<end;i++)
+			__sync_fetch_and_add(cnt, 1u);
+	}
+};
+/// starts a parallel_for of 1000 elements for every element
+struct outer_count{
+	unsigned int* cnt;
+	outer_count(unsigned int* c):cnt(c){}
+	void operator()(size_t begin, size_t end){
+		for(size_t i=begin;i<end;i++){
+			nested_count inner(cnt);
+			parallel_for(1000, 10, inner);
+		}
+	}
+};
+/// reduces a tensor many times, used from several client threads
+struct concurrent_sum{
+	const tensor<float,host_memory_space>* t;
+	float expected;
+	int* errors;
+	concurrent_sum(const tensor<float,host_memory_space>* _t, float e, int* err):t(_t),expected(e),errors(err){}
+	void operator()(){
+		for(int i=0;i<20;i++)
+			if(sum(*t) != expected)
+				__sync_fetch_and_add(errors, 1);
+	}
+};
+
 struct Fix{
 	tensor<float,dev_memory_space> v,w;
 	static const int N = 8092;
@@ -279,6 +328,36 @@ BOOST_AUTO_TEST_CASE( vec_ops_is_nan )
 		BOOST_MESSAGE("Warning: we do not have NaN, skip test!");
 	}
 }
+BOOST_AUTO_TEST_CASE( vec_ops_host_has_inf_nan )
+{
+	// has_inf and has_nan are parallel reductions over bool on the host
+	size_t old_threshold = get_host_parallel_threshold();
+	set_host_parallel_threshold(1);
+	scoped_host_thread_limit limit(4);
+
+	tensor<float,host_memory_space> t(extents[300][337]);
+	fill(t,0.f);
+	tensor_view<float,host_memory_space> tv(indices[index_range()][index_range(0,337,2)], t);
+	BOOST_CHECK(!has_inf(t));
+	BOOST_CHECK(!has_nan(t));
+	BOOST_CHECK(!has_inf(tv));
+	BOOST_CHECK(!has_nan(tv));
+
+	// not part of the view
+	t(299,335) = std::numeric_limits<float>::infinity();
+	t(298,333) = std::numeric_limits<float>::quiet_NaN();
+	BOOST_CHECK(has_inf(t));
+	BOOST_CHECK(has_nan(t));
+	BOOST_CHECK(!has_inf(tv));
+	BOOST_CHECK(!has_nan(tv));
+
+	t(299,336) = std::numeric_limits<float>::infinity();
+	t(0,0)     = std::numeric_limits<float>::quiet_NaN();
+	BOOST_CHECK(has_inf(tv));
+	BOOST_CHECK(has_nan(tv));
+
+	set_host_parallel_threshold(old_threshold);
+}
 BOOST_AUTO_TEST_CASE( vec_ops_norms )
 {
 	sequence(v);
@@ -343,6 +422,277 @@ BOOST_AUTO_TEST_CASE( vec_ops_cross_entropy )
 	}
 }
 
+BOOST_AUTO_TEST_CASE( vec_ops_host_threads )
+{
+	// results of the threaded host kernels must not depend on the number of threads
+	unsigned int old_num_threads = get_host_num_threads();
+	size_t       old_threshold   = get_host_parallel_threshold();
+	set_host_parallel_threshold(1);
+
+	const int n = 100003; // not a multiple of the chunk size
+	tensor<float,host_memory_space> a(n), b(n), r1(n), r4(n), s1(n), s4(n);
+	tensor<unsigned char,host_memory_space> mask(n);
+	sequence(a); apply_scalar_functor(a, SF_MULT, 0.001f);
+	sequence(b); apply_scalar_functor(b, SF_ADD, 1.f);
+	apply_scalar_functor(mask, a, SF_LT, 50.f);
+
+	set_host_num_threads(1);
+	apply_scalar_functor(r1, a, SF_TANH, 1.5f, 0.5f);
+	apply_binary_functor(s1, a, b, BF_AXPBY, 2.f, 3.f);
+	r1 += s1;
+	apply_scalar_functor(r1, SF_SQUARE, &mask);
+
+	set_host_num_threads(4);
+	BOOST_CHECK_EQUAL(get_host_num_threads(), 4u);
+	apply_scalar_functor(r4, a, SF_TANH, 1.5f, 0.5f);
+	apply_binary_functor(s4, a, b, BF_AXPBY, 2.f, 3.f);
+	r4 += s4;
+	apply_scalar_functor(r4, SF_SQUARE, &mask);
+
+	for(int i=0;i<n;i++){
+		BOOST_CHECK_EQUAL((float)s1[i], (float)s4[i]);
+		BOOST_CHECK_EQUAL((float)r1[i], (float)r4[i]);
+	}
+	for(int i=0;i<n;i+=997){
+		float expected = 1.5f*tanh(0.5f*(float)a[i]) + 2.f*(float)a[i] + 3.f*(float)b[i];
+		if(mask[i])
+			expected *= expected;
+		BOOST_CHECK_CLOSE((float)r4[i], expected, 0.01f);
+	}
+
+	set_host_num_threads(old_num_threads);
+	set_host_parallel_threshold(old_threshold);
+}
+
+BOOST_AUTO_TEST_CASE( host_thread_pool_runtime )
+{
+	unsigned int old_num_threads = get_host_num_threads();
+	size_t       old_threshold   = get_host_parallel_threshold();
+	set_host_parallel_threshold(1);
+
+	// reductions are joined in a fixed order: results do not depend on the number of threads
+	sum_squares_range f;
+	set_host_num_threads(1);
+	double r1 = parallel_reduce(100003, 1000, 0.0, f, join_plus());
+	tensor<float,host_memory_space> t(extents[300][301]);
+	sequence(t); apply_scalar_functor(t, SF_MULT, 0.01f);
+	float s1 = sum(t);
+	unsigned int a1 = arg_max(t);
+	set_host_num_threads(4);
+	double r4 = parallel_reduce(100003, 1000, 0.0, f, join_plus());
+	BOOST_CHECK_EQUAL(r1, r4);
+	BOOST_CHECK_EQUAL(r1, parallel_reduce(100003, 10, 0.0, f, join_plus())); // partials on the heap
+	BOOST_CHECK_EQUAL(s1, sum(t));
+	BOOST_CHECK_EQUAL(a1, arg_max(t));
+	BOOST_CHECK_EQUAL(a1, t.size()-1);
+
+	// a strided view is reduced without copying it first
+	tensor_view<float,host_memory_space> tv(indices[index_range(1,299)][index_range(0,301,3)], t);
+	float sv = 0.f;
+	for(int i=1;i<299;i++)
+		for(int j=0;j<301;j+=3)
+			sv += t(i,j);
+	BOOST_CHECK_CLOSE(sum(tv), sv, 0.01f);
+
+	// parallel_for may be called from within a parallel_for
+	unsigned int cnt = 0;
+	outer_count outer(&cnt);
+	parallel_for(64, 1, outer);
+	BOOST_CHECK_EQUAL(cnt, 64000u);
+
+	// several client threads share the pool
+	int errors = 0;
+	boost::thread_group clients;
+	for(int i=0;i<4;i++)
+		clients.create_thread(concurrent_sum(&t, s1, &errors));
+	clients.join_all();
+	BOOST_CHECK_EQUAL(errors, 0);
+
+	// thread limits of the calling thread
+	{
+		scoped_host_thread_limit limit(1);
+		BOOST_CHECK_EQUAL(detail::host_thread_limit(0), 1u);
+		BOOST_CHECK_EQUAL(s1, sum(t));
+	}
+	BOOST_CHECK_EQUAL(detail::host_thread_limit(0), 4u);
+	BOOST_CHECK_EQUAL(detail::host_thread_limit(2), 2u);
+
+	set_host_num_threads(old_num_threads);
+	set_host_parallel_threshold(old_threshold);
+}
+
+BOOST_AUTO_TEST_CASE( vec_ops_strided_views )
+{
+	// host operations work in place on views which are not contiguous
+	tensor<float,host_memory_space> a(extents[20][30][40]), b(extents[20][10][40]);
+	sequence(a);
+	sequence(b);
+	tensor_view<float,host_memory_space> v(indices[index_range()][index_range(0,30,3)][index_range()], a);
+	BOOST_CHECK(!v.is_c_contiguous());
+	tensor<float,host_memory_space> ref = v.copy();
+
+	BOOST_CHECK_CLOSE(sum(v), sum(ref), 0.01f);
+	BOOST_CHECK_CLOSE(norm2(v), norm2(ref), 0.01f);
+	BOOST_CHECK_EQUAL(maximum(v), maximum(ref));
+	BOOST_CHECK_EQUAL(arg_max(v), arg_max(ref));
+
+	apply_scalar_functor(v, SF_MULT, 2.f);
+	apply_binary_functor(v, b, BF_ADD);
+	apply_scalar_functor(v, SF_SQRT);
+	tensor<float,host_memory_space> r = v.copy();
+	for(unsigned int i=0;i<r.size();i++){
+		BOOST_CHECK_CLOSE((float)r[i], sqrt(2.f*ref[i] + b[i]), 0.01f);
+	}
+	BOOST_CHECK_EQUAL((float)a(0,1,0), 40.f); // not part of the view
+
+	// the innermost dimension is strided as well
+	tensor_view<float,host_memory_space> u(indices[index_range()][5][index_range(0,40,2)], a);
+	u = 1.f;
+	apply_scalar_functor(u, SF_ADD, 1.f);
+	BOOST_CHECK_EQUAL(sum(u), 2.f*u.size());
+	BOOST_CHECK_EQUAL((float)a(3,5,0), 2.f);
+	BOOST_CHECK_EQUAL((float)a(3,5,1), 3*1200.f+5*40.f+1.f);
+}
+
+BOOST_AUTO_TEST_CASE( vec_ops_host_simd )
+{
+	// compare vectorized host functors with the scalar path, using the error
+	// bounds documented in simd_functors.hpp plus the error of the scalar path
+	host_simd_level old_level = get_host_simd_level();
+	const int n = 10007; // not a multiple of the vector width
+	tensor<float,host_memory_space> x(n), y(n), ref(n), res(n);
+	for(int i=0;i<n;i++){
+		x[i] = -20.f + 40.f * i / (float)n;
+		y[i] = (i % 101) / 101.f;
+	}
+	tensor<float,host_memory_space> px(n);  // positive arguments for log
+	apply_scalar_functor(px, x, SF_ABS);
+	tensor<float,host_memory_space> ux(n);  // arguments in [0,1) for bernoulli_kl
+	for(int i=0;i<n;i++) ux[i] = (i % 97) / 97.f;
+
+	for(int l = HOST_SIMD_SSE2; l <= get_host_simd_support(); l++){
+		// TOL is the maximum of |res-ref|/(1+|ref|), 0 means identical results
+#define CHECK_RESULT(TOL) \
+		for(int i=0;i<n;i++){ \
+			if(TOL == 0.f) BOOST_CHECK_EQUAL((float)res[i], (float)ref[i]); \
+			else           BOOST_CHECK_SMALL(((float)res[i] - (float)ref[i]) / (1.f + fabsf((float)ref[i])), TOL); \
+		}
+#define CHECK_SF(SRC, TOL, ...) \
+		set_host_simd_level(HOST_SIMD_NONE);        apply_scalar_functor(ref, SRC, __VA_ARGS__); \
+		set_host_simd_level((host_simd_level)l);    apply_scalar_functor(res, SRC, __VA_ARGS__); \
+		CHECK_RESULT(TOL)
+#define CHECK_BF(SRC1, SRC2, TOL, ...) \
+		set_host_simd_level(HOST_SIMD_NONE);        apply_binary_functor(ref, SRC1, SRC2, __VA_ARGS__); \
+		set_host_simd_level((host_simd_level)l);    apply_binary_functor(res, SRC1, SRC2, __VA_ARGS__); \
+		CHECK_RESULT(TOL)
+		CHECK_SF(x,  3e-7f, SF_EXP);
+		CHECK_SF(px, 2e-7f, SF_LOG);
+		CHECK_SF(x,  6e-7f, SF_SIGM);
+		CHECK_SF(x,  6e-7f, SF_SIGM, 2.f);
+		CHECK_SF(x,  3e-7f, SF_TANH);
+		CHECK_SF(x,  3e-7f, SF_TANH, 1.5f, 0.3f);
+		CHECK_SF(x,  4e-7f, SF_LOGADDEXP, 0.3f);
+		CHECK_SF(ux, 1e-6f, SF_BERNOULLI_KL, 0.3f);
+		CHECK_SF(x,  0.f,   SF_AXPB, 1.5f, 0.3f);
+		CHECK_SF(x,  0.f,   SF_SQUARE);
+		CHECK_SF(x,  0.f,   SF_MAX, 0.5f);
+		CHECK_SF(x,  0.f,   SF_RDIV, 0.5f);
+		CHECK_BF(x, y,  4e-7f, BF_LOGADDEXP);
+		CHECK_BF(ux, y, 1e-6f, BF_BERNOULLI_KL);
+		CHECK_BF(x, y,  0.f,   BF_ADD);
+		CHECK_BF(x, y,  0.f,   BF_DIV);
+		CHECK_BF(x, y,  0.f,   BF_MIN);
+		CHECK_BF(x, y,  0.f,   BF_AXPBY, 2.f, 3.f);
+#undef CHECK_RESULT
+#undef CHECK_SF
+#undef CHECK_BF
+	}
+
+	// special values
+	set_host_simd_level(get_host_simd_support());
+	tensor<float,host_memory_space> s(4), r(4);
+	s[0] = 0.f; s[1] = -1.f; s[2] = std::numeric_limits<float>::infinity(); s[3] = 100.f;
+	apply_scalar_functor(r, s, SF_LOG);
+	BOOST_CHECK_EQUAL((float)r[0], -std::numeric_limits<float>::infinity());
+	BOOST_CHECK((float)r[1] != (float)r[1]);
+	BOOST_CHECK_EQUAL((float)r[2], std::numeric_limits<float>::infinity());
+	apply_scalar_functor(r, s, SF_EXP);
+	BOOST_CHECK_EQUAL((float)r[0], 1.f);
+	BOOST_CHECK_EQUAL((float)r[2], std::numeric_limits<float>::infinity());
+	BOOST_CHECK_EQUAL((float)r[3], std::numeric_limits<float>::infinity());
+	apply_scalar_functor(r, s, SF_TANH);
+	BOOST_CHECK_EQUAL((float)r[2], 1.f);
+	BOOST_CHECK_EQUAL((float)r[3], 1.f);
+
+	set_host_simd_level(old_level);
+}
+
+template<class M>
+void test_lazy_expressions(){
+	typedef tensor<float,M> T;
+	const int n = 1031;
+	T a(n), b(n), c(n), d(n), e(n);
+	sequence(a); apply_scalar_functor(a, SF_MULT, 0.01f);
+	sequence(b); apply_scalar_functor(b, SF_ADD, 1.f);
+	sequence(c); apply_scalar_functor(c, SF_MULT, -0.5f);
+	fill(d, 2.f);
+	fill(e, 0.5f);
+
+	// fused expression must give the same result as the eager operators
+	T eager = a*b + c*d - e;
+	T fused = lazy(a)*b + lazy(c)*d - e;
+	BOOST_CHECK_EQUAL(fused.size(), (unsigned int)n);
+	T eager2 = 2.f - a/b*3.f + (-c);
+	T fused2 = 2.f - lazy(a)/b*3.f + (-lazy(c));
+	for(int i=0;i<n;i++){
+		BOOST_CHECK_CLOSE((float)fused[i], (float)eager[i], 0.0001f);
+		BOOST_CHECK_CLOSE((float)fused2[i], (float)eager2[i], 0.0001f);
+	}
+
+	// comparisons
+	tensor<unsigned char,M> m = lazy(a) < 5.f;
+	tensor<unsigned char,M> m2 = lazy(a) == a;
+	for(int i=0;i<n;i++){
+		BOOST_CHECK_EQUAL((bool)m[i], (float)a[i] < 5.f);
+		BOOST_CHECK_EQUAL((int)m2[i], 1);
+	}
+
+	// in-place update of exclusively owned memory, the destination may be an operand
+	const float* ptr = fused.ptr();
+	fused = lazy(fused) * 2.f;
+	BOOST_CHECK_EQUAL(fused.ptr(), ptr);
+	for(int i=0;i<n;i++)
+		BOOST_CHECK_CLOSE((float)fused[i], 2.f*(float)eager[i], 0.0001f);
+
+	// shared memory is not overwritten
+	T shared = fused;
+	fused = lazy(a) + 1.f;
+	BOOST_CHECK_NE(fused.ptr(), shared.ptr());
+	BOOST_CHECK_CLOSE((float)shared[3], 2.f*(float)eager[3], 0.0001f);
+
+	// assignment to a view writes to the viewed memory
+	T r(n);
+	fill(r, 7.f);
+	r[indices[index_range(10,20)]] = lazy(a[indices[index_range(0,10)]]) * 2.f;
+	for(int i=0;i<n;i++){
+		if(i>=10 && i<20)
+			BOOST_CHECK_EQUAL((float)r[i], 2.f*(float)a[i-10]);
+		else
+			BOOST_CHECK_EQUAL((float)r[i], 7.f);
+	}
+	BOOST_CHECK_THROW(r[indices[index_range(0,10)]] = lazy(a)*2.f, std::runtime_error);
+
+	// shape mismatch of operands
+	T f(n/2);
+	BOOST_CHECK_THROW(T g = lazy(a) + f, std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE( vec_ops_lazy )
+{
+	test_lazy_expressions<host_memory_space>();
+	test_lazy_expressions<dev_memory_space>();
+}
+
 BOOST_AUTO_TEST_CASE( vec_rprop )
 {
 	tensor<signed char,dev_memory_space> dW_old(N);
@@ -371,5 +721,34 @@ BOOST_AUTO_TEST_CASE( vec_rprop )
 	}
 }
 
+BOOST_AUTO_TEST_CASE( vec_learn_step_weight_decay_momentum )
+{
+	const float lr = 0.1f, mw = 0.9f, l2decay = 0.05f;
+	tensor<float,host_memory_space> h_W(N), h_M(N), h_dW(N);
+	for(int i=0;i<N;i++){
+		h_W[i]  = i / (float)N - 0.5f;
+		h_M[i]  = 0.5f - (i % 7) / 7.f;
+		h_dW[i] = (i % 5) - 2.f;
+	}
+	tensor<float,dev_memory_space> W(h_W), M(h_M), dW(h_dW);
+
+	// the l2 decay term pulls W towards zero
+	tensor<float,host_memory_space> expected_W(N), expected_M(N);
+	for(int i=0;i<N;i++){
+		expected_M[i] = mw * h_M[i] - lr * (h_dW[i] + l2decay * h_W[i]);
+		expected_W[i] = h_W[i] + expected_M[i];
+	}
+
+	learn_step_weight_decay_momentum(h_W, h_M, h_dW, lr, mw, l2decay);
+	learn_step_weight_decay_momentum(W, M, dW, lr, mw, l2decay);
+
+	for(int i=0;i<N;i++){
+		BOOST_CHECK_SMALL((float)h_M[i] - (float)expected_M[i], 1e-5f);
+		BOOST_CHECK_SMALL((float)h_W[i] - (float)expected_W[i], 1e-5f);
+		BOOST_CHECK_SMALL((float)M[i]   - (float)expected_M[i], 1e-5f);
+		BOOST_CHECK_SMALL((float)W[i]   - (float)expected_W[i], 1e-5f);
+	}
+}
+
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -38,6 +38,8 @@
 #include <cuv/tools/cuv_general.hpp>
 #include <cuv/tensor_ops/tensor_ops.hpp>
 #include <cuv/tools/timing.hpp>
+#include <cuv/tools/thread_pool.hpp>
+#include <cuv/tensor_ops/simd_functors.hpp>
 #include <cuv/random/random.hpp>
 #include <cuv/tensor_ops/rprop.hpp>
 
@@ -85,6 +87,26 @@ struct Fix{
 };
 
 
+/// @name metadata-only operations, each repeated META_OPS times
+/// @{
+static const int META_OPS = 10000;
+typedef tensor<float,host_memory_space> host_tensor;
+typedef tensor_view<float,host_memory_space> host_view;
+static unsigned int meta_sink;
+void meta_copy(const host_tensor& v){
+	for(int i=0;i<META_OPS;i++){ host_tensor t(v); meta_sink += t.ndim(); }
+}
+void meta_view(const host_tensor& v){
+	for(int i=0;i<META_OPS;i++){ host_view t = v[indices[index_range(0,100)]]; meta_sink += t.ndim(); }
+}
+void meta_wrap(host_tensor& v){
+	for(int i=0;i<META_OPS;i++){ host_tensor t(extents[100], v.ptr(), v.m_allocator); meta_sink += t.ndim(); }
+}
+void meta_shape(const host_tensor& v, const host_tensor& w){
+	for(int i=0;i<META_OPS;i++){ meta_sink += v.shape()[0] + (v.shape() == w.shape()) + equal_shape(v,w); }
+}
+/// @}
+
 BOOST_FIXTURE_TEST_SUITE( s, Fix )
 
 
@@ -144,6 +166,74 @@ BOOST_AUTO_TEST_CASE( vec_add )
 }
 
 
+BOOST_AUTO_TEST_CASE( vec_host_threads )
+{
+	sequence(v_host);
+	sequence(w_host);
+	unsigned int old_num_threads = get_host_num_threads();
+	set_host_num_threads(1);
+	MEASURE_TIME(exp_1,  apply_scalar_functor(v_host, SF_EXP), 100);
+	MEASURE_TIME(add_1,  apply_binary_functor(v_host,w_host, BF_ADD), 100);
+	set_host_num_threads(0);
+	printf("Using %d host threads\n", get_host_num_threads());
+	MEASURE_TIME(exp_n,  apply_scalar_functor(v_host, SF_EXP), 100);
+	MEASURE_TIME(add_n,  apply_binary_functor(v_host,w_host, BF_ADD), 100);
+	printf("Speedup exp: %3.4f\n", exp_1/exp_n);
+	printf("Speedup add: %3.4f\n", add_1/add_n);
+	set_host_num_threads(old_num_threads);
+}
+
+
+BOOST_AUTO_TEST_CASE( vec_host_simd )
+{
+	sequence(v_host);
+	apply_scalar_functor(v_host, SF_MULT, 10.f / n);
+	unsigned int old_num_threads = get_host_num_threads();
+	host_simd_level old_level = get_host_simd_level();
+	set_host_num_threads(1);
+	ScalarFunctor sf[] = {SF_EXP, SF_LOG, SF_SIGM, SF_TANH};
+	const char* names[] = {"exp", "log", "sigm", "tanh"};
+	for(int f=0;f<4;f++){
+		printf("%s:\n", names[f]);
+		set_host_simd_level(HOST_SIMD_NONE);
+		MEASURE_TIME(scalar, apply_scalar_functor(w_host, v_host, sf[f]), 20);
+		for(int l = HOST_SIMD_SSE2; l <= get_host_simd_support(); l++){
+			set_host_simd_level((host_simd_level)l);
+			MEASURE_TIME(simd, apply_scalar_functor(w_host, v_host, sf[f]), 20);
+			printf("Speedup level %d: %3.4f\n", l, scalar/simd);
+		}
+	}
+	set_host_simd_level(old_level);
+	set_host_num_threads(old_num_threads);
+}
+
+BOOST_AUTO_TEST_CASE( vec_lazy )
+{
+	// r = v*w + x*y - z: the eager operators allocate four temporaries and
+	// sweep over memory five times, the fused expression once.
+	tensor<float,host_memory_space> x_host(n), y_host(n), z_host(n), r_host(n);
+	tensor<float,dev_memory_space>  x_dev(n),  y_dev(n),  z_dev(n),  r_dev(n);
+	fill_rnd_uniform(v_host); fill_rnd_uniform(w_host); fill_rnd_uniform(x_host); fill_rnd_uniform(y_host); fill_rnd_uniform(z_host);
+	fill_rnd_uniform(v_dev);  fill_rnd_uniform(w_dev);  fill_rnd_uniform(x_dev);  fill_rnd_uniform(y_dev);  fill_rnd_uniform(z_dev);
+	MEASURE_TIME(eager_host, r_host = v_host*w_host + x_host*y_host - z_host, 20);
+	MEASURE_TIME(lazy_host,  r_host = lazy(v_host)*w_host + lazy(x_host)*y_host - z_host, 20);
+	printf("Speedup host: %3.4f\n", eager_host/lazy_host);
+	MEASURE_TIME(eager_dev, r_dev = v_dev*w_dev + x_dev*y_dev - z_dev, 20);
+	MEASURE_TIME(lazy_dev,  r_dev = lazy(v_dev)*w_dev + lazy(x_dev)*y_dev - z_dev, 20);
+	printf("Speedup dev: %3.4f\n", eager_dev/lazy_dev);
+}
+
+BOOST_AUTO_TEST_CASE( tensor_metadata )
+{
+	// construction of views and temporaries should not touch the heap
+	MEASURE_TIME(copy,  meta_copy(v_host), 10);
+	MEASURE_TIME(view,  meta_view(v_host), 10);
+	MEASURE_TIME(wrap,  meta_wrap(v_host), 10);
+	MEASURE_TIME(shape, meta_shape(v_host,w_host), 10);
+	printf("ns/op: copy %3.2f, view %3.2f, wrap %3.2f, shape queries %3.2f\n",
+			1000.f*copy/META_OPS, 1000.f*view/META_OPS, 1000.f*wrap/META_OPS, 1000.f*shape/META_OPS);
+}
+
 BOOST_AUTO_TEST_CASE( vec_rprop )
 {
 	tensor<signed char,dev_memory_space> dW_old(n);
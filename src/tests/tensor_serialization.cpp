@@ -36,6 +36,8 @@
 #include <cuv/tools/cuv_general.hpp>
 #include <cuv/basics/tensor.hpp>
 #include <cuv/basics/io.hpp>
+#include <cuv/basics/tensor_file.hpp>
+#include <cuv/tensor_ops/tensor_ops.hpp>
 using namespace cuv;
 
 struct MyConfig {
@@ -123,4 +125,135 @@ BOOST_AUTO_TEST_CASE( empty_save_test ) {
 	empty_save<tensor<float,dev_memory_space> >();
 }
 
+template<class T>
+void tensor_file_save()
+{
+	typedef typename T::memory_layout_type L;
+	T m(extents[2][3][4]);
+	for (unsigned int i = 0; i < m.size(); ++i)
+		m[i] = i;
+	save_tensor_file("test.cuvt", m);
+
+	// map without copying
+	tensor<float,host_memory_space,L> h = open_tensor_file<float,L>("test.cuvt");
+	BOOST_REQUIRE(cuv::equal_shape(m,h));
+	BOOST_CHECK_EQUAL((size_t)h.ptr() % 64, 0);
+	for (unsigned int i = 0; i < m.size(); ++i)
+		BOOST_CHECK_EQUAL(m[i], h[i]);
+
+	// copy into a tensor of the same type
+	T n;
+	load_tensor_file(n, "test.cuvt");
+	BOOST_REQUIRE(cuv::equal_shape(m,n));
+	for (unsigned int i = 0; i < m.size(); ++i)
+		BOOST_CHECK_EQUAL(m[i], n[i]);
+
+	// a tensor of the right shape is not reallocated
+	T o(extents[2][3][4]);
+	const float* p = o.ptr();
+	load_tensor_file(o, "test.cuvt");
+	BOOST_CHECK_EQUAL(o.ptr(), p);
+	for (unsigned int i = 0; i < m.size(); ++i)
+		BOOST_CHECK_EQUAL(m[i], o[i]);
+
+	// a tensor with the same number of dimensions but a different shape is resized
+	T q(extents[4][3][2]);
+	load_tensor_file(q, "test.cuvt");
+	BOOST_REQUIRE(cuv::equal_shape(m,q));
+	for (unsigned int i = 0; i < m.size(); ++i)
+		BOOST_CHECK_EQUAL(m[i], q[i]);
+}
+
+BOOST_AUTO_TEST_CASE( tensor_file_save_test ) {
+	tensor_file_save<tensor<float,host_memory_space> >();
+	tensor_file_save<tensor<float,dev_memory_space> >();
+	tensor_file_save<tensor<float,host_memory_space,column_major> >();
+	tensor_file_save<tensor<float,dev_memory_space,column_major> >();
+}
+
+BOOST_AUTO_TEST_CASE( tensor_file_strided ) {
+	tensor<float,host_memory_space> m(extents[4][5]);
+	for (unsigned int i = 0; i < m.size(); ++i)
+		m[i] = i;
+	tensor_view<float,host_memory_space> v(indices[index_range(0,4)][index_range(1,3)], m);
+	BOOST_REQUIRE(!v.is_c_contiguous());
+	save_tensor_file("test.cuvt", v);
+
+	tensor<float,host_memory_space> h = open_tensor_file<float>("test.cuvt");
+	BOOST_REQUIRE(cuv::equal_shape(v,h));
+	for (int i = 0; i < 4; ++i)
+		for (int j = 0; j < 2; ++j)
+			BOOST_CHECK_EQUAL(h(i,j), m(i,j+1));
+}
+
+BOOST_AUTO_TEST_CASE( tensor_file_modes ) {
+	tensor<float,host_memory_space> m(extents[3][7]);
+	fill(m, 1.f);
+	save_tensor_file("test.cuvt", m);
+
+	// changes to a private mapping do not reach the file
+	{
+		tensor<float,host_memory_space> h = open_tensor_file<float>("test.cuvt", TF_COPY_ON_WRITE);
+		h(1,1) = 5.f;
+	}
+	BOOST_CHECK_EQUAL(open_tensor_file<float>("test.cuvt")(1,1), 1.f);
+
+	// changes to a shared writable mapping do
+	{
+		tensor<float,host_memory_space> h = open_tensor_file<float>("test.cuvt", TF_READ_WRITE);
+		h(1,1) = 5.f;
+	}
+	BOOST_CHECK_EQUAL(open_tensor_file<float>("test.cuvt")(1,1), 5.f);
+
+	// the mapping outlives the tensor it was opened with
+	tensor<float,host_memory_space> view;
+	{
+		tensor<float,host_memory_space> h = open_tensor_file<float>("test.cuvt");
+		view = h;
+	}
+	BOOST_CHECK_EQUAL(view(2,6), 1.f);
+}
+
+BOOST_AUTO_TEST_CASE( tensor_file_streaming ) {
+	tensor<float,dev_memory_space> chunk(extents[2][5]);
+	{
+		tensor_file_writer<float> out("test.cuvt", extents[6][5]);
+		for (int c = 0; c < 3; ++c) {
+			fill(chunk, (float) c);
+			out.write(chunk);
+		}
+		BOOST_CHECK_EQUAL(out.remaining_bytes(), 0);
+		BOOST_CHECK_THROW(out.write(chunk), std::runtime_error);
+		out.close();
+	}
+	tensor<float,host_memory_space> h = open_tensor_file<float>("test.cuvt");
+	BOOST_REQUIRE_EQUAL(h.shape(0), 6);
+	BOOST_REQUIRE_EQUAL(h.shape(1), 5);
+	for (int i = 0; i < 6; ++i)
+		for (int j = 0; j < 5; ++j)
+			BOOST_CHECK_EQUAL(h(i,j), (float) (i / 2));
+
+	// files which were not written completely cannot be closed
+	tensor_file_writer<float> out("test.cuvt", extents[6][5]);
+	out.write(chunk);
+	BOOST_CHECK_THROW(out.close(), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE( tensor_file_errors ) {
+	tensor<float,host_memory_space> m(extents[2][3]);
+	fill(m, 0.f);
+	save_tensor_file("test.cuvt", m);
+	BOOST_CHECK_THROW(open_tensor_file<int>("test.cuvt"), std::runtime_error);
+	BOOST_CHECK_THROW((open_tensor_file<float,column_major>("test.cuvt")), std::runtime_error);
+
+	// a boost::serialization archive is not a tensor file
+	{
+		std::ofstream os("test.dat");
+		boost::archive::binary_oarchive oa(os);
+		oa << m;
+	}
+	BOOST_CHECK_THROW(open_tensor_file<float>("test.dat"), std::runtime_error);
+	BOOST_CHECK_THROW(open_tensor_file<float>("does_not_exist.cuvt"), std::runtime_error);
+}
+
 BOOST_AUTO_TEST_SUITE_END()